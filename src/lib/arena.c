@@ -0,0 +1,178 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+#include "constants.h"
+#include "debug.h"
+
+/** Alignment of all allocations */
+#define ARENA_ALIGN 16
+
+/** Size of a chunk header (aligned) */
+#define ARENA_HEADER_SIZE                                                      \
+  ((sizeof(arena_chunk_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static size_t arena_round(size_t size, size_t align)
+{
+  return (size + align - 1) & ~(align - 1);
+}
+
+/* Map a new chunk, aligned to the huge page size if huge pages are used
+   (the size is updated to the mapped size) */
+static arena_chunk_t *arena_map_chunk(arena_t *arena, size_t *chunk_size)
+{
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+  if (!arena->huge) {
+    void *mem = mmap(NULL, *chunk_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    return mem == MAP_FAILED ? NULL : (arena_chunk_t *)mem;
+  }
+
+  /* Map an additional huge page and trim the unaligned head and tail */
+  size_t size = arena_round(*chunk_size, ARENA_HUGE_PAGE_SIZE);
+  size_t map_size = size + ARENA_HUGE_PAGE_SIZE;
+  uint8_t *mem = mmap(NULL, map_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (mem == MAP_FAILED) {
+    return NULL;
+  }
+  uint8_t *start = (uint8_t *)arena_round((uintptr_t)mem,
+                                          ARENA_HUGE_PAGE_SIZE);
+  if (start > mem) {
+    munmap(mem, start - mem);
+  }
+  if (start + size < mem + map_size) {
+    munmap(start + size, mem + map_size - (start + size));
+  }
+#ifdef MADV_HUGEPAGE
+  if (madvise(start, size, MADV_HUGEPAGE) != 0) {
+    debug_print("%s", "Warning: Transparent huge pages not available\n");
+  }
+#endif
+  *chunk_size = size;
+  return (arena_chunk_t *)start;
+}
+
+void arena_init(arena_t *arena, size_t chunk_size, int huge)
+{
+  memset(arena, 0, sizeof(arena_t));
+  arena->chunk_size = chunk_size ? chunk_size : ARENA_CHUNK_SIZE;
+  arena->huge = huge;
+  pthread_mutex_init(&arena->lock, NULL);
+}
+
+/* Allocate memory from an arena (the lock is held by the caller) */
+static void *arena_alloc_locked(arena_t *arena, size_t size)
+{
+  size = arena_round(size ? size : 1, ARENA_ALIGN);
+  arena_chunk_t *chunk = arena->head;
+
+  /* Map a new chunk if the current one is full */
+  if (chunk == NULL || chunk->size - chunk->used < size) {
+    size_t chunk_size = arena->chunk_size;
+    if (size + ARENA_HEADER_SIZE > chunk_size) {
+      chunk_size = size + ARENA_HEADER_SIZE;
+    }
+    if ((chunk = arena_map_chunk(arena, &chunk_size)) == NULL) {
+      std_print("%s", "Error: Could not map memory for the arena\n");
+      return NULL;
+    }
+    chunk->next = arena->head;
+    chunk->size = chunk_size;
+    chunk->used = ARENA_HEADER_SIZE;
+    arena->head = chunk;
+  }
+
+  void *ptr = (uint8_t *)chunk + chunk->used;
+  chunk->used += size;
+  arena->allocated += size;
+  arena->last = ptr;
+  return ptr;
+}
+
+void *arena_alloc(arena_t *arena, size_t size)
+{
+  pthread_mutex_lock(&arena->lock);
+  void *ptr = arena_alloc_locked(arena, size);
+  pthread_mutex_unlock(&arena->lock);
+  return ptr;
+}
+
+void *arena_realloc(arena_t *arena, void *ptr, size_t old_size, size_t size)
+{
+  if (ptr == NULL) {
+    return arena_alloc(arena, size);
+  }
+
+  /* Grow or shrink the last allocation in place if the chunk has room */
+  pthread_mutex_lock(&arena->lock);
+  arena_chunk_t *chunk = arena->head;
+  size_t old = arena_round(old_size ? old_size : 1, ARENA_ALIGN);
+  size_t new = arena_round(size ? size : 1, ARENA_ALIGN);
+  if (ptr == arena->last && chunk->size - chunk->used + old >= new) {
+    chunk->used = chunk->used - old + new;
+    arena->allocated = arena->allocated - old + new;
+    pthread_mutex_unlock(&arena->lock);
+    return ptr;
+  }
+
+  /* Otherwise copy the allocation (the old memory is released on reset) */
+  void *mem = arena_alloc_locked(arena, size);
+  pthread_mutex_unlock(&arena->lock);
+  if (mem != NULL) {
+    memcpy(mem, ptr, old_size < size ? old_size : size);
+  }
+  return mem;
+}
+
+void arena_reset(arena_t *arena)
+{
+  arena_chunk_t *chunk = arena->head;
+  while (chunk != NULL) {
+    arena_chunk_t *next = chunk->next;
+    munmap(chunk, chunk->size);
+    chunk = next;
+  }
+  arena->head = NULL;
+  arena->last = NULL;
+  arena->allocated = 0;
+}
+
+size_t arena_memory_usage(arena_t *arena)
+{
+  size_t usage = 0;
+  for (arena_chunk_t *chunk = arena->head; chunk != NULL; chunk = chunk->next) {
+    usage += chunk->size;
+  }
+  return usage;
+}
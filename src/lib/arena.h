@@ -0,0 +1,142 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** A chunk of an arena (header of a single memory mapping) */
+typedef struct struct_arena_chunk_t {
+
+  /** Next chunk
+   *
+   * Previously mapped chunk of the arena
+   */
+  struct struct_arena_chunk_t *next;
+
+  /** Chunk size
+   *
+   * Size of the mapping in bytes (including the header)
+   */
+  size_t size;
+
+  /** Used size
+   *
+   * Allocated bytes of the chunk (including the header)
+   */
+  size_t used;
+
+} arena_chunk_t;
+
+/** A bump allocator backed by anonymous memory mappings */
+typedef struct struct_arena_t {
+
+  /** Current chunk
+   *
+   * Chunk all allocations are served from (list of all chunks)
+   */
+  arena_chunk_t *head;
+
+  /** Chunk size
+   *
+   * Default size of a new chunk in bytes (reserved, not committed)
+   */
+  size_t chunk_size;
+
+  /** Huge page flag
+   *
+   * Back the chunks with transparent huge pages (0 = off, 1 = on)
+   */
+  int huge;
+
+  /** Last allocation
+   *
+   * Last allocation of the arena (can be resized in place)
+   */
+  void *last;
+
+  /** Allocated size
+   *
+   * Sum of all allocations in bytes
+   */
+  size_t allocated;
+
+  /** Lock
+   *
+   * Lock of the arena (tables may be built concurrently)
+   */
+  pthread_mutex_t lock;
+
+} arena_t;
+
+/** Initialize an empty arena (no memory is mapped until the first allocation)
+ *
+ * @param[out] arena         Pointer to the arena
+ * @param[in]  chunk_size    Size of a chunk (0 for the default size)
+ * @param[in]  huge          Use transparent huge pages (0 = off, 1 = on)
+ */
+void arena_init(arena_t *arena, size_t chunk_size, int huge);
+
+/** Allocate memory from an arena (aligned to ARENA_ALIGN bytes)
+ *
+ * @param[in] arena          Pointer to the arena
+ * @param[in] size           Size of the allocation in bytes
+ * @return                   Pointer to the memory, NULL on failure
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/** Resize an allocation of an arena (in place for the last allocation)
+ *
+ * @param[in] arena          Pointer to the arena
+ * @param[in] ptr            Allocation which will be resized (or NULL)
+ * @param[in] old_size       Current size of the allocation in bytes
+ * @param[in] size           New size of the allocation in bytes
+ * @return                   Pointer to the memory, NULL on failure
+ */
+void *arena_realloc(arena_t *arena, void *ptr, size_t old_size, size_t size);
+
+/** Release all allocations of an arena at once (one unmap per chunk)
+ *
+ * @param[in] arena          Pointer to the arena
+ */
+void arena_reset(arena_t *arena);
+
+/** Memory mapped by an arena
+ *
+ * @param[in] arena          Pointer to the arena
+ * @return                   Mapped memory in bytes
+ */
+size_t arena_memory_usage(arena_t *arena);
+
+/** @} */
+
+#endif /* __ARENA_H */
@@ -0,0 +1,367 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "debug.h"
+
+/** All available backends (the first one is the default backend) */
+static const backend_ops_t *backends[] = {&backend_rtr_ops, &backend_array_ops};
+
+const backend_ops_t *backend_get(const char *name)
+{
+  if (name == NULL || !strlen(name)) {
+    return backends[0];
+  }
+  for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+    if (!strcmp(backends[i]->name, name)) {
+      return backends[i];
+    }
+  }
+  return NULL;
+}
+
+int backend_table_init(backend_table_t *tbl, const backend_ops_t *ops,
+                       const backend_ops_t *ref_ops, arena_t *arena)
+{
+  memset(tbl, 0, sizeof(backend_table_t));
+  tbl->ops = ops;
+  tbl->arena = arena;
+  if ((tbl->table = ops->build(NULL, arena)) == NULL) {
+    return -1;
+  }
+
+  /* Differential mode: every record is also added to the reference backend */
+  if (ref_ops != NULL) {
+    tbl->ref_ops = ref_ops;
+    if ((tbl->ref_table = ref_ops->build(NULL, arena)) == NULL) {
+      ops->destroy(tbl->table);
+      tbl->table = NULL;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void backend_table_free(backend_table_t *tbl)
+{
+  if (tbl == NULL || tbl->ops == NULL) {
+    return;
+  }
+  if (tbl->table != NULL) {
+    tbl->ops->destroy(tbl->table);
+  }
+  if (tbl->ref_table != NULL) {
+    tbl->ref_ops->destroy(tbl->ref_table);
+  }
+  roa_set_free(&tbl->records);
+  memset(&tbl->records, 0, sizeof(roa_set_t));
+  tbl->table = NULL;
+  tbl->ref_table = NULL;
+}
+
+int backend_table_clear(backend_table_t *tbl)
+{
+  /* Rebuild empty tables, the differential counters are kept */
+  size_t lookups = tbl->lookups, mismatches = tbl->mismatches;
+  const backend_ops_t *ops = tbl->base_ops ? tbl->base_ops : tbl->ops;
+  const backend_ops_t *ref_ops = tbl->ref_ops;
+  arena_t *arena = tbl->arena;
+  backend_table_free(tbl);
+  if (backend_table_init(tbl, ops, ref_ops, arena) != 0) {
+    return -1;
+  }
+  tbl->lookups = lookups;
+  tbl->mismatches = mismatches;
+  return 0;
+}
+
+int backend_table_add(backend_table_t *tbl, const roa_record_t *record)
+{
+  if (tbl->ops->add(tbl->table, record) != 0) {
+    return -1;
+  }
+  if (tbl->ref_table != NULL && tbl->ref_ops->add(tbl->ref_table, record)) {
+    return -1;
+  }
+  return 0;
+}
+
+int backend_table_remove(backend_table_t *tbl, const roa_record_t *record)
+{
+  if (tbl->ops->remove(tbl->table, record) != 0) {
+    return -1;
+  }
+  if (tbl->ref_table != NULL && tbl->ref_ops->remove(tbl->ref_table, record)) {
+    return -1;
+  }
+  return 0;
+}
+
+int backend_table_add_set(backend_table_t *tbl, const roa_set_t *set)
+{
+  for (size_t i = 0; i < set->count; i++) {
+    if (backend_table_add(tbl, &set->records[i]) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int backend_table_update(backend_table_t *tbl, roa_set_t *set, size_t *added,
+                         size_t *removed)
+{
+  roa_set_t add, del;
+  if (roa_set_init(&add) != 0) {
+    return -1;
+  }
+  if (roa_set_init(&del) != 0) {
+    roa_set_free(&add);
+    return -1;
+  }
+
+  /* Apply the difference to the previous records (removals first) */
+  int ret = roa_set_diff(&tbl->records, set, &add, &del);
+  for (size_t i = 0; !ret && i < del.count; i++) {
+    ret = backend_table_remove(tbl, &del.records[i]);
+  }
+  if (!ret) {
+    ret = backend_table_add_set(tbl, &add);
+  }
+  if (!ret) {
+    if (added != NULL) {
+      *added = add.count;
+    }
+    if (removed != NULL) {
+      *removed = del.count;
+    }
+    roa_set_free(&tbl->records);
+    tbl->records = *set;
+    memset(set, 0, sizeof(roa_set_t));
+  }
+  roa_set_free(&add);
+  roa_set_free(&del);
+  return ret ? -1 : 0;
+}
+
+int backend_table_build_partitioned(backend_table_t *tbl, const roa_set_t *sets,
+                                    size_t count, int threads)
+{
+  /* Build the partitions and the reference table before publishing them */
+  const backend_ops_t *ops = tbl->base_ops ? tbl->base_ops : tbl->ops;
+  void *table = backend_part_create(ops, sets, count, tbl->arena, threads);
+  if (table == NULL) {
+    return -1;
+  }
+  void *ref_table = NULL;
+  if (tbl->ref_ops != NULL) {
+    if ((ref_table = tbl->ref_ops->build(NULL, tbl->arena)) == NULL) {
+      backend_part_ops.destroy(table);
+      return -1;
+    }
+    for (size_t s = 0; s < count; s++) {
+      for (size_t i = 0; i < sets[s].count; i++) {
+        if (tbl->ref_ops->add(ref_table, &sets[s].records[i]) != 0) {
+          tbl->ref_ops->destroy(ref_table);
+          backend_part_ops.destroy(table);
+          return -1;
+        }
+      }
+    }
+  }
+
+  /* Publish the partitioned table */
+  if (tbl->table != NULL) {
+    tbl->ops->destroy(tbl->table);
+  }
+  if (tbl->ref_table != NULL) {
+    tbl->ref_ops->destroy(tbl->ref_table);
+  }
+  tbl->base_ops = ops;
+  tbl->ops = &backend_part_ops;
+  tbl->table = table;
+  tbl->ref_table = ref_table;
+  return 0;
+}
+
+/* Order reasons by prefix, lengths and ASN */
+static int backend_reason_cmp(const void *a, const void *b)
+{
+  const struct pfx_record *ra = (const struct pfx_record *)a;
+  const struct pfx_record *rb = (const struct pfx_record *)b;
+  roa_record_t ka, kb;
+  roa_record_from_addr(ra->asn, &ra->prefix, ra->min_len, ra->max_len, &ka);
+  roa_record_from_addr(rb->asn, &rb->prefix, rb->min_len, rb->max_len, &kb);
+  if (ka.family != kb.family) {
+    return ka.family < kb.family ? -1 : 1;
+  }
+  int ret = memcmp(ka.addr, kb.addr, sizeof(ka.addr));
+  if (ret != 0) {
+    return ret;
+  }
+  if (ka.min_len != kb.min_len) {
+    return ka.min_len < kb.min_len ? -1 : 1;
+  }
+  if (ka.max_len != kb.max_len) {
+    return ka.max_len < kb.max_len ? -1 : 1;
+  }
+  return ka.asn == kb.asn ? 0 : (ka.asn < kb.asn ? -1 : 1);
+}
+
+/* Whether two reason lists contain the same records (in any order) */
+static int backend_reasons_equal(struct pfx_record *a, unsigned int a_len,
+                                 struct pfx_record *b, unsigned int b_len)
+{
+  if (a_len != b_len) {
+    return 0;
+  }
+  if (!a_len) {
+    return 1;
+  }
+  qsort(a, a_len, sizeof(struct pfx_record), backend_reason_cmp);
+  qsort(b, b_len, sizeof(struct pfx_record), backend_reason_cmp);
+  for (unsigned int i = 0; i < a_len; i++) {
+    if (backend_reason_cmp(&a[i], &b[i]) != 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static const char *backend_state_str(enum pfxv_state state)
+{
+  switch (state) {
+  case BGP_PFXV_STATE_VALID: return "valid";
+  case BGP_PFXV_STATE_INVALID: return "invalid";
+  case BGP_PFXV_STATE_NOT_FOUND: return "notfound";
+  default: return "unknown";
+  }
+}
+
+/* Report a lookup which differs between the backend and the reference */
+static void backend_report_mismatch(backend_table_t *tbl, uint32_t asn,
+                                    const struct lrtr_ip_addr *prefix,
+                                    uint8_t mask_len, enum pfxv_state result,
+                                    enum pfxv_state ref_result)
+{
+  char addr[INET6_ADDRSTRLEN] = {0};
+  lrtr_ip_addr_to_str(prefix, addr, sizeof(addr));
+  tbl->mismatches++;
+  std_print("Warning: Backend mismatch for AS%" PRIu32 " %s/%" PRIu8
+            " (%s: %s, %s: %s)\n", asn, addr, mask_len, tbl->ops->name,
+            backend_state_str(result), tbl->ref_ops->name,
+            backend_state_str(ref_result));
+}
+
+int backend_table_lookup(backend_table_t *tbl, uint32_t asn,
+                         const struct lrtr_ip_addr *prefix, uint8_t mask_len,
+                         enum pfxv_state *result)
+{
+  if (tbl->ops->lookup(tbl->table, asn, prefix, mask_len, result) != 0) {
+    return -1;
+  }
+
+  /* Differential mode: compare the result with the reference backend */
+  if (tbl->ref_table != NULL) {
+    enum pfxv_state ref_result;
+    if (tbl->ref_ops->lookup(tbl->ref_table, asn, prefix, mask_len,
+                             &ref_result) != 0) {
+      return -1;
+    }
+    tbl->lookups++;
+    if (*result != ref_result) {
+      backend_report_mismatch(tbl, asn, prefix, mask_len, *result, ref_result);
+    }
+  }
+  return 0;
+}
+
+int backend_table_lookup_with_reasons(backend_table_t *tbl, uint32_t asn,
+                                      const struct lrtr_ip_addr *prefix,
+                                      uint8_t mask_len,
+                                      struct pfx_record **reason,
+                                      unsigned int *reason_len,
+                                      enum pfxv_state *result)
+{
+  if (tbl->ops->lookup_with_reasons(tbl->table, asn, prefix, mask_len, reason,
+                                    reason_len, result) != 0) {
+    return -1;
+  }
+
+  /* Differential mode: compare the result and all reasons with the reference
+     backend (the reasons are sorted for the comparison) */
+  if (tbl->ref_table != NULL) {
+    enum pfxv_state ref_result;
+    struct pfx_record *ref_reason = NULL;
+    unsigned int ref_reason_len = 0;
+    if (tbl->ref_ops->lookup_with_reasons(tbl->ref_table, asn, prefix,
+                                          mask_len, &ref_reason,
+                                          &ref_reason_len, &ref_result) != 0) {
+      free(*reason);
+      *reason = NULL;
+      *reason_len = 0;
+      return -1;
+    }
+    tbl->lookups++;
+    if (*result != ref_result ||
+        !backend_reasons_equal(*reason, *reason_len, ref_reason,
+                               ref_reason_len)) {
+      backend_report_mismatch(tbl, asn, prefix, mask_len, *result, ref_result);
+    }
+    free(ref_reason);
+  }
+  return 0;
+}
+
+void backend_table_freeze(backend_table_t *tbl)
+{
+  if (tbl->table != NULL && tbl->ops->freeze != NULL) {
+    tbl->ops->freeze(tbl->table);
+  }
+  if (tbl->ref_table != NULL && tbl->ref_ops->freeze != NULL) {
+    tbl->ref_ops->freeze(tbl->ref_table);
+  }
+}
+
+size_t backend_table_memory_usage(backend_table_t *tbl)
+{
+  size_t size = 0;
+  if (tbl->table != NULL) {
+    size += tbl->ops->memory_usage(tbl->table);
+  }
+  if (tbl->ref_table != NULL) {
+    size += tbl->ref_ops->memory_usage(tbl->ref_table);
+  }
+  return size;
+}
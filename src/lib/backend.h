@@ -0,0 +1,363 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __BACKEND_H
+#define __BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "roa_index.h"
+#include "roa_set.h"
+#include "rtrlib/rtrlib.h"
+
+/** Operations of a prefix table backend */
+typedef struct struct_backend_ops_t {
+
+  /** Backend name
+   *
+   * Name of the backend (e.g. for the backend option)
+   */
+  const char *name;
+
+  /** Build a prefix table from a ROA set (NULL for an empty table), the table
+      is allocated from the arena if the backend supports it */
+  void *(*build)(const roa_set_t *set, arena_t *arena);
+
+  /** Add a single ROA record to a prefix table */
+  int (*add)(void *table, const roa_record_t *record);
+
+  /** Remove a single ROA record from a prefix table (-1 if it is missing) */
+  int (*remove)(void *table, const roa_record_t *record);
+
+  /** Validate a prefix and origin ASN against a prefix table */
+  int (*lookup)(void *table, uint32_t asn, const struct lrtr_ip_addr *prefix,
+                uint8_t mask_len, enum pfxv_state *result);
+
+  /** Validate a prefix and origin ASN and return all matching records */
+  int (*lookup_with_reasons)(void *table, uint32_t asn,
+                             const struct lrtr_ip_addr *prefix,
+                             uint8_t mask_len, struct pfx_record **reason,
+                             unsigned int *reason_len, enum pfxv_state *result);
+
+  /** Destroy a prefix table */
+  void (*destroy)(void *table);
+
+  /** Memory used by a prefix table in bytes */
+  size_t (*memory_usage)(void *table);
+
+  /** Finish a prefix table before it is read concurrently (e.g. sort lazily
+      sorted records), lookups never modify a frozen table and records can
+      not be added or removed anymore (NULL if lookups are always read-only) */
+  void (*freeze)(void *table);
+
+} backend_ops_t;
+
+/** A prefix table of a backend */
+typedef struct struct_backend_table_t {
+
+  /** Backend operations
+   *
+   * Operations of the backend holding the prefix table
+   */
+  const backend_ops_t *ops;
+
+  /** Base backend operations
+   *
+   * Backend of the partitions if the table is partitioned, otherwise NULL
+   */
+  const backend_ops_t *base_ops;
+
+  /** Backend table
+   *
+   * Backend specific prefix table
+   */
+  void *table;
+
+  /** Reference backend operations
+   *
+   * Operations of the reference backend (differential mode, otherwise NULL)
+   */
+  const backend_ops_t *ref_ops;
+
+  /** Reference backend table
+   *
+   * Prefix table of the reference backend (differential mode)
+   */
+  void *ref_table;
+
+  /** Arena
+   *
+   * Arena the tables are allocated from (NULL for the heap)
+   */
+  arena_t *arena;
+
+  /** Lookup count
+   *
+   * Number of lookups checked against the reference backend
+   */
+  size_t lookups;
+
+  /** Mismatch count
+   *
+   * Number of lookups with a different result of the reference backend
+   */
+  size_t mismatches;
+
+  /** Records
+   *
+   * Canonical ROA set of all records of the table (delta mode)
+   */
+  roa_set_t records;
+
+} backend_table_t;
+
+/** RTRlib backend (reference backend) */
+extern const backend_ops_t backend_rtr_ops;
+
+/** Sorted array backend */
+extern const backend_ops_t backend_array_ops;
+
+/** Partitioned backend (partitions of another backend) */
+extern const backend_ops_t backend_part_ops;
+
+/** Temporal ROA index backend (read-only view of an index) */
+extern const backend_ops_t backend_index_ops;
+
+/** Shared backend (read-only view of a prefix table of the registry) */
+extern const backend_ops_t backend_shared_ops;
+
+struct struct_registry_entry_t;
+
+/** Get a backend by its name
+ *
+ * @param[in] name           Name of the backend (NULL or "" for the default)
+ * @return                   Backend operations, NULL if the name is unknown
+ */
+const backend_ops_t *backend_get(const char *name);
+
+/** Initialize an empty prefix table
+ *
+ * @param[out] tbl           Pointer to the prefix table
+ * @param[in]  ops           Backend of the prefix table
+ * @param[in]  ref_ops       Reference backend for the differential mode
+ *                           (NULL to disable the differential mode)
+ * @param[in]  arena         Arena of the table (NULL for the heap)
+ * @return                   0 if the table was initialized, otherwise -1
+ */
+int backend_table_init(backend_table_t *tbl, const backend_ops_t *ops,
+                       const backend_ops_t *ref_ops, arena_t *arena);
+
+/** Destroy a prefix table
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ */
+void backend_table_free(backend_table_t *tbl);
+
+/** Remove all records of a prefix table
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ * @return                   0 if the table was cleared, otherwise -1
+ */
+int backend_table_clear(backend_table_t *tbl);
+
+/** Add a ROA record to a prefix table
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ * @param[in] record         ROA record which will be added
+ * @return                   0 if the record was added, otherwise -1
+ */
+int backend_table_add(backend_table_t *tbl, const roa_record_t *record);
+
+/** Remove a ROA record from a prefix table
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ * @param[in] record         ROA record which will be removed
+ * @return                   0 if the record was removed, otherwise -1
+ */
+int backend_table_remove(backend_table_t *tbl, const roa_record_t *record);
+
+/** Add all records of a ROA set to a prefix table
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ * @param[in] set            ROA set which will be added
+ * @return                   0 if all records were added, otherwise -1
+ */
+int backend_table_add_set(backend_table_t *tbl, const roa_set_t *set);
+
+/** Update a prefix table to the records of a canonical ROA set, only the
+ *  difference to the records of the previous update is applied to the table
+ *  and the table takes the ownership of the set
+ *
+ * @param[in]  tbl           Pointer to the prefix table
+ * @param[in]  set           Canonical ROA set (see roa_set_unique)
+ * @param[out] added         Number of added records (or NULL)
+ * @param[out] removed       Number of removed records (or NULL)
+ * @return                   0 if the table was updated, otherwise -1
+ */
+int backend_table_update(backend_table_t *tbl, roa_set_t *set, size_t *added,
+                         size_t *removed);
+
+/** Replace all records of a prefix table by the records of several ROA sets,
+ *  the table is partitioned by address family and top-level prefix bits and
+ *  all partitions are built concurrently before they are published together
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ * @param[in] sets           ROA sets (e.g. one per ROA dump)
+ * @param[in] count          Number of ROA sets
+ * @param[in] threads        Number of threads building the partitions
+ * @return                   0 if the table was built, otherwise -1
+ */
+int backend_table_build_partitioned(backend_table_t *tbl, const roa_set_t *sets,
+                                    size_t count, int threads);
+
+/** Build a partitioned prefix table of a backend from several ROA sets
+ *
+ * @param[in] inner          Backend of the partitions
+ * @param[in] sets           ROA sets (e.g. one per ROA dump)
+ * @param[in] count          Number of ROA sets
+ * @param[in] arena          Arena of the partitions (NULL for the heap)
+ * @param[in] threads        Number of threads building the partitions
+ * @return                   Partitioned table, NULL on failure
+ */
+void *backend_part_create(const backend_ops_t *inner, const roa_set_t *sets,
+                          size_t count, arena_t *arena, int threads);
+
+/** Number of partitions of an address family which held records when a
+ *  partitioned table was built
+ *
+ * @param[in] table          Partitioned table
+ * @param[in] family         Address family (ROA_IPV4 or ROA_IPV6)
+ * @return                   Number of used partitions (incl. the short one)
+ */
+int backend_part_used(const void *table, int family);
+
+/** Validate a prefix and origin ASN against a prefix table
+ *
+ * @param[in]  tbl           Pointer to the prefix table
+ * @param[in]  asn           Origin ASN of the prefix
+ * @param[in]  prefix        Announced network prefix
+ * @param[in]  mask_len      Length of the network mask of the prefix
+ * @param[out] result        Validation state
+ * @return                   0 if the validation was valid, otherwise -1
+ */
+int backend_table_lookup(backend_table_t *tbl, uint32_t asn,
+                         const struct lrtr_ip_addr *prefix, uint8_t mask_len,
+                         enum pfxv_state *result);
+
+/** Validate a prefix and origin ASN and return all matching records
+ *
+ * @param[in]  tbl           Pointer to the prefix table
+ * @param[in]  asn           Origin ASN of the prefix
+ * @param[in]  prefix        Announced network prefix
+ * @param[in]  mask_len      Length of the network mask of the prefix
+ * @param[out] reason        Matching records (has to be freed by the caller)
+ * @param[out] reason_len    Number of matching records
+ * @param[out] result        Validation state
+ * @return                   0 if the validation was valid, otherwise -1
+ */
+int backend_table_lookup_with_reasons(backend_table_t *tbl, uint32_t asn,
+                                      const struct lrtr_ip_addr *prefix,
+                                      uint8_t mask_len,
+                                      struct pfx_record **reason,
+                                      unsigned int *reason_len,
+                                      enum pfxv_state *result);
+
+/** Freeze a prefix table (including the reference table), lookups are
+ *  read-only afterwards and the table can be read by several threads
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ */
+void backend_table_freeze(backend_table_t *tbl);
+
+/** Memory used by a prefix table (including the reference table)
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ * @return                   Used memory in bytes
+ */
+size_t backend_table_memory_usage(backend_table_t *tbl);
+
+/** Let a prefix table use an existing RTRlib prefix table (not owned)
+ *
+ * @param[out] tbl           Pointer to the prefix table
+ * @param[in]  pfxt          RTRlib prefix table (e.g. of a RTR socket)
+ * @return                   0 if the table was initialized, otherwise -1
+ */
+int backend_rtr_wrap(backend_table_t *tbl, struct pfx_table *pfxt);
+
+/** Get the RTRlib prefix table of a RTRlib backend table
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ * @return                   RTRlib prefix table, NULL for other backends
+ */
+struct pfx_table *backend_rtr_pfx_table(backend_table_t *tbl);
+
+/** Let a prefix table use the records of a temporal ROA index (not owned)
+ *
+ * @param[out] tbl           Pointer to the prefix table
+ * @param[in]  index         Temporal ROA index
+ * @param[in]  collectors    Bit mask of the collectors of the index
+ * @return                   0 if the table was initialized, otherwise -1
+ */
+int backend_index_wrap(backend_table_t *tbl, const roa_index_t *index,
+                       uint32_t collectors);
+
+/** Set the timestamp of all lookups of a temporal ROA index backend table
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ * @param[in] timestamp      UTC epoch timestamp
+ */
+void backend_index_set_timestamp(backend_table_t *tbl, uint32_t timestamp);
+
+/** Let a prefix table use a shared prefix table of the registry, the table
+ *  takes over the reference of the entry (a cleared table is rebuilt with its
+ *  previous backend)
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ * @param[in] entry          Loaded registry entry
+ * @return                   0 if the table was initialized, otherwise -1
+ */
+int backend_shared_wrap(backend_table_t *tbl,
+                        struct struct_registry_entry_t *entry);
+
+/** Let a prefix table share the records of another prefix table (e.g. of the
+ *  previous epoch), a table which is not shared yet is moved into an
+ *  unregistered entry of the registry first and both tables use the entry
+ *  (tables of an arena and of the differential mode can not be shared)
+ *
+ * @param[in] tbl            Pointer to the prefix table
+ * @param[in] src            Prefix table whose records are shared
+ * @return                   0 if the table was initialized, otherwise -1
+ */
+int backend_shared_reuse(backend_table_t *tbl, backend_table_t *src);
+
+/** @} */
+
+#endif /* __BACKEND_H */
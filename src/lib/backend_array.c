@@ -0,0 +1,323 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "debug.h"
+
+/** Number of possible prefix lengths (IPv6 /0 - /128) */
+#define BACKEND_ARRAY_LENS 129
+
+/** Initial number of reasons of a lookup */
+#define BACKEND_ARRAY_REASONS 8
+
+/** A sorted array backend prefix table */
+typedef struct struct_backend_array_t {
+
+  /** All records sorted by family, canonical prefix, length and ASN */
+  roa_set_t set;
+
+  /** Whether the records are sorted (records are sorted lazily) */
+  int sorted;
+
+  /** Whether the table is frozen (sorted and read-only) */
+  int frozen;
+
+  /** Number of records per family and prefix length */
+  uint32_t lens[2][BACKEND_ARRAY_LENS];
+
+} backend_array_t;
+
+/* Compare the family, the canonical prefix and the prefix length */
+static int backend_array_cmp_prefix(const roa_record_t *a, uint8_t family,
+                                    const uint32_t *addr, uint8_t len)
+{
+  if (a->family != family) {
+    return a->family < family ? -1 : 1;
+  }
+  for (int i = 0; i < 4; i++) {
+    uint32_t word = a->addr[i] & roa_record_word_mask(a->min_len, i);
+    if (word != addr[i]) {
+      return word < addr[i] ? -1 : 1;
+    }
+  }
+  return a->min_len == len ? 0 : (a->min_len < len ? -1 : 1);
+}
+
+static int backend_array_cmp(const void *a, const void *b)
+{
+  const roa_record_t *ra = (const roa_record_t *)a;
+  const roa_record_t *rb = (const roa_record_t *)b;
+  uint32_t addr[4];
+  for (int i = 0; i < 4; i++) {
+    addr[i] = rb->addr[i] & roa_record_word_mask(rb->min_len, i);
+  }
+  int ret = backend_array_cmp_prefix(ra, rb->family, addr, rb->min_len);
+  if (ret != 0) {
+    return ret;
+  }
+  if (ra->asn != rb->asn) {
+    return ra->asn < rb->asn ? -1 : 1;
+  }
+  if (ra->max_len != rb->max_len) {
+    return ra->max_len < rb->max_len ? -1 : 1;
+  }
+  return memcmp(ra->addr, rb->addr, sizeof(ra->addr));
+}
+
+/* Sort all records and remove duplicates */
+static void backend_array_sort(backend_array_t *arr)
+{
+  roa_set_t *set = &arr->set;
+  qsort(set->records, set->count, sizeof(roa_record_t), backend_array_cmp);
+  size_t out = 0;
+  for (size_t i = 0; i < set->count; i++) {
+    if (out > 0 && !backend_array_cmp(&set->records[out - 1],
+                                      &set->records[i])) {
+      arr->lens[set->records[i].family][set->records[i].min_len]--;
+      continue;
+    }
+    set->records[out++] = set->records[i];
+  }
+  set->count = out;
+  arr->sorted = 1;
+}
+
+/* Index of the first record with the given family, prefix and length */
+static size_t backend_array_lower_bound(backend_array_t *arr, uint8_t family,
+                                        const uint32_t *addr, uint8_t len)
+{
+  size_t low = 0, high = arr->set.count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (backend_array_cmp_prefix(&arr->set.records[mid], family, addr, len)
+        < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+static int backend_array_add(void *table, const roa_record_t *record)
+{
+  backend_array_t *arr = (backend_array_t *)table;
+  if (arr->frozen || record->family > ROA_IPV6 ||
+      record->min_len >= BACKEND_ARRAY_LENS) {
+    return -1;
+  }
+  if (roa_set_add(&arr->set, record) != 0) {
+    return -1;
+  }
+  arr->lens[record->family][record->min_len]++;
+  arr->sorted = 0;
+  return 0;
+}
+
+static int backend_array_remove(void *table, const roa_record_t *record)
+{
+  backend_array_t *arr = (backend_array_t *)table;
+  if (arr->frozen) {
+    return -1;
+  }
+  if (!arr->sorted) {
+    backend_array_sort(arr);
+  }
+
+  /* Find the record among all records of its prefix and close the gap */
+  uint32_t addr[4];
+  for (int i = 0; i < 4; i++) {
+    addr[i] = record->addr[i] & roa_record_word_mask(record->min_len, i);
+  }
+  roa_set_t *set = &arr->set;
+  size_t idx = backend_array_lower_bound(arr, record->family, addr,
+                                         record->min_len);
+  for (; idx < set->count; idx++) {
+    int ret = backend_array_cmp(&set->records[idx], record);
+    if (ret > 0) {
+      break;
+    }
+    if (ret == 0) {
+      memmove(&set->records[idx], &set->records[idx + 1],
+              (set->count - idx - 1) * sizeof(roa_record_t));
+      set->count--;
+      arr->lens[record->family][record->min_len]--;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static void backend_array_destroy(void *table)
+{
+  /* Tables of an arena are released with the arena */
+  backend_array_t *arr = (backend_array_t *)table;
+  if (arr->set.arena == NULL) {
+    roa_set_free(&arr->set);
+    free(arr);
+  }
+}
+
+static void *backend_array_build(const roa_set_t *set, arena_t *arena)
+{
+  backend_array_t *arr;
+  if (arena != NULL) {
+    arr = arena_alloc(arena, sizeof(backend_array_t));
+  } else {
+    arr = malloc(sizeof(backend_array_t));
+  }
+  if (arr == NULL) {
+    return NULL;
+  }
+  memset(arr, 0, sizeof(backend_array_t));
+  if (roa_set_init_arena(&arr->set, arena) != 0) {
+    if (arena == NULL) {
+      free(arr);
+    }
+    return NULL;
+  }
+
+  /* Add all records of the set and sort them once */
+  for (size_t i = 0; set != NULL && i < set->count; i++) {
+    if (backend_array_add(arr, &set->records[i]) != 0) {
+      backend_array_destroy(arr);
+      return NULL;
+    }
+  }
+  backend_array_sort(arr);
+  return arr;
+}
+
+static int backend_array_lookup_with_reasons(void *table, uint32_t asn,
+                                             const struct lrtr_ip_addr *prefix,
+                                             uint8_t mask_len,
+                                             struct pfx_record **reason,
+                                             unsigned int *reason_len,
+                                             enum pfxv_state *result)
+{
+  /* A frozen table is always sorted and only read */
+  backend_array_t *arr = (backend_array_t *)table;
+  if (!arr->frozen && !arr->sorted) {
+    backend_array_sort(arr);
+  }
+
+  roa_record_t key;
+  roa_record_from_addr(asn, prefix, mask_len, mask_len, &key);
+  if (mask_len > (key.family == ROA_IPV4 ? 32 : 128)) {
+    return -1;
+  }
+
+  /* Check all covering prefix lengths which exist in the table */
+  int covered = 0, valid = 0;
+  unsigned int reason_size = 0;
+  if (reason != NULL) {
+    *reason = NULL;
+    *reason_len = 0;
+  }
+  for (int len = 0; len <= mask_len; len++) {
+    if (!arr->lens[key.family][len]) {
+      continue;
+    }
+    uint32_t addr[4];
+    for (int i = 0; i < 4; i++) {
+      addr[i] = key.addr[i] & roa_record_word_mask(len, i);
+    }
+    for (size_t i = backend_array_lower_bound(arr, key.family, addr, len);
+         i < arr->set.count && !backend_array_cmp_prefix(&arr->set.records[i],
+                                                         key.family, addr, len);
+         i++) {
+      roa_record_t *rec = &arr->set.records[i];
+      covered = 1;
+      if (rec->asn == asn && mask_len <= rec->max_len) {
+        valid = 1;
+      }
+
+      /* Store the matching record as reason */
+      if (reason != NULL) {
+        if (*reason_len == reason_size) {
+          reason_size = reason_size ? reason_size * 2 : BACKEND_ARRAY_REASONS;
+          struct pfx_record *tmp = realloc(*reason, reason_size *
+                                           sizeof(struct pfx_record));
+          if (tmp == NULL) {
+            free(*reason);
+            *reason = NULL;
+            *reason_len = 0;
+            return -1;
+          }
+          *reason = tmp;
+        }
+        roa_record_to_pfx_record(rec, &(*reason)[(*reason_len)++]);
+      }
+    }
+  }
+
+  *result = valid ? BGP_PFXV_STATE_VALID
+                  : (covered ? BGP_PFXV_STATE_INVALID
+                             : BGP_PFXV_STATE_NOT_FOUND);
+  return 0;
+}
+
+static int backend_array_lookup(void *table, uint32_t asn,
+                                const struct lrtr_ip_addr *prefix,
+                                uint8_t mask_len, enum pfxv_state *result)
+{
+  return backend_array_lookup_with_reasons(table, asn, prefix, mask_len, NULL,
+                                           NULL, result);
+}
+
+static size_t backend_array_memory_usage(void *table)
+{
+  backend_array_t *arr = (backend_array_t *)table;
+  return sizeof(backend_array_t) + arr->set.size * sizeof(roa_record_t);
+}
+
+static void backend_array_freeze(void *table)
+{
+  backend_array_t *arr = (backend_array_t *)table;
+  if (!arr->sorted) {
+    backend_array_sort(arr);
+  }
+  arr->frozen = 1;
+}
+
+const backend_ops_t backend_array_ops = {
+  "array",
+  backend_array_build,
+  backend_array_add,
+  backend_array_remove,
+  backend_array_lookup,
+  backend_array_lookup_with_reasons,
+  backend_array_destroy,
+  backend_array_memory_usage,
+  backend_array_freeze,
+};
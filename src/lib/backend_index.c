@@ -0,0 +1,141 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "debug.h"
+
+/** A prefix table view of a temporal ROA index (read-only) */
+typedef struct struct_backend_index_t {
+
+  /** Temporal ROA index (NULL for an empty table) */
+  const roa_index_t *index;
+
+  /** Bit mask of the collectors of the index */
+  uint32_t collectors;
+
+  /** Timestamp of all lookups */
+  uint32_t timestamp;
+
+} backend_index_t;
+
+static void *backend_index_build(const roa_set_t *set, arena_t *arena)
+{
+  /* Records are only read from an index, a set can not be added */
+  if (set != NULL && set->count) {
+    return NULL;
+  }
+  return calloc(1, sizeof(backend_index_t));
+}
+
+static int backend_index_add(void *table, const roa_record_t *record)
+{
+  std_print("%s", "Error: Records can not be added to a ROA index\n");
+  return -1;
+}
+
+static int backend_index_remove(void *table, const roa_record_t *record)
+{
+  std_print("%s", "Error: Records can not be removed from a ROA index\n");
+  return -1;
+}
+
+static int backend_index_lookup_with_reasons(void *table, uint32_t asn,
+                                             const struct lrtr_ip_addr *prefix,
+                                             uint8_t mask_len,
+                                             struct pfx_record **reason,
+                                             unsigned int *reason_len,
+                                             enum pfxv_state *result)
+{
+  backend_index_t *idx = (backend_index_t *)table;
+  if (idx->index == NULL) {
+    *reason = NULL;
+    *reason_len = 0;
+    *result = BGP_PFXV_STATE_NOT_FOUND;
+    return 0;
+  }
+  return roa_index_lookup(idx->index, idx->collectors, idx->timestamp, asn,
+                          prefix, mask_len, reason, reason_len, result);
+}
+
+static int backend_index_lookup(void *table, uint32_t asn,
+                                const struct lrtr_ip_addr *prefix,
+                                uint8_t mask_len, enum pfxv_state *result)
+{
+  struct pfx_record *reason = NULL;
+  unsigned int reason_len = 0;
+  int ret = backend_index_lookup_with_reasons(table, asn, prefix, mask_len,
+                                              &reason, &reason_len, result);
+  free(reason);
+  return ret;
+}
+
+static void backend_index_destroy(void *table)
+{
+  /* The index is owned by the validation config */
+  free(table);
+}
+
+static size_t backend_index_memory_usage(void *table)
+{
+  return sizeof(backend_index_t);
+}
+
+const backend_ops_t backend_index_ops = {
+  "index",
+  backend_index_build,
+  backend_index_add,
+  backend_index_remove,
+  backend_index_lookup,
+  backend_index_lookup_with_reasons,
+  backend_index_destroy,
+  backend_index_memory_usage,
+  NULL,
+};
+
+int backend_index_wrap(backend_table_t *tbl, const roa_index_t *index,
+                       uint32_t collectors)
+{
+  if (backend_table_init(tbl, &backend_index_ops, NULL, NULL) != 0) {
+    return -1;
+  }
+  ((backend_index_t *)tbl->table)->index = index;
+  ((backend_index_t *)tbl->table)->collectors = collectors;
+  return 0;
+}
+
+void backend_index_set_timestamp(backend_table_t *tbl, uint32_t timestamp)
+{
+  if (tbl->ops == &backend_index_ops) {
+    ((backend_index_t *)tbl->table)->timestamp = timestamp;
+  }
+}
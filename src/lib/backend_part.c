@@ -0,0 +1,360 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "debug.h"
+
+/** Number of top-level prefix bits a table is partitioned by */
+#define BACKEND_PART_BITS 4
+
+/** Number of partitions per address family (without the short partition) */
+#define BACKEND_PART_COUNT (1 << BACKEND_PART_BITS)
+
+/** Number of leading IPv6 bits shared by all global unicast prefixes (2000::/3)
+    which are skipped by the partitioning */
+#define BACKEND_PART_V6_SKIP 3
+
+/** Number of IPv6 prefix bits after 2000::/3 which are folded into the
+    partition bits (spreads the prefixes of every RIR over all partitions) */
+#define BACKEND_PART_V6_BITS 12
+
+/** A prefix table partitioned by address family and top-level prefix bits
+ *
+ * Records shorter than BACKEND_PART_BITS (IPv4) or than BACKEND_PART_V6_SKIP +
+ * BACKEND_PART_V6_BITS (IPv6) are stored in an extra partition per family
+ * (index BACKEND_PART_COUNT), which is checked on every lookup.
+ */
+typedef struct struct_backend_part_t {
+
+  /** Backend of all partitions */
+  const backend_ops_t *inner;
+
+  /** All partitions per family */
+  void *parts[2][BACKEND_PART_COUNT + 1];
+
+  /** Number of records of every partition when the table was built */
+  size_t records[2][BACKEND_PART_COUNT + 1];
+
+} backend_part_t;
+
+/** A parallel build of all partitions */
+typedef struct struct_backend_part_job_t {
+
+  /** Partitioned table which is built */
+  backend_part_t *part;
+
+  /** Records of all partitions */
+  roa_set_t sets[2][BACKEND_PART_COUNT + 1];
+
+  /** Arena of the partitions (NULL for the heap) */
+  arena_t *arena;
+
+  /** Index of the next partition which will be built */
+  int next;
+
+  /** Number of failed partition builds */
+  int failed;
+
+  /** Lock of the job */
+  pthread_mutex_t lock;
+
+} backend_part_job_t;
+
+/* Partition of a prefix (short partition for prefixes shorter than the
+   partition bits), IPv6 prefixes are partitioned by the bits after 2000::/3 */
+static int backend_part_index(int family, const uint32_t *addr, uint8_t len)
+{
+  if (family != ROA_IPV6) {
+    if (len < BACKEND_PART_BITS) {
+      return BACKEND_PART_COUNT;
+    }
+    return addr[0] >> (32 - BACKEND_PART_BITS);
+  }
+  if (len < BACKEND_PART_V6_SKIP + BACKEND_PART_V6_BITS) {
+    return BACKEND_PART_COUNT;
+  }
+  uint32_t bits = (addr[0] << BACKEND_PART_V6_SKIP) >>
+                  (32 - BACKEND_PART_V6_BITS);
+  int idx = 0;
+  for (int i = 0; i < BACKEND_PART_V6_BITS; i += BACKEND_PART_BITS) {
+    idx ^= (bits >> i) & (BACKEND_PART_COUNT - 1);
+  }
+  return idx;
+}
+
+static void backend_part_destroy(void *table)
+{
+  backend_part_t *part = (backend_part_t *)table;
+  for (int f = 0; f < 2; f++) {
+    for (int i = 0; i <= BACKEND_PART_COUNT; i++) {
+      if (part->parts[f][i] != NULL) {
+        part->inner->destroy(part->parts[f][i]);
+      }
+    }
+  }
+  free(part);
+}
+
+/* Build partitions until no partition is left */
+static void *backend_part_worker(void *data)
+{
+  backend_part_job_t *job = (backend_part_job_t *)data;
+  while (1) {
+    pthread_mutex_lock(&job->lock);
+    int idx = job->next++;
+    pthread_mutex_unlock(&job->lock);
+    if (idx >= 2 * (BACKEND_PART_COUNT + 1)) {
+      break;
+    }
+    int f = idx / (BACKEND_PART_COUNT + 1), i = idx % (BACKEND_PART_COUNT + 1);
+    void *table = job->part->inner->build(&job->sets[f][i], job->arena);
+    pthread_mutex_lock(&job->lock);
+    job->part->parts[f][i] = table;
+    job->failed += (table == NULL);
+    pthread_mutex_unlock(&job->lock);
+  }
+  return NULL;
+}
+
+void *backend_part_create(const backend_ops_t *inner, const roa_set_t *sets,
+                          size_t count, arena_t *arena, int threads)
+{
+  backend_part_job_t job;
+  memset(&job, 0, sizeof(job));
+  if ((job.part = malloc(sizeof(backend_part_t))) == NULL) {
+    return NULL;
+  }
+  memset(job.part, 0, sizeof(backend_part_t));
+  job.part->inner = inner;
+  job.arena = arena;
+  pthread_mutex_init(&job.lock, NULL);
+
+  /* Distribute all records of all streams to the partitions */
+  int ret = 0;
+  for (int f = 0; f < 2; f++) {
+    for (int i = 0; i <= BACKEND_PART_COUNT; i++) {
+      ret |= roa_set_init(&job.sets[f][i]);
+    }
+  }
+  for (size_t s = 0; s < count && !ret; s++) {
+    for (size_t i = 0; i < sets[s].count && !ret; i++) {
+      const roa_record_t *rec = &sets[s].records[i];
+      int idx = backend_part_index(rec->family, rec->addr, rec->min_len);
+      ret = roa_set_add(&job.sets[rec->family & 1][idx], rec);
+    }
+  }
+
+  /* Build all partitions concurrently */
+  pthread_t workers[MAX_THREADS];
+  int started = 0;
+  threads = threads < 1 ? 1 : (threads > MAX_THREADS ? MAX_THREADS : threads);
+  for (int t = 0; t < threads && !ret; t++) {
+    if (pthread_create(&workers[t], NULL, backend_part_worker, &job) != 0) {
+      break;
+    }
+    started++;
+  }
+  if (!ret && !started) {
+    backend_part_worker(&job);
+  }
+  for (int t = 0; t < started; t++) {
+    pthread_join(workers[t], NULL);
+  }
+
+  for (int f = 0; f < 2; f++) {
+    for (int i = 0; i <= BACKEND_PART_COUNT; i++) {
+      job.part->records[f][i] = job.sets[f][i].count;
+      roa_set_free(&job.sets[f][i]);
+    }
+  }
+  pthread_mutex_destroy(&job.lock);
+  if (ret || job.failed || job.next < 2 * (BACKEND_PART_COUNT + 1)) {
+    std_print("%s", "Error: Could not build the partitioned prefix table\n");
+    backend_part_destroy(job.part);
+    return NULL;
+  }
+  return job.part;
+}
+
+int backend_part_used(const void *table, int family)
+{
+  const backend_part_t *part = (const backend_part_t *)table;
+  int used = 0;
+  for (int i = 0; i <= BACKEND_PART_COUNT; i++) {
+    used += (part->records[family & 1][i] > 0);
+  }
+  return used;
+}
+
+static void *backend_part_build(const roa_set_t *set, arena_t *arena)
+{
+  /* Partitions of the default backend, built by the calling thread */
+  return backend_part_create(backend_get(NULL), set, set != NULL, arena, 1);
+}
+
+static int backend_part_add(void *table, const roa_record_t *record)
+{
+  backend_part_t *part = (backend_part_t *)table;
+  int idx = backend_part_index(record->family, record->addr,
+                               record->min_len);
+  return part->inner->add(part->parts[record->family & 1][idx], record);
+}
+
+static int backend_part_remove(void *table, const roa_record_t *record)
+{
+  backend_part_t *part = (backend_part_t *)table;
+  int idx = backend_part_index(record->family, record->addr,
+                               record->min_len);
+  return part->inner->remove(part->parts[record->family & 1][idx], record);
+}
+
+/* Combine the results of the short and the prefix partition */
+static enum pfxv_state backend_part_merge(enum pfxv_state a, enum pfxv_state b)
+{
+  if (a == BGP_PFXV_STATE_VALID || b == BGP_PFXV_STATE_VALID) {
+    return BGP_PFXV_STATE_VALID;
+  }
+  if (a == BGP_PFXV_STATE_INVALID || b == BGP_PFXV_STATE_INVALID) {
+    return BGP_PFXV_STATE_INVALID;
+  }
+  return BGP_PFXV_STATE_NOT_FOUND;
+}
+
+static int backend_part_lookup_with_reasons(void *table, uint32_t asn,
+                                            const struct lrtr_ip_addr *prefix,
+                                            uint8_t mask_len,
+                                            struct pfx_record **reason,
+                                            unsigned int *reason_len,
+                                            enum pfxv_state *result)
+{
+  backend_part_t *part = (backend_part_t *)table;
+  roa_record_t key;
+  roa_record_from_addr(asn, prefix, mask_len, mask_len, &key);
+  void **parts = part->parts[key.family & 1];
+  int idx = backend_part_index(key.family, key.addr, mask_len);
+
+  /* Records shorter than the partition bits can cover every prefix */
+  if (reason == NULL) {
+    if (part->inner->lookup(parts[BACKEND_PART_COUNT], asn, prefix, mask_len,
+                            result) != 0) {
+      return -1;
+    }
+  } else if (part->inner->lookup_with_reasons(parts[BACKEND_PART_COUNT], asn,
+                                              prefix, mask_len, reason,
+                                              reason_len, result) != 0) {
+    return -1;
+  }
+  if (idx == BACKEND_PART_COUNT) {
+    return 0;
+  }
+
+  /* Check the partition of the prefix and merge both results */
+  enum pfxv_state part_result;
+  struct pfx_record *part_reason = NULL;
+  unsigned int part_reason_len = 0;
+  if (reason == NULL) {
+    if (part->inner->lookup(parts[idx], asn, prefix, mask_len, &part_result)
+        != 0) {
+      return -1;
+    }
+  } else if (part->inner->lookup_with_reasons(parts[idx], asn, prefix,
+                                              mask_len, &part_reason,
+                                              &part_reason_len, &part_result)
+             != 0) {
+    free(*reason);
+    *reason = NULL;
+    *reason_len = 0;
+    return -1;
+  }
+  *result = backend_part_merge(*result, part_result);
+  if (part_reason_len) {
+    struct pfx_record *tmp = realloc(*reason, (*reason_len + part_reason_len) *
+                                     sizeof(struct pfx_record));
+    if (tmp == NULL) {
+      free(part_reason);
+      free(*reason);
+      *reason = NULL;
+      *reason_len = 0;
+      return -1;
+    }
+    memcpy(tmp + *reason_len, part_reason,
+           part_reason_len * sizeof(struct pfx_record));
+    *reason = tmp;
+    *reason_len += part_reason_len;
+  }
+  free(part_reason);
+  return 0;
+}
+
+static int backend_part_lookup(void *table, uint32_t asn,
+                               const struct lrtr_ip_addr *prefix,
+                               uint8_t mask_len, enum pfxv_state *result)
+{
+  return backend_part_lookup_with_reasons(table, asn, prefix, mask_len, NULL,
+                                          NULL, result);
+}
+
+static size_t backend_part_memory_usage(void *table)
+{
+  backend_part_t *part = (backend_part_t *)table;
+  size_t usage = sizeof(backend_part_t);
+  for (int f = 0; f < 2; f++) {
+    for (int i = 0; i <= BACKEND_PART_COUNT; i++) {
+      usage += part->inner->memory_usage(part->parts[f][i]);
+    }
+  }
+  return usage;
+}
+
+static void backend_part_freeze(void *table)
+{
+  backend_part_t *part = (backend_part_t *)table;
+  for (int f = 0; part->inner->freeze != NULL && f < 2; f++) {
+    for (int i = 0; i <= BACKEND_PART_COUNT; i++) {
+      part->inner->freeze(part->parts[f][i]);
+    }
+  }
+}
+
+const backend_ops_t backend_part_ops = {
+  "partitioned",
+  backend_part_build,
+  backend_part_add,
+  backend_part_remove,
+  backend_part_lookup,
+  backend_part_lookup_with_reasons,
+  backend_part_destroy,
+  backend_part_memory_usage,
+  backend_part_freeze,
+};
@@ -0,0 +1,172 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "debug.h"
+
+/** Approximate size of a RTRlib trie node including its record data */
+#define BACKEND_RTR_NODE_SIZE 96
+
+/** A RTRlib backend prefix table */
+typedef struct struct_backend_rtr_t {
+
+  /** Own RTRlib prefix table */
+  struct pfx_table pfxt;
+
+  /** Used RTRlib prefix table (own table or an external one) */
+  struct pfx_table *used;
+
+  /** Number of added records */
+  size_t records;
+
+} backend_rtr_t;
+
+static void *backend_rtr_build(const roa_set_t *set, arena_t *arena)
+{
+  /* The RTRlib allocates the trie nodes itself, the arena is not used */
+  backend_rtr_t *rtr = malloc(sizeof(backend_rtr_t));
+  if (rtr == NULL) {
+    return NULL;
+  }
+  pfx_table_init(&rtr->pfxt, NULL);
+  rtr->used = &rtr->pfxt;
+  rtr->records = 0;
+
+  /* Add all records of the set */
+  struct pfx_record pfx;
+  for (size_t i = 0; set != NULL && i < set->count; i++) {
+    roa_record_to_pfx_record(&set->records[i], &pfx);
+    if (pfx_table_add(rtr->used, &pfx) == PFX_ERROR) {
+      pfx_table_free(&rtr->pfxt);
+      free(rtr);
+      return NULL;
+    }
+    rtr->records++;
+  }
+  return rtr;
+}
+
+static int backend_rtr_add(void *table, const roa_record_t *record)
+{
+  backend_rtr_t *rtr = (backend_rtr_t *)table;
+  struct pfx_record pfx;
+  roa_record_to_pfx_record(record, &pfx);
+
+  /* Check if the record could be added by the RTRlib (duplicates are valid) */
+  int ret = pfx_table_add(rtr->used, &pfx);
+  if (ret == PFX_ERROR) {
+    return -1;
+  }
+  if (ret == PFX_SUCCESS) {
+    rtr->records++;
+  }
+  return 0;
+}
+
+static int backend_rtr_remove(void *table, const roa_record_t *record)
+{
+  backend_rtr_t *rtr = (backend_rtr_t *)table;
+  struct pfx_record pfx;
+  roa_record_to_pfx_record(record, &pfx);
+  if (pfx_table_remove(rtr->used, &pfx) != PFX_SUCCESS) {
+    return -1;
+  }
+  rtr->records--;
+  return 0;
+}
+
+static int backend_rtr_lookup(void *table, uint32_t asn,
+                              const struct lrtr_ip_addr *prefix,
+                              uint8_t mask_len, enum pfxv_state *result)
+{
+  backend_rtr_t *rtr = (backend_rtr_t *)table;
+  return pfx_table_validate(rtr->used, asn, prefix, mask_len, result) ==
+         PFX_ERROR ? -1 : 0;
+}
+
+static int backend_rtr_lookup_with_reasons(void *table, uint32_t asn,
+                                           const struct lrtr_ip_addr *prefix,
+                                           uint8_t mask_len,
+                                           struct pfx_record **reason,
+                                           unsigned int *reason_len,
+                                           enum pfxv_state *result)
+{
+  backend_rtr_t *rtr = (backend_rtr_t *)table;
+  *reason = NULL;
+  *reason_len = 0;
+  return pfx_table_validate_r(rtr->used, reason, reason_len, asn, prefix,
+                              mask_len, result) == PFX_ERROR ? -1 : 0;
+}
+
+static void backend_rtr_destroy(void *table)
+{
+  /* An external prefix table is owned by the RTRlib */
+  backend_rtr_t *rtr = (backend_rtr_t *)table;
+  pfx_table_free(&rtr->pfxt);
+  free(rtr);
+}
+
+static size_t backend_rtr_memory_usage(void *table)
+{
+  backend_rtr_t *rtr = (backend_rtr_t *)table;
+  return sizeof(backend_rtr_t) + rtr->records * BACKEND_RTR_NODE_SIZE;
+}
+
+const backend_ops_t backend_rtr_ops = {
+  "rtrlib",
+  backend_rtr_build,
+  backend_rtr_add,
+  backend_rtr_remove,
+  backend_rtr_lookup,
+  backend_rtr_lookup_with_reasons,
+  backend_rtr_destroy,
+  backend_rtr_memory_usage,
+  NULL,
+};
+
+int backend_rtr_wrap(backend_table_t *tbl, struct pfx_table *pfxt)
+{
+  if (backend_table_init(tbl, &backend_rtr_ops, NULL, NULL) != 0) {
+    return -1;
+  }
+  ((backend_rtr_t *)tbl->table)->used = pfxt;
+  return 0;
+}
+
+struct pfx_table *backend_rtr_pfx_table(backend_table_t *tbl)
+{
+  if (tbl->ops != &backend_rtr_ops) {
+    return NULL;
+  }
+  return ((backend_rtr_t *)tbl->table)->used;
+}
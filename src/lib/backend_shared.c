@@ -0,0 +1,170 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "debug.h"
+#include "registry.h"
+
+/** A prefix table view of a shared prefix table of the registry (read-only) */
+typedef struct struct_backend_shared_t {
+
+  /** Registry entry of the shared table (NULL for an empty table) */
+  registry_entry_t *entry;
+
+} backend_shared_t;
+
+static void *backend_shared_build(const roa_set_t *set, arena_t *arena)
+{
+  /* Shared tables are immutable, a set can not be added */
+  if (set != NULL && set->count) {
+    return NULL;
+  }
+  return calloc(1, sizeof(backend_shared_t));
+}
+
+static int backend_shared_add(void *table, const roa_record_t *record)
+{
+  std_print("%s", "Error: Records can not be added to a shared table\n");
+  return -1;
+}
+
+static int backend_shared_remove(void *table, const roa_record_t *record)
+{
+  std_print("%s", "Error: Records can not be removed from a shared table\n");
+  return -1;
+}
+
+static int backend_shared_lookup(void *table, uint32_t asn,
+                                 const struct lrtr_ip_addr *prefix,
+                                 uint8_t mask_len, enum pfxv_state *result)
+{
+  backend_shared_t *shared = (backend_shared_t *)table;
+  if (shared->entry == NULL) {
+    *result = BGP_PFXV_STATE_NOT_FOUND;
+    return 0;
+  }
+  return backend_table_lookup(&shared->entry->table, asn, prefix, mask_len,
+                              result);
+}
+
+static int backend_shared_lookup_with_reasons(void *table, uint32_t asn,
+                                              const struct lrtr_ip_addr *prefix,
+                                              uint8_t mask_len,
+                                              struct pfx_record **reason,
+                                              unsigned int *reason_len,
+                                              enum pfxv_state *result)
+{
+  backend_shared_t *shared = (backend_shared_t *)table;
+  if (shared->entry == NULL) {
+    *reason = NULL;
+    *reason_len = 0;
+    *result = BGP_PFXV_STATE_NOT_FOUND;
+    return 0;
+  }
+  return backend_table_lookup_with_reasons(&shared->entry->table, asn, prefix,
+                                           mask_len, reason, reason_len,
+                                           result);
+}
+
+static void backend_shared_destroy(void *table)
+{
+  /* The shared table is released with its last reference */
+  registry_release(((backend_shared_t *)table)->entry);
+  free(table);
+}
+
+static size_t backend_shared_memory_usage(void *table)
+{
+  backend_shared_t *shared = (backend_shared_t *)table;
+  size_t usage = sizeof(backend_shared_t);
+  if (shared->entry != NULL) {
+    usage += backend_table_memory_usage(&shared->entry->table);
+  }
+  return usage;
+}
+
+const backend_ops_t backend_shared_ops = {
+  "shared",
+  backend_shared_build,
+  backend_shared_add,
+  backend_shared_remove,
+  backend_shared_lookup,
+  backend_shared_lookup_with_reasons,
+  backend_shared_destroy,
+  backend_shared_memory_usage,
+  NULL,
+};
+
+int backend_shared_wrap(backend_table_t *tbl, registry_entry_t *entry)
+{
+  /* A cleared table is rebuilt with its previous backend and arena */
+  const backend_ops_t *ops = tbl->base_ops ? tbl->base_ops : tbl->ops;
+  arena_t *arena = tbl->arena;
+  backend_table_free(tbl);
+  if (backend_table_init(tbl, &backend_shared_ops, NULL, NULL) != 0) {
+    return -1;
+  }
+  tbl->base_ops = ops;
+  tbl->arena = arena;
+  ((backend_shared_t *)tbl->table)->entry = entry;
+  return 0;
+}
+
+int backend_shared_reuse(backend_table_t *tbl, backend_table_t *src)
+{
+  /* A table of the heap is moved into an unregistered entry, the source table
+     becomes a view of the entry like the reusing table */
+  if (src->ops != &backend_shared_ops) {
+    if (src->arena != NULL || src->ref_table != NULL) {
+      std_print("%s", "Error: The prefix table can not be shared\n");
+      return -1;
+    }
+    backend_shared_t *view = calloc(1, sizeof(backend_shared_t));
+    registry_entry_t *entry = (view != NULL ? registry_adopt(src) : NULL);
+    if (entry == NULL) {
+      free(view);
+      return -1;
+    }
+    view->entry = entry;
+    src->base_ops = src->base_ops ? src->base_ops : src->ops;
+    src->ops = &backend_shared_ops;
+    src->table = view;
+  }
+
+  registry_entry_t *entry = ((backend_shared_t *)src->table)->entry;
+  if (backend_shared_wrap(tbl, entry) != 0) {
+    return -1;
+  }
+  registry_retain(entry);
+  return 0;
+}
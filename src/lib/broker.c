@@ -27,8 +27,11 @@
  * SOFTWARE.
  */
 
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "broker.h"
 #include "constants.h"
@@ -37,210 +40,667 @@
 #include "utils.h"
 #include "wandio.h"
 
-int broker_connect(rpki_cfg_t *cfg, char *collector, char *time_intervals)
+/* Whether the broker response of historical intervals is final (every
+   interval ended at least BROKER_CACHE_MIN_AGE seconds ago) */
+static int broker_cacheable(rpki_cfg_t *cfg, const char *time_intervals)
 {
-  /* Build the broker request URL */
-  char broker_url[BROKER_REQUEST_URL_LEN] = {0};
-  snprintf(broker_url, sizeof(broker_url),
-           "%scollector=%s&interval=%s", cfg->cfg_broker.broker_url,
-           collector, time_intervals);
+  if (!cfg->cfg_input.mode || !cache_enabled(&cfg->cache)) {
+    return 0;
+  }
+  time_t now = time(NULL);
+  const char *end = strchr(time_intervals, '-');
+  while (end != NULL) {
+    if ((time_t)strtoul(end + 1, NULL, 10) + BROKER_CACHE_MIN_AGE > now) {
+      return 0;
+    }
+    end = strchr(end + 1, '-');
+  }
+  return 1;
+}
+
+/* Broker Response Scheme:
+   01 : Projects   - 02 Value
+   03 : Collectors - 04 Value
+   05 : Interval   - 06 Value
+   07 : start      - 08 Value
+   09 : max_end    - 10 Value
+   11 : data       - 12 object
+   13 : #1 TS      - 14 #1 URL <-- Start of the ROA URLs
+   15 : #2 TS      - 16 #2 URL */
+
+/* An incremental tokenizer of a broker response (JSON), the pairs of a
+   timestamp and a URL are added as soon as they were read and their tokens
+   are reused, only the unparsed text is kept */
+typedef struct struct_broker_parser_t {
+  rpki_cfg_t *cfg;
+  jsmn_parser jsmn;
+  jsmntok_t tokens[BROKER_JSON_TOKENS];
+  char *js;
+  size_t len;
+  size_t size;
+  int data;
+  int ret;
+} broker_parser_t;
+
+static void broker_parser_init(broker_parser_t *parser, rpki_cfg_t *cfg)
+{
+  memset(parser, 0, sizeof(*parser));
+  parser->cfg = cfg;
+  parser->ret = JSMN_ERROR_PART;
+  jsmn_init(&parser->jsmn);
+}
+
+/* Copy the text of a token into a null-terminated buffer */
+static void broker_parser_str(const char *js, const jsmntok_t *token,
+                              char *str)
+{
+  int length = token->end - token->start;
+  memcpy(str, &js[token->start], length);
+  str[length] = '\0';
+}
+
+/* Parse the fields of the broker response preceding the ROA URLs */
+static int broker_parse_header(rpki_cfg_t *cfg, const char *js,
+                               jsmntok_t *tokens)
+{
+  if (tokens[BROKER_JSON_DATA_TOKEN].type != JSMN_OBJECT) {
+    std_print("%s", "Error: invalid response of the broker\n");
+    return -1;
+  }
+
+  /* Clear the broker index */
+  config_broker_t *broker = &cfg->cfg_broker;
+  broker_index_clear(&broker->index);
+
+  /* Add projects in broker-sorted order
+     The broker varies the project order to always ensure an uniform order */
+  config_input_t *input = &cfg->cfg_input;
+  char projects[tokens[2].end - tokens[2].start + 1];
+  broker_parser_str(js, &tokens[2], projects);
+  size_t input_max_size = sizeof(input->broker_projects);
+  input->projects_count = utils_broker_add_projects_collectors(projects,
+                                  input->broker_projects, ",", input->projects);
 
-  /* Check if the broker reports errors, if so stop the process */
-  char broker_err_check[BROKER_ERR_MSG_LEN] = {0}; 
-  if(utils_broker_check_url(broker_url, broker_err_check, BROKER_ERR_MSG_LEN) 
-     != 0) {
+  /* Add collectors in broker-sorted order
+     The broker varies the collectors order to always ensure an uniform order */
+  char collectors[tokens[4].end - tokens[4].start + 1];
+  broker_parser_str(js, &tokens[4], collectors);
+  input->collectors_count = utils_broker_add_projects_collectors(collectors,
+                              input->broker_collectors, ",", input->collectors);
+
+  /* Add intervals in broker-sorted order without duplicates etc. */
+  char intervals[tokens[6].end - tokens[6].start + 1];
+  broker_parser_str(js, &tokens[6], intervals);
+  if(utils_cfg_check_intervals(cfg, intervals) != 0) {
+    std_print("%s", "Error: Invalid interval in the broker response\n");
+    return -1;
+  }
+
+  /* Add first timestamp of broker response */
+  int length = tokens[8].end - tokens[8].start;
+  if (tokens[10].end - tokens[10].start > length) {
+    length = tokens[10].end - tokens[10].start;
+  }
+  char timestamp[length + 1];
+  broker_parser_str(js, &tokens[8], timestamp);
+  if (utils_cfg_validity_check_val(timestamp, &cfg->cfg_time.start, 32) != 0) {
+    std_print("%s", "Error: Invalid timestamp in the broker response\n");
     return -1;
   }
 
-  return broker_json_buf(cfg, broker_url);
+  /* Add latest timestamp of broker response */
+  broker_parser_str(js, &tokens[10], timestamp);
+  if (utils_cfg_validity_check_val(timestamp, &cfg->cfg_time.max_end, 32) !=
+      0) {
+    std_print("%s", "Error: Invalid timestamp in the broker response\n");
+    return -1;
+  }
+
+  return 0;
 }
 
-int broker_json_buf(rpki_cfg_t *cfg, char *broker_url)
+/* Add a timestamp and its ROA URLs to the broker index */
+static int broker_put_url(rpki_cfg_t *cfg, uint32_t timestamp, const char *url,
+                          size_t len)
+{
+  config_broker_t *broker = &cfg->cfg_broker;
+  if (len >= BROKER_ROA_URLS_LEN) {
+    std_print("%s", "Error: ROA URLs of the broker response are too long\n");
+    return -1;
+  }
+  if (broker_index_add(&broker->index, timestamp, url, len) != 0) {
+    std_print("%s", "Error: Could not allocate enough memory\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+/* Add a pair of a timestamp and a URL of the data object */
+static int broker_add_url(rpki_cfg_t *cfg, const char *js,
+                          const jsmntok_t *key, const jsmntok_t *value)
+{
+  if (key->type != JSMN_STRING || value->type != JSMN_STRING) {
+    std_print("%s", "Error: invalid response of the broker\n");
+    return -1;
+  }
+  char ts[key->end - key->start + 1];
+  broker_parser_str(js, key, ts);
+  return broker_put_url(cfg, strtoul(ts, NULL, 10), &js[value->start],
+                        value->end - value->start);
+}
+
+/* Consume all complete tokens, the header is parsed once the data object
+   was opened and every complete pair of the data object is added */
+static int broker_parser_consume(broker_parser_t *parser)
+{
+  jsmn_parser *jsmn = &parser->jsmn;
+  if (!parser->data) {
+    if (jsmn->toknext <= BROKER_JSON_DATA_TOKEN) {
+      return 0;
+    }
+    if (broker_parse_header(parser->cfg, parser->js, parser->tokens) != 0) {
+      return -1;
+    }
+    parser->data = BROKER_JSON_DATA_TOKEN;
+  }
+
+  int first = parser->data + 1;
+  int i = first;
+  for (; i + 1 < (int)jsmn->toknext; i += 2) {
+    if (broker_add_url(parser->cfg, parser->js, &parser->tokens[i],
+                       &parser->tokens[i + 1]) != 0) {
+      return -1;
+    }
+  }
+
+  /* Release the added tokens, a timestamp without its URL is kept (as well
+     as the parent it refers to) */
+  if (i < (int)jsmn->toknext) {
+    parser->tokens[first] = parser->tokens[i];
+    if (jsmn->toksuper == i) {
+      jsmn->toksuper = first;
+    }
+    jsmn->toknext = first + 1;
+  } else {
+    jsmn->toknext = first;
+  }
+  if (jsmn->toksuper > (int)jsmn->toknext - 1) {
+    jsmn->toksuper = parser->data;
+  }
+
+  return 0;
+}
+
+/* Tokenize a chunk of the broker response (tokens may span several chunks) */
+static int broker_parser_feed(broker_parser_t *parser, const char *buf,
+                              size_t len)
+{
+  /* Append the chunk to the unparsed text */
+  if (parser->len + len + 1 > parser->size) {
+    size_t size = parser->len + len + 1;
+    if (size < BROKER_JSON_BUF_SIZE) {
+      size = BROKER_JSON_BUF_SIZE;
+    }
+    char *tmp = realloc(parser->js, size);
+    if (!tmp) {
+      std_print("%s", "Error: Could not allocate enough memory\n");
+      return -1;
+    }
+    parser->js = tmp;
+    parser->size = size;
+  }
+  memcpy(parser->js + parser->len, buf, len);
+  parser->len += len;
+  parser->js[parser->len] = '\0';
+
+  /* Resume the tokenizer, released tokens are reused if it ran out of them */
+  jsmn_parser *jsmn = &parser->jsmn;
+  while (1) {
+    int ret = jsmn_parse(jsmn, parser->js, parser->len, parser->tokens,
+                         BROKER_JSON_TOKENS);
+    if (ret == JSMN_ERROR_INVAL) {
+      std_print("%s", "Error: invalid JSON format\n");
+      return -1;
+    }
+    if (broker_parser_consume(parser) != 0) {
+      return -1;
+    }
+    parser->ret = ret;
+    if (ret != JSMN_ERROR_NOMEM) {
+      break;
+    }
+    if (jsmn->toknext == BROKER_JSON_TOKENS) {
+      std_print("%s", "Error: invalid response of the broker\n");
+      return -1;
+    }
+  }
+
+  /* Discard the tokenized text, except of a pending timestamp */
+  if (!parser->data) {
+    return 0;
+  }
+  size_t shift = jsmn->pos;
+  jsmntok_t *pending = NULL;
+  if ((int)jsmn->toknext == parser->data + 2) {
+    pending = &parser->tokens[parser->data + 1];
+    shift = pending->start;
+  }
+  memmove(parser->js, parser->js + shift, parser->len - shift + 1);
+  parser->len -= shift;
+  jsmn->pos -= shift;
+  if (pending != NULL) {
+    pending->start -= shift;
+    pending->end -= shift;
+  }
+
+  return 0;
+}
+
+/* Check the complete broker response and free the tokenizer */
+static int broker_parser_finish(broker_parser_t *parser)
+{
+  int ret = 0;
+  if (parser->ret < 0) {
+    std_print("%s", "Error: invalid JSON format\n");
+    ret = -1;
+  } else if (!parser->data) {
+    std_print("%s", "Error: invalid response of the broker\n");
+    ret = -1;
+  } else {
+    if (!parser->cfg->cfg_broker.index.count) {
+      std_print("%s", "Info: There are no ROA dumps for the interval\n");
+    }
+    utils_broker_print_debug(parser->cfg);
+  }
+  free(parser->js);
+  parser->js = NULL;
+
+  return ret;
+}
+
+/* Read the broker response (JSON), the beginning of the stream is checked
+   for error messages once it was read (a single request per broker response).
+   With a tokenizer every chunk is tokenized as soon as it was read, otherwise
+   the response is returned as null-terminated buffer */
+static int broker_json_read(char *broker_url, char **json, size_t *len,
+                            broker_parser_t *parser)
 {
   /* Open the broker request URL and allocate enough memory */
   io_t *file_io = wandio_create(broker_url);
-  int length = 0, ret = 0;
+  if (!file_io) {
+    std_print("Error: Could not open %s for reading\n", broker_url);
+    return -1;
+  }
+  int64_t ret = 0;
+  size_t length = 0;
   char *json_file = NULL;
   char *buf = (char *)malloc(BROKER_JSON_BUF_SIZE);
   if (!buf) {
     std_print("%s", "Error: Could not allocate enough memory\n");
+    wandio_destroy(file_io);
     return -1;
   }
 
-  /* Read the JSON file into a corresponding buffer */
+  /* Read the JSON file into a corresponding buffer (only its beginning with
+     a tokenizer) */
+  int checked = 0;
   while (1) {
     ret = wandio_read(file_io, buf, BROKER_JSON_BUF_SIZE);
     if (ret < 0) {
       std_print("%s", "ERROR: Could not read JSON file from broker\n");
-      return -1;
+      break;
     }
     if (!ret) {
       break;
     }
-    if (!(json_file = realloc(json_file, length + ret + 2))) {
+    if (checked && parser != NULL) {
+      if (broker_parser_feed(parser, buf, ret) != 0) {
+        ret = -1;
+        break;
+      }
+      continue;
+    }
+    char *tmp = realloc(json_file, length + ret + 2);
+    if (!tmp) {
       std_print("%s", "ERROR: Could not realloc JSON string\n");
-      return -1;
+      ret = -1;
+      break;
     }
-    strncpy(json_file + length, buf, ret);
+    json_file = tmp;
+    memcpy(json_file + length, buf, ret);
     length += ret;
+    if (!checked && length >= BROKER_ERR_MSG_LEN - 1) {
+      checked = 1;
+      if (utils_broker_check_response(json_file, length) != 0) {
+        ret = -1;
+        break;
+      }
+    }
+    if (checked && parser != NULL) {
+      if (broker_parser_feed(parser, json_file, length) != 0) {
+        ret = -1;
+        break;
+      }
+      length = 0;
+    }
+  }
+  if (ret >= 0 && !checked && json_file != NULL) {
+    if (utils_broker_check_response(json_file, length) != 0) {
+      ret = -1;
+    } else if (parser != NULL &&
+               broker_parser_feed(parser, json_file, length) != 0) {
+      ret = -1;
+    }
   }
-  json_file[length] = '\0';
 
-  /* Destroy all superfluous memory allocations and start the parsing process */
+  /* Destroy all superfluous memory allocations */
   free(buf);
   wandio_destroy(file_io);
-  ret = broker_parse_json(cfg, json_file);
-  free(json_file);
+  if (parser != NULL || ret < 0 || json_file == NULL) {
+    free(json_file);
+    return ret < 0 || (parser == NULL && json_file == NULL) ? -1 : 0;
+  }
+  json_file[length] = '\0';
+  *json = json_file;
+  *len = length;
+  return 0;
+}
 
+int broker_connect(rpki_cfg_t *cfg, char *collector, char *time_intervals)
+{
+  /* Build the broker request URL */
+  char broker_url[BROKER_REQUEST_URL_LEN] = {0};
+  snprintf(broker_url, sizeof(broker_url),
+           "%scollector=%s&interval=%s", cfg->cfg_broker.broker_url,
+           collector, time_intervals);
+
+  /* Final broker responses are read from the cache */
+  int cacheable = broker_cacheable(cfg, time_intervals);
+  char cache_path[CACHE_MAX_PATH_LEN];
+  if (cacheable && cache_lookup(&cfg->cache, broker_url, "json", cache_path,
+                                sizeof(cache_path)) == 0) {
+    char *json_file = cache_read_buf(cache_path, NULL);
+    if (json_file != NULL) {
+      int ret = broker_parse_json(cfg, json_file);
+      free(json_file);
+      return ret;
+    }
+  }
+
+  /* Errors of the broker are detected while the response is read */
+  if (!cacheable) {
+    return broker_json_buf(cfg, broker_url);
+  }
+
+  /* Store valid broker responses in the cache */
+  size_t length = 0;
+  char *json_file = NULL;
+  if (broker_json_read(broker_url, &json_file, &length, NULL) != 0) {
+    return -1;
+  }
+  int ret = broker_parse_json(cfg, json_file);
+  if (!ret && cache_store_buf(&cfg->cache, broker_url, "json", json_file,
+                              length) == 0) {
+    cache_evict(&cfg->cache);
+  }
+  free(json_file);
   return ret;
 }
 
+int broker_json_buf(rpki_cfg_t *cfg, char *broker_url)
+{
+  /* The response is tokenized while it is read */
+  broker_parser_t parser;
+  broker_parser_init(&parser, cfg);
+  if (broker_json_read(broker_url, NULL, NULL, &parser) != 0) {
+    free(parser.js);
+    return -1;
+  }
+
+  return broker_parser_finish(&parser);
+}
+
 int broker_parse_json(rpki_cfg_t *cfg, char *js)
 {
-  /* Initialize the jsmn parser and allocate enough memory */
-  int tok_nr = 256;
-  jsmn_parser parser;
-  jsmn_init(&parser);
-  jsmntok_t *tokens = malloc(sizeof(jsmntok_t) * tok_nr);
-  if (!tokens) {
-    std_print("%s", "Error: Could not allocate enough memory\n");
+  broker_parser_t parser;
+  broker_parser_init(&parser, cfg);
+  if (broker_parser_feed(&parser, js, strlen(js)) != 0) {
+    free(parser.js);
     return -1;
   }
 
-  /* Parse the JSON file and realloc the tokens if necessary */
-  int ret = jsmn_parse(&parser, js, strlen(js), tokens, tok_nr);
-  while (ret == JSMN_ERROR_NOMEM) {
-    tokens = realloc(tokens, sizeof(jsmntok_t) * (tok_nr *= 2));
-    if (!tokens) {
-      std_print("%s", "Error: Could not allocate enough memory\n");
-      return -1;
+  return broker_parser_finish(&parser);
+}
+
+/* Start of the first window at or after a timestamp, the windows only cover
+   the configured intervals (0 = no window is left, an open interval ends at
+   the current time) */
+static uint32_t broker_window_first(rpki_cfg_t *cfg, uint32_t from)
+{
+  config_input_t *input = &cfg->cfg_input;
+  uint32_t now = (uint32_t)time(NULL);
+  uint32_t start = 0;
+  for (int i = 0; i < input->intervals_count; i += 2) {
+    uint32_t end = i + 1 < input->intervals_count ? input->intervals[i + 1] : 0;
+    uint32_t first = input->intervals[i] > from ? input->intervals[i] : from;
+    if ((end && first > end) || (!end && first > now)) {
+      continue;
+    }
+    if (!start || first < start) {
+      start = first;
     }
-    ret = jsmn_parse(&parser, js, strlen(js), tokens, tok_nr);
-  }
-  if (ret == JSMN_ERROR_INVAL || ret == JSMN_ERROR_PART) {
-    std_print("%s", "Error: invalid JSON format\n");
-    return -1;
   }
+  return start;
+}
 
-  /* If some JSON fields are missing, stop the parsing process */
-  if (ret < 12) {
-    std_print("%s", "Error: invalid response of the broker\n");
-    return -1;
+/* Latest timestamp of the broker index */
+static uint32_t broker_window_latest(config_broker_t *broker)
+{
+  broker_index_t *index = &broker->index;
+  return index->count ? index->entries[index->count - 1].timestamp : 0;
+}
+
+/* Free the separate configuration of a window */
+static void broker_window_free(rpki_cfg_t *win)
+{
+  broker_index_free(&win->cfg_broker.index);
+  free(win);
+}
+
+/* Request the broker response of a window */
+static void *broker_window_worker(void *data)
+{
+  broker_window_t *window = (broker_window_t *)data;
+  rpki_cfg_t *win = window->cfg;
+  window->ret = broker_connect(win, win->cfg_input.broker_collectors,
+                               window->intervals);
+  return NULL;
+}
+
+/* Fetch the window starting at a timestamp in the background */
+static int broker_window_fetch(rpki_cfg_t *cfg, uint32_t start)
+{
+  config_input_t *input = &cfg->cfg_input;
+  broker_window_t *window = &cfg->cfg_broker.window;
+  window->start = start;
+  window->end = start + (input->window - 1);
+  if (window->end < start) {
+    window->end = UINT32_MAX;
   }
+  window->ret = 0;
 
-  if (ret == 13) {
-    std_print("%s", "Info: There are no ROA dumps for the interval\n");
+  /* Request the parts of the configured intervals within the window */
+  size_t len = 0;
+  window->intervals[0] = '\0';
+  for (int i = 0; i < input->intervals_count; i += 2) {
+    uint32_t end = i + 1 < input->intervals_count ? input->intervals[i + 1] : 0;
+    uint32_t first = input->intervals[i] > start ? input->intervals[i] : start;
+    uint32_t last = !end || end > window->end ? window->end : end;
+    if (first > last) {
+      continue;
+    }
+    len += snprintf(window->intervals + len, sizeof(window->intervals) - len,
+                    "%s%" PRIu32 "-%" PRIu32, len ? "," : "", first, last);
   }
 
-  /* Broker Response Scheme:
-     01 : Projects   - 02 Value
-     03 : Collectors - 04 Value
-     05 : Interval   - 06 Value
-     07 : start      - 08 Value
-     09 : max_end    - 10 Value
-     11 : data       - 12 object
-     13 : #1 TS      - 14 #1 URL <-- Start of the ROA URLs
-     15 : #2 TS      - 16 #2 URL */
+  /* The broker response is parsed into a separate configuration with the
+     same input, broker URL and cache */
+  rpki_cfg_t *win = calloc(1, sizeof(rpki_cfg_t));
+  if (win == NULL) {
+    std_print("%s", "Error: Could not allocate enough memory\n");
+    return -1;
+  }
+  memcpy(&win->cfg_input, input, sizeof(win->cfg_input));
+  memcpy(&win->cache, &cfg->cache, sizeof(win->cache));
+  broker_index_init(&win->cfg_broker.index);
+  snprintf(win->cfg_broker.broker_url, sizeof(win->cfg_broker.broker_url),
+           "%s", cfg->cfg_broker.broker_url);
+  window->cfg = win;
+  if (pthread_create(&window->thread, NULL, broker_window_worker, window) !=
+      0) {
+    std_print("%s", "Error: Could not start the fetch of the broker window\n");
+    broker_window_free(win);
+    window->cfg = NULL;
+    return -1;
+  }
+  window->running = 1;
+  debug_print("Fetching broker window: %s\n", window->intervals);
+  return 0;
+}
 
-  /* Initialize the broker result khash table */
+/* Replace the broker index by its entries from a timestamp on and the entries
+   of a window */
+static int broker_window_merge(rpki_cfg_t *cfg, rpki_cfg_t *win,
+                               uint32_t keep_ts)
+{
+  /* Remove the entries preceding the timestamp */
   config_broker_t *broker = &cfg->cfg_broker;
-  if (!broker->broker_khash_init) {
-    broker->broker_kh = kh_init(broker_result);
-    broker->broker_khash_init = 1;
-  } else {
-    kh_clear(broker_result, broker->broker_kh);
-  }
-  broker->broker_khash_count = 0;
-  int kh_ret = 0;
-  khiter_t k;
+  broker_index_remove(&broker->index, keep_ts);
 
-  /* Realloc RPKI config URLs if necessary */
-  if (ret > BROKER_ROA_URLS_COUNT) {
-    broker->roa_urls = realloc(broker->roa_urls, sizeof(char *) * ret);
-    for (int i = 0; i < ret; i++) {
-      broker->roa_urls[i] = malloc(BROKER_ROA_URLS_LEN * sizeof(char));
+  /* Add the entries of the window */
+  broker_index_t *win_index = &win->cfg_broker.index;
+  char urls[BROKER_ROA_URLS_LEN];
+  for (size_t i = 0; i < win_index->count; i++) {
+    if (broker_index_urls(win_index, i, urls, sizeof(urls)) != 0 ||
+        broker_put_url(cfg, win_index->entries[i].timestamp, urls,
+                       strlen(urls)) != 0) {
+      return -1;
     }
-    broker->roa_urls_count = ret;
   }
 
-  /* Add projects in broker-sorted order
-     The broker varies the project order to always ensure an uniform order */
+  /* Projects and collectors in broker-sorted order (order of the URLs) */
   config_input_t *input = &cfg->cfg_input;
-  jsmntok_t value = tokens[2];
-  int length = value.end - value.start;
-  char projects[length + 1];
-  memcpy(projects, &js[value.start], length);
-  projects[length] = '\0';
-  size_t input_max_size = sizeof(input->broker_projects);
-  input->projects_count = utils_broker_add_projects_collectors(projects,
-                                  input->broker_projects, ",", input->projects);
+  config_input_t *win_input = &win->cfg_input;
+  memcpy(input->broker_projects, win_input->broker_projects,
+         sizeof(input->broker_projects));
+  memcpy(input->projects, win_input->projects, sizeof(input->projects));
+  input->projects_count = win_input->projects_count;
+  memcpy(input->broker_collectors, win_input->broker_collectors,
+         sizeof(input->broker_collectors));
+  memcpy(input->collectors, win_input->collectors, sizeof(input->collectors));
+  input->collectors_count = win_input->collectors_count;
 
-  /* Add collectors in broker-sorted order
-     The broker varies the collectors order to always ensure an uniform order */
-  value = tokens[4];
-  length = value.end - value.start;
-  char collectors[length + 1];
-  memcpy(collectors, &js[value.start], length);
-  collectors[length] = '\0';
-  input->collectors_count = utils_broker_add_projects_collectors(collectors,
-                              input->broker_collectors, ",", input->collectors);
+  return 0;
+}
 
-  /* Add intervals in broker-sorted order without duplicates etc. */
-  value = tokens[6];
-  length = value.end - value.start;
-  char intervals[length + 1];
-  memcpy(intervals, &js[value.start], length);
-  intervals[length] = '\0';
-  if(utils_cfg_check_intervals(cfg, intervals) != 0) {
-    std_print("%s", "Error: Invalid interval in the broker response\n");
+int broker_window_init(rpki_cfg_t *cfg)
+{
+  /* Clear the broker index */
+  config_broker_t *broker = &cfg->cfg_broker;
+  broker_index_clear(&broker->index);
+  broker->index_used = 0;
+
+  /* The configured intervals are kept, every broker response only covers a
+     window of them */
+  config_input_t *input = &cfg->cfg_input;
+  uint32_t start = broker_window_first(cfg, 0);
+  if (!start) {
+    std_print("%s", "Error: No broker window in the configured intervals\n");
     return -1;
   }
-  
-  /* Add first timestamp of broker response */
-  value = tokens[8];
-  length = value.end - value.start;
-  char timestamp[length + 1];
-  memcpy(timestamp, &js[value.start], length);
-  timestamp[length] = '\0';
-  if (utils_cfg_validity_check_val(timestamp, &cfg->cfg_time.start, 32) != 0) {
-    std_print("%s", "Error: Invalid timestamp in the broker response\n");
+  cfg->cfg_time.start = input->intervals[0];
+  cfg->cfg_time.max_end = input->intervals_count % 2
+                            ? 0 : input->intervals[input->intervals_count - 1];
+  broker->window_start = start;
+
+  /* Fetch the first window at once and the following one in the background */
+  if (broker_window_fetch(cfg, start) != 0 ||
+      broker_window_next(cfg, 0) < 0) {
     return -1;
   }
+  return 0;
+}
 
-  /* Add latest timestamp of broker response */
-  value = tokens[10];
-  length = value.end - value.start;
-  memcpy(timestamp, &js[value.start], length);
-  timestamp[length] = '\0';
-  if (utils_cfg_validity_check_val(timestamp, &cfg->cfg_time.max_end, 32) !=
-      0) {
-    std_print("%s", "Error: Invalid timestamp in the broker response\n");
+int broker_window_next(rpki_cfg_t *cfg, uint32_t keep_ts)
+{
+  config_broker_t *broker = &cfg->cfg_broker;
+  broker_window_t *window = &broker->window;
+  if (!window->running) {
+    return 0;
+  }
+  pthread_join(window->thread, NULL);
+  window->running = 0;
+  rpki_cfg_t *win = window->cfg;
+  window->cfg = NULL;
+  int ret = window->ret != 0 ? -1 : broker_window_merge(cfg, win, keep_ts);
+  broker_window_free(win);
+  if (ret != 0) {
     return -1;
   }
+  if (keep_ts > broker->window_start) {
+    broker->window_start = keep_ts;
+  }
+  broker->window_end = window->end;
+  debug_print("Broker window: %" PRIu32 " - %" PRIu32 " (%zu entries)\n",
+              broker->window_start, broker->window_end, broker->index.count);
 
-  /* Add all timestamps as key and the URL as value to Khash */
-  for (int i = 13; i < ret; i += 2) {
-    jsmntok_t key = tokens[i];
-    int length = key.end - key.start;
-    char ts[length + 1];
-    memcpy(ts, &js[key.start], length);
-    ts[length] = '\0';
-    uint64_t timestamp = atoi(ts);
-    k = kh_put(broker_result, broker->broker_kh, timestamp, &kh_ret);
-    kh_val(broker->broker_kh, k) = '\0';
-
-    jsmntok_t value = tokens[i + 1];
-    length = value.end - value.start;
-    char url[length + 1];
-    memcpy(url, &js[value.start], length);
-    url[length] = '\0';
-    sprintf(broker->roa_urls[broker->broker_khash_count], "%s", url);
-    kh_val(broker->broker_kh, k) = broker->roa_urls[broker->broker_khash_count];
-    broker->broker_khash_count++;
+  /* Fetch the following window in the background */
+  uint32_t next = 0;
+  if (window->end < UINT32_MAX) {
+    next = broker_window_first(cfg, window->end + 1);
+  }
+  if (next && broker_window_fetch(cfg, next) != 0) {
+    return -1;
   }
+  return 1;
+}
 
-  utils_broker_print_debug(cfg);
-  free(tokens);
+int broker_window_seek(rpki_cfg_t *cfg, uint32_t timestamp)
+{
+  config_broker_t *broker = &cfg->cfg_broker;
+  broker_window_t *window = &broker->window;
+  while (window->running && timestamp > broker->window_end) {
 
+    /* The latest entry precedes the timestamp, a timestamp beyond the next
+       window restarts the windows with the one ending at the timestamp */
+    uint32_t keep_ts = broker_window_latest(broker);
+    if (timestamp > window->end) {
+      broker_window_cancel(cfg);
+      uint32_t start = timestamp > cfg->cfg_input.window
+                         ? timestamp - cfg->cfg_input.window + 1 : 0;
+      if (!(start = broker_window_first(cfg, start)) ||
+          broker_window_fetch(cfg, start) != 0) {
+        return -1;
+      }
+      keep_ts = start;
+    }
+    if (broker_window_next(cfg, keep_ts) < 0) {
+      return -1;
+    }
+  }
   return 0;
 }
+
+void broker_window_cancel(rpki_cfg_t *cfg)
+{
+  broker_window_t *window = &cfg->cfg_broker.window;
+  if (window->running) {
+    pthread_join(window->thread, NULL);
+    window->running = 0;
+  }
+  if (window->cfg != NULL) {
+    broker_window_free(window->cfg);
+    window->cfg = NULL;
+  }
+}
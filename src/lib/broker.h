@@ -30,13 +30,58 @@
 #ifndef __BROKER_H
 #define __BROKER_H
 
+#include <pthread.h>
 #include <stdint.h>
 
+#include "broker_index.h"
 #include "elem.h"
 
-/** Initialising the Broker result khash */
-KHASH_INIT(broker_result, khint64_t, char *, 1, kh_int64_hash_func,
-           kh_int64_hash_equal)
+/** A window of the broker index fetched in the background */
+typedef struct struct_broker_window_t {
+
+  /** Worker
+   *
+   * Thread fetching the broker response of the window
+   */
+  pthread_t thread;
+
+  /** Running flag
+   *
+   * Whether the worker was started and not joined yet (0 = no, 1 = yes)
+   */
+  int running;
+
+  /** Window configuration
+   *
+   * Separate configuration the broker response of the window is parsed into
+   */
+  struct struct_rpki_config_t *cfg;
+
+  /** Start
+   *
+   * First timestamp of the window
+   */
+  uint32_t start;
+
+  /** End
+   *
+   * Last timestamp of the window
+   */
+  uint32_t end;
+
+  /** Intervals
+   *
+   * Parts of the configured intervals within the window (broker request)
+   */
+  char intervals[MAX_TIME_WINDOWS * MAX_INPUT_LENGTH];
+
+  /** Result
+   *
+   * Result of the broker request (0 = success, -1 = failure)
+   */
+  int ret;
+
+} broker_window_t;
 
 /** A RPKI broker result object */
 typedef struct struct_config_broker_t {
@@ -65,41 +110,35 @@ typedef struct struct_config_broker_t {
    */
   char info_port[BROKER_INFO_RESP_PORT_LEN];
 
-  /** Broker result khash
+  /** Broker index
    *
-   * Broker result hashtable (UTC epoch timestamp -> ROA-URLS)
+   * Broker result index (UTC epoch timestamp -> ROA-URLS)
    */
-  khash_t(broker_result) * broker_kh;
+  broker_index_t index;
 
-  /** Broker khash count
+  /** Index used
    *
-   * Number of different entries in the broker khash
+   * Number of entries in the broker index already used for validation
    */
-  int broker_khash_count;
+  int index_used;
 
-  /** Broker khash used
+  /** Window start
    *
-   * Number of entries in the broker khash already used for validation
+   * First timestamp held by the windowed broker index (0 = not windowed)
    */
-  int broker_khash_used;
+  uint32_t window_start;
 
-  /** Broker khash init
+  /** Window end
    *
-   * Initialization status of the broker result hashtable
+   * Last timestamp fetched into the windowed broker index
    */
-  int broker_khash_init;
+  uint32_t window_end;
 
-  /** Configuration ROA URLs
+  /** Next window
    *
-   * All ROA URLs - response of the broker service
+   * Window of the broker index fetched in the background
    */
-  char **roa_urls;
-
-  /** ROA URLs count
-   *
-   * Number of initialized ROA URLs
-   */
-  int roa_urls_count;
+  broker_window_t window;
 
 } config_broker_t;
 
@@ -116,7 +155,8 @@ typedef struct struct_rpki_config_t rpki_cfg_t;
  */
 int broker_connect(rpki_cfg_t *cfg, char *collector, char *time_intervals);
 
-/** Read the broker response (JSON) into a buffer
+/** Read and parse the broker response (JSON) chunk by chunk (the ROA URLs are
+ *  added while the response is read)
  *
  * @param[in] cfg            Pointer to the configuration struct
  * @param[in] broker_url     Broker request URL
@@ -124,8 +164,40 @@ int broker_connect(rpki_cfg_t *cfg, char *collector, char *time_intervals);
  */
 int broker_json_buf(rpki_cfg_t *cfg, char *broker_url);
 
-/** Parse the JSON buffer and stores all values in the broker result khash
- * table
+/** Fetch the first window of the broker index (option window), the following
+ *  window is fetched in the background
+ *
+ * @param[in/out] cfg        Pointer to the configuration struct
+ * @return                   0 if the first window was fetched, otherwise -1
+ */
+int broker_window_init(rpki_cfg_t *cfg);
+
+/** Add the window fetched in the background to the broker index and fetch the
+ *  following one, all entries older than a timestamp are removed
+ *
+ * @param[in/out] cfg        Pointer to the configuration struct
+ * @param[in] keep_ts        Oldest timestamp kept in the broker index
+ * @return                   1 if a window was added, 0 if there is no window
+ *                           left, otherwise -1
+ */
+int broker_window_next(rpki_cfg_t *cfg, uint32_t keep_ts);
+
+/** Fetch the windows of the broker index up to a timestamp (the entry
+ *  preceding the timestamp is kept), a window far ahead is fetched at once
+ *
+ * @param[in/out] cfg        Pointer to the configuration struct
+ * @param[in] timestamp      Timestamp which has to be in the broker index
+ * @return                   0 if the windows were fetched, otherwise -1
+ */
+int broker_window_seek(rpki_cfg_t *cfg, uint32_t timestamp);
+
+/** Stop the fetch of the next window of the broker index
+ *
+ * @param[in/out] cfg        Pointer to the configuration struct
+ */
+void broker_window_cancel(rpki_cfg_t *cfg);
+
+/** Parse the JSON buffer and stores all values in the broker index
  *
  * @param[in/out] cfg        Pointer to the configuration struct
  * @param[in] js             Pointer to the JSON buffer
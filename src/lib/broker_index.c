@@ -0,0 +1,446 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "broker_index.h"
+
+/** Initial number of entries of a broker index */
+#define BROKER_INDEX_INIT_SIZE 1024
+
+/** Number of recent sets of URL templates an entry is matched with */
+#define BROKER_INDEX_TEMPLATE_SEARCH 8
+
+/** Max number of sets of URL templates (further entries are verbatim) */
+#define BROKER_INDEX_TEMPLATE_MAX 64
+
+/** Max length of a date of a ROA URL */
+#define BROKER_INDEX_DATE_LEN 32
+
+/** Date formats replaced in the ROA URLs (longest first) */
+static const char *broker_index_formats[] = {
+  "%Y%m%d.%H%M", "%Y%m%d%H%M", "%Y-%m-%d", "%Y/%m/%d",
+  "%Y%m%d",      "%Y.%m",      "%Y/%m",    "%Y-%m",
+};
+
+#define BROKER_INDEX_FORMATS                                                   \
+  (sizeof(broker_index_formats) / sizeof(broker_index_formats[0]))
+
+/* Render ROA URLs from URL templates (collectors without a ROA dump get the
+   placeholder of the broker) */
+static int broker_index_render(char *const *templates, uint32_t avail,
+                               int fields, const char *missing,
+                               int missing_len, const struct tm *tm,
+                               char *dest, size_t size)
+{
+  size_t len = 0;
+  for (int i = 0; i < fields; i++) {
+    if (i) {
+      if (len + 1 >= size) {
+        return -1;
+      }
+      dest[len++] = ',';
+    }
+    if (avail & (1U << i)) {
+      size_t n = strftime(dest + len, size - len, templates[i], tm);
+      if (!n) {
+        return -1;
+      }
+      len += n;
+    } else {
+      if (len + missing_len >= size) {
+        return -1;
+      }
+      memcpy(dest + len, missing, missing_len);
+      len += missing_len;
+    }
+  }
+  if (len >= size) {
+    return -1;
+  }
+  dest[len] = '\0';
+  return 0;
+}
+
+/* Derive the URL template of a ROA URL by replacing the dates of its
+   timestamp by their formats (returns the length of the template) */
+static size_t broker_index_template(const char *url, size_t len,
+                                    char dates[][BROKER_INDEX_DATE_LEN],
+                                    const size_t *date_lens, char *tpl,
+                                    size_t size, int *dated)
+{
+  size_t n = 0;
+  for (size_t i = 0; i < len;) {
+    const char *format = NULL;
+    size_t f = 0;
+    for (; url[i] >= '0' && url[i] <= '9' && f < BROKER_INDEX_FORMATS; f++) {
+      if (date_lens[f] && date_lens[f] <= len - i &&
+          !memcmp(url + i, dates[f], date_lens[f])) {
+        format = broker_index_formats[f];
+        break;
+      }
+    }
+    size_t add = format != NULL ? strlen(format) : (url[i] == '%' ? 2 : 1);
+    if (n + add >= size) {
+      return 0;
+    }
+    if (format != NULL) {
+      memcpy(tpl + n, format, add);
+      i += date_lens[f];
+      *dated = 1;
+    } else {
+      tpl[n] = url[i];
+      if (url[i++] == '%') {
+        tpl[n + 1] = '%';
+      }
+    }
+    n += add;
+  }
+  tpl[n] = '\0';
+  return n;
+}
+
+/* Find a set of URL templates matching the ones of an entry (the most recent
+   sets are searched), a set is extended by unknown URL templates and a new
+   set is added if none matches (only if every URL template has a date, the
+   others are hardly shared by further entries, and up to a limit) */
+static int broker_index_templates(broker_index_t *index, char *const *urls,
+                                  uint32_t avail, int dated)
+{
+  int first = index->templates_count - BROKER_INDEX_TEMPLATE_SEARCH;
+  for (int s = index->templates_count - 1; s >= 0 && s >= first; s--) {
+    broker_templates_t *set = &index->templates[s];
+    int match = 1;
+    for (int i = 0; i < MAX_RPKI_COUNT && match; i++) {
+      match = (!(avail & (1U << i)) || set->urls[i] == NULL ||
+               !strcmp(set->urls[i], urls[i]));
+    }
+    if (!match) {
+      continue;
+    }
+    for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+      if ((avail & (1U << i)) && set->urls[i] == NULL &&
+          (set->urls[i] = strdup(urls[i])) == NULL) {
+        return -1;
+      }
+    }
+    return s;
+  }
+
+  /* Add a new set of URL templates */
+  if (!dated || index->templates_count == BROKER_INDEX_TEMPLATE_MAX) {
+    return -1;
+  }
+  if (index->templates_count == index->templates_size) {
+    int size = index->templates_size ? index->templates_size * 2 : 1;
+    broker_templates_t *tmp =
+      realloc(index->templates, size * sizeof(broker_templates_t));
+    if (tmp == NULL) {
+      return -1;
+    }
+    index->templates = tmp;
+    index->templates_size = size;
+  }
+  broker_templates_t *set = &index->templates[index->templates_count];
+  memset(set, 0, sizeof(*set));
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    if ((avail & (1U << i)) && (set->urls[i] = strdup(urls[i])) == NULL) {
+      for (int j = 0; j < i; j++) {
+        free(set->urls[j]);
+      }
+      return -1;
+    }
+  }
+  return index->templates_count++;
+}
+
+/* Store the ROA URLs of an entry as URL templates, the templates are checked
+   by rendering the ROA URLs (-1 if the ROA URLs are stored verbatim) */
+static int broker_index_compact(broker_index_t *index, broker_entry_t *entry,
+                                const char *urls, size_t len)
+{
+  /* All dates of the timestamp */
+  struct tm tm;
+  time_t ts = entry->timestamp;
+  char dates[BROKER_INDEX_FORMATS][BROKER_INDEX_DATE_LEN];
+  size_t date_lens[BROKER_INDEX_FORMATS];
+  if (len >= BROKER_ROA_URLS_LEN || gmtime_r(&ts, &tm) == NULL) {
+    return -1;
+  }
+  for (size_t f = 0; f < BROKER_INDEX_FORMATS; f++) {
+    date_lens[f] = strftime(dates[f], sizeof(dates[f]),
+                            broker_index_formats[f], &tm);
+  }
+
+  /* The URL template of every ROA URL (a collector without a ROA dump has
+     the placeholder of the broker) */
+  char buf[BROKER_ROA_URLS_LEN];
+  char *templates[MAX_RPKI_COUNT] = {NULL};
+  char missing[2];
+  int missing_len = index->missing_len;
+  memcpy(missing, index->missing, sizeof(missing));
+  size_t n = 0;
+  int fields = 0, dated = 1;
+  uint32_t avail = 0;
+  for (size_t start = 0; start <= len; fields++) {
+    const char *url = urls + start;
+    const char *next = memchr(url, ',', len - start);
+    size_t url_len = next != NULL ? (size_t)(next - url) : len - start;
+    if (fields == MAX_RPKI_COUNT) {
+      return -1;
+    }
+    if (url_len > 1) {
+      int url_dated = 0;
+      size_t tpl_len = broker_index_template(url, url_len, dates, date_lens,
+                                             buf + n, sizeof(buf) - n,
+                                             &url_dated);
+      if (!tpl_len) {
+        return -1;
+      }
+      dated &= url_dated;
+      templates[fields] = buf + n;
+      avail |= 1U << fields;
+      n += tpl_len + 1;
+    } else if (missing_len < 0) {
+      memcpy(missing, url, url_len);
+      missing_len = url_len;
+    } else if (missing_len != (int)url_len || memcmp(missing, url, url_len)) {
+      return -1;
+    }
+    start += url_len + 1;
+  }
+
+  /* The rendered ROA URLs have to equal the ROA URLs */
+  char check[BROKER_ROA_URLS_LEN];
+  if (broker_index_render(templates, avail, fields, missing, missing_len, &tm,
+                          check, sizeof(check)) != 0 ||
+      strlen(check) != len || memcmp(check, urls, len)) {
+    return -1;
+  }
+  int set = broker_index_templates(index, templates, avail, dated);
+  if (set < 0) {
+    return -1;
+  }
+  memcpy(index->missing, missing, sizeof(missing));
+  index->missing_len = missing_len;
+  entry->avail = avail;
+  entry->templates = set;
+  entry->fields = fields;
+  return 0;
+}
+
+/* Store the ROA URLs of an entry verbatim */
+static int broker_index_verbatim(broker_index_t *index, broker_entry_t *entry,
+                                 const char *urls, size_t len)
+{
+  if (index->pool_len + len + 1 > UINT32_MAX - 1) {
+    return -1;
+  }
+  if (index->pool_len + len + 1 > index->pool_size) {
+    size_t size = index->pool_size ? index->pool_size * 2 : BROKER_ROA_URLS_LEN;
+    while (size < index->pool_len + len + 1) {
+      size *= 2;
+    }
+    char *tmp = realloc(index->pool, size);
+    if (tmp == NULL) {
+      return -1;
+    }
+    index->pool = tmp;
+    index->pool_size = size;
+  }
+  memcpy(index->pool + index->pool_len, urls, len);
+  index->pool[index->pool_len + len] = '\0';
+  entry->verbatim = index->pool_len + 1;
+  index->pool_len += len + 1;
+  return 0;
+}
+
+void broker_index_init(broker_index_t *index)
+{
+  memset(index, 0, sizeof(*index));
+  index->missing_len = -1;
+}
+
+void broker_index_clear(broker_index_t *index)
+{
+  for (int s = 0; s < index->templates_count; s++) {
+    for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+      free(index->templates[s].urls[i]);
+    }
+  }
+  index->templates_count = 0;
+  index->count = 0;
+  index->pool_len = 0;
+  index->missing_len = -1;
+}
+
+void broker_index_free(broker_index_t *index)
+{
+  broker_index_clear(index);
+  free(index->entries);
+  free(index->templates);
+  free(index->pool);
+  broker_index_init(index);
+}
+
+int broker_index_add(broker_index_t *index, uint32_t timestamp,
+                     const char *urls, size_t len)
+{
+  broker_entry_t entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.timestamp = timestamp;
+  if (broker_index_compact(index, &entry, urls, len) != 0 &&
+      broker_index_verbatim(index, &entry, urls, len) != 0) {
+    return -1;
+  }
+
+  /* Entries are appended in chronological order, otherwise inserted */
+  size_t pos = broker_index_lower(index, timestamp);
+  if (pos < index->count && index->entries[pos].timestamp == timestamp) {
+    index->entries[pos] = entry;
+    return 0;
+  }
+  if (index->count == index->size) {
+    size_t size = index->size ? index->size * 2 : BROKER_INDEX_INIT_SIZE;
+    broker_entry_t *tmp = realloc(index->entries, size * sizeof(entry));
+    if (tmp == NULL) {
+      return -1;
+    }
+    index->entries = tmp;
+    index->size = size;
+  }
+  memmove(&index->entries[pos + 1], &index->entries[pos],
+          (index->count - pos) * sizeof(entry));
+  index->entries[pos] = entry;
+  index->count++;
+  return 0;
+}
+
+size_t broker_index_lower(const broker_index_t *index, uint32_t timestamp)
+{
+  size_t lo = 0, hi = index->count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (index->entries[mid].timestamp < timestamp) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+int broker_index_find(const broker_index_t *index, uint32_t timestamp)
+{
+  size_t pos = broker_index_lower(index, timestamp);
+  if (pos == index->count || index->entries[pos].timestamp != timestamp) {
+    return -1;
+  }
+  return (int)pos;
+}
+
+int broker_index_floor(const broker_index_t *index, uint32_t timestamp)
+{
+  size_t pos = broker_index_lower(index, timestamp);
+  if (pos < index->count && index->entries[pos].timestamp == timestamp) {
+    return (int)pos;
+  }
+  return (int)pos - 1;
+}
+
+int broker_index_urls(const broker_index_t *index, size_t pos, char *dest,
+                      size_t size)
+{
+  const broker_entry_t *entry = &index->entries[pos];
+  if (entry->verbatim) {
+    const char *urls = index->pool + entry->verbatim - 1;
+    size_t len = strlen(urls);
+    if (len >= size) {
+      return -1;
+    }
+    memcpy(dest, urls, len + 1);
+    return 0;
+  }
+  struct tm tm;
+  time_t ts = entry->timestamp;
+  if (gmtime_r(&ts, &tm) == NULL) {
+    return -1;
+  }
+  return broker_index_render(index->templates[entry->templates].urls,
+                             entry->avail, entry->fields, index->missing,
+                             index->missing_len, &tm, dest, size);
+}
+
+void broker_index_remove(broker_index_t *index, uint32_t timestamp)
+{
+  size_t pos = broker_index_lower(index, timestamp);
+  memmove(index->entries, &index->entries[pos],
+          (index->count - pos) * sizeof(broker_entry_t));
+  index->count -= pos;
+
+  /* Only the verbatim ROA URLs of the kept entries are copied into a new
+     pool (the pool is kept if there is not enough memory) */
+  if (!index->pool_len) {
+    return;
+  }
+  char *pool = malloc(index->pool_size);
+  if (pool == NULL) {
+    return;
+  }
+  size_t pool_len = 0;
+  for (size_t i = 0; i < index->count; i++) {
+    broker_entry_t *entry = &index->entries[i];
+    if (entry->verbatim) {
+      size_t len = strlen(index->pool + entry->verbatim - 1) + 1;
+      memcpy(pool + pool_len, index->pool + entry->verbatim - 1, len);
+      entry->verbatim = pool_len + 1;
+      pool_len += len;
+    }
+  }
+  free(index->pool);
+  index->pool = pool;
+  index->pool_len = pool_len;
+}
+
+size_t broker_index_memory(const broker_index_t *index)
+{
+  size_t size = index->size * sizeof(broker_entry_t) + index->pool_size +
+                index->templates_size * sizeof(broker_templates_t);
+  for (int s = 0; s < index->templates_count; s++) {
+    for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+      if (index->templates[s].urls[i] != NULL) {
+        size += strlen(index->templates[s].urls[i]) + 1;
+      }
+    }
+  }
+  return size;
+}
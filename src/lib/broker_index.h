@@ -0,0 +1,241 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __BROKER_INDEX_H
+#define __BROKER_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "constants.h"
+
+/** An entry of the broker index (the ROA URLs of a timestamp) */
+typedef struct struct_broker_entry_t {
+
+  /** Timestamp
+   *
+   * ROA timestamp of the entry (UTC epoch timestamp)
+   */
+  uint32_t timestamp;
+
+  /** Availability
+   *
+   * Bit mask of the collectors with a ROA dump (order of the collectors)
+   */
+  uint32_t avail;
+
+  /** Verbatim ROA URLs
+   *
+   * Offset of the ROA URLs in the verbatim pool plus one (0 = the ROA URLs
+   * are rendered from the URL templates)
+   */
+  uint32_t verbatim;
+
+  /** URL templates
+   *
+   * Index of the set of URL templates the ROA URLs are rendered from
+   */
+  uint16_t templates;
+
+  /** Field count
+   *
+   * Number of ROA URLs including the ones of collectors without a ROA dump
+   */
+  uint8_t fields;
+
+} broker_entry_t;
+
+/** A set of URL templates (one per collector) */
+typedef struct struct_broker_templates_t {
+
+  /** URL templates
+   *
+   * strftime formats of the ROA URLs of every collector (NULL = unknown)
+   */
+  char *urls[MAX_RPKI_COUNT];
+
+} broker_templates_t;
+
+/** The broker index (ROA URLs of all timestamps of a broker response) stored
+ *  as URL templates per collector and a sorted array of timestamps, the ROA
+ *  URLs are rendered on demand */
+typedef struct struct_broker_index_t {
+
+  /** Entries
+   *
+   * All entries sorted by their timestamp
+   */
+  broker_entry_t *entries;
+
+  /** Entry count
+   *
+   * Number of entries in the index
+   */
+  size_t count;
+
+  /** Entry size
+   *
+   * Number of allocated entries
+   */
+  size_t size;
+
+  /** URL templates
+   *
+   * Sets of URL templates of the entries
+   */
+  broker_templates_t *templates;
+
+  /** Template count
+   *
+   * Number of sets of URL templates
+   */
+  int templates_count;
+
+  /** Template size
+   *
+   * Number of allocated sets of URL templates
+   */
+  int templates_size;
+
+  /** Missing URL
+   *
+   * Placeholder of the broker for a collector without a ROA dump
+   */
+  char missing[2];
+
+  /** Missing URL length
+   *
+   * Length of the placeholder (-1 = not seen yet)
+   */
+  int missing_len;
+
+  /** Verbatim pool
+   *
+   * ROA URLs which do not match their URL templates (null-terminated)
+   */
+  char *pool;
+
+  /** Pool length
+   *
+   * Number of used bytes of the verbatim pool
+   */
+  size_t pool_len;
+
+  /** Pool size
+   *
+   * Number of allocated bytes of the verbatim pool
+   */
+  size_t pool_size;
+
+} broker_index_t;
+
+/** Initialize an empty broker index
+ *
+ * @param[out] index         Pointer to the broker index
+ */
+void broker_index_init(broker_index_t *index);
+
+/** Remove all entries and URL templates of a broker index (the entries stay
+ *  allocated)
+ *
+ * @param[in] index          Pointer to the broker index
+ */
+void broker_index_clear(broker_index_t *index);
+
+/** Free all entries and URL templates of a broker index
+ *
+ * @param[in] index          Pointer to the broker index
+ */
+void broker_index_free(broker_index_t *index);
+
+/** Add the ROA URLs of a timestamp to a broker index, an entry of the same
+ *  timestamp is replaced
+ *
+ * @param[in] index          Pointer to the broker index
+ * @param[in] timestamp      ROA timestamp (UTC epoch timestamp)
+ * @param[in] urls           ROA URLs (delimiter: ",", not null-terminated)
+ * @param[in] len            Length of the ROA URLs
+ * @return                   0 if the entry was added, otherwise -1
+ */
+int broker_index_add(broker_index_t *index, uint32_t timestamp,
+                     const char *urls, size_t len);
+
+/** Get the position of the first entry at or after a timestamp
+ *
+ * @param[in] index          Pointer to the broker index
+ * @param[in] timestamp      UTC epoch timestamp
+ * @return                   Position of the entry (the entry count if all
+ *                           entries precede the timestamp)
+ */
+size_t broker_index_lower(const broker_index_t *index, uint32_t timestamp);
+
+/** Get the position of the entry of a timestamp
+ *
+ * @param[in] index          Pointer to the broker index
+ * @param[in] timestamp      ROA timestamp (UTC epoch timestamp)
+ * @return                   Position of the entry, -1 if there is none
+ */
+int broker_index_find(const broker_index_t *index, uint32_t timestamp);
+
+/** Get the position of the latest entry at or before a timestamp
+ *
+ * @param[in] index          Pointer to the broker index
+ * @param[in] timestamp      UTC epoch timestamp
+ * @return                   Position of the entry, -1 if there is none
+ */
+int broker_index_floor(const broker_index_t *index, uint32_t timestamp);
+
+/** Render the ROA URLs of an entry
+ *
+ * @param[in]  index         Pointer to the broker index
+ * @param[in]  pos           Position of the entry
+ * @param[out] dest          Buffer of the ROA URLs (delimiter: ",")
+ * @param[in]  size          Size of the buffer
+ * @return                   0 if the ROA URLs were rendered, otherwise -1
+ */
+int broker_index_urls(const broker_index_t *index, size_t pos, char *dest,
+                      size_t size);
+
+/** Remove all entries preceding a timestamp from a broker index
+ *
+ * @param[in] index          Pointer to the broker index
+ * @param[in] timestamp      Timestamp of the oldest entry which is kept
+ */
+void broker_index_remove(broker_index_t *index, uint32_t timestamp);
+
+/** Get the memory used by a broker index
+ *
+ * @param[in] index          Pointer to the broker index
+ * @return                   Number of allocated bytes
+ */
+size_t broker_index_memory(const broker_index_t *index);
+
+/** @} */
+
+#endif /* __BROKER_INDEX_H */
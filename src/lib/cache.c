@@ -0,0 +1,317 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "debug.h"
+#include "roa_parser.h"
+#include "roa_snapshot.h"
+
+/** Name prefix of the links of all URLs */
+#define CACHE_URL_PREFIX "url-"
+
+/** Name prefix of all cached objects */
+#define CACHE_OBJ_PREFIX "obj-"
+
+/** A cached object considered for the eviction */
+typedef struct struct_cache_entry_t {
+
+  /** Name of the object */
+  char name[64];
+
+  /** Size of the object in bytes */
+  uint64_t size;
+
+  /** Time of the last use */
+  struct timespec used;
+
+} cache_entry_t;
+
+/* Build the name of an object (or of the link of a URL) from its hash */
+static int cache_name(char *name, size_t len, const char *prefix, uint64_t hash,
+                      const char *ext)
+{
+  int ret = snprintf(name, len, "%s%016" PRIx64 ".%s", prefix, hash, ext);
+  return ret < 0 || (size_t)ret >= len ? -1 : 0;
+}
+
+static int cache_join(char *path, size_t len, const cache_t *cache,
+                      const char *name)
+{
+  int ret = snprintf(path, len, "%s/%s", cache->dir, name);
+  return ret < 0 || (size_t)ret >= len ? -1 : 0;
+}
+
+int cache_init(cache_t *cache, const char *dir, uint64_t limit)
+{
+  memset(cache, 0, sizeof(cache_t));
+  if (strlen(dir) >= sizeof(cache->dir)) {
+    std_print("%s", "Error: Cache directory exceeds maximum length\n");
+    return -1;
+  }
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    std_print("Error: Could not create the cache directory %s\n", dir);
+    return -1;
+  }
+  snprintf(cache->dir, sizeof(cache->dir), "%s", dir);
+  cache->limit = limit;
+  return 0;
+}
+
+int cache_enabled(const cache_t *cache)
+{
+  return cache->dir[0] != '\0';
+}
+
+int cache_lookup(const cache_t *cache, const char *url, const char *ext,
+                 char *path, size_t len)
+{
+  char name[64], link[CACHE_MAX_PATH_LEN];
+  uint64_t key = roa_parser_hash_buf(url, strlen(url));
+  if (!cache_enabled(cache) ||
+      cache_name(name, sizeof(name), CACHE_URL_PREFIX, key, ext) != 0 ||
+      cache_join(link, sizeof(link), cache, name) != 0) {
+    return -1;
+  }
+
+  /* Resolve the link of the URL, a link to an evicted object is removed */
+  ssize_t ret = readlink(link, name, sizeof(name) - 1);
+  if (ret < 0) {
+    return -1;
+  }
+  name[ret] = '\0';
+  if (cache_join(path, len, cache, name) != 0) {
+    return -1;
+  }
+  if (access(path, R_OK) != 0) {
+    unlink(link);
+    return -1;
+  }
+
+  /* The modification time marks the last use of an object */
+  utimensat(AT_FDCWD, path, NULL, 0);
+  debug_print("Cache hit: %s\n", url);
+  return 0;
+}
+
+/* Move a written object into the cache and link the URL to it */
+static int cache_commit(const cache_t *cache, const char *url, const char *ext,
+                        const char *tmp, uint64_t hash)
+{
+  char obj[64], link[64], obj_path[CACHE_MAX_PATH_LEN];
+  char link_path[CACHE_MAX_PATH_LEN], link_tmp[CACHE_MAX_PATH_LEN];
+  uint64_t key = roa_parser_hash_buf(url, strlen(url));
+  if (cache_name(obj, sizeof(obj), CACHE_OBJ_PREFIX, hash, ext) != 0 ||
+      cache_name(link, sizeof(link), CACHE_URL_PREFIX, key, ext) != 0 ||
+      cache_join(obj_path, sizeof(obj_path), cache, obj) != 0 ||
+      cache_join(link_path, sizeof(link_path), cache, link) != 0 ||
+      snprintf(link_tmp, sizeof(link_tmp), "%s.%ld.tmp", link_path,
+               (long)getpid()) >= (int)sizeof(link_tmp)) {
+    unlink(tmp);
+    return -1;
+  }
+
+  /* Objects and links are replaced atomically (concurrent users of the cache
+     see either the old or the new file) */
+  unlink(link_tmp);
+  if (rename(tmp, obj_path) != 0 || symlink(obj, link_tmp) != 0 ||
+      rename(link_tmp, link_path) != 0) {
+    std_print("Error: Could not store %s in the cache\n", url);
+    unlink(tmp);
+    unlink(link_tmp);
+    return -1;
+  }
+  return 0;
+}
+
+/* Build the path of a temporary object */
+static int cache_tmp(const cache_t *cache, const char *url, char *path,
+                     size_t len)
+{
+  int ret = snprintf(path, len, "%s/%016" PRIx64 ".%ld.tmp", cache->dir,
+                     roa_parser_hash_buf(url, strlen(url)), (long)getpid());
+  return ret < 0 || (size_t)ret >= len ? -1 : 0;
+}
+
+int cache_store_set(const cache_t *cache, const char *url, roa_set_t *set,
+                    uint64_t hash)
+{
+  char tmp[CACHE_MAX_PATH_LEN];
+  if (!cache_enabled(cache) || cache_tmp(cache, url, tmp, sizeof(tmp)) != 0 ||
+      roa_snapshot_write(tmp, set, hash, 1) != 0) {
+    return -1;
+  }
+  return cache_commit(cache, url, "snap", tmp, hash);
+}
+
+int cache_store_buf(const cache_t *cache, const char *url, const char *ext,
+                    const void *buf, size_t len)
+{
+  char tmp[CACHE_MAX_PATH_LEN];
+  if (!cache_enabled(cache) || cache_tmp(cache, url, tmp, sizeof(tmp)) != 0) {
+    return -1;
+  }
+  FILE *file = fopen(tmp, "wb");
+  if (file == NULL) {
+    std_print("Error: Could not open %s for writing\n", tmp);
+    return -1;
+  }
+  int ret = (fwrite(buf, 1, len, file) != len);
+  ret |= (fclose(file) != 0);
+  if (ret) {
+    std_print("Error: Could not write %s\n", tmp);
+    unlink(tmp);
+    return -1;
+  }
+  return cache_commit(cache, url, ext, tmp, roa_parser_hash_buf(buf, len));
+}
+
+char *cache_read_buf(const char *path, size_t *len)
+{
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  struct stat st;
+  char *buf = NULL;
+  if (fstat(fileno(file), &st) == 0 && (buf = malloc(st.st_size + 1)) != NULL &&
+      fread(buf, 1, st.st_size, file) != (size_t)st.st_size) {
+    free(buf);
+    buf = NULL;
+  }
+  fclose(file);
+  if (buf != NULL) {
+    buf[st.st_size] = '\0';
+    if (len != NULL) {
+      *len = st.st_size;
+    }
+  }
+  return buf;
+}
+
+/* Remove all links to evicted objects */
+static void cache_prune_links(const cache_t *cache)
+{
+  DIR *dir = opendir(cache->dir);
+  struct dirent *ent;
+  char path[CACHE_MAX_PATH_LEN];
+  while (dir != NULL && (ent = readdir(dir)) != NULL) {
+    struct stat st;
+    if (!strncmp(ent->d_name, CACHE_URL_PREFIX, strlen(CACHE_URL_PREFIX)) &&
+        cache_join(path, sizeof(path), cache, ent->d_name) == 0 &&
+        stat(path, &st) != 0 && errno == ENOENT) {
+      unlink(path);
+    }
+  }
+  if (dir != NULL) {
+    closedir(dir);
+  }
+}
+
+static int cache_cmp_used(const void *a, const void *b)
+{
+  const struct timespec *x = &((const cache_entry_t *)a)->used;
+  const struct timespec *y = &((const cache_entry_t *)b)->used;
+  if (x->tv_sec != y->tv_sec) {
+    return x->tv_sec < y->tv_sec ? -1 : 1;
+  }
+  return x->tv_nsec < y->tv_nsec ? -1 : (x->tv_nsec > y->tv_nsec);
+}
+
+int cache_evict(const cache_t *cache)
+{
+  if (!cache_enabled(cache)) {
+    return 0;
+  }
+  DIR *dir = opendir(cache->dir);
+  if (dir == NULL) {
+    std_print("Error: Could not open the cache directory %s\n", cache->dir);
+    return -1;
+  }
+
+  /* Collect the size and the last use of all objects */
+  cache_entry_t *entries = NULL;
+  size_t count = 0, size = 0;
+  uint64_t total = 0;
+  struct dirent *ent;
+  char path[CACHE_MAX_PATH_LEN];
+  while ((ent = readdir(dir)) != NULL) {
+    struct stat st;
+    if (strncmp(ent->d_name, CACHE_OBJ_PREFIX, strlen(CACHE_OBJ_PREFIX)) ||
+        strlen(ent->d_name) >= sizeof(entries->name) ||
+        cache_join(path, sizeof(path), cache, ent->d_name) != 0 ||
+        stat(path, &st) != 0) {
+      continue;
+    }
+    if (count == size) {
+      size = size ? 2 * size : 64;
+      cache_entry_t *tmp = realloc(entries, size * sizeof(cache_entry_t));
+      if (tmp == NULL) {
+        std_print("%s", "Error: Could not allocate memory for the cache\n");
+        free(entries);
+        closedir(dir);
+        return -1;
+      }
+      entries = tmp;
+    }
+    snprintf(entries[count].name, sizeof(entries->name), "%s", ent->d_name);
+    entries[count].size = st.st_size;
+    entries[count].used = st.st_mtim;
+    total += st.st_size;
+    count++;
+  }
+  closedir(dir);
+
+  /* Remove the least recently used objects first */
+  int evicted = 0;
+  qsort(entries, count, sizeof(cache_entry_t), cache_cmp_used);
+  for (size_t i = 0; i < count && total > cache->limit; i++) {
+    if (cache_join(path, sizeof(path), cache, entries[i].name) == 0 &&
+        unlink(path) == 0) {
+      total -= entries[i].size;
+      evicted++;
+    }
+  }
+  free(entries);
+  if (evicted) {
+    cache_prune_links(cache);
+    debug_print("Cache: evicted %i objects, %" PRIu64 " bytes left\n",
+                evicted, total);
+  }
+  return evicted;
+}
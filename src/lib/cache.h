@@ -0,0 +1,132 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __CACHE_H
+#define __CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "roa_set.h"
+
+/** A local on-disk cache of ROA dumps and broker responses
+ *
+ * Every cached object is stored once under its content hash, every URL is a
+ * symbolic link to the object of its content (e.g. unchanged ROA dumps of
+ * consecutive epochs share one object). ROA dumps are stored as ROA
+ * snapshots. The least recently used objects are evicted with their links if
+ * the cache exceeds its size limit.
+ */
+typedef struct struct_cache_t {
+
+  /** Directory
+   *
+   * Directory of the cache (empty = cache disabled)
+   */
+  char dir[CACHE_MAX_PATH_LEN];
+
+  /** Size limit
+   *
+   * Max size of all cached objects in bytes
+   */
+  uint64_t limit;
+
+} cache_t;
+
+/** Initialize a cache (the directory is created if necessary)
+ *
+ * @param[out] cache         Pointer to the cache
+ * @param[in]  dir           Directory of the cache
+ * @param[in]  limit         Max size of all cached objects in bytes
+ * @return                   0 if the cache is usable, otherwise -1
+ */
+int cache_init(cache_t *cache, const char *dir, uint64_t limit);
+
+/** Whether a cache is enabled
+ *
+ * @param[in] cache          Pointer to the cache
+ * @return                   1 if the cache is enabled, otherwise 0
+ */
+int cache_enabled(const cache_t *cache);
+
+/** Look up the cached object of a URL (a hit marks it as recently used)
+ *
+ * @param[in]  cache         Pointer to the cache
+ * @param[in]  url           URL of the object
+ * @param[in]  ext           Type of the object (file extension)
+ * @param[out] path          Path of the cached object
+ * @param[in]  len           Size of the path buffer
+ * @return                   0 on a cache hit, otherwise -1
+ */
+int cache_lookup(const cache_t *cache, const char *url, const char *ext,
+                 char *path, size_t len);
+
+/** Store the parsed records of a ROA dump as ROA snapshot
+ *
+ * @param[in] cache          Pointer to the cache
+ * @param[in] url            URL of the ROA dump
+ * @param[in] set            ROA set of the ROA dump (sorted and deduplicated)
+ * @param[in] hash           Content hash of the ROA dump
+ * @return                   0 if the ROA dump was stored, otherwise -1
+ */
+int cache_store_set(const cache_t *cache, const char *url, roa_set_t *set,
+                    uint64_t hash);
+
+/** Store a downloaded buffer (e.g. a broker response)
+ *
+ * @param[in] cache          Pointer to the cache
+ * @param[in] url            URL of the buffer
+ * @param[in] ext            Type of the buffer (file extension)
+ * @param[in] buf            Content of the buffer
+ * @param[in] len            Length of the buffer
+ * @return                   0 if the buffer was stored, otherwise -1
+ */
+int cache_store_buf(const cache_t *cache, const char *url, const char *ext,
+                    const void *buf, size_t len);
+
+/** Read a cached buffer into a null-terminated string
+ *
+ * @param[in] path           Path of the cached object
+ * @param[out] len           Length of the buffer (or NULL)
+ * @return                   Content of the buffer (released by the caller) or
+ *                           NULL if it could not be read
+ */
+char *cache_read_buf(const char *path, size_t *len);
+
+/** Evict the least recently used objects until the cache fits its size limit
+ *
+ * @param[in] cache          Pointer to the cache
+ * @return                   Number of evicted objects or -1 on an error
+ */
+int cache_evict(const cache_t *cache);
+
+/** @} */
+
+#endif /* __CACHE_H */
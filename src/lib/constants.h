@@ -52,6 +52,116 @@
 /** Max number of SSH parameters */
 #define MAX_SSH_CNT 3
 
+/** Max length of the options string */
+#define MAX_OPTIONS_LEN 4096
+
+/** Max number of worker threads */
+#define MAX_THREADS 64
+
+/** Max number of previous epochs kept for out-of-order timestamps */
+#define MAX_RECENT_EPOCHS 64
+
+/** Max number of live configurations with a change feed (per process) */
+#define MAX_LIVE_FEEDS 64
+
+/** Number of buckets of the process-wide registry of shared prefix tables */
+#define REGISTRY_BUCKETS 256
+
+/* -------------------- Options ----------------------- */
+
+/** Minimize the ROA records of a dump before the import (0|1) */
+#define OPTION_MINIMIZE "minimize"
+
+/** Backend of the prefix tables (rtrlib|array) */
+#define OPTION_BACKEND "backend"
+
+/** Reference backend all lookups are compared with (rtrlib|array) */
+#define OPTION_DIFF_BACKEND "diff_backend"
+
+/** Allocate the prefix tables of an epoch from an arena (0|1) */
+#define OPTION_ARENA "arena"
+
+/** Back the arena with transparent huge pages (0|1) */
+#define OPTION_HUGEPAGES "hugepages"
+
+/** Number of concurrent downloads and parsers of an epoch (0 = all cores) */
+#define OPTION_THREADS "threads"
+
+/** Apply only the difference between consecutive ROA dumps (0|1) */
+#define OPTION_DELTA "delta"
+
+/** Import the next epoch in the background while the current one is used */
+#define OPTION_PREFETCH "prefetch"
+
+/** Report the records not contained in the ROA dumps of all collectors */
+#define OPTION_DIVERGENCE "divergence"
+
+/** Share loaded prefix tables with all configurations of the process (0|1) */
+#define OPTION_SHARED "shared"
+
+/** Import only every k-th ROA dump of the broker response */
+#define OPTION_EPOCH_STRIDE "epoch_stride"
+
+/** Import only the first ROA dump of every time bucket (seconds) */
+#define OPTION_EPOCH_BUCKET "epoch_bucket"
+
+/** Number of previous epochs kept for out-of-order timestamps */
+#define OPTION_EPOCHS "epochs"
+
+/** Memory budget of the previous epochs in MB */
+#define OPTION_EPOCHS_SIZE "epochs_size"
+
+/** Directory of the local cache of ROA dumps and broker responses */
+#define OPTION_CACHE "cache"
+
+/** Size limit of the local cache in MB */
+#define OPTION_CACHE_SIZE "cache_size"
+
+/** Temporal ROA index used instead of the ROA dumps (historical mode) */
+#define OPTION_INDEX "index"
+
+/** Shared memory directory of the epoch images of all processes */
+#define OPTION_SHM "shm"
+
+/** Number of epoch images kept in the shared memory directory */
+#define OPTION_SHM_COUNT "shm_count"
+
+/** Length of the windows the broker index is fetched in (seconds) */
+#define OPTION_WINDOW "window"
+
+/* -------------------- ROA parser -------------------- */
+
+/** Size of a chunk read from a ROA dump */
+#define ROA_PARSER_CHUNK_SIZE (64 * 1024)
+
+/** Max length of a single line of a ROA dump */
+#define ROA_PARSER_MAX_LINE_LEN 512
+
+/** Max number of chunks of a ROA dump buffered between download and parser */
+#define ROA_PARSER_QUEUE_LEN 16
+
+/* -------------------- Cache ------------------------- */
+
+/** Max length of a cache path */
+#define CACHE_MAX_PATH_LEN 1024
+
+/** Default size limit of the cache in MB */
+#define CACHE_DEFAULT_SIZE 1024
+
+/** Name prefix of the epoch images in the shared memory directory */
+#define VALIDATION_IMAGE_PREFIX "roafetch-"
+
+/** Default number of epoch images kept in the shared memory directory */
+#define VALIDATION_IMAGE_COUNT 16
+
+/* -------------------- Arena ------------------------- */
+
+/** Default size of an arena chunk (virtual, committed on first touch) */
+#define ARENA_CHUNK_SIZE (64UL * 1024 * 1024)
+
+/** Size of a transparent huge page */
+#define ARENA_HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
 /* -------------------- Validation -------------------- */
 
 /** Length of a valid asn entry (project,collector,status,ASN) */
@@ -88,14 +198,17 @@
 /** Size of a string representation of a port number */
 #define BROKER_INFO_RESP_PORT_LEN 6
 
-/** Initial count of ROA dump URLs in JSON */
-#define BROKER_ROA_URLS_COUNT 2048
-
 /** Max size of the broker JSON buffer */
 #define BROKER_JSON_BUF_SIZE 6144
 
-/** Max size of the broker ROA dump buffer */
-#define BROKER_ROA_DUMP_BUFLEN 6144
+/** Number of JSON tokens held by the broker response tokenizer */
+#define BROKER_JSON_TOKENS 64
+
+/** Token of the data object in the broker response (see broker.c) */
+#define BROKER_JSON_DATA_TOKEN 12
+
+/** Min age of the end of an interval to cache its broker response (s) */
+#define BROKER_CACHE_MIN_AGE 86400
 
 /** Max size of the broker URL without arguments */
 #define BROKER_MAX_MAIN_URL_LEN 1024
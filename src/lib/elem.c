@@ -74,6 +74,15 @@ void elem_destroy(elem_t *elem)
 int elem_get_rpki_validation_result_snprintf(rpki_cfg_t *cfg, char *buf,
                                              size_t len, elem_t const *elem)
 {
+  return elem_get_rpki_validation_result_snprintf_epoch(cfg, buf, len, elem,
+                                                        cfg->cfg_val.pfxt_count);
+}
+
+int elem_get_rpki_validation_result_snprintf_epoch(rpki_cfg_t *cfg, char *buf,
+                                                   size_t len,
+                                                   elem_t const *elem,
+                                                   int pfxt_count)
+{
 
   char *val; char *asn = NULL; const char *key = '\0';
   char last_key[VALIDATION_MAX_SINGLE_RESULT_LEN] = {0};
@@ -126,7 +135,7 @@ int elem_get_rpki_validation_result_snprintf(rpki_cfg_t *cfg, char *buf,
 
     /* Add all remaining notfounds
        Output: PJ_1,CC_1,notfound;(PJ_2,CC_2,notfound;)* */
-    for (int k = 0; k < cfg->cfg_val.pfxt_count; k++) {
+    for (int k = 0; k < pfxt_count; k++) {
       if (elem->rpki_validation_status[k] == NOTFOUND) {
         snprintf(result + strlen(result), sizeof(result) - strlen(result),
                  "%s,%s,notfound;", input->projects[k], input->collectors[k]);
@@ -144,15 +153,29 @@ int elem_get_rpki_validation_result_snprintf(rpki_cfg_t *cfg, char *buf,
 
 int elem_get_rpki_validation_result(rpki_cfg_t *cfg,
                                      struct rtr_mgr_config *rtr_cfg,
-                                     elem_t *elem, char *prefix,
+                                     elem_t *elem,
+                                     const struct lrtr_ip_addr *prefix,
                                      uint32_t asn, uint8_t mask_len,
-                                     struct pfx_table *pfxt, int pfxt_count)
+                                     backend_table_t *pfxt, int pfxt_count)
+{
+  return elem_get_rpki_validation_result_epoch(cfg, rtr_cfg, elem, prefix, asn,
+                                               mask_len, pfxt, pfxt_count,
+                                               cfg->cfg_val.pfxt_active);
+}
+
+int elem_get_rpki_validation_result_epoch(rpki_cfg_t *cfg,
+                                          struct rtr_mgr_config *rtr_cfg,
+                                          elem_t *elem,
+                                          const struct lrtr_ip_addr *prefix,
+                                          uint32_t asn, uint8_t mask_len,
+                                          backend_table_t *pfxt, int pfxt_count,
+                                          const int *pfxt_active)
 {
 
   /* Only validate if the elem was not validated already, the prefix table
      is active (Historical) or NULL (Live validation) */
   if (elem->rpki_validation_status[pfxt_count] == NOTVALIDATED &&
-      (cfg->cfg_val.pfxt_active[pfxt_count] || pfxt == NULL)) {
+      (pfxt_active[pfxt_count] || pfxt == NULL)) {
 
     /* Validate with the corresponding validation */
     struct reasoned_result reason;
@@ -31,6 +31,7 @@
 #define __ELEM_H
 
 #include "khash.h"
+#include "backend.h"
 #include "constants.h"
 #include "rtrlib/rtrlib.h"
 
@@ -122,12 +123,27 @@ void elem_destroy(elem_t *elem);
 int elem_get_rpki_validation_result_snprintf(rpki_cfg_t *cfg, char *buf,
                                              size_t len, elem_t const *elem);
 
+/** Write the string representation of the RPKI validation result of an elem
+ *  validated with the prefix tables of an epoch
+ *
+ * @param[in]  cfg             Pointer to the configuration struct
+ * @param[out] buf             Buffer the validation result will be printed into
+ * @param[in]  len             Available size for validation result output
+ * @param[in]  elem            Elem whose RPKI validation result will be printed
+ * @param[in]  pfxt_count      Number of prefix tables of the epoch
+ * @return                     0 if the print process was valid, otherwise -1
+ */
+int elem_get_rpki_validation_result_snprintf_epoch(rpki_cfg_t *cfg, char *buf,
+                                                   size_t len,
+                                                   elem_t const *elem,
+                                                   int pfxt_count);
+
 /** Get the result of the RPKI-Validation for the elem
  *
  * @param[in]  cfg             Pointer to the configuration struct
  * @param[in]  rtr_mgr_config  Pointer to the rtr_mgr_config struct
  * @param[in]  elem            Elem which will be validated
- * @param[in]  prefix          BGP prefix which will be validated
+ * @param[in]  prefix          Address of the BGP prefix which will be validated
  * @param[in]  origin_asn      Origin ASN of the BGP elem
  * @param[in]  mask_len        Mask_len of the prefix
  * @param[out] pfxt            Pointer to all prefix tables
@@ -136,9 +152,32 @@ int elem_get_rpki_validation_result_snprintf(rpki_cfg_t *cfg, char *buf,
  */
 int elem_get_rpki_validation_result(rpki_cfg_t *cfg,
                                     struct rtr_mgr_config *rtr_cfg,
-                                    elem_t *elem, char *prefix,
+                                    elem_t *elem,
+                                    const struct lrtr_ip_addr *prefix,
                                     uint32_t asn, uint8_t mask_len,
-                                    struct pfx_table *pfxt, int pfxt_count);
+                                    backend_table_t *pfxt, int pfxt_count);
+
+/** Get the result of the RPKI-Validation for the elem with a prefix table of
+ *  an epoch (the active prefix tables of the configuration are not used)
+ *
+ * @param[in]  cfg             Pointer to the configuration struct
+ * @param[in]  rtr_mgr_config  Pointer to the rtr_mgr_config struct
+ * @param[in]  elem            Elem which will be validated
+ * @param[in]  prefix          Address of the BGP prefix which will be validated
+ * @param[in]  origin_asn      Origin ASN of the BGP elem
+ * @param[in]  mask_len        Mask_len of the prefix
+ * @param[out] pfxt            Pointer to the prefix table of the epoch
+ * @param[in]  pfxt_count      Index of the prefix table
+ * @param[in]  pfxt_active     Active prefix tables of the epoch
+ * @return                     0 if the validation was valid, otherwise -1
+ */
+int elem_get_rpki_validation_result_epoch(rpki_cfg_t *cfg,
+                                          struct rtr_mgr_config *rtr_cfg,
+                                          elem_t *elem,
+                                          const struct lrtr_ip_addr *prefix,
+                                          uint32_t asn, uint8_t mask_len,
+                                          backend_table_t *pfxt, int pfxt_count,
+                                          const int *pfxt_active);
 
 /** @} */
 
@@ -0,0 +1,175 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "registry.h"
+#include "roa_parser.h"
+
+/** Shared prefix tables of the process, the lock guards all entries and the
+    condition signals every published entry */
+static registry_entry_t *registry_buckets[REGISTRY_BUCKETS];
+static size_t registry_entries;
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t registry_cond = PTHREAD_COND_INITIALIZER;
+
+/* Remove an entry from its bucket (the registry lock is held) */
+static void registry_unlink(registry_entry_t *entry)
+{
+  registry_entry_t **next = &registry_buckets[entry->hash % REGISTRY_BUCKETS];
+  while (*next != NULL && *next != entry) {
+    next = &(*next)->next;
+  }
+  if (*next != NULL) {
+    *next = entry->next;
+    registry_entries--;
+  }
+  entry->next = NULL;
+}
+
+registry_entry_t *registry_acquire(const char *key, const backend_ops_t *ops,
+                                   int *load)
+{
+  uint64_t hash = roa_parser_hash_buf(key, strlen(key));
+  pthread_mutex_lock(&registry_lock);
+  registry_entry_t *entry = registry_buckets[hash % REGISTRY_BUCKETS];
+  while (entry != NULL && (entry->hash != hash || strcmp(entry->key, key))) {
+    entry = entry->next;
+  }
+  if (entry != NULL) {
+    entry->refs++;
+    pthread_mutex_unlock(&registry_lock);
+    *load = 0;
+    return entry;
+  }
+
+  /* The first importer of a key creates an empty table and loads it */
+  if ((entry = calloc(1, sizeof(registry_entry_t))) == NULL ||
+      (entry->key = strdup(key)) == NULL ||
+      backend_table_init(&entry->table, ops, NULL, NULL) != 0) {
+    pthread_mutex_unlock(&registry_lock);
+    std_print("%s", "Error: Could not register a shared prefix table\n");
+    if (entry != NULL) {
+      free(entry->key);
+    }
+    free(entry);
+    return NULL;
+  }
+  entry->hash = hash;
+  entry->refs = 1;
+  entry->next = registry_buckets[hash % REGISTRY_BUCKETS];
+  registry_buckets[hash % REGISTRY_BUCKETS] = entry;
+  registry_entries++;
+  pthread_mutex_unlock(&registry_lock);
+  *load = 1;
+  return entry;
+}
+
+void registry_publish(registry_entry_t *entry, int ret)
+{
+  /* The table is frozen before it is read concurrently */
+  if (ret == 0) {
+    backend_table_freeze(&entry->table);
+  }
+  pthread_mutex_lock(&registry_lock);
+  entry->state = (ret == 0 ? 1 : -1);
+  if (ret != 0) {
+    registry_unlink(entry);
+  }
+  pthread_cond_broadcast(&registry_cond);
+  pthread_mutex_unlock(&registry_lock);
+}
+
+int registry_wait(registry_entry_t *entry)
+{
+  pthread_mutex_lock(&registry_lock);
+  while (entry->state == 0) {
+    pthread_cond_wait(&registry_cond, &registry_lock);
+  }
+  int ret = (entry->state == 1 ? 0 : -1);
+  pthread_mutex_unlock(&registry_lock);
+  return ret;
+}
+
+registry_entry_t *registry_adopt(backend_table_t *table)
+{
+  registry_entry_t *entry = calloc(1, sizeof(registry_entry_t));
+  if (entry == NULL) {
+    std_print("%s", "Error: Could not register a shared prefix table\n");
+    return NULL;
+  }
+  entry->table = *table;
+  backend_table_freeze(&entry->table);
+  entry->refs = 1;
+  entry->state = 1;
+  table->table = NULL;
+  table->ref_table = NULL;
+  memset(&table->records, 0, sizeof(roa_set_t));
+  return entry;
+}
+
+void registry_retain(registry_entry_t *entry)
+{
+  if (entry == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&registry_lock);
+  entry->refs++;
+  pthread_mutex_unlock(&registry_lock);
+}
+
+void registry_release(registry_entry_t *entry)
+{
+  if (entry == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&registry_lock);
+  int refs = --entry->refs;
+  if (!refs) {
+    registry_unlink(entry);
+  }
+  pthread_mutex_unlock(&registry_lock);
+  if (refs) {
+    return;
+  }
+  backend_table_free(&entry->table);
+  free(entry->key);
+  free(entry);
+}
+
+size_t registry_count(void)
+{
+  pthread_mutex_lock(&registry_lock);
+  size_t count = registry_entries;
+  pthread_mutex_unlock(&registry_lock);
+  return count;
+}
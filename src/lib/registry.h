@@ -0,0 +1,145 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __REGISTRY_H
+#define __REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "backend.h"
+
+/** A loaded prefix table shared by all configurations of the process
+ *
+ * Every prefix table is registered under a key of its ROA dumps (the URLs of
+ * the ROA dumps, which contain the collector and the dump timestamp) and the
+ * import settings. Shared tables are immutable once they are loaded and are
+ * released with the last reference.
+ */
+typedef struct struct_registry_entry_t {
+
+  /** Key
+   *
+   * Backend, import settings and URLs of the ROA dumps of the table
+   */
+  char *key;
+
+  /** Key hash
+   *
+   * Hash of the key (bucket of the registry)
+   */
+  uint64_t hash;
+
+  /** Prefix table
+   *
+   * Shared prefix table (read-only once it is loaded)
+   */
+  backend_table_t table;
+
+  /** Reference count
+   *
+   * Number of prefix tables and importers using the entry
+   */
+  int refs;
+
+  /** State
+   *
+   * 0 = loading, 1 = loaded, -1 = the import failed
+   */
+  int state;
+
+  /** Next entry
+   *
+   * Next entry of the same bucket of the registry
+   */
+  struct struct_registry_entry_t *next;
+
+} registry_entry_t;
+
+/** Acquire a reference of the shared prefix table of a key, a missing entry
+ *  is created and has to be loaded by the caller (never blocks, see
+ *  registry_wait for entries loaded by another configuration)
+ *
+ * @param[in]  key           Key of the prefix table
+ * @param[in]  ops           Backend of a created prefix table
+ * @param[out] load          1 if the caller has to load the table, otherwise 0
+ * @return                   Registry entry, NULL on failure
+ */
+registry_entry_t *registry_acquire(const char *key, const backend_ops_t *ops,
+                                   int *load);
+
+/** Publish a prefix table loaded by the caller, the table is frozen before
+ *  other importers read it (a failed table is removed from the registry, the
+ *  next acquisition loads it again)
+ *
+ * @param[in] entry          Registry entry
+ * @param[in] ret            Result of the import (0 = loaded, -1 = failed)
+ */
+void registry_publish(registry_entry_t *entry, int ret);
+
+/** Wait until the prefix table of an entry is published (importers have to
+ *  publish all of their own entries before they wait for another one)
+ *
+ * @param[in] entry          Registry entry
+ * @return                   0 if the table was loaded, otherwise -1
+ */
+int registry_wait(registry_entry_t *entry);
+
+/** Create an unregistered entry which takes over a loaded prefix table (e.g.
+ *  a prefix table shared by consecutive epochs of a configuration), the entry
+ *  is never found by registry_acquire, the taken over table is frozen and
+ *  the table of the caller is left empty
+ *
+ * @param[in] table          Prefix table which is taken over
+ * @return                   Registry entry with one reference, NULL on failure
+ */
+registry_entry_t *registry_adopt(backend_table_t *table);
+
+/** Acquire another reference of a registry entry
+ *
+ * @param[in] entry          Registry entry
+ */
+void registry_retain(registry_entry_t *entry);
+
+/** Release a reference of a registry entry, the prefix table is destroyed
+ *  with the last reference
+ *
+ * @param[in] entry          Registry entry
+ */
+void registry_release(registry_entry_t *entry);
+
+/** Number of prefix tables in the registry
+ *
+ * @return                   Number of registered prefix tables
+ */
+size_t registry_count(void);
+
+/** @} */
+
+#endif /* __REGISTRY_H */
@@ -0,0 +1,629 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "roa_index.h"
+#include "debug.h"
+#include "roa_parser.h"
+
+/** Alignment of all sections */
+#define ROA_INDEX_ALIGN 8
+
+/** Initial number of events of an index builder */
+#define ROA_INDEX_EVENTS_INIT_SIZE 1024
+
+/** Initial number of reasons of a lookup */
+#define ROA_INDEX_REASONS_INIT_SIZE 8
+
+static size_t roa_index_round(size_t size)
+{
+  return (size + ROA_INDEX_ALIGN - 1) & ~(size_t)(ROA_INDEX_ALIGN - 1);
+}
+
+/* Order of the events by record and collector (the records of a family
+   section are stored in this order) */
+static int roa_index_event_key_cmp(const void *a, const void *b)
+{
+  const roa_index_event_t *x = a, *y = b;
+  const roa_record_t *rx = &x->record, *ry = &y->record;
+  if (rx->family != ry->family) {
+    return rx->family < ry->family ? -1 : 1;
+  }
+  for (int i = 0; i < 4; i++) {
+    if (rx->addr[i] != ry->addr[i]) {
+      return rx->addr[i] < ry->addr[i] ? -1 : 1;
+    }
+  }
+  if (rx->min_len != ry->min_len) {
+    return rx->min_len < ry->min_len ? -1 : 1;
+  }
+  if (rx->max_len != ry->max_len) {
+    return rx->max_len < ry->max_len ? -1 : 1;
+  }
+  if (rx->asn != ry->asn) {
+    return rx->asn < ry->asn ? -1 : 1;
+  }
+  if (x->collector != y->collector) {
+    return x->collector < y->collector ? -1 : 1;
+  }
+  return 0;
+}
+
+/* Order of the events of a record and collector by timestamp */
+static int roa_index_event_cmp(const void *a, const void *b)
+{
+  const roa_index_event_t *x = a, *y = b;
+  int ret = roa_index_event_key_cmp(a, b);
+  if (ret != 0 || x->timestamp == y->timestamp) {
+    return ret;
+  }
+  return x->timestamp < y->timestamp ? -1 : 1;
+}
+
+void roa_index_builder_init(roa_index_builder_t *builder)
+{
+  memset(builder, 0, sizeof(roa_index_builder_t));
+}
+
+void roa_index_builder_free(roa_index_builder_t *builder)
+{
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    roa_set_free(&builder->current[i]);
+    free(builder->coverage[i]);
+  }
+  free(builder->events);
+  memset(builder, 0, sizeof(roa_index_builder_t));
+}
+
+int roa_index_builder_collector(roa_index_builder_t *builder,
+                                const char *name)
+{
+  for (int i = 0; i < builder->collectors; i++) {
+    if (!strcmp(builder->names[i], name)) {
+      return i;
+    }
+  }
+  if (builder->collectors == MAX_RPKI_COUNT ||
+      strlen(name) >= ROA_INDEX_NAME_LEN) {
+    std_print("Error: Could not add the collector %s to the index\n", name);
+    return -1;
+  }
+  snprintf(builder->names[builder->collectors], ROA_INDEX_NAME_LEN, "%s",
+           name);
+  return builder->collectors++;
+}
+
+/* Add an event for every record of a set */
+static int roa_index_builder_events(roa_index_builder_t *builder,
+                                    const roa_set_t *set, int collector,
+                                    uint32_t timestamp, int added)
+{
+  for (size_t i = 0; i < set->count; i++) {
+    if (builder->events_count == builder->events_size) {
+      size_t size = builder->events_size ? 2 * builder->events_size
+                                         : ROA_INDEX_EVENTS_INIT_SIZE;
+      roa_index_event_t *events =
+        realloc(builder->events, size * sizeof(roa_index_event_t));
+      if (events == NULL) {
+        std_print("%s", "Error: Could not allocate memory for the index\n");
+        return -1;
+      }
+      builder->events = events;
+      builder->events_size = size;
+    }
+    roa_index_event_t *event = &builder->events[builder->events_count++];
+    event->record = set->records[i];
+    event->timestamp = timestamp;
+    event->collector = collector;
+    event->added = added;
+  }
+  return 0;
+}
+
+int roa_index_builder_add(roa_index_builder_t *builder, int collector,
+                          uint32_t timestamp, roa_set_t *set)
+{
+  /* The ROA dumps of a collector have to be added in chronological order */
+  int known = (collector >= 0 && collector < builder->collectors);
+  uint32_t end = known ? builder->end[collector] : 0;
+  roa_set_unique(set);
+  if (!known || (end && timestamp <= end - ROA_ARCHIVE_INTERVAL)) {
+    std_print("%s", "Error: ROA dumps are not added in chronological order\n");
+    roa_set_free(set);
+    return -1;
+  }
+
+  /* A gap between two ROA dumps closes all records after the last one */
+  roa_set_t *current = &builder->current[collector];
+  if (end && timestamp > end) {
+    if (roa_index_builder_events(builder, current, collector, end, 0) != 0) {
+      roa_set_free(set);
+      return -1;
+    }
+    roa_set_free(current);
+  }
+
+  /* Only the difference to the last ROA dump is recorded */
+  roa_set_t added, removed;
+  memset(&added, 0, sizeof(added));
+  memset(&removed, 0, sizeof(removed));
+  int ret = roa_set_diff(current, set, &added, &removed);
+  if (!ret) {
+    ret = roa_index_builder_events(builder, &removed, collector, timestamp, 0);
+  }
+  if (!ret) {
+    ret = roa_index_builder_events(builder, &added, collector, timestamp, 1);
+  }
+  roa_set_free(&added);
+  roa_set_free(&removed);
+  if (ret != 0) {
+    roa_set_free(set);
+    return -1;
+  }
+  roa_set_free(current);
+  *current = *set;
+
+  /* Extend the coverage of the collector or start a new interval */
+  size_t n = builder->coverage_count[collector];
+  if (!end || timestamp > end) {
+    roa_index_interval_t *coverage =
+      realloc(builder->coverage[collector], (n + 1) * sizeof(*coverage));
+    if (coverage == NULL) {
+      std_print("%s", "Error: Could not allocate memory for the index\n");
+      return -1;
+    }
+    coverage[n].start = timestamp;
+    builder->coverage[collector] = coverage;
+    builder->coverage_count[collector] = ++n;
+  }
+  builder->end[collector] = timestamp + ROA_ARCHIVE_INTERVAL;
+  builder->coverage[collector][n - 1].end = builder->end[collector];
+  return 0;
+}
+
+int roa_index_builder_write(roa_index_builder_t *builder, const char *path)
+{
+  /* All records of the last ROA dumps are valid until their end */
+  for (int c = 0; c < builder->collectors; c++) {
+    if (roa_index_builder_events(builder, &builder->current[c], c,
+                                 builder->end[c], 0) != 0) {
+      return -1;
+    }
+    roa_set_free(&builder->current[c]);
+  }
+  qsort(builder->events, builder->events_count, sizeof(roa_index_event_t),
+        roa_index_event_cmp);
+
+  /* Every record starts with an added event, the events of a record
+     alternate (added, removed) */
+  roa_index_header_t header;
+  memset(&header, 0, sizeof(header));
+  size_t intervals = builder->events_count / 2;
+  for (int c = 0; c < builder->collectors; c++) {
+    intervals += builder->coverage_count[c];
+  }
+  for (size_t i = 0; i < builder->events_count; i += 2) {
+    const roa_index_event_t *event = &builder->events[i];
+    if (i == 0 ||
+        roa_index_event_key_cmp(&builder->events[i - 2], event) != 0) {
+      header.count[event->record.family == ROA_IPV6]++;
+    }
+  }
+
+  /* Lay out all sections behind the header */
+  memcpy(header.magic, ROA_INDEX_MAGIC, ROA_INDEX_MAGIC_LEN);
+  header.version = ROA_INDEX_VERSION;
+  header.byte_order = ROA_INDEX_BYTE_ORDER;
+  header.collectors = builder->collectors;
+  size_t size = roa_index_round(sizeof(header));
+  header.collector_offset = size;
+  size += roa_index_round(builder->collectors * sizeof(roa_index_collector_t));
+  header.offset[ROA_IPV4] = size;
+  size += roa_index_round(header.count[ROA_IPV4] * sizeof(roa_index_ipv4_t));
+  header.offset[ROA_IPV6] = size;
+  size += roa_index_round(header.count[ROA_IPV6] * sizeof(roa_index_ipv6_t));
+  header.interval_offset = size;
+  size += roa_index_round(intervals * sizeof(roa_index_interval_t));
+  header.bytes_offset = size;
+  size += roa_index_round(2 * ROA_INDEX_BYTES_LEN * sizeof(uint32_t));
+  header.size = size;
+
+  uint8_t *buf = calloc(1, size);
+  if (buf == NULL) {
+    std_print("%s", "Error: Could not allocate memory for the index\n");
+    return -1;
+  }
+  roa_index_collector_t *collectors = (void *)(buf + header.collector_offset);
+  roa_index_ipv4_t *ipv4 = (void *)(buf + header.offset[ROA_IPV4]);
+  roa_index_ipv6_t *ipv6 = (void *)(buf + header.offset[ROA_IPV6]);
+  roa_index_interval_t *ivs = (void *)(buf + header.interval_offset);
+  uint32_t *bytes = (void *)(buf + header.bytes_offset);
+
+  /* The intervals of the collectors precede the intervals of the records */
+  size_t n_ivs = 0;
+  for (int c = 0; c < builder->collectors; c++) {
+    memcpy(collectors[c].name, builder->names[c], ROA_INDEX_NAME_LEN);
+    collectors[c].first = n_ivs;
+    collectors[c].count = builder->coverage_count[c];
+    for (size_t i = 0; i < builder->coverage_count[c]; i++) {
+      ivs[n_ivs++] = builder->coverage[c][i];
+      if (!header.start || builder->coverage[c][i].start < header.start) {
+        header.start = builder->coverage[c][i].start;
+      }
+      if (builder->coverage[c][i].end > header.end) {
+        header.end = builder->coverage[c][i].end;
+      }
+    }
+  }
+
+  size_t n[2] = {0, 0};
+  for (size_t i = 0; i < builder->events_count; i += 2) {
+    const roa_index_event_t *event = &builder->events[i];
+    const roa_record_t *rec = &event->record;
+    int family = rec->family == ROA_IPV6;
+    roa_index_interval_t iv = {event->timestamp,
+                               builder->events[i + 1].timestamp};
+    if (i > 0 && !roa_index_event_key_cmp(&builder->events[i - 2], event)) {
+      uint32_t *count = family ? &ipv6[n[family] - 1].count
+                               : &ipv4[n[family] - 1].count;
+      ivs[n_ivs++] = iv;
+      (*count)++;
+      continue;
+    }
+    if (family == ROA_IPV4) {
+      roa_index_ipv4_t *r = &ipv4[n[family]];
+      r->asn = rec->asn;
+      r->addr = rec->addr[0];
+      r->min_len = rec->min_len;
+      r->max_len = rec->max_len;
+      r->collector = event->collector;
+      r->first = n_ivs;
+      r->count = 1;
+    } else {
+      roa_index_ipv6_t *r = &ipv6[n[family]];
+      r->asn = rec->asn;
+      memcpy(r->addr, rec->addr, sizeof(rec->addr));
+      r->min_len = rec->min_len;
+      r->max_len = rec->max_len;
+      r->collector = event->collector;
+      r->first = n_ivs;
+      r->count = 1;
+    }
+    ivs[n_ivs++] = iv;
+    bytes[family * ROA_INDEX_BYTES_LEN + (rec->addr[0] >> 24) + 1]++;
+    n[family]++;
+  }
+  header.interval_count = n_ivs;
+
+  /* Every top address byte entry is the first record of its byte */
+  for (int b = 1; b < 2 * ROA_INDEX_BYTES_LEN; b++) {
+    if (b != ROA_INDEX_BYTES_LEN) {
+      bytes[b] += bytes[b - 1];
+    }
+  }
+
+  size_t head = roa_index_round(sizeof(header));
+  header.checksum = roa_parser_hash_buf(buf + head, size - head);
+  memcpy(buf, &header, sizeof(header));
+
+  int ret = 0;
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    std_print("Error: Could not open %s for writing\n", path);
+    ret = -1;
+  } else if (fwrite(buf, 1, size, file) != size) {
+    std_print("Error: Could not write the index %s\n", path);
+    ret = -1;
+  }
+  if (file != NULL && fclose(file) != 0 && !ret) {
+    std_print("Error: Could not write the index %s\n", path);
+    ret = -1;
+  }
+  free(buf);
+  return ret;
+}
+
+/* Get a record of an index with its collector and intervals */
+static void roa_index_record(const roa_index_t *index, int family, size_t i,
+                             roa_record_t *rec, int *collector,
+                             uint32_t *first, uint32_t *count)
+{
+  memset(rec, 0, sizeof(roa_record_t));
+  rec->family = family;
+  if (family == ROA_IPV4) {
+    const roa_index_ipv4_t *r = &index->ipv4[i];
+    rec->asn = r->asn;
+    rec->addr[0] = r->addr;
+    rec->min_len = r->min_len;
+    rec->max_len = r->max_len;
+    *collector = r->collector;
+    *first = r->first;
+    *count = r->count;
+  } else {
+    const roa_index_ipv6_t *r = &index->ipv6[i];
+    rec->asn = r->asn;
+    memcpy(rec->addr, r->addr, sizeof(rec->addr));
+    rec->min_len = r->min_len;
+    rec->max_len = r->max_len;
+    *collector = r->collector;
+    *first = r->first;
+    *count = r->count;
+  }
+}
+
+/* Check the bounds of all sections and references of a mapped index */
+static int roa_index_check(roa_index_t *index, const uint8_t *buf, size_t len)
+{
+  const roa_index_header_t *header = (const void *)buf;
+  if (len < sizeof(*header) ||
+      memcmp(header->magic, ROA_INDEX_MAGIC, ROA_INDEX_MAGIC_LEN) ||
+      header->version != ROA_INDEX_VERSION ||
+      header->byte_order != ROA_INDEX_BYTE_ORDER || header->size > len ||
+      header->collectors > MAX_RPKI_COUNT) {
+    std_print("%s", "Error: Invalid or incompatible ROA index\n");
+    return -1;
+  }
+
+  /* Check the bounds of all sections (the sizes are checked for overflows) */
+  size_t size = header->size, head = roa_index_round(sizeof(*header));
+  uint64_t offsets[] = {header->collector_offset, header->offset[ROA_IPV4],
+                        header->offset[ROA_IPV6], header->interval_offset,
+                        header->bytes_offset};
+  uint64_t counts[] = {header->collectors, header->count[ROA_IPV4],
+                       header->count[ROA_IPV6], header->interval_count,
+                       2 * ROA_INDEX_BYTES_LEN};
+  size_t sizes[] = {sizeof(roa_index_collector_t), sizeof(roa_index_ipv4_t),
+                    sizeof(roa_index_ipv6_t), sizeof(roa_index_interval_t),
+                    sizeof(uint32_t)};
+  for (int i = 0; i < 5; i++) {
+    if (offsets[i] < head || offsets[i] > size ||
+        offsets[i] % ROA_INDEX_ALIGN || counts[i] > (size - offsets[i]) /
+                                                     sizes[i]) {
+      std_print("%s", "Error: Corrupt sections in the ROA index\n");
+      return -1;
+    }
+  }
+  if (roa_parser_hash_buf(buf + head, size - head) != header->checksum) {
+    std_print("%s", "Error: Checksum mismatch in the ROA index\n");
+    return -1;
+  }
+
+  index->header = header;
+  index->collectors = (const void *)(buf + header->collector_offset);
+  index->ipv4 = (const void *)(buf + header->offset[ROA_IPV4]);
+  index->ipv6 = (const void *)(buf + header->offset[ROA_IPV6]);
+  index->intervals = (const void *)(buf + header->interval_offset);
+  index->bytes = (const void *)(buf + header->bytes_offset);
+
+  /* Check the references of all collectors and records */
+  int ret = 0;
+  for (uint32_t c = 0; c < header->collectors; c++) {
+    const roa_index_collector_t *col = &index->collectors[c];
+    ret |= (col->first > header->interval_count ||
+            col->count > header->interval_count - col->first ||
+            !memchr(col->name, 0, ROA_INDEX_NAME_LEN));
+  }
+  for (int f = ROA_IPV4; f <= ROA_IPV6; f++) {
+    const uint32_t *bytes = &index->bytes[f * ROA_INDEX_BYTES_LEN];
+    ret |= (bytes[0] != 0 ||
+            bytes[ROA_INDEX_BYTES_LEN - 1] != header->count[f]);
+    for (int b = 1; b < ROA_INDEX_BYTES_LEN; b++) {
+      ret |= (bytes[b - 1] > bytes[b]);
+    }
+    for (size_t i = 0; i < header->count[f] && !ret; i++) {
+      roa_record_t rec;
+      int collector;
+      uint32_t first, count;
+      roa_index_record(index, f, i, &rec, &collector, &first, &count);
+      ret |= ((uint32_t)collector >= header->collectors ||
+              first > header->interval_count ||
+              count > header->interval_count - first);
+    }
+  }
+  if (ret) {
+    std_print("%s", "Error: Corrupt references in the ROA index\n");
+    return -1;
+  }
+  return 0;
+}
+
+int roa_index_open(roa_index_t *index, const char *path)
+{
+  memset(index, 0, sizeof(roa_index_t));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    std_print("Error: Could not open %s for reading\n", path);
+    return -1;
+  }
+  struct stat st;
+  void *map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) {
+    std_print("Error: Could not map the ROA index %s\n", path);
+    return -1;
+  }
+  if (roa_index_check(index, map, st.st_size) != 0) {
+    munmap(map, st.st_size);
+    memset(index, 0, sizeof(roa_index_t));
+    return -1;
+  }
+  index->map = map;
+  index->size = st.st_size;
+  return 0;
+}
+
+void roa_index_close(roa_index_t *index)
+{
+  if (index->map != NULL) {
+    munmap(index->map, index->size);
+  }
+  memset(index, 0, sizeof(roa_index_t));
+}
+
+int roa_index_collector(const roa_index_t *index, const char *name)
+{
+  for (uint32_t c = 0; index->header != NULL && c < index->header->collectors;
+       c++) {
+    if (!strcmp(index->collectors[c].name, name)) {
+      return c;
+    }
+  }
+  return -1;
+}
+
+/* Whether a timestamp is in one of the sorted intervals */
+static int roa_index_contains(const roa_index_t *index, uint32_t first,
+                              uint32_t count, uint32_t timestamp)
+{
+  /* Find the last interval starting before or at the timestamp */
+  const roa_index_interval_t *ivs = &index->intervals[first];
+  size_t lo = 0, hi = count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (ivs[mid].start <= timestamp) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo > 0 && timestamp < ivs[lo - 1].end;
+}
+
+int roa_index_active(const roa_index_t *index, int collector,
+                     uint32_t timestamp)
+{
+  if (index->header == NULL || collector < 0 ||
+      (uint32_t)collector >= index->header->collectors) {
+    return 0;
+  }
+  const roa_index_collector_t *col = &index->collectors[collector];
+  return roa_index_contains(index, col->first, col->count, timestamp);
+}
+
+/* Compare the prefix of a record with a prefix and length */
+static int roa_index_prefix_cmp(const roa_record_t *rec, const uint32_t *addr,
+                                uint8_t len)
+{
+  for (int i = 0; i < 4; i++) {
+    if (rec->addr[i] != addr[i]) {
+      return rec->addr[i] < addr[i] ? -1 : 1;
+    }
+  }
+  return rec->min_len == len ? 0 : (rec->min_len < len ? -1 : 1);
+}
+
+int roa_index_lookup(const roa_index_t *index, uint32_t collectors,
+                     uint32_t timestamp, uint32_t asn,
+                     const struct lrtr_ip_addr *prefix, uint8_t mask_len,
+                     struct pfx_record **reason, unsigned int *reason_len,
+                     enum pfxv_state *result)
+{
+  roa_record_t query;
+  roa_record_from_addr(asn, prefix, mask_len, mask_len, &query);
+  int family = query.family;
+  *reason = NULL;
+  *reason_len = 0;
+  *result = BGP_PFXV_STATE_NOT_FOUND;
+  if (index->header == NULL || mask_len > (family == ROA_IPV4 ? 32 : 128)) {
+    return -1;
+  }
+
+  /* Every covering prefix length is a contiguous range of the records of its
+     top address byte */
+  int covered = 0, valid = 0;
+  roa_record_t last;
+  memset(&last, 0, sizeof(last));
+  unsigned int cap = 0;
+  for (int len = 0; len <= mask_len; len++) {
+    uint32_t addr[4];
+    for (int w = 0; w < 4; w++) {
+      addr[w] = query.addr[w] & roa_record_word_mask(len, w);
+    }
+    const uint32_t *bytes = &index->bytes[family * ROA_INDEX_BYTES_LEN];
+    size_t lo = bytes[addr[0] >> 24], hi = bytes[(addr[0] >> 24) + 1];
+    roa_record_t rec;
+    int collector;
+    uint32_t first, count;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      roa_index_record(index, family, mid, &rec, &collector, &first, &count);
+      if (roa_index_prefix_cmp(&rec, addr, len) < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    for (size_t i = lo; i < index->header->count[family]; i++) {
+      roa_index_record(index, family, i, &rec, &collector, &first, &count);
+      if (roa_index_prefix_cmp(&rec, addr, len) != 0) {
+        break;
+      }
+      if (!(collectors & (1u << collector)) ||
+          !roa_index_contains(index, first, count, timestamp)) {
+        continue;
+      }
+      covered = 1;
+      valid |= (rec.asn == asn && mask_len <= rec.max_len);
+
+      /* Equal records of several collectors are adjacent */
+      if (*reason_len && last.asn == rec.asn && last.max_len == rec.max_len &&
+          !roa_index_prefix_cmp(&last, rec.addr, rec.min_len)) {
+        continue;
+      }
+      if (*reason_len == cap) {
+        cap = cap ? 2 * cap : ROA_INDEX_REASONS_INIT_SIZE;
+        struct pfx_record *tmp = realloc(*reason, cap * sizeof(**reason));
+        if (tmp == NULL) {
+          free(*reason);
+          *reason = NULL;
+          *reason_len = 0;
+          return -1;
+        }
+        *reason = tmp;
+      }
+      roa_record_to_pfx_record(&rec, &(*reason)[(*reason_len)++]);
+      last = rec;
+    }
+  }
+  if (covered) {
+    *result = valid ? BGP_PFXV_STATE_VALID : BGP_PFXV_STATE_INVALID;
+  }
+  return 0;
+}
@@ -0,0 +1,421 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __ROA_INDEX_H
+#define __ROA_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "roa_set.h"
+#include "rtrlib/rtrlib.h"
+
+/** Magic number at the beginning of a temporal ROA index */
+#define ROA_INDEX_MAGIC "ROAIDX\r\n"
+
+/** Length of the magic number */
+#define ROA_INDEX_MAGIC_LEN 8
+
+/** Version of the temporal ROA index format */
+#define ROA_INDEX_VERSION 1
+
+/** Byte order mark (indexes are stored in host byte order) */
+#define ROA_INDEX_BYTE_ORDER 0x01020304
+
+/** Maximum length of a collector name (PJ:CC) including the terminator */
+#define ROA_INDEX_NAME_LEN 64
+
+/** Number of top address byte entries per address family */
+#define ROA_INDEX_BYTES_LEN 257
+
+/** Header of a temporal ROA index
+ *
+ * An index consists of the header, the collectors, the IPv4 records, the IPv6
+ * records, the validity intervals and the top address byte entries, every
+ * section is aligned to 8 bytes. Every unique record of a collector is stored
+ * once with the intervals it was contained in the ROA dumps of the collector.
+ * The records of a family are sorted by prefix, length, max length, ASN and
+ * collector, the top address byte entries contain the first record of every
+ * top address byte.
+ */
+typedef struct struct_roa_index_header_t {
+
+  /** Magic number (ROA_INDEX_MAGIC) */
+  char magic[ROA_INDEX_MAGIC_LEN];
+
+  /** Format version (ROA_INDEX_VERSION) */
+  uint32_t version;
+
+  /** Byte order mark (ROA_INDEX_BYTE_ORDER) */
+  uint32_t byte_order;
+
+  /** Checksum of all sections behind the header */
+  uint64_t checksum;
+
+  /** Size of the index in bytes (including the header) */
+  uint64_t size;
+
+  /** Number of collectors */
+  uint32_t collectors;
+
+  /** First timestamp covered by a ROA dump */
+  uint32_t start;
+
+  /** First timestamp after the last ROA dump */
+  uint32_t end;
+
+  /** Padding (0) */
+  uint32_t pad;
+
+  /** Offset of the collectors */
+  uint64_t collector_offset;
+
+  /** Number of records per address family */
+  uint64_t count[2];
+
+  /** Offset of the records per address family */
+  uint64_t offset[2];
+
+  /** Number of validity intervals */
+  uint64_t interval_count;
+
+  /** Offset of the validity intervals */
+  uint64_t interval_offset;
+
+  /** Offset of the top address byte entries */
+  uint64_t bytes_offset;
+
+} roa_index_header_t;
+
+/** A validity interval [start, end) of a record or collector */
+typedef struct struct_roa_index_interval_t {
+
+  /** First timestamp of the interval */
+  uint32_t start;
+
+  /** First timestamp after the interval */
+  uint32_t end;
+
+} roa_index_interval_t;
+
+/** A collector of a temporal ROA index */
+typedef struct struct_roa_index_collector_t {
+
+  /** Name of the collector (PJ:CC) */
+  char name[ROA_INDEX_NAME_LEN];
+
+  /** First interval the collector has ROA dumps for */
+  uint32_t first;
+
+  /** Number of intervals */
+  uint32_t count;
+
+} roa_index_collector_t;
+
+/** An IPv4 record of a temporal ROA index */
+typedef struct struct_roa_index_ipv4_t {
+
+  /** Origin ASN */
+  uint32_t asn;
+
+  /** Prefix address */
+  uint32_t addr;
+
+  /** Prefix length and max length */
+  uint8_t min_len, max_len;
+
+  /** Collector of the record */
+  uint8_t collector;
+
+  /** Padding (0) */
+  uint8_t pad;
+
+  /** First validity interval */
+  uint32_t first;
+
+  /** Number of validity intervals */
+  uint32_t count;
+
+} roa_index_ipv4_t;
+
+/** An IPv6 record of a temporal ROA index */
+typedef struct struct_roa_index_ipv6_t {
+
+  /** Origin ASN */
+  uint32_t asn;
+
+  /** Prefix address words */
+  uint32_t addr[4];
+
+  /** Prefix length and max length */
+  uint8_t min_len, max_len;
+
+  /** Collector of the record */
+  uint8_t collector;
+
+  /** Padding (0) */
+  uint8_t pad;
+
+  /** First validity interval */
+  uint32_t first;
+
+  /** Number of validity intervals */
+  uint32_t count;
+
+} roa_index_ipv6_t;
+
+/** A change of a record of a collector while an index is built */
+typedef struct struct_roa_index_event_t {
+
+  /** Changed record */
+  roa_record_t record;
+
+  /** Timestamp of the change */
+  uint32_t timestamp;
+
+  /** Collector of the record */
+  uint8_t collector;
+
+  /** Whether the record was added (1) or removed (0) */
+  uint8_t added;
+
+} roa_index_event_t;
+
+/** A builder of a temporal ROA index (ROA dumps are added in order) */
+typedef struct struct_roa_index_builder_t {
+
+  /** Collector names
+   *
+   * Names of all collectors of the index (PJ:CC)
+   */
+  char names[MAX_RPKI_COUNT][ROA_INDEX_NAME_LEN];
+
+  /** Collector count
+   *
+   * Number of collectors of the index
+   */
+  int collectors;
+
+  /** Current records
+   *
+   * Canonical ROA set of the last ROA dump per collector
+   */
+  roa_set_t current[MAX_RPKI_COUNT];
+
+  /** Last timestamps
+   *
+   * First timestamp after the last ROA dump per collector (0 = none yet)
+   */
+  uint32_t end[MAX_RPKI_COUNT];
+
+  /** Coverage
+   *
+   * Intervals every collector has ROA dumps for
+   */
+  roa_index_interval_t *coverage[MAX_RPKI_COUNT];
+
+  /** Coverage count
+   *
+   * Number of intervals per collector
+   */
+  size_t coverage_count[MAX_RPKI_COUNT];
+
+  /** Events
+   *
+   * Added and removed records of all collectors
+   */
+  roa_index_event_t *events;
+
+  /** Event count
+   *
+   * Number of events
+   */
+  size_t events_count;
+
+  /** Event size
+   *
+   * Number of allocated events
+   */
+  size_t events_size;
+
+} roa_index_builder_t;
+
+/** A loaded temporal ROA index (mapped) */
+typedef struct struct_roa_index_t {
+
+  /** Header
+   *
+   * Header of the index (beginning of the index)
+   */
+  const roa_index_header_t *header;
+
+  /** Collectors
+   *
+   * All collectors of the index
+   */
+  const roa_index_collector_t *collectors;
+
+  /** IPv4 records
+   *
+   * Records of the IPv4 section
+   */
+  const roa_index_ipv4_t *ipv4;
+
+  /** IPv6 records
+   *
+   * Records of the IPv6 section
+   */
+  const roa_index_ipv6_t *ipv6;
+
+  /** Intervals
+   *
+   * Validity intervals of all records and collectors
+   */
+  const roa_index_interval_t *intervals;
+
+  /** Top address byte entries
+   *
+   * First record of every top address byte per family
+   */
+  const uint32_t *bytes;
+
+  /** Mapping
+   *
+   * Memory mapping of the index
+   */
+  void *map;
+
+  /** Size
+   *
+   * Size of the mapping in bytes
+   */
+  size_t size;
+
+} roa_index_t;
+
+/** Initialize an empty index builder
+ *
+ * @param[out] builder       Pointer to the index builder
+ */
+void roa_index_builder_init(roa_index_builder_t *builder);
+
+/** Free all records and events of an index builder
+ *
+ * @param[in] builder        Pointer to the index builder
+ */
+void roa_index_builder_free(roa_index_builder_t *builder);
+
+/** Get the collector of an index builder with a name (added if it is new)
+ *
+ * @param[in] builder        Pointer to the index builder
+ * @param[in] name           Name of the collector (PJ:CC)
+ * @return                   Collector, -1 if there are too many collectors
+ */
+int roa_index_builder_collector(roa_index_builder_t *builder,
+                                const char *name);
+
+/** Add the ROA dump of a collector to an index builder, the ROA dumps of a
+ *  collector are added in chronological order and every ROA dump is valid
+ *  until the next one (at most for ROA_ARCHIVE_INTERVAL seconds)
+ *
+ * @param[in] builder        Pointer to the index builder
+ * @param[in] collector      Collector of the ROA dump
+ * @param[in] timestamp      Timestamp of the ROA dump
+ * @param[in] set            ROA set of the ROA dump (the builder takes the
+ *                           ownership of the set)
+ * @return                   0 if the ROA dump was added, otherwise -1
+ */
+int roa_index_builder_add(roa_index_builder_t *builder, int collector,
+                          uint32_t timestamp, roa_set_t *set);
+
+/** Write all added ROA dumps of an index builder as temporal ROA index
+ *
+ * @param[in] builder        Pointer to the index builder
+ * @param[in] path           Path of the index (local file)
+ * @return                   0 if the index was written, otherwise -1
+ */
+int roa_index_builder_write(roa_index_builder_t *builder, const char *path);
+
+/** Load a temporal ROA index by mapping it
+ *
+ * @param[out] index         Pointer to the index
+ * @param[in]  path          Path to the index (local file)
+ * @return                   0 if the index is valid, otherwise -1
+ */
+int roa_index_open(roa_index_t *index, const char *path);
+
+/** Release a temporal ROA index
+ *
+ * @param[in] index          Pointer to the index
+ */
+void roa_index_close(roa_index_t *index);
+
+/** Get a collector of a temporal ROA index by its name
+ *
+ * @param[in] index          Pointer to the index
+ * @param[in] name           Name of the collector (PJ:CC)
+ * @return                   Collector, -1 if the index has no such collector
+ */
+int roa_index_collector(const roa_index_t *index, const char *name);
+
+/** Whether a collector of a temporal ROA index has a ROA dump for a timestamp
+ *
+ * @param[in] index          Pointer to the index
+ * @param[in] collector      Collector
+ * @param[in] timestamp      UTC epoch timestamp
+ * @return                   1 if the collector has a ROA dump, otherwise 0
+ */
+int roa_index_active(const roa_index_t *index, int collector,
+                     uint32_t timestamp);
+
+/** Validate a prefix and origin ASN at a timestamp against the records of
+ *  several collectors of a temporal ROA index (equal records of different
+ *  collectors are reported once)
+ *
+ * @param[in]  index         Pointer to the index
+ * @param[in]  collectors    Bit mask of the collectors
+ * @param[in]  timestamp     UTC epoch timestamp
+ * @param[in]  asn           Origin ASN of the prefix
+ * @param[in]  prefix        Announced network prefix
+ * @param[in]  mask_len      Length of the network mask of the prefix
+ * @param[out] reason        Matching records (has to be freed by the caller)
+ * @param[out] reason_len    Number of matching records
+ * @param[out] result        Validation state
+ * @return                   0 if the validation was valid, otherwise -1
+ */
+int roa_index_lookup(const roa_index_t *index, uint32_t collectors,
+                     uint32_t timestamp, uint32_t asn,
+                     const struct lrtr_ip_addr *prefix, uint8_t mask_len,
+                     struct pfx_record **reason, unsigned int *reason_len,
+                     enum pfxv_state *result);
+
+/** @} */
+
+#endif /* __ROA_INDEX_H */
@@ -0,0 +1,611 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "roa_parser.h"
+#include "roa_scan.h"
+#include "roa_snapshot.h"
+#include "debug.h"
+#include "utils.h"
+#include "wandio.h"
+
+/** Header of a ROA dump (optionally followed by further fields) */
+#define ROA_PARSER_HEADER "ASN,IP Prefix,Max Length"
+
+/** Multipliers of the content hash */
+#define ROA_PARSER_HASH_K1 0x9E3779B97F4A7C15ULL
+#define ROA_PARSER_HASH_K2 0xC2B2AE3D27D4EB4FULL
+
+/** Value + 1 of every hexadecimal digit (0 for other characters) */
+static const int8_t roa_parser_hex[256] = {
+  ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6,
+  ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10, ['a'] = 11, ['b'] = 12,
+  ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16, ['A'] = 11, ['B'] = 12,
+  ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+/* Parse an unsigned decimal value of at most max (leading zeros allowed) */
+static int roa_parser_uint(const char *str, size_t len, uint64_t max,
+                           uint64_t *val)
+{
+  if (!len) {
+    return -1;
+  }
+  uint64_t rst = 0;
+  for (size_t i = 0; i < len; i++) {
+    unsigned int digit = (unsigned char)str[i] - '0';
+    if (digit > 9 || (rst = rst * 10 + digit) > max) {
+      return -1;
+    }
+  }
+  *val = rst;
+  return 0;
+}
+
+/* Parse a dotted-quad IPv4 address into host byte order (as inet_pton, no
+   leading zeros and exactly four octets) */
+static int roa_parser_addr4(const char *str, size_t len, uint32_t *addr)
+{
+  uint32_t rst = 0, octet = 0;
+  int octets = 0, digits = 0;
+  for (size_t i = 0; i < len; i++) {
+    unsigned int digit = (unsigned char)str[i] - '0';
+    if (digit <= 9) {
+      if ((digits && !octet) || (octet = octet * 10 + digit) > 255) {
+        return -1;
+      }
+      digits++;
+    } else if (str[i] == '.' && digits && octets < 3) {
+      rst = (rst << 8) | octet;
+      octet = digits = 0;
+      octets++;
+    } else {
+      return -1;
+    }
+  }
+  if (!digits || octets != 3) {
+    return -1;
+  }
+  *addr = (rst << 8) | octet;
+  return 0;
+}
+
+/* Parse an IPv6 address (with "::" compression and an optional embedded
+   IPv4 address) into host byte order words */
+static int roa_parser_addr6(const char *str, size_t len, uint32_t *addr)
+{
+  uint16_t words[8] = {0};
+  int cnt = 0, gap = -1;
+  size_t pos = 0;
+
+  /* A leading colon is only valid as part of "::" */
+  if (len >= 2 && str[0] == ':' && str[1] == ':') {
+    gap = 0;
+    pos = 2;
+  } else if (len && str[0] == ':') {
+    return -1;
+  }
+
+  while (pos < len) {
+    const char *end = memchr(str + pos, ':', len - pos);
+    size_t group = (end == NULL ? len : (size_t)(end - str)) - pos;
+
+    /* An embedded IPv4 address has to be the last group */
+    if (end == NULL && memchr(str + pos, '.', group) != NULL) {
+      uint32_t addr4;
+      if (cnt > 6 || roa_parser_addr4(str + pos, group, &addr4) != 0) {
+        return -1;
+      }
+      words[cnt++] = addr4 >> 16;
+      words[cnt++] = addr4 & 0xFFFF;
+      break;
+    }
+
+    /* Every group consists of one to four hexadecimal digits */
+    if (!group || group > 4 || cnt == 8) {
+      return -1;
+    }
+    uint32_t word = 0;
+    for (size_t i = pos; i < pos + group; i++) {
+      int digit = roa_parser_hex[(unsigned char)str[i]];
+      if (!digit) {
+        return -1;
+      }
+      word = (word << 4) | (digit - 1);
+    }
+    words[cnt++] = word;
+    if (end == NULL) {
+      break;
+    }
+
+    /* Colon, compression ("::" only once) or a dangling colon at the end */
+    pos += group + 1;
+    if (pos < len && str[pos] == ':') {
+      if (gap >= 0) {
+        return -1;
+      }
+      gap = cnt;
+      pos++;
+    } else if (pos == len) {
+      return -1;
+    }
+  }
+
+  /* Expand the compression to the missing zero words */
+  if (gap >= 0) {
+    if (cnt == 8) {
+      return -1;
+    }
+    int tail = cnt - gap;
+    memmove(&words[8 - tail], &words[gap], tail * sizeof(uint16_t));
+    memset(&words[gap], 0, (8 - cnt) * sizeof(uint16_t));
+  } else if (cnt != 8) {
+    return -1;
+  }
+  for (int i = 0; i < 4; i++) {
+    addr[i] = ((uint32_t)words[2 * i] << 16) | words[2 * i + 1];
+  }
+  return 0;
+}
+
+int roa_parser_addr(const char *str, size_t len, struct lrtr_ip_addr *addr)
+{
+  if (memchr(str, ':', len) != NULL) {
+    addr->ver = LRTR_IPV6;
+    return roa_parser_addr6(str, len, addr->u.addr6.addr);
+  }
+  addr->ver = LRTR_IPV4;
+  return roa_parser_addr4(str, len, &addr->u.addr4.addr);
+}
+
+int roa_parser_prefix(const char *str, size_t len, struct lrtr_ip_addr *addr,
+                      uint8_t *min_len)
+{
+  const char *slash = memchr(str, '/', len);
+  uint64_t val;
+  if (slash == NULL || roa_parser_addr(str, slash - str, addr) != 0 ||
+      roa_parser_uint(slash + 1, str + len - slash - 1,
+                      addr->ver == LRTR_IPV4 ? 32 : 128, &val) != 0) {
+    return -1;
+  }
+  *min_len = val;
+  return 0;
+}
+
+int roa_parser_asn(const char *str, size_t len, uint32_t *asn)
+{
+  /* Bypass the different notations for the ASN (e.g. 718 || AS718) */
+  if (len > 2 && str[0] == 'A' && str[1] == 'S') {
+    str += 2;
+    len -= 2;
+  }
+  uint64_t val;
+  if (roa_parser_uint(str, len, UINT32_MAX, &val) != 0) {
+    return -1;
+  }
+  *asn = val;
+  return 0;
+}
+
+int roa_parser_uint8(const char *str, size_t len, uint8_t *val)
+{
+  uint64_t rst;
+  if (roa_parser_uint(str, len, UINT8_MAX, &rst) != 0) {
+    return -1;
+  }
+  *val = rst;
+  return 0;
+}
+
+/* Parse a single line of a ROA dump with the start of its first fields
+   (fields is NULL if the fields are not known yet)
+   Format: ASN,IP Prefix,Max Length(,Trust Anchor)? */
+static int roa_parser_line(roa_parser_t *parser, const char *line, size_t len,
+                           const char **line_fields, int cnt)
+{
+  /* Skip empty lines and line endings of different platforms */
+  if (len && line[len - 1] == '\r') {
+    len--;
+  }
+  if (!len) {
+    return 0;
+  }
+  parser->lines++;
+
+  /* Check whether the ROA dump contains header information, abort if not */
+  if (!parser->header) {
+    if (len < strlen(ROA_PARSER_HEADER) ||
+        strncmp(line, ROA_PARSER_HEADER, strlen(ROA_PARSER_HEADER))) {
+      std_print("%s", "Error: Could not read ROA file from broker\n");
+      return -1;
+    }
+    parser->header = 1;
+    return 0;
+  }
+
+  /* Split the first three fields (further fields are ignored) */
+  const char *fields[4] = {line, NULL, NULL, NULL};
+  const char *end = line + len;
+  if (line_fields != NULL) {
+    memcpy(fields, line_fields, cnt * sizeof(char *));
+  } else {
+    cnt = 1;
+    for (const char *c = line; c < end && cnt < 4; c++) {
+      if (*c == ',') {
+        fields[cnt++] = c + 1;
+      }
+    }
+  }
+  if (cnt < 3) {
+    std_print("Error: Record is corrupt at line: %zu\n", parser->lines);
+    return -1;
+  }
+  if (cnt == 3) {
+    fields[3] = end + 1;
+  }
+
+  /* Convert the fields directly into binary values */
+  uint32_t asn = 0;
+  uint8_t min_len = 0, max_len = 0;
+  struct lrtr_ip_addr ip;
+  if (roa_parser_asn(fields[0], fields[1] - fields[0] - 1, &asn) != 0 ||
+      roa_parser_prefix(fields[1], fields[2] - fields[1] - 1, &ip,
+                        &min_len) != 0 ||
+      roa_parser_uint8(fields[2], fields[3] - fields[2] - 1, &max_len) != 0) {
+    std_print("Error: Record is corrupt at line: %zu\n", parser->lines);
+    return -1;
+  }
+
+  /* Pass the record on */
+  roa_record_t record;
+  roa_record_from_addr(asn, &ip, min_len, max_len, &record);
+  parser->records++;
+  return parser->record_fp(&record, parser->data);
+}
+
+/* Mix a word of the ROA dump into the content hash */
+static inline uint64_t roa_parser_hash_mix(uint64_t hash, uint64_t word)
+{
+  hash ^= word * ROA_PARSER_HASH_K1;
+  return ((hash << 31) | (hash >> 33)) * ROA_PARSER_HASH_K2;
+}
+
+/* Hash the bytes of a chunk word by word, the bytes of an incomplete word are
+   kept for the next chunk (in memory order, like complete words) */
+static void roa_parser_hash_update(roa_parser_t *parser, const char *buf,
+                                   size_t len)
+{
+  size_t i = 0;
+  for (; i < len && (parser->size & 7); i++) {
+    memcpy((char *)&parser->hash_word + (parser->size++ & 7), buf + i, 1);
+    if (!(parser->size & 7)) {
+      parser->hash = roa_parser_hash_mix(parser->hash, parser->hash_word);
+      parser->hash_word = 0;
+    }
+  }
+  uint64_t hash = parser->hash, word;
+  size_t words = (len - i) / 8;
+  for (size_t w = 0; w < words; w++, i += 8) {
+    memcpy(&word, buf + i, sizeof(word));
+    hash = roa_parser_hash_mix(hash, word);
+  }
+  parser->hash = hash;
+  parser->size += words * 8;
+  for (; i < len; i++) {
+    memcpy((char *)&parser->hash_word + (parser->size++ & 7), buf + i, 1);
+  }
+}
+
+void roa_parser_init(roa_parser_t *parser, roa_parser_record_fp record_fp,
+                     void *data)
+{
+  memset(parser, 0, sizeof(roa_parser_t));
+  parser->record_fp = record_fp;
+  parser->data = data;
+}
+
+int roa_parser_feed(roa_parser_t *parser, const char *buf, size_t len)
+{
+  /* Current line, start of its fields and whether it started in a previous
+     chunk (the beginning is stored in the line buffer) */
+  const char *line = buf;
+  const char *fields[4] = {buf, NULL, NULL, NULL};
+  int cnt = 1, carry = (parser->line_len > 0);
+
+  /* Visit all commas and newlines found by the structural scanner */
+  uint64_t bitmap[ROA_SCAN_BLOCK_SIZE / 64];
+  for (size_t pos = 0; pos < len; pos += ROA_SCAN_BLOCK_SIZE) {
+    size_t block = len - pos;
+    block = (block < ROA_SCAN_BLOCK_SIZE ? block : ROA_SCAN_BLOCK_SIZE);
+    roa_scan_structural(buf + pos, block, bitmap);
+    roa_parser_hash_update(parser, buf + pos, block);
+    for (size_t w = 0; w < (block + 63) / 64; w++) {
+      for (uint64_t bits = bitmap[w]; bits; bits &= bits - 1) {
+        const char *c = buf + pos + w * 64 + __builtin_ctzll(bits);
+        if (*c == ',') {
+          if (cnt < 4) {
+            fields[cnt++] = c + 1;
+          }
+          continue;
+        }
+
+        /* Parse complete lines directly from the chunk, a line which started
+           in the previous chunk is completed in the line buffer */
+        int ret;
+        if (carry) {
+          size_t n = c - buf;
+          if (parser->line_len + n > sizeof(parser->line)) {
+            std_print("Error: Record is corrupt at line: %zu\n",
+                      parser->lines + 1);
+            return -1;
+          }
+          memcpy(parser->line + parser->line_len, buf, n);
+          ret = roa_parser_line(parser, parser->line, parser->line_len + n,
+                                NULL, 0);
+          parser->line_len = 0;
+          carry = 0;
+        } else {
+          ret = roa_parser_line(parser, line, c - line, fields, cnt);
+        }
+        if (ret != 0) {
+          return -1;
+        }
+        line = fields[0] = c + 1;
+        cnt = 1;
+      }
+    }
+  }
+
+  /* Keep an incomplete line for the next chunk */
+  size_t n = buf + len - line;
+  if (parser->line_len + n > sizeof(parser->line)) {
+    std_print("Error: Record is corrupt at line: %zu\n", parser->lines + 1);
+    return -1;
+  }
+  memcpy(parser->line + parser->line_len, line, n);
+  parser->line_len += n;
+  return 0;
+}
+
+int roa_parser_finish(roa_parser_t *parser)
+{
+  if (parser->line_len) {
+    size_t len = parser->line_len;
+    parser->line_len = 0;
+    if (roa_parser_line(parser, parser->line, len, NULL, 0) != 0) {
+      return -1;
+    }
+  }
+  if (!parser->header) {
+    std_print("%s", "Error: Could not read ROA file from broker\n");
+    return -1;
+  }
+  return 0;
+}
+
+uint64_t roa_parser_hash(const roa_parser_t *parser)
+{
+  /* Mix in the incomplete last word and the size, then finalize the hash */
+  uint64_t hash = parser->hash;
+  if (parser->size & 7) {
+    hash = roa_parser_hash_mix(hash, parser->hash_word);
+  }
+  hash ^= parser->size;
+  hash = (hash ^ (hash >> 33)) * ROA_PARSER_HASH_K2;
+  hash = (hash ^ (hash >> 29)) * ROA_PARSER_HASH_K1;
+  hash ^= hash >> 32;
+  return hash ? hash : 1;
+}
+
+uint64_t roa_parser_hash_buf(const void *buf, size_t len)
+{
+  roa_parser_t parser;
+  roa_parser_init(&parser, NULL, NULL);
+  roa_parser_hash_update(&parser, (const char *)buf, len);
+  return roa_parser_hash(&parser);
+}
+
+/* Whether a ROA dump starts with the magic number of a compression format
+   (gzip, bzip2, xz, zstd, lz4) */
+static int roa_parser_encoded(const unsigned char *buf, size_t len)
+{
+  static const struct {
+    const char *magic;
+    size_t len;
+  } formats[] = {{"\x1f\x8b", 2}, {"BZh", 3}, {"\xfd" "7zXZ", 5},
+                 {"\x28\xb5\x2f\xfd", 4}, {"\x04\x22\x4d\x18", 4}};
+  for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+    if (len >= formats[i].len && !memcmp(buf, formats[i].magic, formats[i].len)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int roa_parser_mappable(const char *roa_path)
+{
+  if (strstr(roa_path, "://") != NULL) {
+    return 0;
+  }
+  unsigned char magic[ROA_SNAPSHOT_MAGIC_LEN];
+  struct stat st;
+  int fd = open(roa_path, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  ssize_t len = 0;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    len = pread(fd, magic, sizeof(magic), 0);
+  }
+  close(fd);
+  return len > 0 && !roa_parser_encoded(magic, len);
+}
+
+/* Load the records of a ROA snapshot without parsing (from the opened file if
+   it is not NULL) */
+static int roa_parser_read_snapshot(const char *roa_path, io_t *file_io,
+                                    roa_parser_record_fp record_fp, void *data,
+                                    size_t *records, uint64_t *hash)
+{
+  roa_snapshot_t snap;
+  if ((file_io != NULL ? roa_snapshot_open_io(&snap, file_io, roa_path)
+                       : roa_snapshot_open(&snap, roa_path)) != 0) {
+    return -1;
+  }
+  int ret = roa_snapshot_read(&snap, record_fp, data);
+  if (records != NULL) {
+    *records = snap.header->count[ROA_IPV4] + snap.header->count[ROA_IPV6];
+  }
+  if (hash != NULL) {
+    *hash = snap.header->hash;
+  }
+  roa_snapshot_close(&snap);
+  return ret;
+}
+
+/* Parse a local uncompressed ROA dump directly from a mapping of the file,
+   local ROA snapshots are mapped by the snapshot reader (returns 1 if the file
+   can not be mapped) */
+static int roa_parser_read_mapped(const char *roa_path,
+                                  roa_parser_record_fp record_fp, void *data,
+                                  size_t *records, uint64_t *hash)
+{
+  if (strstr(roa_path, "://") != NULL) {
+    return 1;
+  }
+  int fd = open(roa_path, O_RDONLY);
+  if (fd < 0) {
+    return 1;
+  }
+  struct stat st;
+  void *map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) {
+    return 1;
+  }
+  size_t len = st.st_size;
+  size_t magic = len < ROA_SNAPSHOT_MAGIC_LEN ? len : ROA_SNAPSHOT_MAGIC_LEN;
+  if (roa_parser_encoded(map, magic)) {
+    munmap(map, len);
+    return 1;
+  }
+  if (roa_snapshot_detect(map, magic)) {
+    munmap(map, len);
+    return roa_parser_read_snapshot(roa_path, NULL, record_fp, data, records,
+                                    hash);
+  }
+
+  /* The whole mapping is parsed at once, the kernel reads ahead */
+  madvise(map, len, MADV_SEQUENTIAL);
+  roa_parser_t parser;
+  roa_parser_init(&parser, record_fp, data);
+  int ret = roa_parser_feed(&parser, map, len);
+  munmap(map, len);
+  if (ret != 0 || roa_parser_finish(&parser) != 0) {
+    return -1;
+  }
+  if (records != NULL) {
+    *records = parser.records;
+  }
+  if (hash != NULL) {
+    *hash = roa_parser_hash(&parser);
+  }
+  return 0;
+}
+
+int roa_parser_read(char *roa_path, roa_parser_record_fp record_fp, void *data,
+                    size_t *records, uint64_t *hash)
+{
+  /* Local uncompressed ROA dumps are parsed without any copy */
+  int mapped = roa_parser_read_mapped(roa_path, record_fp, data, records,
+                                      hash);
+  if (mapped <= 0) {
+    return mapped;
+  }
+
+  io_t *file_io = wandio_create(roa_path);
+  if (file_io == NULL) {
+    std_print("Error: Could not open %s for reading\n", roa_path);
+    return -1;
+  }
+
+  /* Snapshots are loaded without parsing, the peeked magic number is still
+     buffered and read again by the snapshot loader */
+  char magic[ROA_SNAPSHOT_MAGIC_LEN];
+  int64_t peek = wandio_peek(file_io, magic, sizeof(magic));
+  if (peek > 0 && roa_snapshot_detect(magic, peek)) {
+    int snap_ret = roa_parser_read_snapshot(roa_path, file_io, record_fp, data,
+                                            records, hash);
+    wandio_destroy(file_io);
+    return snap_ret;
+  }
+
+  char *buf = malloc(ROA_PARSER_CHUNK_SIZE);
+  if (buf == NULL) {
+    wandio_destroy(file_io);
+    return -1;
+  }
+
+  /* Parse every chunk as soon as it was read */
+  roa_parser_t parser;
+  roa_parser_init(&parser, record_fp, data);
+  int64_t ret;
+  while ((ret = wandio_read(file_io, buf, ROA_PARSER_CHUNK_SIZE)) > 0) {
+    if (roa_parser_feed(&parser, buf, ret) != 0) {
+      break;
+    }
+  }
+  if (ret < 0) {
+    std_print("%s", "Error: Could not read ROA file from broker\n");
+  }
+  free(buf);
+  wandio_destroy(file_io);
+  if (ret != 0 || roa_parser_finish(&parser) != 0) {
+    return -1;
+  }
+
+  if (records != NULL) {
+    *records = parser.records;
+  }
+  if (hash != NULL) {
+    *hash = roa_parser_hash(&parser);
+  }
+  return 0;
+}
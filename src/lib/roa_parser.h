@@ -0,0 +1,217 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __ROA_PARSER_H
+#define __ROA_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "roa_set.h"
+
+/** Function called for every parsed ROA record
+ *
+ * @param[in] record         Parsed ROA record
+ * @param[in] data           User data passed to the parser
+ * @return                   0 to continue the parsing, otherwise -1
+ */
+typedef int (*roa_parser_record_fp)(const roa_record_t *record, void *data);
+
+/** An incremental ROA dump (CSV) parser */
+typedef struct struct_roa_parser_t {
+
+  /** Record function
+   *
+   * Function called for every parsed ROA record
+   */
+  roa_parser_record_fp record_fp;
+
+  /** User data
+   *
+   * User data passed to the record function
+   */
+  void *data;
+
+  /** Line buffer
+   *
+   * Incomplete line at the end of the previous chunk
+   */
+  char line[ROA_PARSER_MAX_LINE_LEN];
+
+  /** Line buffer length
+   *
+   * Length of the incomplete line
+   */
+  size_t line_len;
+
+  /** Header flag
+   *
+   * Whether the header of the ROA dump was parsed (0 = no, 1 = yes)
+   */
+  int header;
+
+  /** Line count
+   *
+   * Number of parsed lines (including the header)
+   */
+  size_t lines;
+
+  /** Record count
+   *
+   * Number of parsed ROA records
+   */
+  size_t records;
+
+  /** Content hash
+   *
+   * Hash of all complete 8 byte words of the ROA dump
+   */
+  uint64_t hash;
+
+  /** Hash word
+   *
+   * Bytes of the incomplete last word of the ROA dump
+   */
+  uint64_t hash_word;
+
+  /** Size
+   *
+   * Number of bytes of the ROA dump
+   */
+  uint64_t size;
+
+} roa_parser_t;
+
+/** Parse an IPv4 or IPv6 address (as accepted by inet_pton)
+ *
+ * @param[in]  str           Address (not necessarily null-terminated)
+ * @param[in]  len           Length of the address
+ * @param[out] addr          RTRlib address in host byte order
+ * @return                   0 if the address is valid, otherwise -1
+ */
+int roa_parser_addr(const char *str, size_t len, struct lrtr_ip_addr *addr);
+
+/** Parse a prefix in the notation "address/length"
+ *
+ * @param[in]  str           Prefix (not necessarily null-terminated)
+ * @param[in]  len           Length of the prefix string
+ * @param[out] addr          RTRlib address in host byte order
+ * @param[out] min_len       Length of the prefix
+ * @return                   0 if the prefix is valid, otherwise -1
+ */
+int roa_parser_prefix(const char *str, size_t len, struct lrtr_ip_addr *addr,
+                      uint8_t *min_len);
+
+/** Parse an ASN in the notation "718" or "AS718"
+ *
+ * @param[in]  str           ASN (not necessarily null-terminated)
+ * @param[in]  len           Length of the ASN string
+ * @param[out] asn           ASN value
+ * @return                   0 if the ASN is valid, otherwise -1
+ */
+int roa_parser_asn(const char *str, size_t len, uint32_t *asn);
+
+/** Parse an unsigned 8 bit decimal value (e.g. the max length of a ROA)
+ *
+ * @param[in]  str           Value (not necessarily null-terminated)
+ * @param[in]  len           Length of the value string
+ * @param[out] val           Parsed value
+ * @return                   0 if the value is valid, otherwise -1
+ */
+int roa_parser_uint8(const char *str, size_t len, uint8_t *val);
+
+/** Initialize a ROA dump parser
+ *
+ * @param[out] parser        Pointer to the parser
+ * @param[in]  record_fp     Function called for every parsed ROA record
+ * @param[in]  data          User data passed to the record function
+ */
+void roa_parser_init(roa_parser_t *parser, roa_parser_record_fp record_fp,
+                     void *data);
+
+/** Parse a chunk of a ROA dump (records may span several chunks)
+ *
+ * @param[in] parser         Pointer to the parser
+ * @param[in] buf            Chunk of the ROA dump
+ * @param[in] len            Length of the chunk
+ * @return                   0 if the chunk was parsed, otherwise -1
+ */
+int roa_parser_feed(roa_parser_t *parser, const char *buf, size_t len);
+
+/** Parse the remaining line of a ROA dump after the last chunk
+ *
+ * @param[in] parser         Pointer to the parser
+ * @return                   0 if the ROA dump was valid, otherwise -1
+ */
+int roa_parser_finish(roa_parser_t *parser);
+
+/** Get the content hash of all bytes fed to a ROA dump parser (a fast non
+ *  cryptographic hash, identical ROA dumps have the same hash regardless of
+ *  their chunks)
+ *
+ * @param[in] parser         Pointer to the parser
+ * @return                   Content hash (never 0)
+ */
+uint64_t roa_parser_hash(const roa_parser_t *parser);
+
+/** Get the content hash of a buffer (the same hash as for a ROA dump with
+ *  the same content)
+ *
+ * @param[in] buf            Buffer
+ * @param[in] len            Length of the buffer
+ * @return                   Content hash (never 0)
+ */
+uint64_t roa_parser_hash_buf(const void *buf, size_t len);
+
+/** Whether a ROA dump is a local uncompressed file or ROA snapshot which is
+ *  read from a mapping of the file
+ *
+ * @param[in] roa_path       Path to the ROA dump (local file or URL)
+ * @return                   1 if the ROA dump is mapped, otherwise 0
+ */
+int roa_parser_mappable(const char *roa_path);
+
+/** Read and parse a ROA dump (local uncompressed ROA dumps are parsed from a
+ *  mapping of the file, all other ROA dumps chunk by chunk, ROA snapshots are
+ *  detected and loaded without parsing)
+ *
+ * @param[in] roa_path       Path to the ROA dump (local file or URL)
+ * @param[in] record_fp      Function called for every parsed ROA record
+ * @param[in] data           User data passed to the record function
+ * @param[out] records       Number of parsed ROA records (or NULL)
+ * @param[out] hash          Content hash of the ROA dump (or NULL)
+ * @return                   0 if the ROA dump was parsed, otherwise -1
+ */
+int roa_parser_read(char *roa_path, roa_parser_record_fp record_fp, void *data,
+                    size_t *records, uint64_t *hash);
+
+/** @} */
+
+#endif /* __ROA_PARSER_H */
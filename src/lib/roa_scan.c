@@ -0,0 +1,168 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "roa_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ROA_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+/** Scanner of a single block */
+typedef void (*roa_scan_fp)(const char *buf, size_t len, uint64_t *bitmap);
+
+/* Scan the remaining bytes of a block one at a time */
+static void roa_scan_tail(const char *buf, size_t start, size_t len,
+                          uint64_t *bitmap)
+{
+  for (size_t i = start; i < len; i++) {
+    if (buf[i] == ',' || buf[i] == '\n') {
+      bitmap[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+  }
+}
+
+static void roa_scan_scalar(const char *buf, size_t len, uint64_t *bitmap)
+{
+  memset(bitmap, 0, ((len + 63) / 64) * sizeof(uint64_t));
+  roa_scan_tail(buf, 0, len, bitmap);
+}
+
+#ifdef ROA_SCAN_X86
+__attribute__((target("sse2")))
+static void roa_scan_sse2(const char *buf, size_t len, uint64_t *bitmap)
+{
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i newline = _mm_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    uint64_t word = 0;
+    for (int j = 0; j < 4; j++) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(buf + i + j * 16));
+      __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, comma),
+                               _mm_cmpeq_epi8(v, newline));
+      word |= (uint64_t)(uint16_t)_mm_movemask_epi8(m) << (j * 16);
+    }
+    bitmap[i / 64] = word;
+  }
+  if (i < len) {
+    bitmap[i / 64] = 0;
+    roa_scan_tail(buf, i, len, bitmap);
+  }
+}
+
+__attribute__((target("avx2")))
+static void roa_scan_avx2(const char *buf, size_t len, uint64_t *bitmap)
+{
+  const __m256i comma = _mm256_set1_epi8(',');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *)(buf + i));
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(buf + i + 32));
+    __m256i mlo = _mm256_or_si256(_mm256_cmpeq_epi8(lo, comma),
+                                  _mm256_cmpeq_epi8(lo, newline));
+    __m256i mhi = _mm256_or_si256(_mm256_cmpeq_epi8(hi, comma),
+                                  _mm256_cmpeq_epi8(hi, newline));
+    bitmap[i / 64] = (uint64_t)(uint32_t)_mm256_movemask_epi8(mlo) |
+                     (uint64_t)(uint32_t)_mm256_movemask_epi8(mhi) << 32;
+  }
+  if (i < len) {
+    bitmap[i / 64] = 0;
+    roa_scan_tail(buf, i, len, bitmap);
+  }
+}
+#endif
+
+/** Selected scanner (NULL until the first scan) */
+static roa_scan_fp roa_scan_impl = NULL;
+
+/** Selected instruction set */
+static roa_scan_isa_t roa_scan_isa = ROA_SCAN_AUTO;
+
+/** Selection of the best instruction set on the first scan */
+static pthread_once_t roa_scan_once = PTHREAD_ONCE_INIT;
+
+static void roa_scan_init(void)
+{
+  if (roa_scan_impl == NULL) {
+    roa_scan_set_isa(ROA_SCAN_AUTO);
+  }
+}
+
+int roa_scan_set_isa(roa_scan_isa_t isa)
+{
+#ifdef ROA_SCAN_X86
+  __builtin_cpu_init();
+  if (isa == ROA_SCAN_AUTO) {
+    isa = __builtin_cpu_supports("avx2")
+              ? ROA_SCAN_AVX2
+              : (__builtin_cpu_supports("sse2") ? ROA_SCAN_SSE2
+                                                : ROA_SCAN_SCALAR);
+  }
+  if ((isa == ROA_SCAN_AVX2 && !__builtin_cpu_supports("avx2")) ||
+      (isa == ROA_SCAN_SSE2 && !__builtin_cpu_supports("sse2"))) {
+    return -1;
+  }
+  roa_scan_impl = (isa == ROA_SCAN_AVX2
+                       ? roa_scan_avx2
+                       : (isa == ROA_SCAN_SSE2 ? roa_scan_sse2
+                                               : roa_scan_scalar));
+#else
+  if (isa == ROA_SCAN_AUTO) {
+    isa = ROA_SCAN_SCALAR;
+  }
+  if (isa != ROA_SCAN_SCALAR) {
+    return -1;
+  }
+  roa_scan_impl = roa_scan_scalar;
+#endif
+  roa_scan_isa = isa;
+  return 0;
+}
+
+const char *roa_scan_isa_name(void)
+{
+  pthread_once(&roa_scan_once, roa_scan_init);
+  switch (roa_scan_isa) {
+  case ROA_SCAN_AVX2: return "avx2";
+  case ROA_SCAN_SSE2: return "sse2";
+  default: return "scalar";
+  }
+}
+
+void roa_scan_structural(const char *buf, size_t len, uint64_t *bitmap)
+{
+  pthread_once(&roa_scan_once, roa_scan_init);
+  roa_scan_impl(buf, len, bitmap);
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __ROA_SCAN_H
+#define __ROA_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Size of a block scanned at once (multiple of 64) */
+#define ROA_SCAN_BLOCK_SIZE 4096
+
+/** Instruction sets of the structural scanner */
+typedef enum {
+
+  /** Best instruction set of the CPU */
+  ROA_SCAN_AUTO = 0,
+
+  /** Portable byte-at-a-time scanner */
+  ROA_SCAN_SCALAR = 1,
+
+  /** SSE2 (16 bytes at a time) */
+  ROA_SCAN_SSE2 = 2,
+
+  /** AVX2 (32 bytes at a time) */
+  ROA_SCAN_AVX2 = 3
+
+} roa_scan_isa_t;
+
+/** Find all structural characters (comma, newline) of a block
+ *
+ * Bit i % 64 of bitmap[i / 64] is set if buf[i] is a comma or a newline.
+ *
+ * @param[in]  buf           Block which will be scanned
+ * @param[in]  len           Length of the block (max. ROA_SCAN_BLOCK_SIZE)
+ * @param[out] bitmap        Position bitmap (ROA_SCAN_BLOCK_SIZE / 64 words)
+ */
+void roa_scan_structural(const char *buf, size_t len, uint64_t *bitmap);
+
+/** Select the instruction set of the structural scanner
+ *
+ * @param[in] isa            Instruction set (ROA_SCAN_AUTO for the best one)
+ * @return                   0 if the instruction set is supported, otherwise -1
+ */
+int roa_scan_set_isa(roa_scan_isa_t isa);
+
+/** Name of the selected instruction set of the structural scanner
+ *
+ * @return                   Name of the instruction set
+ */
+const char *roa_scan_isa_name(void);
+
+/** @} */
+
+#endif /* __ROA_SCAN_H */
@@ -0,0 +1,418 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roa_set.h"
+
+/** Initial number of records of a ROA set */
+#define ROA_SET_INIT_SIZE 1024
+
+/** Max depth of the covering prefix stack (IPv6 /0 - /128) */
+#define ROA_SET_MAX_DEPTH 129
+
+uint32_t roa_record_word_mask(uint8_t len, int word)
+{
+  int bits = (int)len - 32 * word;
+  if (bits <= 0) {
+    return 0;
+  }
+  return bits >= 32 ? UINT32_MAX : ~(UINT32_MAX >> bits);
+}
+
+/* Whether record a covers the prefix of record b (a is canonical) */
+static int roa_set_covers(const roa_record_t *a, const roa_record_t *b)
+{
+  if (a->family != b->family || a->min_len > b->min_len) {
+    return 0;
+  }
+  for (int i = 0; i < 4; i++) {
+    if ((b->addr[i] & roa_record_word_mask(a->min_len, i)) != a->addr[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Order by ASN, family, prefix, min length and descending max length
+   -> covering prefixes of the same ASN precede all covered prefixes */
+static int roa_set_cmp_key(const roa_record_t *a, const roa_record_t *b)
+{
+  if (a->asn != b->asn) {
+    return a->asn < b->asn ? -1 : 1;
+  }
+  if (a->family != b->family) {
+    return a->family < b->family ? -1 : 1;
+  }
+  for (int i = 0; i < 4; i++) {
+    if (a->addr[i] != b->addr[i]) {
+      return a->addr[i] < b->addr[i] ? -1 : 1;
+    }
+  }
+  if (a->min_len != b->min_len) {
+    return a->min_len < b->min_len ? -1 : 1;
+  }
+  return 0;
+}
+
+static int roa_set_cmp_prefix(const void *a, const void *b)
+{
+  return roa_set_cmp_key((const roa_record_t *)a, (const roa_record_t *)b);
+}
+
+static int roa_set_cmp(const void *a, const void *b)
+{
+  const roa_record_t *ra = (const roa_record_t *)a;
+  const roa_record_t *rb = (const roa_record_t *)b;
+  int ret = roa_set_cmp_key(ra, rb);
+  if (ret != 0) {
+    return ret;
+  }
+  return ra->max_len == rb->max_len ? 0 : (ra->max_len > rb->max_len ? -1 : 1);
+}
+
+int roa_set_init(roa_set_t *set)
+{
+  return roa_set_init_arena(set, NULL);
+}
+
+int roa_set_init_arena(roa_set_t *set, arena_t *arena)
+{
+  set->count = 0;
+  set->size = ROA_SET_INIT_SIZE;
+  set->arena = arena;
+  if (arena != NULL) {
+    set->records = arena_alloc(arena, set->size * sizeof(roa_record_t));
+  } else {
+    set->records = malloc(set->size * sizeof(roa_record_t));
+  }
+  if (set->records == NULL) {
+    set->size = 0;
+    return -1;
+  }
+  return 0;
+}
+
+void roa_set_free(roa_set_t *set)
+{
+  if (set == NULL) {
+    return;
+  }
+  if (set->arena == NULL) {
+    free(set->records);
+  }
+  set->records = NULL;
+  set->count = 0;
+  set->size = 0;
+}
+
+int roa_set_add(roa_set_t *set, const roa_record_t *record)
+{
+  /* Double the size of the set if necessary */
+  if (set->count == set->size) {
+    size_t size = set->size ? set->size * 2 : ROA_SET_INIT_SIZE;
+    roa_record_t *records;
+    if (set->arena != NULL) {
+      records = arena_realloc(set->arena, set->records,
+                              set->size * sizeof(roa_record_t),
+                              size * sizeof(roa_record_t));
+    } else {
+      records = realloc(set->records, size * sizeof(roa_record_t));
+    }
+    if (records == NULL) {
+      return -1;
+    }
+    set->records = records;
+    set->size = size;
+  }
+  set->records[set->count++] = *record;
+  return 0;
+}
+
+int roa_set_copy(const roa_set_t *from, roa_set_t *to)
+{
+  to->count = 0;
+  to->size = (from->count ? from->count : ROA_SET_INIT_SIZE);
+  to->arena = NULL;
+  to->records = malloc(to->size * sizeof(roa_record_t));
+  if (to->records == NULL) {
+    to->size = 0;
+    return -1;
+  }
+  if (from->count) {
+    memcpy(to->records, from->records, from->count * sizeof(roa_record_t));
+  }
+  to->count = from->count;
+  return 0;
+}
+
+void roa_set_sort(roa_set_t *set)
+{
+  qsort(set->records, set->count, sizeof(roa_record_t), roa_set_cmp);
+}
+
+/* Remove all records covered by a record of the same ASN with an equal or
+   larger max length (set has to be sorted), return the removed count */
+static size_t roa_set_remove_covered(roa_set_t *set)
+{
+  roa_record_t *stack[ROA_SET_MAX_DEPTH];
+  int depth = 0;
+  size_t out = 0;
+
+  for (size_t i = 0; i < set->count; i++) {
+    roa_record_t rec = set->records[i];
+
+    /* Pop all records which do not cover the current one
+       Note: Records of another ASN never cover the current record */
+    while (depth > 0 && (stack[depth - 1]->asn != rec.asn ||
+                         !roa_set_covers(stack[depth - 1], &rec))) {
+      depth--;
+    }
+
+    /* Every record on the stack has a larger max length than its parent, so
+       checking the top of the stack is sufficient */
+    if (depth > 0 && stack[depth - 1]->max_len >= rec.max_len) {
+      continue;
+    }
+    set->records[out] = rec;
+    stack[depth++] = &set->records[out++];
+  }
+
+  size_t removed = set->count - out;
+  set->count = out;
+  return removed;
+}
+
+/* Raise the max length of a record to the smaller max length of both of its
+   direct sub-prefixes (same ASN), return the number of raised records */
+static size_t roa_set_merge_siblings(roa_set_t *set)
+{
+  size_t merged = 0;
+  for (size_t i = 0; i < set->count; i++) {
+    roa_record_t *parent = &set->records[i];
+    uint8_t bits = parent->family == ROA_IPV4 ? 32 : 128;
+
+    /* A merge is only exact if the parent prefix itself is valid */
+    if (parent->min_len >= bits || parent->max_len < parent->min_len) {
+      continue;
+    }
+
+    /* Look up both sub-prefixes */
+    roa_record_t child = *parent;
+    child.min_len = parent->min_len + 1;
+    roa_record_t *lower = bsearch(&child, set->records, set->count,
+                                  sizeof(roa_record_t), roa_set_cmp_prefix);
+    child.addr[parent->min_len / 32] |= 1U << (31 - parent->min_len % 32);
+    roa_record_t *upper = bsearch(&child, set->records, set->count,
+                                  sizeof(roa_record_t), roa_set_cmp_prefix);
+    if (lower == NULL || upper == NULL) {
+      continue;
+    }
+
+    /* Both sub-prefixes are valid for the ASN up to the smaller max length */
+    uint8_t max_len = lower->max_len < upper->max_len ? lower->max_len
+                                                      : upper->max_len;
+    if (max_len > parent->max_len) {
+      parent->max_len = max_len;
+      merged++;
+    }
+  }
+  return merged;
+}
+
+/* Canonicalise all prefixes (clear host bits) */
+static void roa_set_canonicalise(roa_set_t *set)
+{
+  for (size_t i = 0; i < set->count; i++) {
+    roa_record_t *rec = &set->records[i];
+    for (int w = 0; w < 4; w++) {
+      rec->addr[w] &= roa_record_word_mask(rec->min_len, w);
+    }
+  }
+}
+
+size_t roa_set_minimize(roa_set_t *set)
+{
+  size_t count = set->count;
+  roa_set_canonicalise(set);
+
+  /* Remove covered records and merge siblings until nothing changes */
+  roa_set_sort(set);
+  roa_set_remove_covered(set);
+  while (roa_set_merge_siblings(set) > 0) {
+    roa_set_remove_covered(set);
+  }
+
+  return count - set->count;
+}
+
+size_t roa_set_unique(roa_set_t *set)
+{
+  size_t count = set->count, out = 0;
+  roa_set_canonicalise(set);
+  roa_set_sort(set);
+  for (size_t i = 0; i < set->count; i++) {
+    if (out > 0 && !roa_set_cmp(&set->records[out - 1], &set->records[i])) {
+      continue;
+    }
+    set->records[out++] = set->records[i];
+  }
+  set->count = out;
+  return count - out;
+}
+
+int roa_set_diff(const roa_set_t *from, const roa_set_t *to, roa_set_t *added,
+                 roa_set_t *removed)
+{
+  /* Merge both sorted sets, records of only one set changed */
+  size_t i = 0, j = 0;
+  while (i < from->count || j < to->count) {
+    int cmp;
+    if (i == from->count) {
+      cmp = 1;
+    } else if (j == to->count) {
+      cmp = -1;
+    } else {
+      cmp = roa_set_cmp(&from->records[i], &to->records[j]);
+    }
+    if (cmp < 0 && roa_set_add(removed, &from->records[i]) != 0) {
+      return -1;
+    }
+    if (cmp > 0 && roa_set_add(added, &to->records[j]) != 0) {
+      return -1;
+    }
+    i += (cmp <= 0);
+    j += (cmp >= 0);
+  }
+  return 0;
+}
+
+/* Restore the heap order of a merge below a position (the heap holds the
+   indexes of the ROA sets ordered by their next record) */
+static void roa_set_merge_sift(const roa_set_t *sets, const size_t *next,
+                               int *heap, int len, int pos)
+{
+  for (;;) {
+    int min = pos, l = 2 * pos + 1, r = 2 * pos + 2;
+    if (l < len && roa_set_cmp(&sets[heap[l]].records[next[heap[l]]],
+                               &sets[heap[min]].records[next[heap[min]]]) < 0) {
+      min = l;
+    }
+    if (r < len && roa_set_cmp(&sets[heap[r]].records[next[heap[r]]],
+                               &sets[heap[min]].records[next[heap[min]]]) < 0) {
+      min = r;
+    }
+    if (min == pos) {
+      return;
+    }
+    int tmp = heap[pos];
+    heap[pos] = heap[min];
+    heap[min] = tmp;
+    pos = min;
+  }
+}
+
+/* The ROA sets of a merge are reported as bits of a 32 bit mask */
+_Static_assert(MAX_RPKI_COUNT <= 32,
+               "MAX_RPKI_COUNT exceeds the bits of the merge mask");
+
+int roa_set_merge(const roa_set_t *sets, int count, roa_set_merge_fp merge_fp,
+                  void *data)
+{
+  /* Build a heap of all non-empty sets */
+  int heap[MAX_RPKI_COUNT], len = 0;
+  size_t next[MAX_RPKI_COUNT] = {0};
+  if (count > MAX_RPKI_COUNT) {
+    return -1;
+  }
+  for (int i = 0; i < count; i++) {
+    if (sets[i].count) {
+      heap[len++] = i;
+    }
+  }
+  for (int i = len / 2 - 1; i >= 0; i--) {
+    roa_set_merge_sift(sets, next, heap, len, i);
+  }
+
+  /* Pop the smallest record from all sets containing it */
+  while (len > 0) {
+    const roa_record_t *record = &sets[heap[0]].records[next[heap[0]]];
+    roa_record_t rec = *record;
+    uint32_t mask = 0;
+    while (len > 0 &&
+           !roa_set_cmp(&sets[heap[0]].records[next[heap[0]]], &rec)) {
+      int set = heap[0];
+      mask |= (uint32_t)1 << set;
+      if (++next[set] == sets[set].count) {
+        heap[0] = heap[--len];
+      }
+      roa_set_merge_sift(sets, next, heap, len, 0);
+    }
+    if (merge_fp(&rec, mask, data) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void roa_record_from_addr(uint32_t asn, const struct lrtr_ip_addr *prefix,
+                          uint8_t min_len, uint8_t max_len,
+                          roa_record_t *record)
+{
+  memset(record, 0, sizeof(roa_record_t));
+  if (prefix->ver == LRTR_IPV4) {
+    record->family = ROA_IPV4;
+    record->addr[0] = prefix->u.addr4.addr;
+  } else {
+    record->family = ROA_IPV6;
+    memcpy(record->addr, prefix->u.addr6.addr, sizeof(record->addr));
+  }
+  record->asn = asn;
+  record->min_len = min_len;
+  record->max_len = max_len;
+}
+
+void roa_record_to_pfx_record(const roa_record_t *record,
+                              struct pfx_record *pfx)
+{
+  memset(pfx, 0, sizeof(struct pfx_record));
+  if (record->family == ROA_IPV4) {
+    pfx->prefix.ver = LRTR_IPV4;
+    pfx->prefix.u.addr4.addr = record->addr[0];
+  } else {
+    pfx->prefix.ver = LRTR_IPV6;
+    memcpy(pfx->prefix.u.addr6.addr, record->addr, sizeof(record->addr));
+  }
+  pfx->asn = record->asn;
+  pfx->min_len = record->min_len;
+  pfx->max_len = record->max_len;
+  pfx->socket = NULL;
+}
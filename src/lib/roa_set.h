@@ -0,0 +1,243 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __ROA_SET_H
+#define __ROA_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "constants.h"
+#include "rtrlib/rtrlib.h"
+
+/** Address families of a ROA record */
+typedef enum {
+
+  /** IPv4 */
+  ROA_IPV4 = 0,
+
+  /** IPv6 */
+  ROA_IPV6 = 1,
+
+} roa_family_t;
+
+/** A single ROA record (validated ROA payload) */
+typedef struct struct_roa_record_t {
+
+  /** Prefix address
+   *
+   * Address words in host byte order (IPv4 only uses the first word)
+   */
+  uint32_t addr[4];
+
+  /** ASN
+   *
+   * Origin ASN of the ROA record
+   */
+  uint32_t asn;
+
+  /** Address family
+   *
+   * Address family of the prefix (roa_family_t)
+   */
+  uint8_t family;
+
+  /** Min length
+   *
+   * Length of the prefix of the ROA record
+   */
+  uint8_t min_len;
+
+  /** Max length
+   *
+   * Max length of the ROA record
+   */
+  uint8_t max_len;
+
+} roa_record_t;
+
+/** A set of ROA records (e.g. all records of a ROA dump) */
+typedef struct struct_roa_set_t {
+
+  /** ROA records
+   *
+   * All records of the set
+   */
+  roa_record_t *records;
+
+  /** Record count
+   *
+   * Number of records in the set
+   */
+  size_t count;
+
+  /** Record size
+   *
+   * Number of allocated records
+   */
+  size_t size;
+
+  /** Arena
+   *
+   * Arena the records are allocated from (NULL for the heap)
+   */
+  arena_t *arena;
+
+} roa_set_t;
+
+/** Initialize an empty ROA set
+ *
+ * @param[out] set           Pointer to the ROA set
+ * @return                   0 if the set was initialized, otherwise -1
+ */
+int roa_set_init(roa_set_t *set);
+
+/** Initialize an empty ROA set whose records are allocated from an arena
+ *
+ * @param[out] set           Pointer to the ROA set
+ * @param[in]  arena         Arena of the records (NULL for the heap)
+ * @return                   0 if the set was initialized, otherwise -1
+ */
+int roa_set_init_arena(roa_set_t *set, arena_t *arena);
+
+/** Free all records of a ROA set (records of an arena are released with it)
+ *
+ * @param[in] set            Pointer to the ROA set
+ */
+void roa_set_free(roa_set_t *set);
+
+/** Add a ROA record to a ROA set
+ *
+ * @param[in] set            Pointer to the ROA set
+ * @param[in] record         ROA record which will be added (copied)
+ * @return                   0 if the record was added, otherwise -1
+ */
+int roa_set_add(roa_set_t *set, const roa_record_t *record);
+
+/** Copy all records of a ROA set into a new ROA set (on the heap)
+ *
+ * @param[in]  from          Pointer to the ROA set
+ * @param[out] to            Pointer to the new ROA set
+ * @return                   0 if the set was copied, otherwise -1
+ */
+int roa_set_copy(const roa_set_t *from, roa_set_t *to);
+
+/** Sort a ROA set by ASN, address family, prefix and length
+ *
+ * @param[in] set            Pointer to the ROA set
+ */
+void roa_set_sort(roa_set_t *set);
+
+/** Minimize a ROA set without changing the validation outcome
+ *
+ * Removes duplicates and records covered by a record of the same ASN with an
+ * equal or larger max length, and raises the max length of a record if both
+ * of its direct sub-prefixes are present for the same ASN. The validation
+ * state of every (prefix, origin) pair stays the same, only the reasons
+ * reflect the minimized records. All prefixes are canonicalised (host bits
+ * cleared) and the set is sorted afterwards.
+ *
+ * @param[in] set            Pointer to the ROA set
+ * @return                   Number of removed records
+ */
+size_t roa_set_minimize(roa_set_t *set);
+
+/** Bring a ROA set into its canonical form: all prefixes are canonicalised
+ *  (host bits cleared), the set is sorted and duplicates are removed
+ *
+ * @param[in] set            Pointer to the ROA set
+ * @return                   Number of removed duplicates
+ */
+size_t roa_set_unique(roa_set_t *set);
+
+/** Function called for every distinct record of a merge of ROA sets
+ *
+ * @param[in] record         ROA record
+ * @param[in] sets           Bit mask of the ROA sets containing the record
+ * @param[in] data           User data passed to the merge
+ * @return                   0 to continue the merge, otherwise -1
+ */
+typedef int (*roa_set_merge_fp)(const roa_record_t *record, uint32_t sets,
+                                void *data);
+
+/** Merge several canonical ROA sets in one sorted pass (k-way merge), every
+ *  distinct record is reported once in sorted order
+ *
+ * @param[in] sets           Canonical ROA sets
+ * @param[in] count          Number of ROA sets (at most MAX_RPKI_COUNT)
+ * @param[in] merge_fp       Function called for every distinct record
+ * @param[in] data           User data passed to the merge function
+ * @return                   0 if all records were merged, otherwise -1
+ */
+int roa_set_merge(const roa_set_t *sets, int count, roa_set_merge_fp merge_fp,
+                  void *data);
+
+/** Compute the difference between two canonical ROA sets (sorted merge)
+ *
+ * @param[in]  from          Previous ROA set (canonical)
+ * @param[in]  to            Next ROA set (canonical)
+ * @param[out] added         Records only contained in the next set
+ * @param[out] removed       Records only contained in the previous set
+ * @return                   0 if the difference was computed, otherwise -1
+ */
+int roa_set_diff(const roa_set_t *from, const roa_set_t *to, roa_set_t *added,
+                 roa_set_t *removed);
+
+/** Get the netmask of a single address word for a prefix length
+ *
+ * @param[in] len            Prefix length
+ * @param[in] word           Index of the address word (0-3)
+ * @return                   Netmask of the address word
+ */
+uint32_t roa_record_word_mask(uint8_t len, int word);
+
+/** Convert a RTRlib address and lengths into a ROA record
+ *
+ * @param[in]  asn           ASN value of the ROA record
+ * @param[in]  prefix        Address of the prefix of the ROA record
+ * @param[in]  min_len       Min length of the prefix of the ROA record
+ * @param[in]  max_len       Max length of the prefix of the ROA record
+ * @param[out] record        ROA record
+ */
+void roa_record_from_addr(uint32_t asn, const struct lrtr_ip_addr *prefix,
+                          uint8_t min_len, uint8_t max_len,
+                          roa_record_t *record);
+
+/** Convert a ROA record into a RTRlib prefix record
+ *
+ * @param[in]  record        ROA record
+ * @param[out] pfx           RTRlib prefix record
+ */
+void roa_record_to_pfx_record(const roa_record_t *record,
+                              struct pfx_record *pfx);
+
+/** @} */
+
+#endif /* __ROA_SET_H */
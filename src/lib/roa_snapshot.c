@@ -0,0 +1,365 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "roa_snapshot.h"
+#include "debug.h"
+#include "wandio.h"
+
+/** Alignment of all sections */
+#define ROA_SNAPSHOT_ALIGN 8
+
+static size_t roa_snapshot_round(size_t size)
+{
+  return (size + ROA_SNAPSHOT_ALIGN - 1) & ~(size_t)(ROA_SNAPSHOT_ALIGN - 1);
+}
+
+/* Order of the records within a family section */
+static int roa_snapshot_cmp(const void *a, const void *b)
+{
+  const roa_record_t *x = a, *y = b;
+  if (x->family != y->family) {
+    return x->family < y->family ? -1 : 1;
+  }
+  for (int i = 0; i < 4; i++) {
+    if (x->addr[i] != y->addr[i]) {
+      return x->addr[i] < y->addr[i] ? -1 : 1;
+    }
+  }
+  if (x->min_len != y->min_len) {
+    return x->min_len < y->min_len ? -1 : 1;
+  }
+  if (x->max_len != y->max_len) {
+    return x->max_len < y->max_len ? -1 : 1;
+  }
+  if (x->asn != y->asn) {
+    return x->asn < y->asn ? -1 : 1;
+  }
+  return 0;
+}
+
+int roa_snapshot_detect(const void *buf, size_t len)
+{
+  return len >= ROA_SNAPSHOT_MAGIC_LEN &&
+         !memcmp(buf, ROA_SNAPSHOT_MAGIC, ROA_SNAPSHOT_MAGIC_LEN);
+}
+
+int roa_snapshot_write(const char *path, roa_set_t *set, uint64_t hash,
+                       int index)
+{
+  /* Deduplicate the records and sort them by family and prefix */
+  roa_set_unique(set);
+  qsort(set->records, set->count, sizeof(roa_record_t), roa_snapshot_cmp);
+  size_t count[2] = {0, 0};
+  for (size_t i = 0; i < set->count; i++) {
+    count[set->records[i].family == ROA_IPV6]++;
+  }
+
+  /* Lay out all sections behind the header */
+  roa_snapshot_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, ROA_SNAPSHOT_MAGIC, ROA_SNAPSHOT_MAGIC_LEN);
+  header.version = ROA_SNAPSHOT_VERSION;
+  header.byte_order = ROA_SNAPSHOT_BYTE_ORDER;
+  header.hash = hash;
+  header.count[ROA_IPV4] = count[ROA_IPV4];
+  header.count[ROA_IPV6] = count[ROA_IPV6];
+  size_t size = roa_snapshot_round(sizeof(header));
+  header.offset[ROA_IPV4] = size;
+  size += roa_snapshot_round(count[ROA_IPV4] * sizeof(roa_snapshot_ipv4_t));
+  header.offset[ROA_IPV6] = size;
+  size += roa_snapshot_round(count[ROA_IPV6] * sizeof(roa_snapshot_ipv6_t));
+  if (index) {
+    header.index = size;
+    size += roa_snapshot_round(2 * ROA_SNAPSHOT_INDEX_LEN * sizeof(uint32_t));
+  }
+  header.size = size;
+
+  uint8_t *buf = calloc(1, size);
+  if (buf == NULL) {
+    std_print("%s", "Error: Could not allocate memory for the snapshot\n");
+    return -1;
+  }
+  roa_snapshot_ipv4_t *ipv4 = (void *)(buf + header.offset[ROA_IPV4]);
+  roa_snapshot_ipv6_t *ipv6 = (void *)(buf + header.offset[ROA_IPV6]);
+  uint32_t *idx = index ? (void *)(buf + header.index) : NULL;
+  size_t n[2] = {0, 0};
+  for (size_t i = 0; i < set->count; i++) {
+    const roa_record_t *rec = &set->records[i];
+    uint8_t byte = rec->addr[0] >> 24;
+    if (rec->family == ROA_IPV4) {
+      ipv4[n[ROA_IPV4]].asn = rec->asn;
+      ipv4[n[ROA_IPV4]].addr = rec->addr[0];
+      ipv4[n[ROA_IPV4]].min_len = rec->min_len;
+      ipv4[n[ROA_IPV4]].max_len = rec->max_len;
+    } else {
+      ipv6[n[ROA_IPV6]].asn = rec->asn;
+      memcpy(ipv6[n[ROA_IPV6]].addr, rec->addr, sizeof(rec->addr));
+      ipv6[n[ROA_IPV6]].min_len = rec->min_len;
+      ipv6[n[ROA_IPV6]].max_len = rec->max_len;
+    }
+
+    if (idx != NULL) {
+      idx[rec->family * ROA_SNAPSHOT_INDEX_LEN + byte + 1]++;
+    }
+    n[rec->family == ROA_IPV6]++;
+  }
+
+  /* Every index entry is the first record of its top address byte */
+  for (int b = 1; idx != NULL && b < 2 * ROA_SNAPSHOT_INDEX_LEN; b++) {
+    if (b != ROA_SNAPSHOT_INDEX_LEN) {
+      idx[b] += idx[b - 1];
+    }
+  }
+
+  size_t head = roa_snapshot_round(sizeof(header));
+  header.checksum = roa_parser_hash_buf(buf + head, size - head);
+  memcpy(buf, &header, sizeof(header));
+
+  int ret = 0;
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    std_print("Error: Could not open %s for writing\n", path);
+    ret = -1;
+  } else if (fwrite(buf, 1, size, file) != size) {
+    std_print("Error: Could not write the snapshot %s\n", path);
+    ret = -1;
+  }
+  if (file != NULL && fclose(file) != 0 && !ret) {
+    std_print("Error: Could not write the snapshot %s\n", path);
+    ret = -1;
+  }
+  free(buf);
+  return ret;
+}
+
+int roa_snapshot_init(roa_snapshot_t *snap, const void *buf, size_t len)
+{
+  memset(snap, 0, sizeof(roa_snapshot_t));
+  const roa_snapshot_header_t *header = buf;
+  if (!roa_snapshot_detect(buf, len) || len < sizeof(*header) ||
+      header->version != ROA_SNAPSHOT_VERSION ||
+      header->byte_order != ROA_SNAPSHOT_BYTE_ORDER || header->size > len) {
+    std_print("%s", "Error: Invalid or incompatible ROA snapshot\n");
+    return -1;
+  }
+
+  /* Check the bounds of all sections (the sizes are checked for overflows) */
+  size_t size = header->size, head = roa_snapshot_round(sizeof(*header));
+  size_t rec_size[2] = {sizeof(roa_snapshot_ipv4_t),
+                        sizeof(roa_snapshot_ipv6_t)};
+  for (int f = ROA_IPV4; f <= ROA_IPV6; f++) {
+    uint64_t off = header->offset[f], count = header->count[f];
+    if (off < head || off > size || off % ROA_SNAPSHOT_ALIGN ||
+        count > (size - off) / rec_size[f]) {
+      std_print("%s", "Error: Corrupt sections in the ROA snapshot\n");
+      return -1;
+    }
+  }
+  size_t idx_size = 2 * ROA_SNAPSHOT_INDEX_LEN * sizeof(uint32_t);
+  if (header->index && (header->index < head || header->index > size ||
+                        header->index % ROA_SNAPSHOT_ALIGN ||
+                        size - header->index < idx_size)) {
+    std_print("%s", "Error: Corrupt index in the ROA snapshot\n");
+    return -1;
+  }
+  if (roa_parser_hash_buf((const uint8_t *)buf + head, size - head) !=
+      header->checksum) {
+    std_print("%s", "Error: Checksum mismatch in the ROA snapshot\n");
+    return -1;
+  }
+
+  snap->header = header;
+  snap->ipv4 = (const void *)((const uint8_t *)buf + header->offset[ROA_IPV4]);
+  snap->ipv6 = (const void *)((const uint8_t *)buf + header->offset[ROA_IPV6]);
+  if (header->index) {
+    snap->index = (const void *)((const uint8_t *)buf + header->index);
+    for (int f = ROA_IPV4; f <= ROA_IPV6; f++) {
+      const uint32_t *idx = &snap->index[f * ROA_SNAPSHOT_INDEX_LEN];
+      int sorted = (idx[0] == 0);
+      for (int b = 1; b < ROA_SNAPSHOT_INDEX_LEN; b++) {
+        sorted &= (idx[b - 1] <= idx[b]);
+      }
+      if (!sorted || idx[ROA_SNAPSHOT_INDEX_LEN - 1] != header->count[f]) {
+        std_print("%s", "Error: Corrupt index in the ROA snapshot\n");
+        memset(snap, 0, sizeof(roa_snapshot_t));
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/* Read a snapshot from an opened file into memory */
+static int roa_snapshot_read_io(roa_snapshot_t *snap, io_t *file_io,
+                                const char *path)
+{
+  size_t size = 0, cap = 0;
+  uint8_t *buf = NULL;
+  int64_t ret = 0;
+  while (1) {
+    if (size == cap) {
+      cap = cap ? 2 * cap : ROA_PARSER_CHUNK_SIZE;
+      uint8_t *tmp = realloc(buf, cap);
+      if (tmp == NULL) {
+        ret = -1;
+        break;
+      }
+      buf = tmp;
+    }
+    if ((ret = wandio_read(file_io, buf + size, cap - size)) <= 0) {
+      break;
+    }
+    size += ret;
+  }
+  if (ret < 0) {
+    std_print("Error: Could not read the snapshot %s\n", path);
+    free(buf);
+    return -1;
+  }
+  if (roa_snapshot_init(snap, buf, size) != 0) {
+    free(buf);
+    return -1;
+  }
+  snap->buf = buf;
+  snap->size = size;
+  return 0;
+}
+
+/* Read a snapshot which can not be mapped (URLs or compressed files) */
+static int roa_snapshot_load(roa_snapshot_t *snap, const char *path)
+{
+  io_t *file_io = wandio_create(path);
+  if (file_io == NULL) {
+    std_print("Error: Could not open %s for reading\n", path);
+    return -1;
+  }
+  int ret = roa_snapshot_read_io(snap, file_io, path);
+  wandio_destroy(file_io);
+  return ret;
+}
+
+int roa_snapshot_open_io(roa_snapshot_t *snap, io_t *file_io, const char *path)
+{
+  memset(snap, 0, sizeof(roa_snapshot_t));
+  return roa_snapshot_read_io(snap, file_io, path);
+}
+
+int roa_snapshot_open(roa_snapshot_t *snap, const char *path)
+{
+  memset(snap, 0, sizeof(roa_snapshot_t));
+  if (strstr(path, "://") != NULL) {
+    return roa_snapshot_load(snap, path);
+  }
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    std_print("Error: Could not open %s for reading\n", path);
+    return -1;
+  }
+  struct stat st;
+  void *map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) {
+    return roa_snapshot_load(snap, path);
+  }
+
+  /* Compressed snapshots do not start with the magic number */
+  if (!roa_snapshot_detect(map, st.st_size)) {
+    munmap(map, st.st_size);
+    return roa_snapshot_load(snap, path);
+  }
+  if (roa_snapshot_init(snap, map, st.st_size) != 0) {
+    munmap(map, st.st_size);
+    return -1;
+  }
+  snap->map = map;
+  snap->size = st.st_size;
+  return 0;
+}
+
+void roa_snapshot_close(roa_snapshot_t *snap)
+{
+  if (snap->map != NULL) {
+    munmap(snap->map, snap->size);
+  }
+  free(snap->buf);
+  memset(snap, 0, sizeof(roa_snapshot_t));
+}
+
+int roa_snapshot_read(const roa_snapshot_t *snap,
+                      roa_parser_record_fp record_fp, void *data)
+{
+  roa_record_t rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.family = ROA_IPV4;
+  for (size_t i = 0; i < snap->header->count[ROA_IPV4]; i++) {
+    rec.asn = snap->ipv4[i].asn;
+    rec.addr[0] = snap->ipv4[i].addr;
+    rec.min_len = snap->ipv4[i].min_len;
+    rec.max_len = snap->ipv4[i].max_len;
+    if (record_fp(&rec, data) != 0) {
+      return -1;
+    }
+  }
+  rec.family = ROA_IPV6;
+  for (size_t i = 0; i < snap->header->count[ROA_IPV6]; i++) {
+    rec.asn = snap->ipv6[i].asn;
+    memcpy(rec.addr, snap->ipv6[i].addr, sizeof(rec.addr));
+    rec.min_len = snap->ipv6[i].min_len;
+    rec.max_len = snap->ipv6[i].max_len;
+    if (record_fp(&rec, data) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int roa_snapshot_range(const roa_snapshot_t *snap, uint8_t family,
+                       uint8_t byte, size_t *first, size_t *count)
+{
+  if (snap->index == NULL || family > ROA_IPV6) {
+    return -1;
+  }
+  const uint32_t *idx = &snap->index[family * ROA_SNAPSHOT_INDEX_LEN];
+  *first = idx[byte];
+  *count = idx[byte + 1] - idx[byte];
+  return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __ROA_SNAPSHOT_H
+#define __ROA_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "roa_parser.h"
+#include "roa_set.h"
+#include "wandio.h"
+
+/** Magic number at the beginning of a ROA snapshot */
+#define ROA_SNAPSHOT_MAGIC "ROASNP\r\n"
+
+/** Length of the magic number */
+#define ROA_SNAPSHOT_MAGIC_LEN 8
+
+/** Version of the ROA snapshot format */
+#define ROA_SNAPSHOT_VERSION 1
+
+/** Byte order mark (snapshots are stored in host byte order) */
+#define ROA_SNAPSHOT_BYTE_ORDER 0x01020304
+
+/** Number of index entries per address family (top address byte + 1) */
+#define ROA_SNAPSHOT_INDEX_LEN 257
+
+/** Header of a ROA snapshot
+ *
+ * A snapshot consists of the header, the IPv4 records, the IPv6 records and
+ * an optional index, every section is aligned to 8 bytes. The records of a
+ * family are sorted by prefix, length, max length and ASN (duplicates are
+ * removed), the index contains the first record of every top address byte.
+ */
+typedef struct struct_roa_snapshot_header_t {
+
+  /** Magic number (ROA_SNAPSHOT_MAGIC) */
+  char magic[ROA_SNAPSHOT_MAGIC_LEN];
+
+  /** Format version (ROA_SNAPSHOT_VERSION) */
+  uint32_t version;
+
+  /** Byte order mark (ROA_SNAPSHOT_BYTE_ORDER) */
+  uint32_t byte_order;
+
+  /** Content hash of the ROA dump the snapshot was converted from */
+  uint64_t hash;
+
+  /** Checksum of all sections behind the header */
+  uint64_t checksum;
+
+  /** Size of the snapshot in bytes (including the header) */
+  uint64_t size;
+
+  /** Number of records per address family */
+  uint64_t count[2];
+
+  /** Offset of the records per address family */
+  uint64_t offset[2];
+
+  /** Offset of the index (0 = no index) */
+  uint64_t index;
+
+} roa_snapshot_header_t;
+
+/** An IPv4 record of a ROA snapshot */
+typedef struct struct_roa_snapshot_ipv4_t {
+
+  /** Origin ASN */
+  uint32_t asn;
+
+  /** Prefix address */
+  uint32_t addr;
+
+  /** Prefix length and max length */
+  uint8_t min_len, max_len;
+
+  /** Padding (0) */
+  uint16_t pad;
+
+} roa_snapshot_ipv4_t;
+
+/** An IPv6 record of a ROA snapshot */
+typedef struct struct_roa_snapshot_ipv6_t {
+
+  /** Origin ASN */
+  uint32_t asn;
+
+  /** Prefix address words */
+  uint32_t addr[4];
+
+  /** Prefix length and max length */
+  uint8_t min_len, max_len;
+
+  /** Padding (0) */
+  uint16_t pad;
+
+} roa_snapshot_ipv6_t;
+
+/** A loaded ROA snapshot (mapped or read into memory) */
+typedef struct struct_roa_snapshot_t {
+
+  /** Header
+   *
+   * Header of the snapshot (beginning of the snapshot)
+   */
+  const roa_snapshot_header_t *header;
+
+  /** IPv4 records
+   *
+   * Records of the IPv4 section
+   */
+  const roa_snapshot_ipv4_t *ipv4;
+
+  /** IPv6 records
+   *
+   * Records of the IPv6 section
+   */
+  const roa_snapshot_ipv6_t *ipv6;
+
+  /** Index
+   *
+   * First record of every top address byte per family (NULL = no index)
+   */
+  const uint32_t *index;
+
+  /** Mapping
+   *
+   * Memory mapping of the snapshot (NULL if it was read into memory)
+   */
+  void *map;
+
+  /** Buffer
+   *
+   * Memory the snapshot was read into (NULL if it is mapped)
+   */
+  void *buf;
+
+  /** Size
+   *
+   * Size of the mapping or the buffer in bytes
+   */
+  size_t size;
+
+} roa_snapshot_t;
+
+/** Whether a buffer starts with the magic number of a ROA snapshot
+ *
+ * @param[in] buf            Beginning of a ROA dump or snapshot
+ * @param[in] len            Length of the buffer
+ * @return                   1 for a snapshot, otherwise 0
+ */
+int roa_snapshot_detect(const void *buf, size_t len);
+
+/** Write a ROA set as ROA snapshot
+ *
+ * @param[in] path           Path of the snapshot (local file)
+ * @param[in] set            ROA set (it is sorted and deduplicated)
+ * @param[in] hash           Content hash of the converted ROA dump
+ * @param[in] index          Write the index section (0 = no, 1 = yes)
+ * @return                   0 if the snapshot was written, otherwise -1
+ */
+int roa_snapshot_write(const char *path, roa_set_t *set, uint64_t hash,
+                       int index);
+
+/** Load a ROA snapshot which is already in memory (the snapshot does not take
+ *  the ownership of the buffer)
+ *
+ * @param[out] snap          Pointer to the snapshot
+ * @param[in]  buf           Content of the snapshot (aligned to 8 bytes)
+ * @param[in]  len           Length of the snapshot
+ * @return                   0 if the snapshot is valid, otherwise -1
+ */
+int roa_snapshot_init(roa_snapshot_t *snap, const void *buf, size_t len);
+
+/** Load a ROA snapshot, local files are mapped, URLs and compressed files are
+ *  read into memory
+ *
+ * @param[out] snap          Pointer to the snapshot
+ * @param[in]  path          Path to the snapshot (local file or URL)
+ * @return                   0 if the snapshot is valid, otherwise -1
+ */
+int roa_snapshot_open(roa_snapshot_t *snap, const char *path);
+
+/** Load a ROA snapshot from an already opened file (e.g. a URL whose magic
+ *  number was peeked), the file is read into memory and not closed
+ *
+ * @param[out] snap          Pointer to the snapshot
+ * @param[in]  file_io       Opened file, read from its current position
+ * @param[in]  path          Path to the snapshot (for error messages)
+ * @return                   0 if the snapshot is valid, otherwise -1
+ */
+int roa_snapshot_open_io(roa_snapshot_t *snap, io_t *file_io,
+                         const char *path);
+
+/** Release a ROA snapshot
+ *
+ * @param[in] snap           Pointer to the snapshot
+ */
+void roa_snapshot_close(roa_snapshot_t *snap);
+
+/** Pass all records of a ROA snapshot to a record function
+ *
+ * @param[in] snap           Pointer to the snapshot
+ * @param[in] record_fp      Function called for every ROA record
+ * @param[in] data           User data passed to the record function
+ * @return                   0 if all records were passed, otherwise -1
+ */
+int roa_snapshot_read(const roa_snapshot_t *snap,
+                      roa_parser_record_fp record_fp, void *data);
+
+/** Get the records of a family whose prefix starts with a top address byte
+ *  (requires the index section)
+ *
+ * @param[in]  snap          Pointer to the snapshot
+ * @param[in]  family        Address family (roa_family_t)
+ * @param[in]  byte          Top address byte
+ * @param[out] first         First record of the family section
+ * @param[out] count         Number of records
+ * @return                   0 if the snapshot has an index, otherwise -1
+ */
+int roa_snapshot_range(const roa_snapshot_t *snap, uint8_t family,
+                       uint8_t byte, size_t *first, size_t *count);
+
+/** @} */
+
+#endif /* __ROA_SNAPSHOT_H */
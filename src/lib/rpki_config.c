@@ -29,6 +29,7 @@
 
 #include <arpa/inet.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,6 +39,10 @@
 #include "utils.h"
 #include "constants.h"
 #include "debug.h"
+#include "registry.h"
+#include "roa_parser.h"
+#include "roa_snapshot.h"
+#include "roa_set.h"
 #include "validation.h"
 #include "rpki_config.h"
 #include "wandio.h"
@@ -57,23 +62,18 @@ rpki_cfg_t *cfg_create(char *projects_collectors, char *time_intervals,
   /* Set the Broker request URL for the default and info service */
   utils_cfg_set_broker_urls(cfg, broker_url);
 
-  /* Allocate memory for the ROA URLs */
-  config_broker_t *broker = &cfg->cfg_broker;
-  broker->roa_urls_count = BROKER_ROA_URLS_COUNT;
-  broker->roa_urls = malloc(BROKER_ROA_URLS_COUNT * sizeof(char *));
-  for (int i = 0; i < BROKER_ROA_URLS_COUNT; i++) {
-    broker->roa_urls[i] = malloc(BROKER_ROA_URLS_LEN);
-  }
-  broker->broker_khash_init = 0;
+  /* The broker index is allocated with the broker response */
+  broker_index_init(&cfg->cfg_broker.index);
 
-  /* Allocate memory for the Prefix Tables */
+  /* Allocate memory for the Prefix Tables (default backend) */
   config_validation_t *val = &cfg->cfg_val;
   val->pfxt = NULL;
-  val->pfxt = malloc(MAX_RPKI_COUNT * sizeof(struct pfx_table));
-  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
-    pfx_table_init(&val->pfxt[i], NULL);
+  val->epoch = val->next = NULL;
+  if (validation_set_backend(cfg, NULL, NULL) != 0) {
+    validation_free_epoch(val->epoch);
+    free(cfg);
+    return NULL;
   }
-  val->pfxt_count = 0;
 
   /* Set up the RTR manager config */
   val->rtr_mgr_cfg = NULL;
@@ -111,23 +111,45 @@ int cfg_destroy(rpki_cfg_t *cfg)
     return -1;
   }
 
-  /* Destroy the ROA URLs */
-  config_broker_t *broker = &cfg->cfg_broker;
-  for (int i = 0; i < broker->roa_urls_count; i++) {
-    free(broker->roa_urls[i]);
+  /* Wait for a running prefetch of the next epoch and the next window of
+     the broker index */
+  cfg_prefetch_cancel(cfg);
+  broker_window_cancel(cfg);
+
+  /* Report the result of the differential mode */
+  config_validation_t *val = &cfg->cfg_val;
+  if (val->pfxt != NULL && val->diff_backend != NULL) {
+    size_t lookups = 0, mismatches = 0;
+    for (int e = -1; e < val->recent_count; e++) {
+      backend_table_t *pfxt = e < 0 ? val->pfxt : val->recent[e]->pfxt;
+      for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+        lookups += pfxt[i].lookups;
+        mismatches += pfxt[i].mismatches;
+      }
+    }
+    std_print("Info: Backend %s vs. %s: %zu lookups, %zu mismatches\n",
+              val->backend->name, val->diff_backend->name, lookups,
+              mismatches);
+  }
+
+  /* Destroy the Prefix Tables of all epochs */
+  validation_free_epoch(val->epoch);
+  validation_free_epoch(val->next);
+  for (int i = 0; i < val->recent_count; i++) {
+    validation_free_epoch(val->recent[i]);
   }
-  free(broker->roa_urls);
 
-  /* Destroy the Prefix Tables */
+  /* Release the ROA sets of the change feed */
   for (int i = 0; i < MAX_RPKI_COUNT; i++) {
-    pfx_table_free(&cfg->cfg_val.pfxt[i]);
+    roa_set_free(&val->change_sets[i]);
   }
-  //pfx_table_free(cfg->cfg_val.pfxt);
-  free(cfg->cfg_val.pfxt);
 
-  /* Destroy the KHASH */
-  kh_destroy(broker_result, broker->broker_kh);
-  broker->broker_kh = NULL;
+  /* Release the temporal ROA index and its prefix tables */
+  validation_free_epoch(val->index_epoch);
+  roa_index_close(&val->index);
+
+  /* Destroy the broker index */
+  broker_index_free(&cfg->cfg_broker.index);
 
   /* Destroy the live connection to the RTR socket */
   if (!cfg->cfg_input.mode) {
@@ -139,22 +161,77 @@ int cfg_destroy(rpki_cfg_t *cfg)
   return 0;
 }
 
+/* First timestamp of the broker index (the start of the held windows) */
+static uint32_t cfg_index_start(rpki_cfg_t *cfg)
+{
+  uint32_t start = cfg->cfg_time.start;
+  if (cfg->cfg_broker.window_start > start) {
+    start = cfg->cfg_broker.window_start;
+  }
+  return start;
+}
+
+/* Position of the ROA timestamp of a timestamp, the latest entry at or before
+   the timestamp (minute granularity) which does not precede the broker index
+   (-1 if there is none) */
+static int cfg_index_floor(rpki_cfg_t *cfg, uint32_t timestamp)
+{
+  broker_index_t *index = &cfg->cfg_broker.index;
+  uint32_t roa_ts = timestamp - (timestamp % 60);
+  int pos = broker_index_floor(index, roa_ts);
+  if (pos < 0 || (index->entries[pos].timestamp != roa_ts &&
+                  index->entries[pos].timestamp < cfg_index_start(cfg))) {
+    return -1;
+  }
+  return pos;
+}
+
+/* Fetch the windows of the broker index until an entry follows the last used
+   one, the current entry is kept */
+static int cfg_next_window(rpki_cfg_t *cfg, uint32_t current_ts,
+                           uint32_t used_ts)
+{
+  config_broker_t *broker = &cfg->cfg_broker;
+  while (((int)broker->index.count - broker->index_used) <= 1) {
+    if (broker_window_next(cfg, current_ts) != 1) {
+      return -1;
+    }
+    broker->index_used = broker_index_lower(&broker->index, used_ts);
+  }
+  return 0;
+}
+
 int cfg_get_timestamps(rpki_cfg_t *cfg, uint32_t timestamp, char *dest)
 {
-  /* Get the current timestamp by downgrading the timestamp minute-wise */
-  khash_t(broker_result) *broker_kh = cfg->cfg_broker.broker_kh;
-  uint32_t current_ts = timestamp - (timestamp % 60);
-  while (kh_get(broker_result, broker_kh, current_ts) == kh_end(broker_kh)) {
-    current_ts -= 60;
+  /* The windows of the broker index up to the timestamp are fetched first */
+  if (broker_window_seek(cfg, timestamp) != 0) {
+    return -1;
+  }
+
+  /* Get the current timestamp of the broker index */
+  broker_index_t *index = &cfg->cfg_broker.index;
+  int pos = cfg_index_floor(cfg, timestamp);
+  if (pos < 0) {
+    return -1;
+  }
+  uint32_t current_ts = index->entries[pos].timestamp;
+  if (broker_index_urls(index, pos, dest, BROKER_ROA_URLS_LEN) != 0) {
+    return -1;
   }
-  strcpy(dest, kh_value(broker_kh, kh_get(broker_result,broker_kh,current_ts)));
   cfg->cfg_time.current_roa_timestamp = current_ts;
 
-  /* If there are more than one entry in the hash table */
-  if (kh_size(broker_kh) > 1) {
+  /* The entries of a windowed broker index preceding the current one were
+     not used but are skipped */
+  if (cfg->cfg_broker.window_start) {
+    cfg->cfg_broker.index_used = pos;
+  }
+
+  /* If there are more than one entry in the broker index (or more windows) */
+  if (index->count > 1 || cfg->cfg_broker.window.running) {
     cfg->cfg_time.next_roa_timestamp = cfg_next_timestamp(cfg, current_ts);
   } else {
     cfg->cfg_time.next_roa_timestamp = 0;
+    cfg->cfg_time.skipped_roa_timestamp = 0;
   }
 
   return 0;
@@ -162,180 +239,1158 @@ int cfg_get_timestamps(rpki_cfg_t *cfg, uint32_t timestamp, char *dest)
 
 uint32_t cfg_next_timestamp(rpki_cfg_t *cfg, uint32_t current_ts)
 {
-  uint32_t next_ts;
+  uint32_t next_ts = current_ts;
   config_broker_t *broker = &cfg->cfg_broker;
-  khash_t(broker_result) *broker_kh = cfg->cfg_broker.broker_kh;
+  config_input_t *input = &cfg->cfg_input;
+  broker_index_t *index = &broker->index;
+  cfg->cfg_time.skipped_roa_timestamp = 0;
 
-  /* If there are more than the current timestamp left, get the next one */
-  if ((broker->broker_khash_count - broker->broker_khash_used) > 1) {
-    next_ts = current_ts + ROA_ARCHIVE_INTERVAL;
-    while (kh_get(broker_result, broker_kh, next_ts) == kh_end(broker_kh)) {
-      next_ts += ROA_ARCHIVE_INTERVAL;
+  /* If there are more than the current timestamp left, get the next one (ROA
+     files skipped by the epoch stride or bucket are counted as used), the
+     next window of a windowed broker index is added once all were used */
+  for (uint32_t step = 1;
+       ((int)broker->index.count - broker->index_used) > 1 ||
+       !cfg_next_window(cfg, current_ts, next_ts); step++) {
+    size_t pos = broker_index_lower(index, next_ts + ROA_ARCHIVE_INTERVAL);
+    if (pos == index->count) {
+      break;
     }
+    next_ts = index->entries[pos].timestamp;
+    if ((input->epoch_stride < 2 || !(step % input->epoch_stride)) &&
+        (!input->epoch_bucket ||
+         next_ts / input->epoch_bucket != current_ts / input->epoch_bucket)) {
+      return next_ts;
+    }
+    cfg->cfg_time.skipped_roa_timestamp = next_ts;
+    broker->index_used++;
+  }
 
   /* If no timestamp is left, set the next timestamp to 0 */
-  } else {
-    next_ts = 0;
-  }
+  return 0;
+}
 
-  return next_ts;
+/* Forward declaration */
+static int cfg_import_dumps(rpki_cfg_t *cfg, char **roa_paths,
+                            backend_table_t **pfxts, uint64_t *hashes,
+                            int reuse, roa_set_t *changes, int count);
+
+/* Release the ROA sets of an import kept for the change feed */
+static void cfg_import_free(config_import_t *imp)
+{
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    roa_set_free(&imp->changes[i]);
+  }
+  imp->feed = 0;
 }
 
-int cfg_parse_urls(rpki_cfg_t *cfg, char *url)
+/* Import the ROA dumps of an epoch into shared prefix tables of the registry,
+   a registered table is used without an import. All tables are acquired and
+   the own ones are loaded and published before any other table is waited for
+   (importers of the same ROA dumps never wait for each other) */
+static int cfg_import_shared(rpki_cfg_t *cfg, char **roa_paths,
+                             backend_table_t **roa_tables, int count)
 {
+  config_input_t *input = &cfg->cfg_input;
+  const backend_ops_t *backend = cfg->cfg_val.backend;
+  registry_entry_t *entries[MAX_RPKI_COUNT];
+  char *load_paths[MAX_RPKI_COUNT];
+  backend_table_t *load_tables[MAX_RPKI_COUNT];
+  int load[MAX_RPKI_COUNT], loads = 0, ret = 0;
 
-  /* Clean all Prefix Tables and flags before parsing new URLs */
-  config_validation_t *val = &cfg->cfg_val;
-  memset(val->pfxt_active, 0, sizeof(val->pfxt_active));
-  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
-    pfx_table_src_remove(&val->pfxt[i], NULL);
+  /* A table is registered under the backend, the minimization and the URLs
+     of its ROA dumps (a unified table under all URLs of the epoch) */
+  int tables = (input->unified ? 1 : count);
+  size_t len = strlen(backend->name) + 16;
+  for (int i = 0; i < count; i++) {
+    len += strlen(roa_paths[i]) + 1;
+  }
+  char *key = malloc(len);
+  for (int t = 0; t < tables; t++) {
+    int first = input->unified ? 0 : t, last = input->unified ? count : t + 1;
+    int off = (key != NULL ? snprintf(key, len, "%s,%i", backend->name,
+                                      input->minimize) : 0);
+    for (int i = first; i < last && key != NULL; i++) {
+      off += snprintf(key + off, len - off, ",%s", roa_paths[i]);
+    }
+    if (key == NULL ||
+        (entries[t] = registry_acquire(key, backend, &load[t])) == NULL) {
+      ret = -1;
+      tables = t;
+      break;
+    }
+    for (int i = first; i < last && load[t]; i++) {
+      load_paths[loads] = roa_paths[i];
+      load_tables[loads++] = &entries[t]->table;
+    }
   }
-  val->pfxt_count = 0;
+  free(key);
 
-  /* Split the URL string in chunks and import the matching ROA file */
+  /* Load and publish the own tables, then wait for all other tables */
+  int loaded = (!ret && loads ? cfg_import_dumps(cfg, load_paths, load_tables,
+                                                 NULL, 0, NULL, loads)
+                              : ret);
+  for (int t = 0; t < tables; t++) {
+    if (load[t]) {
+      registry_publish(entries[t], loaded);
+    }
+  }
+  ret |= loaded;
+  for (int t = 0; t < tables; t++) {
+    if (!load[t] && registry_wait(entries[t]) != 0) {
+      ret = -1;
+    }
+  }
+
+  /* Every prefix table of the epoch takes over the reference of its entry */
+  int shared = 0;
+  for (int t = 0; t < tables; t++) {
+    if (ret != 0 || backend_shared_wrap(roa_tables[t], entries[t]) != 0) {
+      registry_release(entries[t]);
+      ret = -1;
+    }
+    shared += !load[t];
+  }
+  debug_print("Shared prefix tables: %i of %i loaded before (%zu registered)\n",
+              shared, tables, registry_count());
+  return ret;
+}
+
+/* Import all ROA dumps of an epoch into the prefix tables of the next epoch
+   (or a previous epoch), the current epoch is used until the next one is
+   published (in delta mode the epoch still holds a previous import, only the
+   difference is applied) */
+static int cfg_import_urls(rpki_cfg_t *cfg, config_import_t *imp)
+{
+  config_validation_t *val = &cfg->cfg_val;
   config_input_t *input = &cfg->cfg_input;
-  char *end_roa_arg; char *urls = strdup(url);
+  validation_epoch_t *epoch = imp->epoch;
+  int pfxt_count = 0, *pfxt_active = imp->pfxt_active;
+  memset(imp->pfxt_active, 0, sizeof(imp->pfxt_active));
+  memset(imp->hash, 0, sizeof(imp->hash));
+  memset(imp->reused, 0, sizeof(imp->reused));
+  if (!input->delta && validation_clear_epoch(cfg, epoch) != 0) {
+    return -1;
+  }
+
+  /* Split the URL string in chunks and collect the matching ROA files */
+  char *end_roa_arg; char *urls = strdup(imp->urls);
   char *roa_arg = strtok_r(urls, ",", &end_roa_arg);
-  while (roa_arg != NULL) {
+  char *roa_paths[MAX_RPKI_COUNT];
+  backend_table_t *roa_tables[MAX_RPKI_COUNT];
+  int roa_collectors[MAX_RPKI_COUNT];
+  uint64_t roa_hashes[MAX_RPKI_COUNT];
+  int roa_paths_count = 0, ret = 0;
+  while (roa_arg != NULL && !ret) {
 
     /* If the broker passed an URL (ROA dump) for the current collector import 
        the ROA dump and set the Prefix Table as active */
     if (strlen(roa_arg) > 1) {
-      if (!strstr(roa_arg, input->collectors[val->pfxt_count])) {
+      if (!strstr(roa_arg, input->collectors[pfxt_count])) {
         std_print("%s", "The order of the URLs is wrong\n");
-        std_print("%s %s\n", roa_arg, input->collectors[val->pfxt_count]);
-        return -1;
+        std_print("%s %s\n", roa_arg, input->collectors[pfxt_count]);
+        ret = -1;
+        break;
       }
       /* If unified flag isn't set, import ROA dumps in diff. Prefix Tables else
-         import all ROA dumps in a single Prefix Table */
-      if (!input->unified) {
-        if (cfg_import_roa_file(roa_arg, &val->pfxt[val->pfxt_count]) != 0) {
-          return -1;
-        }
-      } else {
-        if (cfg_import_roa_file(roa_arg, &val->pfxt[0]) != 0) {
-          return -1;
-        }
-      }
-      val->pfxt_active[val->pfxt_count] = 1;
-      val->pfxt_count++;
+         import all ROA dumps in a single Prefix Table (all ROA dumps are
+         imported at once after all URLs were parsed) */
+      roa_paths[roa_paths_count] = roa_arg;
+      roa_tables[roa_paths_count] = &epoch->pfxt[input->unified ? 0
+                                                                : pfxt_count];
+      roa_collectors[roa_paths_count] = pfxt_count;
+      roa_hashes[roa_paths_count++] = val->epoch->hash[pfxt_count];
+      pfxt_active[pfxt_count] = 1;
+    }
 
     /* If the broker didn't pass an URL the Prefix Table is empty and skipped */
-    } else {
-      val->pfxt_active[val->pfxt_count] = 0;
-      val->pfxt_count++;
-    }
+    pfxt_count++;
     roa_arg = strtok_r(NULL, ",", &end_roa_arg);
   }
+  imp->pfxt_count = pfxt_count;
+
+  /* The ROA sets of the epoch are kept for the change feed (next epoch) and
+     the divergent records */
+  roa_set_t changes[MAX_RPKI_COUNT];
+  memset(changes, 0, sizeof(changes));
+  imp->feed = (val->change_fp != NULL && epoch == val->next);
+  int keep = (imp->feed || input->divergence);
+
+  /* The epoch image of another process replaces the import, an epoch without
+     an image is imported and published as image (shm option), neither is
+     used in delta or differential mode */
+  char image[CACHE_MAX_PATH_LEN];
+  int publish = (strlen(input->shm_dir) && roa_paths_count && !ret &&
+                 !input->delta && val->diff_backend == NULL &&
+                 validation_image_path(cfg, imp->urls, image,
+                                       sizeof(image)) == 0);
+  int mapped = (publish && !keep &&
+                validation_map_image(cfg, epoch, image) == 0);
+  publish &= !mapped;
+
+  /* Shared prefix tables are only used without the ROA sets (and neither in
+     delta nor in differential mode) */
+  int share = (input->shared && !keep && !publish && !input->delta &&
+               val->diff_backend == NULL);
+
+  /* ROA dumps can only be unchanged if the same collectors have ROA dumps
+     (the next epoch is compared with the current one) */
+  int unchanged = (epoch == val->next && pfxt_count == val->pfxt_count &&
+                   !memcmp(pfxt_active, val->pfxt_active,
+                           sizeof(imp->pfxt_active)) && !share && !mapped);
+  for (int i = 0; i < roa_paths_count && !unchanged; i++) {
+    roa_hashes[i] = 0;
+  }
+
+  /* The prefix table of an unchanged ROA dump is shared with the current epoch
+     instead of being inserted again (not for a unified table, the tables of an
+     arena and the tables of the delta and differential mode) */
+  int reuse = (unchanged && !input->unified && !input->arena &&
+               !input->delta && val->diff_backend == NULL);
+  uint64_t prev_hashes[MAX_RPKI_COUNT];
+  memcpy(prev_hashes, roa_hashes, sizeof(prev_hashes));
+  if (!ret && roa_paths_count && share) {
+    ret = cfg_import_shared(cfg, roa_paths, roa_tables, roa_paths_count);
+  } else if (!ret && roa_paths_count && !mapped) {
+    ret = cfg_import_dumps(cfg, roa_paths, roa_tables, roa_hashes, reuse,
+                           keep || publish ? changes : NULL, roa_paths_count);
+  }
+  for (int i = 0; i < roa_paths_count; i++) {
+    imp->changes[roa_collectors[i]] = changes[i];
+  }
   free(urls);
 
+  /* A failed publication keeps the imported epoch */
+  if (!ret && publish) {
+    validation_write_image(cfg, image, imp->timestamp, imp->changes,
+                           pfxt_active, pfxt_count);
+  }
+
+  /* Keep the current epoch if every ROA dump equals the current one */
+  for (int i = 0; i < roa_paths_count; i++) {
+    unchanged &= (roa_hashes[i] == prev_hashes[i]);
+    imp->hash[roa_collectors[i]] = roa_hashes[i];
+    imp->reused[roa_collectors[i]] = (reuse && roa_hashes[i] == prev_hashes[i]);
+  }
+  imp->unchanged = unchanged;
+  if (!ret && unchanged) {
+    return 0;
+  }
+
+  /* All ROA dumps are merged once for the divergent records of the epoch */
+  if (!ret && input->divergence) {
+    ret = validation_set_divergence(epoch, imp->changes, pfxt_active,
+                                    pfxt_count);
+  }
+  for (int i = 0; !imp->feed && i < MAX_RPKI_COUNT; i++) {
+    roa_set_free(&imp->changes[i]);
+  }
+
+  /* Delta mode: prefix tables without a ROA dump in this epoch are emptied */
+  for (int i = 0; !ret && input->delta && i < MAX_RPKI_COUNT; i++) {
+    int used = input->unified ? !i && roa_paths_count : pfxt_active[i];
+    if (!used && epoch->pfxt[i].records.count) {
+      ret = backend_table_clear(&epoch->pfxt[i]);
+    }
+  }
+
+  /* A failed import keeps the current epoch */
+  if (ret != 0) {
+    cfg_import_free(imp);
+    validation_clear_epoch(cfg, epoch);
+    return -1;
+  }
+  return 0;
+}
+
+/* Report the ROA sets of a published import to the change feed (an import
+   started before the change feed was set is not reported) */
+static int cfg_publish_changes(rpki_cfg_t *cfg, config_import_t *imp)
+{
+  int ret = 0;
+  if (imp->feed && cfg->cfg_val.change_fp != NULL) {
+    ret = validation_report_changes(cfg, cfg->cfg_time.current_roa_timestamp,
+                                    imp->changes, imp->pfxt_active,
+                                    imp->pfxt_count);
+  }
+  cfg_import_free(imp);
+  return ret;
+}
+
+/* Publish an imported epoch once all ROA dumps were imported */
+static int cfg_publish_urls(rpki_cfg_t *cfg, config_import_t *imp)
+{
+  /* The epoch is used from the current ROA timestamp until the ROA dumps
+     skipped by the epoch stride or bucket are outdated */
+  config_validation_t *val = &cfg->cfg_val;
+  config_time_t *cfg_time = &cfg->cfg_time;
+  uint32_t expires = cfg_time->current_roa_timestamp;
+  if (cfg_time->skipped_roa_timestamp > expires) {
+    expires = cfg_time->skipped_roa_timestamp;
+  }
+  expires += ROA_ARCHIVE_INTERVAL;
+  if (imp->unchanged) {
+    debug_print("%s", "ROA dumps unchanged, keeping the prefix tables\n");
+    val->epoch->expires = expires;
+    return cfg_publish_changes(cfg, imp);
+  }
+
+  /* The prefix tables of unchanged ROA dumps are shared with the current
+     epoch (the current epoch is only used by the calling thread) */
+  for (int i = 0; i < imp->pfxt_count; i++) {
+    if (imp->reused[i] && backend_shared_reuse(&val->next->pfxt[i],
+                                               &val->epoch->pfxt[i]) != 0) {
+      cfg_import_free(imp);
+      return -1;
+    }
+  }
+  memcpy(val->next->hash, imp->hash, sizeof(imp->hash));
+  val->next->timestamp = cfg_time->current_roa_timestamp;
+  val->next->expires = expires;
+  if (validation_publish_epoch(cfg, imp->pfxt_count, imp->pfxt_active) != 0) {
+    cfg_import_free(imp);
+    return -1;
+  }
+  if (cfg_publish_changes(cfg, imp) != 0) {
+    return -1;
+  }
+
+  size_t usage = 0;
+  for (int i = 0; i < val->pfxt_count; i++) {
+    usage += backend_table_memory_usage(&val->pfxt[i]);
+  }
+  debug_print("Prefix tables (%s): %zu bytes, arena: %zu bytes mapped\n",
+              val->backend->name, usage,
+              arena_memory_usage(&val->epoch->arena));
+
   return 0;
 }
-int cfg_import_roa_file(char *roa_path, struct pfx_table *pfxt)
+
+int cfg_parse_urls(rpki_cfg_t *cfg, char *url)
 {
+  /* A prefetched epoch is discarded, the next epoch is imported again */
+  cfg_prefetch_cancel(cfg);
 
-  /* Read the whole ROA dump in, reallocate memory if necessary and store it 
-     in `roa_file` */
-  char *roa_file = NULL;
-  int length = 0, ret = 0;
-  char *buf = (char *) malloc(BROKER_ROA_DUMP_BUFLEN);
-  io_t *file_io = wandio_create(roa_path);
-  if (file_io == NULL) {
-    std_print("Error: Could not open %s for reading\n", roa_path);
+  config_import_t imp;
+  memset(&imp, 0, sizeof(imp));
+  imp.urls = url;
+  imp.timestamp = cfg->cfg_time.current_roa_timestamp;
+  imp.epoch = cfg->cfg_val.next;
+  if (cfg_import_urls(cfg, &imp) != 0) {
     return -1;
   }
+  return cfg_publish_urls(cfg, &imp);
+}
+
+validation_epoch_t *cfg_load_epoch(rpki_cfg_t *cfg, uint32_t timestamp)
+{
+  /* Get the ROA timestamp of the timestamp from the broker index */
+  int pos = cfg->cfg_input.epochs ? cfg_index_floor(cfg, timestamp) : -1;
+  if (pos < 0) {
+    return NULL;
+  }
+  uint32_t roa_ts = cfg->cfg_broker.index.entries[pos].timestamp;
+
+  /* No epoch if there is a gap between two ROA dumps */
+  if (timestamp >= roa_ts + ROA_ARCHIVE_INTERVAL) {
+    return NULL;
+  }
+
+  /* Import the ROA dumps into a new epoch which is kept as most recently used
+     one (a running prefetch is finished first, its result is kept) */
+  cfg_prefetch_wait(cfg);
+  char urls[BROKER_ROA_URLS_LEN];
+  if (broker_index_urls(&cfg->cfg_broker.index, pos, urls, sizeof(urls)) !=
+      0) {
+    return NULL;
+  }
+  config_import_t imp;
+  memset(&imp, 0, sizeof(imp));
+  imp.urls = urls;
+  imp.timestamp = roa_ts;
+  if ((imp.epoch = validation_create_epoch(cfg)) == NULL) {
+    return NULL;
+  }
+  if (cfg_import_urls(cfg, &imp) != 0) {
+    validation_free_epoch(imp.epoch);
+    return NULL;
+  }
+  validation_epoch_t *epoch = imp.epoch;
+  memcpy(epoch->hash, imp.hash, sizeof(imp.hash));
+  memcpy(epoch->pfxt_active, imp.pfxt_active, sizeof(imp.pfxt_active));
+  epoch->pfxt_count = imp.pfxt_count;
+  epoch->timestamp = roa_ts;
+  epoch->expires = roa_ts + ROA_ARCHIVE_INTERVAL;
+  validation_epoch_t *reuse = validation_keep_epoch(cfg, epoch);
+  if (reuse == NULL) {
+    validation_free_epoch(epoch);
+    return NULL;
+  }
+  validation_free_epoch(reuse);
+  debug_print("Loaded previous ROA Timestamp: %" PRIu32 "\n", roa_ts);
+  return epoch;
+}
+
+/* Import the next epoch in the background */
+static void *cfg_prefetch_worker(void *data)
+{
+  rpki_cfg_t *cfg = (rpki_cfg_t *)data;
+  config_prefetch_t *prefetch = &cfg->cfg_prefetch;
+  prefetch->ret = cfg_import_urls(cfg, &prefetch->imp);
+  return NULL;
+}
+
+int cfg_prefetch_start(rpki_cfg_t *cfg, uint32_t timestamp, char *url)
+{
+  config_prefetch_t *prefetch = &cfg->cfg_prefetch;
+  cfg_prefetch_cancel(cfg);
+  snprintf(prefetch->urls, sizeof(prefetch->urls), "%s", url);
+  memset(&prefetch->imp, 0, sizeof(prefetch->imp));
+  prefetch->imp.urls = prefetch->urls;
+  prefetch->imp.timestamp = timestamp;
+  prefetch->imp.epoch = cfg->cfg_val.next;
+  prefetch->timestamp = timestamp;
+  prefetch->ret = 0;
+  if (pthread_create(&prefetch->thread, NULL, cfg_prefetch_worker, cfg) != 0) {
+    std_print("%s", "Error: Could not start the prefetch of the next epoch\n");
+    return -1;
+  }
+  prefetch->running = 1;
+  debug_print("Prefetching ROA Timestamp: %" PRIu32 "\n", timestamp);
+  return 0;
+}
+
+int cfg_prefetch_next(rpki_cfg_t *cfg)
+{
+  /* Prefetch the epoch of the next ROA timestamp (if there is one) */
+  broker_index_t *index = &cfg->cfg_broker.index;
+  uint32_t next_ts = cfg->cfg_time.next_roa_timestamp;
+  int pos = next_ts ? broker_index_find(index, next_ts) : -1;
+  char urls[BROKER_ROA_URLS_LEN];
+  if (!cfg->cfg_input.prefetch || pos < 0 ||
+      broker_index_urls(index, pos, urls, sizeof(urls)) != 0) {
+    return 0;
+  }
+  return cfg_prefetch_start(cfg, next_ts, urls);
+}
+
+void cfg_prefetch_wait(rpki_cfg_t *cfg)
+{
+  config_prefetch_t *prefetch = &cfg->cfg_prefetch;
+  if (prefetch->running) {
+    pthread_join(prefetch->thread, NULL);
+    prefetch->running = 0;
+    prefetch->ready = 1;
+  }
+}
+
+void cfg_prefetch_cancel(rpki_cfg_t *cfg)
+{
+  /* The worker is waited for, the prefix tables of the next epoch are reused
+     by the next import (in delta mode the difference to their records is
+     applied) */
+  cfg_prefetch_wait(cfg);
+  cfg_import_free(&cfg->cfg_prefetch.imp);
+  cfg->cfg_prefetch.ready = 0;
+}
+
+int cfg_switch_epoch(rpki_cfg_t *cfg, uint32_t timestamp, char *url)
+{
+  /* Publish the prefetched epoch at once, otherwise import it now */
+  config_prefetch_t *prefetch = &cfg->cfg_prefetch;
+  int ret = -1;
+  cfg_prefetch_wait(cfg);
+  if (prefetch->ready && prefetch->timestamp == timestamp && !prefetch->ret) {
+    ret = cfg_publish_urls(cfg, &prefetch->imp);
+  }
+  cfg_import_free(&prefetch->imp);
+  prefetch->ready = 0;
+  if (ret != 0 && cfg_parse_urls(cfg, url) != 0) {
+    return -1;
+  }
+
+  /* Prefetch the following epoch while the new one is used */
+  cfg_prefetch_next(cfg);
+  return 0;
+}
+
+/* Add a parsed ROA record to a ROA set */
+static int cfg_roa_set_record(const roa_record_t *record, void *data)
+{
+  if (roa_set_add((roa_set_t *)data, record) != 0) {
+    std_print("%s", "Error: Record could not be added\n");
+    return -1;
+  }
+  return 0;
+}
+
+/* Add a parsed ROA record to a prefix table */
+static int cfg_table_record(const roa_record_t *record, void *data)
+{
+  if (backend_table_add((backend_table_t *)data, record) != 0) {
+    std_print("%s", "Error: Record could not be added\n");
+    return -1;
+  }
+  return 0;
+}
+
+int cfg_parse_roa_file(char *roa_path, roa_set_t *set, uint64_t *hash)
+{
+  size_t records = 0;
+  if (roa_parser_read(roa_path, cfg_roa_set_record, set, &records, hash) !=
+      0) {
+    return -1;
+  }
+  debug_print("Parsed ROA dump: %s (%zu records)\n", roa_path, records);
+
+  return 0;
+}
+
+int cfg_import_roa_file(rpki_cfg_t *cfg, char *roa_path,
+                        backend_table_t *pfxt, uint64_t *hash)
+{
+  /* A cached ROA dump is read from its snapshot, every other downloaded ROA
+     dump is stored in the cache */
+  config_validation_t *val = &cfg->cfg_val;
+  char cache_path[CACHE_MAX_PATH_LEN];
+  int store = 0;
+  if (strstr(roa_path, "://") != NULL && cache_enabled(&cfg->cache)) {
+    if (cache_lookup(&cfg->cache, roa_path, "snap", cache_path,
+                     sizeof(cache_path)) == 0) {
+      roa_path = cache_path;
+    } else {
+      store = 1;
+    }
+  }
+
+  /* Without minimization every record is added as soon as it was parsed */
+  if (!cfg->cfg_input.minimize && !store) {
+    size_t records = 0;
+    if (roa_parser_read(roa_path, cfg_table_record, pfxt, &records, hash) !=
+        0) {
+      return -1;
+    }
+    val->roa_records_parsed += records;
+    val->roa_records_imported += records;
+    debug_print("Imported ROA dump: %s\n", roa_path);
+    return 0;
+  }
+
+  /* Otherwise parse all records of the ROA dump into a ROA set first */
+  roa_set_t set;
+  uint64_t set_hash = 0;
+  if (roa_set_init(&set) != 0) {
+    std_print("%s", "Error: Could not allocate memory for the ROA set\n");
+    return -1;
+  }
+  if (cfg_parse_roa_file(roa_path, &set, &set_hash) != 0) {
+    roa_set_free(&set);
+    return -1;
+  }
+  if (hash != NULL) {
+    *hash = set_hash;
+  }
+
+  /* The ROA dump is stored in the cache before the minimization */
+  if (store && cache_store_set(&cfg->cache, roa_path, &set, set_hash) == 0 &&
+      cache_evict(&cfg->cache) < 0) {
+    debug_print("%s", "Warning: Could not evict the cache\n");
+  }
+
+  /* Minimize the collected records and add the remaining ones */
+  size_t records = set.count;
+  cfg_minimize_roa_set(cfg, &set);
+  if (backend_table_add_set(pfxt, &set) != 0) {
+    std_print("%s", "Error: Record could not be added\n");
+    roa_set_free(&set);
+    return -1;
+  }
+  val->roa_records_parsed += records;
+  val->roa_records_imported += set.count;
+  roa_set_free(&set);
+
+  debug_print("Imported ROA dump: %s\n", roa_path);
+
+  return 0;
+}
+
+void cfg_minimize_roa_set(rpki_cfg_t *cfg, roa_set_t *set)
+{
+  if (!cfg->cfg_input.minimize) {
+    return;
+  }
+  size_t records = set->count;
+  roa_set_minimize(set);
+  debug_print("Minimized ROA dump: %zu -> %zu records (ratio: %.3f)\n",
+              records, set->count,
+              records ? (double)set->count / records : 1.0);
+}
+
+/** A chunk of a downloaded ROA dump */
+typedef struct struct_cfg_import_chunk_t {
+
+  /** Next chunk of the ROA dump */
+  struct struct_cfg_import_chunk_t *next;
+
+  /** Length of the chunk */
+  size_t len;
+
+  /** Content of the chunk */
+  char buf[];
+
+} cfg_import_chunk_t;
+
+/** A ROA dump in the import pipeline */
+typedef struct struct_cfg_import_dump_t {
+
+  /** Path of the ROA dump */
+  char *path;
+
+  /** Prefix table the records are added to */
+  backend_table_t *pfxt;
+
+  /** Downloaded chunks which were not parsed yet */
+  cfg_import_chunk_t *head, *tail;
+
+  /** Number of downloaded chunks which were not parsed yet */
+  int queued;
+
+  /** Whether the download is finished */
+  int fetched;
+
+  /** Content hash of the parsed ROA dump */
+  uint64_t hash;
+
+  /** Whether the ROA dump is read from the cache (path of the snapshot) */
+  int cached;
+
+  /** Whether the ROA dump is mapped by its parser instead of downloaded
+      (cached snapshots and local uncompressed files) */
+  int mapped;
+
+  /** Path of the cached snapshot of the ROA dump */
+  char cache_path[CACHE_MAX_PATH_LEN];
+
+} cfg_import_dump_t;
+
+/** A pipelined import of several ROA dumps
+ *
+ * Download (and decompression), parsing and the insertion into the prefix
+ * tables run as separate stages, every stage works on another ROA dump
+ */
+typedef struct struct_cfg_import_job_t {
+
+  /** All ROA dumps */
+  cfg_import_dump_t *dumps;
+
+  /** ROA set of every ROA dump */
+  roa_set_t *sets;
+
+  /** Content hash of the previous ROA dump of every ROA dump (or NULL) */
+  const uint64_t *hashes;
+
+  /** Whether an unchanged ROA dump is not inserted (its prefix table is
+      shared with the previous one) */
+  int reuse;
+
+  /** Canonical copy of the ROA set of every ROA dump for the change feed (or
+      NULL) */
+  roa_set_t *changes;
+
+  /** Number of ROA dumps */
+  int count;
+
+  /** Index of the next ROA dump which will be downloaded */
+  int next_fetch;
+
+  /** Index of the next ROA dump which will be parsed */
+  int next_parse;
+
+  /** Indexes of the parsed ROA dumps (in order of completion) */
+  int *parsed;
+
+  /** Number of parsed ROA dumps */
+  int parsed_count;
+
+  /** Whether an import failed (all stages stop) */
+  int failed;
+
+  /** Number of ROA dumps stored in the cache */
+  int stored;
+
+  /** Lock of the job */
+  pthread_mutex_t lock;
+
+  /** Condition signaled on every change of the job */
+  pthread_cond_t cond;
+
+} cfg_import_job_t;
+
+/* Abort all stages of an import (the lock is held by the caller) */
+static void cfg_import_fail(cfg_import_job_t *job)
+{
+  job->failed = 1;
+  pthread_cond_broadcast(&job->cond);
+}
+
+/* Download ROA dumps chunk by chunk until no dump is left, every dump is at
+   most ROA_PARSER_QUEUE_LEN chunks ahead of its parser */
+static void *cfg_import_fetcher(void *data)
+{
+  cfg_import_job_t *job = (cfg_import_job_t *)data;
   while (1) {
-    ret = wandio_read(file_io, buf, BROKER_ROA_DUMP_BUFLEN);
+    pthread_mutex_lock(&job->lock);
+    int idx = job->failed ? job->count : job->next_fetch++;
+    pthread_mutex_unlock(&job->lock);
+    if (idx >= job->count) {
+      break;
+    }
+    cfg_import_dump_t *dump = &job->dumps[idx];
+
+    /* Cached and local ROA dumps are mapped by their parser */
+    if (dump->mapped) {
+      pthread_mutex_lock(&job->lock);
+      dump->fetched = 1;
+      pthread_cond_broadcast(&job->cond);
+      pthread_mutex_unlock(&job->lock);
+      continue;
+    }
+    io_t *file_io = wandio_create(dump->path);
+    if (file_io == NULL) {
+      std_print("Error: Could not open %s for reading\n", dump->path);
+      pthread_mutex_lock(&job->lock);
+      cfg_import_fail(job);
+      pthread_mutex_unlock(&job->lock);
+      break;
+    }
+
+    int64_t ret;
+    while (1) {
+      cfg_import_chunk_t *chunk =
+        malloc(sizeof(cfg_import_chunk_t) + ROA_PARSER_CHUNK_SIZE);
+      if (chunk == NULL ||
+          (ret = wandio_read(file_io, chunk->buf, ROA_PARSER_CHUNK_SIZE)) <= 0) {
+        ret = (chunk == NULL ? -1 : ret);
+        free(chunk);
+        break;
+      }
+      chunk->len = ret;
+      chunk->next = NULL;
+
+      /* Wait until the parser caught up */
+      pthread_mutex_lock(&job->lock);
+      while (dump->queued >= ROA_PARSER_QUEUE_LEN && !job->failed) {
+        pthread_cond_wait(&job->cond, &job->lock);
+      }
+      if (job->failed) {
+        pthread_mutex_unlock(&job->lock);
+        free(chunk);
+        break;
+      }
+      if (dump->tail != NULL) {
+        dump->tail->next = chunk;
+      } else {
+        dump->head = chunk;
+      }
+      dump->tail = chunk;
+      dump->queued++;
+      pthread_cond_broadcast(&job->cond);
+      pthread_mutex_unlock(&job->lock);
+    }
+    wandio_destroy(file_io);
+
+    pthread_mutex_lock(&job->lock);
     if (ret < 0) {
       std_print("%s", "Error: Could not read ROA file from broker\n");
-      return -1;
+      cfg_import_fail(job);
     }
-    if (!ret) {
-      break;
+    dump->fetched = 1;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+  }
+  return NULL;
+}
+
+/* Append a downloaded chunk of a ROA snapshot to its buffer */
+static int cfg_import_snapshot_append(uint8_t **buf, size_t *len, size_t *cap,
+                                      const cfg_import_chunk_t *chunk)
+{
+  if (*len + chunk->len > *cap) {
+    size_t size = *cap ? *cap : ROA_PARSER_CHUNK_SIZE;
+    while (size < *len + chunk->len) {
+      size *= 2;
     }
-    if (!(roa_file = realloc(roa_file, length + ret + 2))) {
-      std_print("%s", "Error: Could not realloc roa string\n");
+    uint8_t *tmp = realloc(*buf, size);
+    if (tmp == NULL) {
+      std_print("%s", "Error: Could not allocate memory for the snapshot\n");
       return -1;
     }
-    strncpy(roa_file + length, buf, ret);
-    length += ret;
+    *buf = tmp;
+    *cap = size;
   }
-  roa_file[length] = '\0';
-  free(buf);
-  wandio_destroy(file_io);
+  memcpy(*buf + *len, chunk->buf, chunk->len);
+  *len += chunk->len;
+  return 0;
+}
 
-  /* Check whether the ROA dump contains header information, abort if not */
-  if(strstr(roa_file, "ASN,IP Prefix,Max Length") == NULL && 
-     strstr(roa_file, "ASN,IP Prefix,Max Length,Trust Anchor") == NULL) {
-    std_print("%s", "Error: Could not read ROA file from broker\n");
+/* Load a downloaded ROA snapshot into the ROA set of its dump */
+static int cfg_import_snapshot(cfg_import_job_t *job, int idx,
+                               const uint8_t *buf, size_t len,
+                               size_t *records, uint64_t *hash)
+{
+  roa_snapshot_t snap;
+  if (roa_snapshot_init(&snap, buf, len) != 0 ||
+      roa_snapshot_read(&snap, cfg_roa_set_record, &job->sets[idx]) != 0) {
     return -1;
   }
-  
-  /* Check whether the ROA dump format contains the trustanchor information */
-  int roa_fields_cnt = 0, line_cnt = 0, dbg_line = 0;
-  for (size_t i = 0; i < strcspn(roa_file, "\n"); i++) {
-    roa_fields_cnt += (roa_file[i] == ',' ? 1 : 0);
-  }
-  roa_fields_cnt++;
-
-  /* Skip the header */
-  char *arg_end = NULL;
-  char *arg = strtok_r(roa_file, ",\n", &arg_end);
-  for (size_t i = 0; i < roa_fields_cnt; i++) {
-    arg = strtok_r(NULL, ",\n", &arg_end);
-  }
-
-  /* Parse the ROA file and add every record to the prefix table
-     Format: ASN,IP Prefix,Max Length(, Trustanchor)?*/
-  uint32_t asn = 0;
-  uint8_t min_len = 0, max_len = 0;
-  char addr[INET6_ADDRSTRLEN] = {0};
-  while (arg != NULL) {
-    switch (line_cnt) {
-    case 0:
-      /* Bypass the different notations for the ASN (e.g. 718 || AS718) */
-      if (strstr(arg, "AS")) {
-        if (utils_cfg_validity_check_val(arg + strlen("AS"), &asn, 32) != 0) {
-          return -1;
-        }
-      } else if (utils_cfg_validity_check_val(arg, &asn, 32) != 0) {
-        return -1;
-      }
+  *records = snap.header->count[ROA_IPV4] + snap.header->count[ROA_IPV6];
+  *hash = snap.header->hash;
+  return 0;
+}
+
+/* Parse downloaded ROA dumps until no dump is left (ROA snapshots are
+   collected and loaded at once) */
+static void *cfg_import_parser(void *data)
+{
+  cfg_import_job_t *job = (cfg_import_job_t *)data;
+  while (1) {
+    pthread_mutex_lock(&job->lock);
+    int idx = job->failed ? job->count : job->next_parse++;
+    pthread_mutex_unlock(&job->lock);
+    if (idx >= job->count) {
       break;
-    case 1:
-      if (utils_cfg_validity_check_prefix(arg, addr, &min_len) != 0) {
-        return -1;
+    }
+    cfg_import_dump_t *dump = &job->dumps[idx];
+    size_t records = 0;
+    uint64_t hash = 0;
+
+    /* Cached and local ROA dumps are parsed from a mapping of the file */
+    if (dump->mapped) {
+      int ret = roa_parser_read(dump->path, cfg_roa_set_record,
+                                &job->sets[idx], &records, &hash);
+      pthread_mutex_lock(&job->lock);
+      if (ret != 0) {
+        cfg_import_fail(job);
+      } else if (!job->failed) {
+        debug_print("Parsed ROA dump: %s (%zu records)\n", dump->path,
+                    records);
+        dump->hash = hash;
+        job->parsed[job->parsed_count++] = idx;
+        pthread_cond_broadcast(&job->cond);
       }
-      break;
-    case 2:
-      if (utils_cfg_validity_check_val(arg, &max_len, 8) != 0) {
+      pthread_mutex_unlock(&job->lock);
+      continue;
+    }
+    roa_parser_t parser;
+    roa_parser_init(&parser, cfg_roa_set_record, &job->sets[idx]);
+    uint8_t *snap_buf = NULL;
+    size_t snap_len = 0, snap_cap = 0;
+    int snapshot = -1;
+
+    /* Parse every chunk as soon as it was downloaded */
+    int ret = 0, failed = 0;
+    while (!ret) {
+      pthread_mutex_lock(&job->lock);
+      while (dump->head == NULL && !dump->fetched && !job->failed) {
+        pthread_cond_wait(&job->cond, &job->lock);
+      }
+      cfg_import_chunk_t *chunk = (job->failed ? NULL : dump->head);
+      if (chunk != NULL) {
+        dump->head = chunk->next;
+        dump->tail = (dump->head == NULL ? NULL : dump->tail);
+        dump->queued--;
+        pthread_cond_broadcast(&job->cond);
+      }
+      failed = job->failed;
+      pthread_mutex_unlock(&job->lock);
+      if (chunk == NULL) {
+        break;
+      }
+      if (snapshot < 0) {
+        snapshot = roa_snapshot_detect(chunk->buf, chunk->len);
+      }
+      if (snapshot) {
+        ret = cfg_import_snapshot_append(&snap_buf, &snap_len, &snap_cap,
+                                         chunk);
+      } else {
+        ret = roa_parser_feed(&parser, chunk->buf, chunk->len);
+      }
+      free(chunk);
+    }
+    if (!ret && !failed && snapshot == 1) {
+      ret = cfg_import_snapshot(job, idx, snap_buf, snap_len, &records, &hash);
+    } else if (!ret && !failed) {
+      ret = roa_parser_finish(&parser);
+      records = parser.records;
+      hash = roa_parser_hash(&parser);
+    }
+    free(snap_buf);
+
+    /* Pass the ROA dump on to the insertion */
+    pthread_mutex_lock(&job->lock);
+    if (ret != 0) {
+      cfg_import_fail(job);
+    } else if (!failed) {
+      debug_print("Parsed ROA dump: %s (%zu records)\n", dump->path,
+                  records);
+      dump->hash = hash;
+      job->parsed[job->parsed_count++] = idx;
+      pthread_cond_broadcast(&job->cond);
+    }
+    pthread_mutex_unlock(&job->lock);
+  }
+  return NULL;
+}
+
+/* Add the parsed ROA dumps to their prefix tables in order of completion (a
+   partitioned unified prefix table and the tables of the delta mode are built
+   from all ROA dumps at once, ROA dumps equal to their previous one are added
+   last) */
+static int cfg_import_insert(rpki_cfg_t *cfg, cfg_import_job_t *job)
+{
+  config_validation_t *val = &cfg->cfg_val;
+  for (int i = 0; i < job->count; i++) {
+    pthread_mutex_lock(&job->lock);
+    while (i == job->parsed_count && !job->failed) {
+      pthread_cond_wait(&job->cond, &job->lock);
+    }
+    int idx = (job->failed ? -1 : job->parsed[i]);
+    pthread_mutex_unlock(&job->lock);
+    if (idx < 0) {
+      return -1;
+    }
+
+    /* Downloaded ROA dumps are stored in the cache before the minimization */
+    roa_set_t *set = &job->sets[idx];
+    cfg_import_dump_t *dump = &job->dumps[idx];
+    if (cache_enabled(&cfg->cache) && !dump->cached &&
+        strstr(dump->path, "://") != NULL &&
+        cache_store_set(&cfg->cache, dump->path, set, dump->hash) == 0) {
+      job->stored++;
+    }
+    val->roa_records_parsed += set->count;
+
+    /* The change feed compares the ROA dumps before the minimization */
+    if (job->changes != NULL) {
+      if (roa_set_copy(set, &job->changes[idx]) != 0) {
+        std_print("%s", "Error: Could not copy the ROA set\n");
+        pthread_mutex_lock(&job->lock);
+        cfg_import_fail(job);
+        pthread_mutex_unlock(&job->lock);
         return -1;
       }
-      break;
-    case 3:
+      roa_set_unique(&job->changes[idx]);
+    }
+    cfg_minimize_roa_set(cfg, set);
+    val->roa_records_imported += set->count;
+    if ((cfg->cfg_input.unified && cfg->cfg_input.threads > 1) ||
+        cfg->cfg_input.delta ||
+        (job->hashes != NULL && job->dumps[idx].hash == job->hashes[idx])) {
+      continue;
+    }
+    if (backend_table_add_set(job->dumps[idx].pfxt, set) != 0) {
+      std_print("%s", "Error: Record could not be added\n");
+      pthread_mutex_lock(&job->lock);
+      cfg_import_fail(job);
+      pthread_mutex_unlock(&job->lock);
+      return -1;
+    }
+    roa_set_free(set);
+  }
+  return 0;
+}
+
+/* Import ROA dumps one after another, every record is added as soon as it was
+   parsed (the records of an unchanged ROA dump are discarded if its prefix
+   table is shared with the previous one) */
+static int cfg_import_serial(rpki_cfg_t *cfg, char **roa_paths,
+                             backend_table_t **pfxts, uint64_t *hashes,
+                             int reuse, int count)
+{
+  for (int i = 0; i < count; i++) {
+    uint64_t hash = 0;
+    if (cfg_import_roa_file(cfg, roa_paths[i], pfxts[i], &hash) != 0) {
+      return -1;
+    }
+    if (hashes == NULL) {
+      continue;
+    }
+    if (reuse && hash == hashes[i] && backend_table_clear(pfxts[i]) != 0) {
+      return -1;
+    }
+    hashes[i] = hash;
+  }
+  return 0;
+}
+
+/* Import several ROA dumps (with a canonical copy of every ROA set for the
+   change feed if changes is set), without threads every ROA dump is imported
+   while it is parsed unless the ROA sets are needed */
+static int cfg_import_dumps(rpki_cfg_t *cfg, char **roa_paths,
+                            backend_table_t **pfxts, uint64_t *hashes,
+                            int reuse, roa_set_t *changes, int count)
+{
+  if (cfg->cfg_input.threads < 2 && !cfg->cfg_input.delta && changes == NULL) {
+    return cfg_import_serial(cfg, roa_paths, pfxts, hashes, reuse, count);
+  }
+
+  cfg_import_job_t job;
+  memset(&job, 0, sizeof(job));
+  job.count = count;
+  job.hashes = hashes;
+  job.reuse = reuse;
+  job.changes = changes;
+  job.dumps = calloc(count, sizeof(cfg_import_dump_t));
+  job.sets = malloc(count * sizeof(roa_set_t));
+  job.parsed = malloc(count * sizeof(int));
+  if (job.dumps == NULL || job.sets == NULL || job.parsed == NULL) {
+    std_print("%s", "Error: Could not allocate memory for the ROA sets\n");
+    free(job.dumps);
+    free(job.sets);
+    free(job.parsed);
+    return -1;
+  }
+  for (int i = 0; i < count; i++) {
+    cfg_import_dump_t *dump = &job.dumps[i];
+    dump->path = roa_paths[i];
+    dump->pfxt = pfxts[i];
+    if (strstr(dump->path, "://") != NULL &&
+        cache_lookup(&cfg->cache, dump->path, "snap", dump->cache_path,
+                     sizeof(dump->cache_path)) == 0) {
+      dump->path = dump->cache_path;
+      dump->cached = 1;
+    }
+    dump->mapped = (dump->cached || roa_parser_mappable(dump->path));
+    if (roa_set_init(&job.sets[i]) != 0) {
+      job.failed = 1;
+    }
+  }
+  pthread_mutex_init(&job.lock, NULL);
+  pthread_cond_init(&job.cond, NULL);
+
+  /* Start the download and parser stages, the insertion runs in the calling
+     thread (without threads all stages run one after another) */
+  int threads = cfg->cfg_input.threads < count ? cfg->cfg_input.threads : count;
+  threads = (job.failed || cfg->cfg_input.threads < 2 ? 0 : threads);
+  pthread_t workers[2 * MAX_THREADS];
+  int started = 0;
+  void *(*stages[])(void *) = {cfg_import_fetcher, cfg_import_parser};
+  for (int t = 0; t < 2 * threads; t++) {
+    if (pthread_create(&workers[t], NULL, stages[t % 2], &job) != 0) {
       break;
     }
+    started++;
+  }
 
-    /* Add record if all fields were extracted and are valid */
-    if (line_cnt == roa_fields_cnt - 1) {
-      line_cnt = 0;
-      dbg_line++;
-      if (cfg_add_record_to_pfx_table(asn, addr, min_len, max_len, pfxt) != 0) {
-        std_print("Error: Record is corrupt at line: %i\n",
-                  dbg_line / roa_fields_cnt);
-        return -1;
+  /* Without any thread every ROA dump is parsed one after another, without a
+     parser thread the calling thread parses all ROA dumps first */
+  if (!started) {
+    for (int i = 0; i < count && !job.failed; i++) {
+      if (cfg_parse_roa_file(job.dumps[i].path, &job.sets[i],
+                             &job.dumps[i].hash)
+          != 0) {
+        job.failed = 1;
+      } else {
+        job.parsed[job.parsed_count++] = i;
       }
-    } else {
-      line_cnt++;
-      dbg_line++;
     }
-    arg = strtok_r(NULL, ",\n", &arg_end);
+  } else if (started % 2) {
+    cfg_import_parser(&job);
   }
+  int ret = cfg_import_insert(cfg, &job);
+  for (int t = 0; t < started; t++) {
+    pthread_join(workers[t], NULL);
+  }
+  ret |= (job.failed ? -1 : 0);
 
-  debug_print("Imported ROA dump: %s\n", roa_path);
-  free(roa_file);
+  /* Nothing is inserted if every ROA dump equals its previous one, otherwise
+     the deferred ROA dumps are added now (unless their prefix tables are
+     shared with the previous ones) */
+  int partitioned = (cfg->cfg_input.unified && cfg->cfg_input.threads > 1);
+  int unchanged = (hashes != NULL && !ret);
+  for (int i = 0; i < count && unchanged; i++) {
+    unchanged = (job.dumps[i].hash == hashes[i]);
+  }
+  int deferred = !unchanged && hashes != NULL && !reuse && !partitioned &&
+                 !cfg->cfg_input.delta;
+  for (int i = 0; i < count && !ret && deferred; i++) {
+    if (job.dumps[i].hash == hashes[i] &&
+        backend_table_add_set(pfxts[i], &job.sets[i]) != 0) {
+      std_print("%s", "Error: Record could not be added\n");
+      ret = -1;
+    }
+  }
+  for (int i = 0; i < count && !ret && hashes != NULL; i++) {
+    hashes[i] = job.dumps[i].hash;
+  }
 
-  return 0;
+  /* Delta mode: merge the ROA sets of every prefix table and only apply the
+     difference to the records of the previous import */
+  for (int i = 0; !ret && !unchanged && cfg->cfg_input.delta && i < count;
+       i++) {
+    int first = 1;
+    for (int j = 0; j < i && first; j++) {
+      first = (pfxts[j] != pfxts[i]);
+    }
+    for (int j = i + 1; j < count && first && !ret; j++) {
+      for (size_t r = 0; pfxts[j] == pfxts[i] && r < job.sets[j].count; r++) {
+        if (roa_set_add(&job.sets[i], &job.sets[j].records[r]) != 0) {
+          ret = -1;
+          break;
+        }
+      }
+    }
+    if (!first || ret) {
+      continue;
+    }
+    size_t added = 0, removed = 0;
+    roa_set_unique(&job.sets[i]);
+    if (backend_table_update(pfxts[i], &job.sets[i], &added, &removed) != 0) {
+      std_print("%s", "Error: ROA delta could not be applied\n");
+      ret = -1;
+      break;
+    }
+    debug_print("ROA delta: %zu added, %zu removed, %zu records\n", added,
+                removed, pfxts[i]->records.count);
+  }
+
+  /* Build all partitions of a unified prefix table from the record streams */
+  if (!ret && !unchanged && partitioned && !cfg->cfg_input.delta &&
+      backend_table_build_partitioned(pfxts[0], job.sets, count,
+                                      cfg->cfg_input.threads) != 0) {
+    ret = -1;
+  }
+
+  if (job.stored && cache_evict(&cfg->cache) < 0) {
+    debug_print("%s", "Warning: Could not evict the cache\n");
+  }
+
+  /* Release all ROA sets and the chunks left by an aborted import */
+  for (int i = 0; i < count; i++) {
+    roa_set_free(&job.sets[i]);
+    while (job.dumps[i].head != NULL) {
+      cfg_import_chunk_t *chunk = job.dumps[i].head;
+      job.dumps[i].head = chunk->next;
+      free(chunk);
+    }
+  }
+  pthread_cond_destroy(&job.cond);
+  pthread_mutex_destroy(&job.lock);
+  free(job.dumps);
+  free(job.sets);
+  free(job.parsed);
+
+  debug_print("Imported %i ROA dumps with %i threads\n", count,
+              cfg->cfg_input.threads);
+  return ret;
+}
+
+int cfg_import_roa_files(rpki_cfg_t *cfg, char **roa_paths,
+                         backend_table_t **pfxts, uint64_t *hashes, int count)
+{
+  return cfg_import_dumps(cfg, roa_paths, pfxts, hashes,
+                          hashes != NULL && !cfg->cfg_input.unified &&
+                            !cfg->cfg_input.delta,
+                          NULL, count);
 }
 
 int cfg_add_record_to_pfx_table(uint32_t asn, char *address, uint8_t min_len,
@@ -344,8 +1399,8 @@ int cfg_add_record_to_pfx_table(uint32_t asn, char *address, uint8_t min_len,
 
   struct pfx_record pfx;
 
-  /* Check if the IP address could be interpreted by the RTRlib */
-  if (lrtr_ip_str_to_addr(address, &pfx.prefix) != 0) {
+  /* Check if the IP address is valid */
+  if (roa_parser_addr(address, strlen(address), &pfx.prefix) != 0) {
     std_print("%s", "Error: Address not interpretable\n");
     return -1;
   }
@@ -362,3 +1417,45 @@ int cfg_add_record_to_pfx_table(uint32_t asn, char *address, uint8_t min_len,
 
   return 0;
 }
+
+int cfg_add_record_to_table(uint32_t asn, char *address, uint8_t min_len,
+                            uint8_t max_len, backend_table_t *pfxt)
+{
+  /* Check if the IP address is valid */
+  struct lrtr_ip_addr prefix;
+  if (roa_parser_addr(address, strlen(address), &prefix) != 0) {
+    std_print("%s", "Error: Address not interpretable\n");
+    return -1;
+  }
+
+  /* Check if the record could be added by the backend */
+  roa_record_t record;
+  roa_record_from_addr(asn, &prefix, min_len, max_len, &record);
+  if (backend_table_add(pfxt, &record) != 0) {
+    std_print("%s", "Error: Record could not be added\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+int cfg_add_record_to_roa_set(uint32_t asn, char *address, uint8_t min_len,
+                              uint8_t max_len, roa_set_t *set)
+{
+  /* Check if the IP address is valid */
+  struct lrtr_ip_addr prefix;
+  if (roa_parser_addr(address, strlen(address), &prefix) != 0) {
+    std_print("%s", "Error: Address not interpretable\n");
+    return -1;
+  }
+
+  /* Check if the record could be added to the ROA set */
+  roa_record_t record;
+  roa_record_from_addr(asn, &prefix, min_len, max_len, &record);
+  if (roa_set_add(set, &record) != 0) {
+    std_print("%s", "Error: Record could not be added\n");
+    return -1;
+  }
+
+  return 0;
+}
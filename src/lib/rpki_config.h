@@ -30,10 +30,14 @@
 #ifndef __CONFIG_H
 #define __CONFIG_H
 
+#include <pthread.h>
 #include <stdint.h>
 
 #include "khash.h"
 #include "broker.h"
+#include "backend.h"
+#include "cache.h"
+#include "roa_set.h"
 #include "validation.h"
 #include "constants.h"
 #include "rtrlib/rtrlib.h"
@@ -113,6 +117,136 @@ typedef struct struct_config_input_t {
    */
   int intervals_count;
 
+  /** Minimize flag
+   *
+   * Minimize the ROA records of every dump before the import (0 = off, 1 = on)
+   */
+  int minimize;
+
+  /** Backend name
+   *
+   * Name of the prefix table backend (empty for the default backend)
+   */
+  char backend[MAX_INPUT_LENGTH];
+
+  /** Reference backend name
+   *
+   * Name of the reference backend of the differential mode (empty = off)
+   */
+  char diff_backend[MAX_INPUT_LENGTH];
+
+  /** Arena flag
+   *
+   * Allocate the prefix tables of an epoch from an arena (0 = off, 1 = on)
+   */
+  int arena;
+
+  /** Huge page flag
+   *
+   * Back the epoch arena with transparent huge pages (0 = off, 1 = on)
+   */
+  int hugepages;
+
+  /** Thread count
+   *
+   * Number of concurrent downloads and parsers of an epoch (1 = serial import)
+   */
+  int threads;
+
+  /** Delta flag
+   *
+   * Apply only the difference between consecutive ROA dumps (0 = off, 1 = on)
+   */
+  int delta;
+
+  /** Prefetch flag
+   *
+   * Import the epoch of the next ROA timestamp in the background while the
+   * current epoch is used (0 = off, 1 = on)
+   */
+  int prefetch;
+
+  /** Divergence flag
+   *
+   * Compute the records which are not contained in the ROA dumps of all
+   * collectors of every epoch (0 = off, 1 = on)
+   */
+  int divergence;
+
+  /** Shared flag
+   *
+   * Share the loaded prefix tables with all configurations of the process
+   * which import the same ROA dumps (0 = off, 1 = on)
+   */
+  int shared;
+
+  /** Epoch stride
+   *
+   * Import only every k-th ROA dump of the broker response (0 or 1 = every
+   * ROA dump)
+   */
+  uint32_t epoch_stride;
+
+  /** Epoch bucket
+   *
+   * Import only the first ROA dump of every time bucket of this length in
+   * seconds (0 = every ROA dump)
+   */
+  uint32_t epoch_bucket;
+
+  /** Recent epochs
+   *
+   * Number of previous epochs kept for out-of-order timestamps (0 = none)
+   */
+  uint32_t epochs;
+
+  /** Recent epochs size
+   *
+   * Memory budget of the previous epochs in MB (0 = no budget)
+   */
+  uint32_t epochs_size;
+
+  /** Cache directory
+   *
+   * Directory of the local cache of ROA dumps and broker responses (empty =
+   * no cache)
+   */
+  char cache_dir[CACHE_MAX_PATH_LEN];
+
+  /** Cache size
+   *
+   * Size limit of the local cache in MB (0 = CACHE_DEFAULT_SIZE)
+   */
+  uint32_t cache_size;
+
+  /** Index path
+   *
+   * Path of a temporal ROA index used instead of the ROA dumps (empty = no
+   * index)
+   */
+  char index_path[CACHE_MAX_PATH_LEN];
+
+  /** Shared memory directory
+   *
+   * Directory of the epoch images shared by all processes (e.g. /dev/shm,
+   * empty = no epoch images)
+   */
+  char shm_dir[CACHE_MAX_PATH_LEN];
+
+  /** Shared memory image count
+   *
+   * Number of the most recently used epoch images kept in the shared memory
+   * directory (0 = VALIDATION_IMAGE_COUNT)
+   */
+  uint32_t shm_count;
+
+  /** Broker window
+   *
+   * Length of the windows in seconds the broker index is fetched and held in,
+   * the next window is fetched in the background (0 = whole intervals)
+   */
+  uint32_t window;
+
 } config_input_t;
 
 /** A RPKI config time object */
@@ -130,6 +264,14 @@ typedef struct struct_config_time_t {
   */
   uint32_t next_roa_timestamp;
 
+  /** Timestamp of the last skipped ROA file
+   *
+   * Timestamp of the last ROA file between the current and the next ROA file
+   * which was skipped by the epoch stride or bucket (0 = none), the current
+   * ROA file is used until the next one
+   */
+  uint32_t skipped_roa_timestamp;
+
   /** Start timestamp
    *
    * First timestamp of the broker response
@@ -150,6 +292,123 @@ typedef struct struct_config_time_t {
 
 } config_time_t;
 
+/** An import of the ROA dumps of an epoch */
+typedef struct struct_config_import_t {
+
+  /** ROA URLs
+   *
+   * ROA URLs of the epoch (delimiter: ","), owned by the caller or the
+   * prefetch
+   */
+  const char *urls;
+
+  /** ROA timestamp
+   *
+   * ROA timestamp of the epoch (UTC epoch timestamp)
+   */
+  uint32_t timestamp;
+
+  /** Epoch
+   *
+   * Epoch the ROA dumps are imported into (the next epoch is compared with
+   * the current one)
+   */
+  validation_epoch_t *epoch;
+
+  /** Prefix table count
+   *
+   * Number of collectors of the epoch
+   */
+  int pfxt_count;
+
+  /** Active prefix tables
+   *
+   * Whether a collector has a ROA dump in the epoch (0 = no, 1 = yes)
+   */
+  int pfxt_active[MAX_RPKI_COUNT];
+
+  /** Content hashes
+   *
+   * Content hashes of the ROA dumps of every collector (0 = none)
+   */
+  uint64_t hash[MAX_RPKI_COUNT];
+
+  /** Reused prefix tables
+   *
+   * Whether the ROA dump of a collector equals the one of the current epoch
+   * and its prefix table is shared with the current epoch (0 = no, 1 = yes)
+   */
+  int reused[MAX_RPKI_COUNT];
+
+  /** Unchanged flag
+   *
+   * Whether all ROA dumps equal the current epoch (0 = no, 1 = yes)
+   */
+  int unchanged;
+
+  /** Change feed flag
+   *
+   * Whether the ROA sets of the change feed were kept (0 = no, 1 = yes)
+   */
+  int feed;
+
+  /** Change feed ROA sets
+   *
+   * Canonical ROA set of the ROA dump of every collector (only if a change
+   * feed is set), reported when the epoch is published
+   */
+  roa_set_t changes[MAX_RPKI_COUNT];
+
+} config_import_t;
+
+/** A RPKI config prefetch object */
+typedef struct struct_config_prefetch_t {
+
+  /** Worker
+   *
+   * Thread importing the next epoch
+   */
+  pthread_t thread;
+
+  /** Running flag
+   *
+   * Whether the worker was started and not joined yet (0 = no, 1 = yes)
+   */
+  int running;
+
+  /** Ready flag
+   *
+   * Whether the worker was joined and its import is not published or
+   * discarded yet (0 = no, 1 = yes)
+   */
+  int ready;
+
+  /** Timestamp
+   *
+   * ROA timestamp of the prefetched epoch (UTC epoch timestamp)
+   */
+  uint32_t timestamp;
+
+  /** ROA URLs
+   *
+   * ROA URLs of the prefetched epoch (rendered from the broker index)
+   */
+  char urls[BROKER_ROA_URLS_LEN];
+
+  /** Import
+   *
+   * Import of the next epoch (published by the switch to its timestamp)
+   */
+  config_import_t imp;
+
+  /** Result
+   *
+   * Result of the import (0 = imported, -1 = failed)
+   */
+  int ret;
+
+} config_prefetch_t;
+
 /** A RPKI Configuration object */
 typedef struct struct_rpki_config_t {
 
@@ -165,6 +424,12 @@ typedef struct struct_rpki_config_t {
   /** Config Validation */
   config_validation_t cfg_val;
 
+  /** Local cache of ROA dumps and broker responses */
+  cache_t cache;
+
+  /** Config Prefetch */
+  config_prefetch_t cfg_prefetch;
+
 } rpki_cfg_t;
 
 /** Create a configuration for the RPKI validation
@@ -200,7 +465,8 @@ int cfg_destroy(rpki_cfg_t *cfg);
  */
 int cfg_get_timestamps(rpki_cfg_t *cfg, uint32_t timestamp, char *dest);
 
-/** Get the next timestamp if there is any (or end of time interval)
+/** Get the next timestamp if there is any (or end of time interval), ROA
+ *  files skipped by the epoch stride or bucket are marked as used
  *
  * @param[in] cfg            Pointer to the configuration struct
  * @param[in] current_ts     Current active timestamp (key of the broker Kh)
@@ -217,13 +483,109 @@ uint32_t cfg_next_timestamp(rpki_cfg_t *cfg, uint32_t current_ts);
  */
 int cfg_parse_urls(rpki_cfg_t *cfg, char *url);
 
-/** Parse a ROA file and import all records to a prefix table
+/** Switch to the epoch of a ROA timestamp, a prefetched epoch is published
+ *  at once (otherwise the ROA URLs are parsed), afterwards the epoch of the
+ *  next ROA timestamp is prefetched (if the prefetch option is set)
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] timestamp      ROA timestamp of the epoch
+ * @param[in] url            String containing ROA URLs (delimiter: ",")
+ * @return                   0 if the epoch was switched, otherwise -1
+ */
+int cfg_switch_epoch(rpki_cfg_t *cfg, uint32_t timestamp, char *url);
+
+/** Start the import of an epoch in the background (a running prefetch is
+ *  cancelled), the epoch is published by cfg_switch_epoch
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] timestamp      ROA timestamp of the epoch
+ * @param[in] url            String containing ROA URLs (delimiter: ",", copied)
+ * @return                   0 if the prefetch was started, otherwise -1
+ */
+int cfg_prefetch_start(rpki_cfg_t *cfg, uint32_t timestamp, char *url);
+
+/** Prefetch the epoch of the next ROA timestamp of the broker response (if
+ *  the prefetch option is set and there is a next ROA timestamp)
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @return                   0 if the prefetch was started or skipped,
+ *                           otherwise -1
+ */
+int cfg_prefetch_next(rpki_cfg_t *cfg);
+
+/** Wait for a running prefetch and discard the prefetched epoch
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ */
+void cfg_prefetch_cancel(rpki_cfg_t *cfg);
+
+/** Wait for a running prefetch, the prefetched epoch is kept until the switch
+ *  to its timestamp
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ */
+void cfg_prefetch_wait(rpki_cfg_t *cfg);
+
+/** Import the ROA dumps of a timestamp older than the current epoch into a
+ *  previous epoch (if previous epochs are kept)
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] timestamp      UTC epoch timestamp
+ * @return                   Pointer to the epoch, NULL if there are no ROA
+ *                           dumps for the timestamp or an error occurred
+ */
+validation_epoch_t *cfg_load_epoch(rpki_cfg_t *cfg, uint32_t timestamp);
+
+/** Parse a ROA file and add all records to a ROA set
  *
+ * @param[in]  roa_path      Path to the ROA file which will be parsed
+ * @param[out] set           ROA set to which the records are added
+ * @param[out] hash          Content hash of the ROA file (or NULL)
+ * @return                   0 if the parsing was successful, otherwise -1
+ */
+int cfg_parse_roa_file(char *roa_path, roa_set_t *set, uint64_t *hash);
+
+/** Parse a ROA file and import all records to a prefix table, every record
+ *  is added as soon as it was parsed (the records are collected first for the
+ *  minimization and for the cache)
+ *
+ * @param[in]  cfg           Pointer to the configuration struct
  * @param[in]  roa_file      Path to the ROA file which will be imported
  * @param[out] pfxt          Corresponding Prefix Table
+ * @param[out] hash          Content hash of the ROA file (or NULL)
  * @return                   0 if the import was successful, otherwise -1
  */
-int cfg_import_roa_file(char *roa_path, struct pfx_table *pfxt);
+int cfg_import_roa_file(rpki_cfg_t *cfg, char *roa_path,
+                        backend_table_t *pfxt, uint64_t *hash);
+
+/** Import several ROA files: with several threads the download (and
+ *  decompression), the parsing and the insertion of different ROA files run
+ *  concurrently in a pipeline and a unified prefix table is built as a
+ *  partitioned prefix table of all records (in delta mode only the difference
+ *  to the previous records is applied), without threads every ROA file is
+ *  imported while it is parsed. The prefix table of a ROA file equal to its
+ *  previous ROA file is left empty (the previous prefix table is reused), a
+ *  unified prefix table is only left empty by the pipeline if every ROA file
+ *  is unchanged
+ *
+ * @param[in]  cfg           Pointer to the configuration struct
+ * @param[in]  roa_paths     Paths to the ROA files which will be imported
+ * @param[out] pfxts         Prefix Table of every ROA file (unified mode: all
+ *                           ROA files share the first Prefix Table)
+ * @param[in,out] hashes     Content hash of the previous ROA file (0 if it is
+ *                           unknown) and of the imported ROA file (or NULL)
+ * @param[in]  count         Number of ROA files
+ * @return                   0 if the import was successful, otherwise -1
+ */
+int cfg_import_roa_files(rpki_cfg_t *cfg, char **roa_paths,
+                         backend_table_t **pfxts, uint64_t *hashes, int count);
+
+/** Minimize a ROA set of a ROA file if the minimization is enabled
+ *
+ * @param[in]     cfg        Pointer to the configuration struct
+ * @param[in,out] set        ROA set which will be minimized
+ */
+void cfg_minimize_roa_set(rpki_cfg_t *cfg, roa_set_t *set);
 
 /** Add an ROA record of a ROA file to the prefix table
  *
@@ -237,4 +599,28 @@ int cfg_import_roa_file(char *roa_path, struct pfx_table *pfxt);
 int cfg_add_record_to_pfx_table(uint32_t asn, char *address, uint8_t min_len,
                                 uint8_t max_len, struct pfx_table *pfxt);
 
+/** Add an ROA record of a ROA file to a backend prefix table
+ *
+ * @param[in]  asn           ASN value of the ROA record
+ * @param[in]  address       IP adress of the prefix of the ROA record
+ * @param[in]  min_len       Min length of the prefix of the ROA record
+ * @param[in]  max_len       Max length of the prefix of the ROA record
+ * @param[out] pfxt          Backend prefix table to which the record is added
+ * @return                   0 if the add-process was valid, otherwise -1
+ */
+int cfg_add_record_to_table(uint32_t asn, char *address, uint8_t min_len,
+                            uint8_t max_len, backend_table_t *pfxt);
+
+/** Add an ROA record of a ROA file to a ROA set
+ *
+ * @param[in]  asn           ASN value of the ROA record
+ * @param[in]  address       IP adress of the prefix of the ROA record
+ * @param[in]  min_len       Min length of the prefix of the ROA record
+ * @param[in]  max_len       Max length of the prefix of the ROA record
+ * @param[out] set           ROA set to which the record is added
+ * @return                   0 if the add-process was valid, otherwise -1
+ */
+int cfg_add_record_to_roa_set(uint32_t asn, char *address, uint8_t min_len,
+                              uint8_t max_len, roa_set_t *set);
+
 #endif /* __CONFIG_H */
@@ -35,42 +35,61 @@
 
 void utils_broker_print_debug(rpki_cfg_t *cfg)
 {
-  uint64_t key1;
-  char *val;
-  debug_print("%s", "\n----------- Broker Khash -------------------\n");
-  kh_foreach(cfg->cfg_broker.broker_kh, key1, val, 
-  debug_print("Key: %"PRIu64", Value: %s\n", key1, val));
+  /* The ROA URLs are only rendered in debug mode */
+  if (!DEBUG_TEST) {
+    return;
+  }
+  broker_index_t *index = &cfg->cfg_broker.index;
+  char urls[BROKER_ROA_URLS_LEN];
+  debug_print("%s", "\n----------- Broker Index -------------------\n");
+  for (size_t i = 0; i < index->count; i++) {
+    if (broker_index_urls(index, i, urls, sizeof(urls)) == 0) {
+      debug_print("Key: %"PRIu32", Value: %s\n", index->entries[i].timestamp,
+                  urls);
+    }
+  }
+  debug_print("Entries: %zu, URL templates: %i, Memory: %zu bytes\n",
+              index->count, index->templates_count,
+              broker_index_memory(index));
   debug_print("%s", "\n");
 }
 
+int utils_broker_check_response(const char *buf, size_t len)
+{
+  /* Only the beginning of a response is checked, error messages of the
+     broker and HTML pages of the web server start with their signature */
+  char head[BROKER_ERR_MSG_LEN];
+  snprintf(head, sizeof(head), "%.*s", (int)len, buf);
+  if (!strncmp(head, "Error:", strlen("Error:")) ||
+      !strncmp(head, "Malformed", strlen("Malformed"))) {
+    std_print("%s\n", head);
+    return -1;
+  }
+  if (strstr(head, "nginx") != NULL || strstr(head, "html") != NULL) {
+    std_print("%s\n", "Error: ROA-Broker does not work properly");
+    return -1;
+  }
+  return 0;
+}
+
 int utils_broker_check_url(char *broker_url, char* result, size_t size)
 {
   /* Get the broker reponse and check if it is reachable */
   io_t *json_chk_err = wandio_create(broker_url);
   if (json_chk_err == NULL) {
     std_print("ERROR: Could not open %s for reading\n", broker_url);
-    wandio_destroy(json_chk_err);
     return -1;
   }
 
-  /* Check if the broker reports errors, if so stop the process */
-  wandio_read(json_chk_err, result, size);
-  if (!strncmp(result, "Error:", strlen("Error:")) ||
-      !strncmp(result, "Malformed", strlen("Malformed"))) {
-    result[strlen(result)] = '\0';
-    std_print("%s\n", result);
-    wandio_destroy(json_chk_err);
-    return -1;
-  }
-  if (strstr (result, "nginx") != NULL || strstr (result, "html") != NULL) {
-    std_print("%s\n", "Error: ROA-Broker does not work properly");
-    wandio_destroy(json_chk_err);
+  /* The (short) response is read once and checked for errors */
+  int64_t ret = wandio_read(json_chk_err, result, size - 1);
+  wandio_destroy(json_chk_err);
+  if (ret < 0) {
+    std_print("ERROR: Could not read %s\n", broker_url);
     return -1;
   }
-  
-  wandio_destroy(json_chk_err);
-
-  return 0;
+  result[ret] = '\0';
+  return utils_broker_check_response(result, ret);
 }
 
 int utils_broker_add_projects_collectors(char* input, char* cfg_str_concat,
@@ -82,10 +101,11 @@ int utils_broker_add_projects_collectors(char* input, char* cfg_str_concat,
 
   /* Extract every input element if it's length is valid */
   int count = 0;
-  char *arg = strtok(input_cpy, del);
+  char *end_arg;
+  char *arg = strtok_r(input_cpy, del, &end_arg);
   while(arg != NULL) {
     snprintf(cfg_str[count++], MAX_INPUT_LENGTH, "%s", arg);
-    arg = strtok(NULL, del);
+    arg = strtok_r(NULL, del, &end_arg);
   }
 
   /* Concatenate all inputs and store it */
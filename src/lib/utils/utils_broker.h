@@ -40,10 +40,21 @@
  */
 void utils_broker_print_debug(rpki_cfg_t *cfg);
 
-/** Check whether the broker service URL works and throws no error message
+/** Check whether the beginning of a broker response is an error message of
+ *  the broker or an HTML page of the web server
+ *
+ * @param[in] buf              Beginning of the broker response
+ * @param[in] len              Length of the beginning
+ * @return                     0 if the response is no error, otherwise -1
+ */
+int utils_broker_check_response(const char *buf, size_t len);
+
+/** Read a short broker response (e.g. of the info URL) with a single request
+ *  and check whether it is an error message
  *
  * @param[in] broker_url       Broker request/info URL
- * @param[in] result           Buffer where the response is stored
+ * @param[out] result          Buffer where the response is stored
+ *                             (null-terminated)
  * @param[in] size             Size of the buffer
  * @return                     0 if the check process was valid, otherwise -1
  */
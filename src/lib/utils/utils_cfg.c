@@ -36,6 +36,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <arpa/inet.h>
+#include <unistd.h>
 
 #include "utils_cfg.h"
 #include "debug.h"
@@ -175,14 +176,16 @@ int utils_cfg_add_intervals(char *input, size_t input_max_size, char *del,
     return -1;
   }
   
-  /* Iterate over the intervals and parse it */
-  char *arg = strtok(input_cpy, del);
+  /* Iterate over the intervals and parse it (reentrant, the broker index is
+     also parsed in the background) */
+  char *end_arg;
+  char *arg = strtok_r(input_cpy, del, &end_arg);
   while(arg != NULL) {
     if(utils_cfg_validity_check_val(arg, &cfg_num[count++], 32) != 0) {
       std_print("%s", "Error: Min length of prefix is invalid\n");
       return -1;
     }
-    arg = strtok(NULL, del);
+    arg = strtok_r(NULL, del, &end_arg);
   }
 
   /* Concatenate all intervals and store it */
@@ -285,6 +288,158 @@ int utils_cfg_check_ssh_options(rpki_cfg_t *cfg, char* ssh_options)
   return 0;
 }
 
+int utils_cfg_check_options(rpki_cfg_t *cfg, char* options)
+{
+  if (options == NULL || !strlen(options)) {
+    return 0;
+  }
+
+  /* Check whether the option list exceeds the maximum length */
+  if (strlen(options) >= MAX_OPTIONS_LEN) {
+    std_print("%s", "Error: Options exceed maximum length\n");
+    return -1;
+  }
+  char options_cpy[MAX_OPTIONS_LEN] = {0};
+  snprintf(options_cpy, sizeof(options_cpy), "%s", options);
+
+  /* Split the options (key=value) and add every single one */
+  char *end_arg = NULL;
+  char *arg = strtok_r(options_cpy, ",", &end_arg);
+  while (arg != NULL) {
+    char *value = strchr(arg, '=');
+    if (value == NULL) {
+      std_print("Error: Option has no value: %s\n", arg);
+      return -1;
+    }
+    *value++ = '\0';
+    if (utils_cfg_add_option(cfg, utils_cfg_trim_whitespace(arg),
+                             utils_cfg_trim_whitespace(value)) != 0) {
+      return -1;
+    }
+    arg = strtok_r(NULL, ",", &end_arg);
+  }
+
+  return 0;
+}
+
+int utils_cfg_add_option(rpki_cfg_t *cfg, char* key, char* value)
+{
+  config_input_t *input = &cfg->cfg_input;
+  uint32_t val = 0;
+
+  if (!strcmp(key, OPTION_MINIMIZE) || !strcmp(key, OPTION_ARENA) ||
+      !strcmp(key, OPTION_HUGEPAGES) || !strcmp(key, OPTION_DELTA) ||
+      !strcmp(key, OPTION_PREFETCH) || !strcmp(key, OPTION_DIVERGENCE) ||
+      !strcmp(key, OPTION_SHARED)) {
+    if (!strlen(value) || utils_cfg_validity_check_val(value, &val, 32) != 0 ||
+        val > 1) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    if (!strcmp(key, OPTION_MINIMIZE)) {
+      input->minimize = val;
+    } else if (!strcmp(key, OPTION_ARENA)) {
+      input->arena = val;
+    } else if (!strcmp(key, OPTION_DELTA)) {
+      input->delta = val;
+    } else if (!strcmp(key, OPTION_PREFETCH)) {
+      input->prefetch = val;
+    } else if (!strcmp(key, OPTION_DIVERGENCE)) {
+      input->divergence = val;
+    } else if (!strcmp(key, OPTION_SHARED)) {
+      input->shared = val;
+    } else {
+      input->hugepages = val;
+    }
+  } else if (!strcmp(key, OPTION_THREADS)) {
+    if (!strlen(value) || utils_cfg_validity_check_val(value, &val, 32) != 0 ||
+        val > MAX_THREADS) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    if (!val) {
+      long cores = sysconf(_SC_NPROCESSORS_ONLN);
+      val = cores < 1 ? 1 : (cores > MAX_THREADS ? MAX_THREADS : cores);
+    }
+    input->threads = val;
+  } else if (!strcmp(key, OPTION_BACKEND) ||
+             !strcmp(key, OPTION_DIFF_BACKEND)) {
+    if (backend_get(value) == NULL || strlen(value) >= MAX_INPUT_LENGTH) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    snprintf(!strcmp(key, OPTION_BACKEND) ? input->backend
+                                          : input->diff_backend,
+             MAX_INPUT_LENGTH, "%s", value);
+  } else if (!strcmp(key, OPTION_CACHE)) {
+    if (!strlen(value) || strlen(value) >= sizeof(input->cache_dir)) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    snprintf(input->cache_dir, sizeof(input->cache_dir), "%s", value);
+  } else if (!strcmp(key, OPTION_INDEX)) {
+    if (!strlen(value) || strlen(value) >= sizeof(input->index_path)) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    snprintf(input->index_path, sizeof(input->index_path), "%s", value);
+  } else if (!strcmp(key, OPTION_SHM)) {
+    if (!strlen(value) || strlen(value) >= sizeof(input->shm_dir)) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    snprintf(input->shm_dir, sizeof(input->shm_dir), "%s", value);
+  } else if (!strcmp(key, OPTION_SHM_COUNT)) {
+    if (!strlen(value) || utils_cfg_validity_check_val(value, &val, 32) != 0 ||
+        !val) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    input->shm_count = val;
+  } else if (!strcmp(key, OPTION_CACHE_SIZE)) {
+    if (!strlen(value) || utils_cfg_validity_check_val(value, &val, 32) != 0 ||
+        !val) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    input->cache_size = val;
+  } else if (!strcmp(key, OPTION_EPOCHS)) {
+    if (!strlen(value) || utils_cfg_validity_check_val(value, &val, 32) != 0 ||
+        val > MAX_RECENT_EPOCHS) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    input->epochs = val;
+  } else if (!strcmp(key, OPTION_EPOCHS_SIZE)) {
+    if (!strlen(value) || utils_cfg_validity_check_val(value, &val, 32) != 0 ||
+        !val) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    input->epochs_size = val;
+  } else if (!strcmp(key, OPTION_EPOCH_STRIDE) ||
+             !strcmp(key, OPTION_EPOCH_BUCKET) ||
+             !strcmp(key, OPTION_WINDOW)) {
+    if (!strlen(value) || utils_cfg_validity_check_val(value, &val, 32) != 0 ||
+        !val) {
+      std_print("Error: Invalid value for option %s\n", key);
+      return -1;
+    }
+    if (!strcmp(key, OPTION_EPOCH_STRIDE)) {
+      input->epoch_stride = val;
+    } else if (!strcmp(key, OPTION_EPOCH_BUCKET)) {
+      input->epoch_bucket = val;
+    } else {
+      input->window = val;
+    }
+  } else {
+    std_print("Error: Unknown option: %s\n", key);
+    return -1;
+  }
+
+  return 0;
+}
+
 int utils_cfg_set_broker_urls(rpki_cfg_t *cfg, char* broker_url)
 {
   /* If a custom broker URL is set, use it otherwise use the default broker */
@@ -366,7 +521,9 @@ int utils_cfg_validity_check_prefix(char* prefix, char* address,
   size_t ipv6_prefix_len = INET6_ADDRSTRLEN + 4;
   char prefix_dup[ipv6_prefix_len];
   snprintf(prefix_dup, sizeof(prefix_dup), "%s", prefix);
-  char *minlen = strtok(prefix_dup, "/"); minlen = strtok(NULL, "/");
+  char *minlen_end = NULL;
+  char *minlen = strtok_r(prefix_dup, "/", &minlen_end);
+  minlen = strtok_r(NULL, "/", &minlen_end);
   if(utils_cfg_validity_check_val(minlen, min_len, 8) != 0) {
     std_print("%s", "Error: Min length of prefix is invalid\n");
     return -1;
@@ -72,6 +72,23 @@ int utils_cfg_check_flags(rpki_cfg_t *cfg, int unified, int mode);
  */
 int utils_cfg_check_ssh_options(rpki_cfg_t *cfg, char* ssh_options);
 
+/** Check whether the options are valid, if so add them
+ *
+ * @param[in] cfg              Pointer to the configuration struct
+ * @param[in] options          Passed options (key=value(,key=value)*)
+ * @return                     0 if the check process was valid, otherwise -1
+ */
+int utils_cfg_check_options(rpki_cfg_t *cfg, char* options);
+
+/** Check whether a single option is valid, if so add it
+ *
+ * @param[in] cfg              Pointer to the configuration struct
+ * @param[in] key              Name of the option
+ * @param[in] value            Value of the option
+ * @return                     0 if the check process was valid, otherwise -1
+ */
+int utils_cfg_add_option(rpki_cfg_t *cfg, char* key, char* value);
+
 /** Set the broker if a custom broker is set otherwise use the default broker
  *
  * @param[in] cfg              Pointer to the configuration struct
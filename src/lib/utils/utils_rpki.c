@@ -40,13 +40,16 @@ void utils_rpki_print_config_debug(rpki_cfg_t* cfg){
   debug_print("Collectors:      %s\n",      cfg->cfg_input.broker_collectors);
   debug_print("Unified:         %i\n",      cfg->cfg_input.unified);
   debug_print("Mode:            %i\n",      cfg->cfg_input.mode);
-  debug_print("Interval:        %s\n\n",    cfg->cfg_input.broker_intervals);
+  debug_print("Interval:        %s\n",      cfg->cfg_input.broker_intervals);
+  debug_print("Minimize:        %i\n\n",    cfg->cfg_input.minimize);
   debug_print("%s", "----------- Hashtable ----------------------\n");
-  debug_print("Khash Count:     %i\n",      cfg->cfg_broker.broker_khash_count);
+  debug_print("Index Count:     %zu\n",     cfg->cfg_broker.index.count);
   debug_print("First Timestamp: %"PRIu32"\n",cfg->cfg_time.start);
   debug_print("Last Timestamp:  %"PRIu32"\n\n",cfg->cfg_time.max_end);
   debug_print("%s", "----------- Sorted Broker Array ------------\n");
-  for(int i = 0; i < cfg->cfg_broker.broker_khash_count; i++)
-  debug_print("Url: %s\n", cfg->cfg_broker.roa_urls[i]);
+  char urls[BROKER_ROA_URLS_LEN];
+  for(size_t i = 0; DEBUG_TEST && i < cfg->cfg_broker.index.count; i++)
+  if (broker_index_urls(&cfg->cfg_broker.index, i, urls, sizeof(urls)) == 0)
+  debug_print("Url: %s\n", urls);
   debug_print("%s", "--------------------------------------------\n");
 }
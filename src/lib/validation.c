@@ -27,20 +27,190 @@
  * SOFTWARE.
  */
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <inttypes.h>
 #include <netinet/in.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "utils.h"
 #include "validation.h"
 #include "constants.h"
 #include "debug.h"
+#include "roa_parser.h"
 #include "rpki_config.h"
 #include "rtrlib/rtrlib.h"
 #include "wandio.h"
 
+/** An update of the RTR server which is not reported yet */
+typedef struct struct_validation_update_t {
+
+  /** Changed ROA record */
+  roa_record_t record;
+
+  /** Whether the record was added (1) or removed (0) */
+  int added;
+
+} validation_update_t;
+
+/** A live configuration with a change feed */
+typedef struct struct_validation_feed_t {
+
+  /** Prefix table of the RTR socket */
+  struct pfx_table *table;
+
+  /** Configuration of the prefix table */
+  rpki_cfg_t *cfg;
+
+  /** Change feed and its user data (copied for the RTRlib thread) */
+  validation_change_fp change_fp;
+  void *change_data;
+
+  /** Project and collector of the RTR server */
+  char project[MAX_INPUT_LENGTH];
+  char collector[MAX_INPUT_LENGTH];
+
+  /** Serial number of the registration of the change feed */
+  unsigned serial;
+
+  /** Whether the records of the prefix table were reported, until then the
+      updates are buffered */
+  int synced;
+
+  /** Buffered updates (while the prefix table is reported) */
+  validation_update_t *updates;
+  size_t updates_count;
+  size_t updates_size;
+
+} validation_feed_t;
+
+/* All live configurations with a change feed (the update function of the
+   RTRlib has no user data, configurations are found by their prefix table),
+   the lock is never held while a change feed is called */
+static validation_feed_t validation_feeds[MAX_LIVE_FEEDS];
+static pthread_mutex_t validation_feeds_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned validation_feeds_serial = 0;
+
+/* Report a single added or removed record to a change feed */
+static void validation_report_update(const validation_feed_t *feed,
+                                     const roa_record_t *rec, int added)
+{
+  feed->change_fp(feed->project, feed->collector, (uint32_t)time(NULL),
+                  added ? rec : NULL, added ? 1 : 0, added ? NULL : rec,
+                  added ? 0 : 1, feed->change_data);
+}
+
+/* Buffer an update until the records of the prefix table are reported (the
+   lock is held by the caller) */
+static int validation_buffer_update(validation_feed_t *feed,
+                                    const roa_record_t *rec, int added)
+{
+  if (feed->updates_count == feed->updates_size) {
+    size_t size = feed->updates_size * 2 + 16;
+    validation_update_t *updates =
+      realloc(feed->updates, size * sizeof(validation_update_t));
+    if (updates == NULL) {
+      return -1;
+    }
+    feed->updates = updates;
+    feed->updates_size = size;
+  }
+  feed->updates[feed->updates_count].record = *rec;
+  feed->updates[feed->updates_count++].added = added;
+  return 0;
+}
+
+/* Report a record of an update of the RTR server to the change feed of its
+   configuration (called by the RTRlib), updates are buffered while the
+   records of the prefix table are reported */
+static void validation_update_record(struct pfx_table *table,
+                                     const struct pfx_record record,
+                                     const bool added)
+{
+  validation_feed_t feed;
+  feed.change_fp = NULL;
+  roa_record_t rec;
+  roa_record_from_addr(record.asn, &record.prefix, record.min_len,
+                       record.max_len, &rec);
+  pthread_mutex_lock(&validation_feeds_lock);
+  for (int i = 0; i < MAX_LIVE_FEEDS; i++) {
+    validation_feed_t *cur = &validation_feeds[i];
+    if (cur->cfg == NULL || cur->table != table) {
+      continue;
+    }
+    if (cur->synced) {
+      feed = *cur;
+    } else if (validation_buffer_update(cur, &rec, added) != 0) {
+      std_print("%s", "Error: Could not buffer an update of the change feed\n");
+    }
+    break;
+  }
+  pthread_mutex_unlock(&validation_feeds_lock);
+
+  /* The change feed is called without the lock */
+  if (feed.change_fp != NULL) {
+    validation_report_update(&feed, &rec, added);
+  }
+}
+
+/* Add a record of the prefix table of the RTR socket to a ROA set */
+static void validation_table_record(const struct pfx_record *record,
+                                    void *data)
+{
+  roa_record_t rec;
+  roa_record_from_addr(record->asn, &record->prefix, record->min_len,
+                       record->max_len, &rec);
+  roa_set_add((roa_set_t *)data, &rec);
+}
+
+/* Remove a live configuration from the change feeds (the lock is held by the
+   caller) */
+static void validation_remove_feed(rpki_cfg_t *cfg)
+{
+  for (int i = 0; i < MAX_LIVE_FEEDS; i++) {
+    if (validation_feeds[i].cfg == cfg) {
+      free(validation_feeds[i].updates);
+      memset(&validation_feeds[i], 0, sizeof(validation_feed_t));
+    }
+  }
+}
+
+/* Compare two ROA records (all fields) */
+static int validation_record_cmp(const void *a, const void *b)
+{
+  return memcmp(a, b, sizeof(roa_record_t));
+}
+
+/* Apply a buffered update to the reported records of a prefix table, returns
+   whether the update changes them (updates of records which were already
+   reported with the prefix table are skipped) */
+static int validation_apply_update(roa_set_t *set,
+                                   const validation_update_t *update)
+{
+  roa_record_t *found = bsearch(&update->record, set->records, set->count,
+                                sizeof(roa_record_t), validation_record_cmp);
+  if ((found != NULL) == (update->added != 0)) {
+    return 0;
+  }
+  if (found != NULL) {
+    size_t pos = found - set->records;
+    memmove(found, found + 1, (set->count - pos - 1) * sizeof(roa_record_t));
+    set->count--;
+    return 1;
+  }
+  if (roa_set_add(set, &update->record) != 0) {
+    return 0;
+  }
+  qsort(set->records, set->count, sizeof(roa_record_t), validation_record_cmp);
+  return 1;
+}
+
 int validation_set_live_config(char *broker_collectors, rpki_cfg_t *cfg,
                           char *ssh_options)
 {
@@ -62,8 +232,9 @@ int validation_set_live_config(char *broker_collectors, rpki_cfg_t *cfg,
   snprintf(info_url, sizeof(info_url), "%s&collector=%s",
            broker->info_url, broker_collectors);
 
-  /* Check if the broker reports errors, if so stop the process */
-  char info_check_rst[BROKER_ERR_MSG_LEN] = {0}; 
+  /* Read the info response once, if the broker reports errors stop the
+     process */
+  char info_check_rst[BROKER_ERR_MSG_LEN] = {0};
   if(utils_broker_check_url(info_url, info_check_rst, BROKER_ERR_MSG_LEN) 
      != 0) {
     return -1;
@@ -142,11 +313,18 @@ struct rtr_mgr_config *validation_start_connection(rpki_cfg_t *cfg, char *host,
 
   /* Initialize the RTR manager and and wait for a synchronized state */  
   struct rtr_mgr_config *conf;
-  int ret = rtr_mgr_init(&conf, groups, 1, 30, 600, 600, NULL, NULL, NULL,NULL);
+  int ret = rtr_mgr_init(&conf, groups, 1, 30, 600, 600,
+                         validation_update_record, NULL, NULL, NULL);
   rtr_mgr_start(conf);
   while (!rtr_mgr_conf_in_sync(conf))
     sleep(1);
 
+  /* Use the prefix table of the RTR socket for all live validations */
+  if (backend_rtr_wrap(&val->live_table, rtr->pfx_table) != 0) {
+    std_print("%s", "Error: Could not set up the live prefix table\n");
+    return NULL;
+  }
+
   return conf;
 }
 
@@ -154,6 +332,9 @@ void validation_close_connection(rpki_cfg_t *cfg)
 {
   /* Close the RTR manager config (RTRlib) if it is initialized */
   config_validation_t *val = &cfg->cfg_val;
+  pthread_mutex_lock(&validation_feeds_lock);
+  validation_remove_feed(cfg);
+  pthread_mutex_unlock(&validation_feeds_lock);
   if (val->rtr_mgr_cfg != NULL) {
     rtr_mgr_stop(val->rtr_mgr_cfg);
     rtr_mgr_free(val->rtr_mgr_cfg);
@@ -173,37 +354,672 @@ void validation_close_connection(rpki_cfg_t *cfg)
   if (val->rtr_allocs[2] != NULL) {
     free(val->rtr_allocs[2]);
   }
+
+  /* Close the live prefix table (the RTRlib prefix table is not freed) */
+  backend_table_free(&val->live_table);
 }
 
-int validation_validate(rpki_cfg_t *cfg, uint32_t asn, char *prefix,
-                        uint8_t mask_len, struct pfx_table *pfxt,
-                        struct reasoned_result *reason)
+int validation_set_backend(rpki_cfg_t *cfg, char *backend, char *diff_backend)
 {
-  /* Convert the prefix in an RTRlib address */
-  struct lrtr_ip_addr pref;
-  if (lrtr_ip_str_to_addr(prefix, &pref) != 0) {
-    std_print("%s", "Error: Address not interpretable\n");
+  /* Check whether the backends exist */
+  config_validation_t *val = &cfg->cfg_val;
+  const backend_ops_t *ops = backend_get(backend);
+  const backend_ops_t *ref_ops = NULL;
+  if (ops == NULL) {
+    std_print("Error: Unknown prefix table backend: %s\n", backend);
     return -1;
   }
-  enum pfxv_state result;
-  struct pfx_record *pfx_reason = NULL;
-  unsigned int reason_len = 0;
+  if (diff_backend != NULL && strlen(diff_backend) &&
+      (ref_ops = backend_get(diff_backend)) == NULL) {
+    std_print("Error: Unknown prefix table backend: %s\n", diff_backend);
+    return -1;
+  }
+
+  /* Destroy all epochs, both epochs are rebuilt with the backend */
+  validation_free_epoch(val->epoch);
+  validation_free_epoch(val->next);
+  for (int i = 0; i < val->recent_count; i++) {
+    validation_free_epoch(val->recent[i]);
+  }
+  val->recent_count = 0;
+  val->epoch = val->next = NULL;
+  val->pfxt = NULL;
+  val->pfxt_count = 0;
+
+  val->backend = ops;
+  val->diff_backend = ref_ops;
+  if ((val->epoch = validation_create_epoch(cfg)) == NULL ||
+      (val->next = validation_create_epoch(cfg)) == NULL) {
+    return -1;
+  }
+  val->pfxt = val->epoch->pfxt;
+
+  return 0;
+}
+
+validation_epoch_t *validation_create_epoch(rpki_cfg_t *cfg)
+{
+  config_validation_t *val = &cfg->cfg_val;
+  config_input_t *input = &cfg->cfg_input;
+  validation_epoch_t *epoch = malloc(sizeof(validation_epoch_t));
+  if (epoch == NULL) {
+    std_print("%s", "Error: Could not allocate memory for the prefix tables\n");
+    return NULL;
+  }
+
+  /* Initialize all prefix tables of the epoch with the backend (the tables of
+     the delta mode are never allocated from an arena) */
+  memset(epoch, 0, sizeof(validation_epoch_t));
+  arena_init(&epoch->arena, 0, input->hugepages);
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    if (backend_table_init(&epoch->pfxt[i], val->backend, val->diff_backend,
+                           input->arena && !input->delta ? &epoch->arena
+                                                         : NULL) != 0) {
+      std_print("%s", "Error: Could not initialize the prefix tables\n");
+      validation_free_epoch(epoch);
+      return NULL;
+    }
+  }
+  return epoch;
+}
+
+void validation_free_epoch(validation_epoch_t *epoch)
+{
+  if (epoch == NULL) {
+    return;
+  }
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    backend_table_free(&epoch->pfxt[i]);
+  }
+  roa_index_close(&epoch->image);
+  arena_reset(&epoch->arena);
+  free(epoch->divergence);
+  free(epoch);
+}
+
+size_t validation_epoch_memory_usage(validation_epoch_t *epoch)
+{
+  /* Prefix tables in an arena are counted by the mapped arena */
+  size_t usage = 0;
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    usage += backend_table_memory_usage(&epoch->pfxt[i]);
+  }
+  size_t arena = arena_memory_usage(&epoch->arena);
+  return (arena > usage ? arena : usage) +
+         epoch->divergence_size * sizeof(validation_divergence_t);
+}
 
-  /* Validate the BGP record with the current state of the RTR server (Live) */
-  if(pfxt == NULL) {
-    if(pfx_table_validate_r(cfg->cfg_val.rtr_socket->pfx_table, &pfx_reason, 
-                       &reason_len, asn, &pref, mask_len, &result) == PFX_ERROR) {
-      std_print("%s\n", "Error: COuld not validate the record");
+/* Remove the least recently used epoch, the differential counters move on
+   with the current epoch */
+static validation_epoch_t *validation_evict_epoch(config_validation_t *val)
+{
+  validation_epoch_t *epoch = val->recent[--val->recent_count];
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    val->epoch->pfxt[i].lookups += epoch->pfxt[i].lookups;
+    val->epoch->pfxt[i].mismatches += epoch->pfxt[i].mismatches;
+    epoch->pfxt[i].lookups = epoch->pfxt[i].mismatches = 0;
+  }
+  epoch->timestamp = epoch->expires = 0;
+  return epoch;
+}
+
+validation_epoch_t *validation_keep_epoch(rpki_cfg_t *cfg,
+                                          validation_epoch_t *epoch)
+{
+  /* Reuse the least recently used epoch if the count is reached */
+  config_validation_t *val = &cfg->cfg_val;
+  config_input_t *input = &cfg->cfg_input;
+  validation_epoch_t *reuse = NULL;
+  if (val->recent_count >= (int)input->epochs) {
+    reuse = validation_evict_epoch(val);
+  } else if ((reuse = validation_create_epoch(cfg)) == NULL) {
+    return NULL;
+  }
+  memmove(&val->recent[1], &val->recent[0],
+          val->recent_count * sizeof(validation_epoch_t *));
+  val->recent[0] = epoch;
+  val->recent_count++;
+
+  /* Free the least recently used epochs beyond the memory budget (the most
+     recently used one is always kept) */
+  uint64_t budget = (uint64_t)input->epochs_size << 20;
+  size_t usage = 0;
+  for (int i = 0; budget && i < val->recent_count; i++) {
+    usage += validation_epoch_memory_usage(val->recent[i]);
+  }
+  while (budget && usage > budget && val->recent_count > 1) {
+    validation_epoch_t *evicted = validation_evict_epoch(val);
+    usage -= validation_epoch_memory_usage(evicted);
+    validation_free_epoch(evicted);
+  }
+  return reuse;
+}
+
+validation_epoch_t *validation_find_epoch(rpki_cfg_t *cfg, uint32_t timestamp)
+{
+  /* Move the epoch of the timestamp to the front */
+  config_validation_t *val = &cfg->cfg_val;
+  for (int i = 0; i < val->recent_count; i++) {
+    validation_epoch_t *epoch = val->recent[i];
+    if (timestamp >= epoch->timestamp && timestamp < epoch->expires) {
+      memmove(&val->recent[1], &val->recent[0],
+              i * sizeof(validation_epoch_t *));
+      val->recent[0] = epoch;
+      return epoch;
+    }
+  }
+  return NULL;
+}
+
+/* Let all prefix tables of an epoch use the records of a temporal ROA index,
+   every configured collector is mapped to its collector of the index and the
+   unified validation uses the records of all collectors in one table (a
+   cleared table is rebuilt with the backend of the configuration) */
+static int validation_wrap_index(rpki_cfg_t *cfg, validation_epoch_t *epoch,
+                                 const roa_index_t *index, int *collectors)
+{
+  config_input_t *input = &cfg->cfg_input;
+  uint32_t all = 0;
+  char name[ROA_INDEX_NAME_LEN];
+  for (int i = 0; i < input->collectors_count; i++) {
+    snprintf(name, sizeof(name), "%s:%s", input->projects[i],
+             input->collectors[i]);
+    int c = collectors[i] = roa_index_collector(index, name);
+    if (c < 0) {
+      debug_print("Info: The ROA index has no ROA dumps of %s\n", name);
+    } else {
+      all |= (1u << c);
+    }
+  }
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    int c = i < input->collectors_count ? collectors[i] : -1;
+    uint32_t mask = input->unified ? (i ? 0 : all) : (c < 0 ? 0 : (1u << c));
+    backend_table_t *tbl = &epoch->pfxt[i];
+    arena_t *arena = tbl->arena;
+    backend_table_free(tbl);
+    if (backend_index_wrap(tbl, index, mask) != 0) {
+      std_print("%s", "Error: Could not initialize the prefix tables\n");
       return -1;
     }
+    tbl->base_ops = cfg->cfg_val.backend;
+    tbl->arena = arena;
+  }
+  return 0;
+}
 
-  /* Validate the BGP record with the given prefix table (Historical) */
-  } else {
-      if(pfx_table_validate_r(pfxt, &pfx_reason, &reason_len, asn, &pref,
-                              mask_len, &result) == PFX_ERROR) {
-        std_print("%s\n", "Error: COuld not validate the record");
+int validation_set_index(rpki_cfg_t *cfg, const char *path)
+{
+  config_validation_t *val = &cfg->cfg_val;
+  if (roa_index_open(&val->index, path) != 0) {
+    return -1;
+  }
+  if ((val->index_epoch = validation_create_epoch(cfg)) == NULL) {
+    roa_index_close(&val->index);
+    return -1;
+  }
+  if (validation_wrap_index(cfg, val->index_epoch, &val->index,
+                            val->index_collectors) != 0) {
+    return -1;
+  }
+  debug_print("Loaded ROA index %s (%" PRIu64 " IPv4 and %" PRIu64
+              " IPv6 records)\n", path, val->index.header->count[ROA_IPV4],
+              val->index.header->count[ROA_IPV6]);
+  return 0;
+}
+
+int validation_image_path(rpki_cfg_t *cfg, const char *urls, char *path,
+                          size_t len)
+{
+  /* Images are named by the hash of the import settings and the ROA URLs */
+  char key[BROKER_ROA_URLS_LEN + 16];
+  int ret = snprintf(key, sizeof(key), "%i,%s", cfg->cfg_input.minimize, urls);
+  if (ret < 0 || (size_t)ret >= sizeof(key)) {
+    return -1;
+  }
+  ret = snprintf(path, len, "%s/%s%016" PRIx64 ".rix",
+                 cfg->cfg_input.shm_dir, VALIDATION_IMAGE_PREFIX,
+                 roa_parser_hash_buf(key, ret));
+  return ret < 0 || (size_t)ret >= len ? -1 : 0;
+}
+
+int validation_write_image(rpki_cfg_t *cfg, const char *path,
+                           uint32_t timestamp, const roa_set_t *sets,
+                           const int *pfxt_active, int pfxt_count)
+{
+  /* Every collector of the epoch is a collector of the image with a single
+     ROA dump (minimized like the prefix tables) */
+  config_input_t *input = &cfg->cfg_input;
+  roa_index_builder_t builder;
+  roa_index_builder_init(&builder);
+  char name[ROA_INDEX_NAME_LEN];
+  int ret = 0;
+  for (int i = 0; i < pfxt_count && !ret; i++) {
+    roa_set_t set;
+    if (!pfxt_active[i]) {
+      continue;
+    }
+    snprintf(name, sizeof(name), "%s:%s", input->projects[i],
+             input->collectors[i]);
+    int c = roa_index_builder_collector(&builder, name);
+    if (c < 0 || roa_set_copy(&sets[i], &set) != 0) {
+      ret = -1;
+      break;
+    }
+    cfg_minimize_roa_set(cfg, &set);
+    ret = roa_index_builder_add(&builder, c, timestamp, &set);
+  }
+
+  /* The image is written under a temporary name and renamed at once, other
+     processes never map an incomplete image */
+  char tmp[CACHE_MAX_PATH_LEN];
+  int len = snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+  if (!ret && (len < 0 || (size_t)len >= sizeof(tmp))) {
+    ret = -1;
+  }
+  if (!ret && roa_index_builder_write(&builder, tmp) != 0) {
+    remove(tmp);
+    ret = -1;
+  }
+  roa_index_builder_free(&builder);
+  if (!ret && rename(tmp, path) != 0) {
+    remove(tmp);
+    ret = -1;
+  }
+  if (ret != 0) {
+    std_print("Error: Could not publish the epoch image %s\n", path);
+    return -1;
+  }
+  debug_print("Published epoch image %s\n", path);
+  validation_evict_images(cfg);
+  return 0;
+}
+
+/** An epoch image of the shared memory directory */
+typedef struct struct_validation_image_t {
+
+  /** File name of the image */
+  char name[256];
+
+  /** Last publication or mapping of the image */
+  struct timespec used;
+
+} validation_image_t;
+
+/* Order epoch images by their last use, most recent first */
+static int validation_cmp_image(const void *a, const void *b)
+{
+  const struct timespec *x = &((const validation_image_t *)a)->used;
+  const struct timespec *y = &((const validation_image_t *)b)->used;
+  if (x->tv_sec != y->tv_sec) {
+    return x->tv_sec > y->tv_sec ? -1 : 1;
+  }
+  return x->tv_nsec > y->tv_nsec ? -1 : (x->tv_nsec < y->tv_nsec);
+}
+
+int validation_evict_images(rpki_cfg_t *cfg)
+{
+  const char *dir_path = cfg->cfg_input.shm_dir;
+  size_t keep = cfg->cfg_input.shm_count ? cfg->cfg_input.shm_count
+                                         : VALIDATION_IMAGE_COUNT;
+  DIR *dir = opendir(dir_path);
+  if (dir == NULL) {
+    std_print("Error: Could not open the shared memory directory %s\n",
+              dir_path);
+    return -1;
+  }
+
+  /* Collect the last use of all published images (temporary images of a
+     running publication end with the process ID and are skipped) */
+  validation_image_t *images = NULL;
+  size_t count = 0, size = 0;
+  struct dirent *ent;
+  char path[CACHE_MAX_PATH_LEN];
+  while ((ent = readdir(dir)) != NULL) {
+    size_t len = strlen(ent->d_name);
+    struct stat st;
+    if (strncmp(ent->d_name, VALIDATION_IMAGE_PREFIX,
+                strlen(VALIDATION_IMAGE_PREFIX)) ||
+        len < 4 || strcmp(ent->d_name + len - 4, ".rix") ||
+        len >= sizeof(images->name) ||
+        snprintf(path, sizeof(path), "%s/%s", dir_path, ent->d_name) >=
+          (int)sizeof(path) ||
+        stat(path, &st) != 0) {
+      continue;
+    }
+    if (count == size) {
+      size = size ? 2 * size : 64;
+      validation_image_t *tmp = realloc(images,
+                                        size * sizeof(validation_image_t));
+      if (tmp == NULL) {
+        std_print("%s", "Error: Could not allocate memory for the images\n");
+        free(images);
+        closedir(dir);
         return -1;
       }
+      images = tmp;
+    }
+    snprintf(images[count].name, sizeof(images->name), "%s", ent->d_name);
+    images[count].used = st.st_mtim;
+    count++;
+  }
+  closedir(dir);
+
+  /* Only the most recently used images are kept, processes which still map
+     an evicted image keep their mapping until the epoch is cleared */
+  int evicted = 0;
+  qsort(images, count, sizeof(validation_image_t), validation_cmp_image);
+  for (size_t i = keep; i < count; i++) {
+    int len = snprintf(path, sizeof(path), "%s/%s", dir_path, images[i].name);
+    evicted += (len < (int)sizeof(path) && unlink(path) == 0);
+  }
+  free(images);
+  if (evicted) {
+    debug_print("Evicted %i epoch images\n", evicted);
+  }
+  return evicted;
+}
+
+int validation_map_image(rpki_cfg_t *cfg, validation_epoch_t *epoch,
+                         const char *path)
+{
+  /* An image which is not published yet is imported by the caller */
+  int collectors[MAX_RPKI_COUNT];
+  if (access(path, R_OK) != 0 || roa_index_open(&epoch->image, path) != 0) {
+    return -1;
+  }
+  if (validation_wrap_index(cfg, epoch, &epoch->image, collectors) != 0) {
+    validation_clear_epoch(cfg, epoch);
+    return -1;
+  }
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    backend_index_set_timestamp(&epoch->pfxt[i], epoch->image.header->start);
+  }
+
+  /* A mapped image counts as used, it is evicted after unused images */
+  utimensat(AT_FDCWD, path, NULL, 0);
+  debug_print("Mapped epoch image %s\n", path);
+  return 0;
+}
+
+validation_epoch_t *validation_index_epoch(rpki_cfg_t *cfg, uint32_t timestamp)
+{
+  /* Only collectors with a ROA dump for the timestamp are validated */
+  config_validation_t *val = &cfg->cfg_val;
+  config_input_t *input = &cfg->cfg_input;
+  validation_epoch_t *epoch = val->index_epoch;
+  int active = 0;
+  for (int i = 0; i < input->collectors_count; i++) {
+    backend_index_set_timestamp(&epoch->pfxt[i], timestamp);
+    epoch->pfxt_active[i] = roa_index_active(&val->index,
+                                             val->index_collectors[i],
+                                             timestamp);
+    active |= epoch->pfxt_active[i];
+  }
+  epoch->pfxt_count = input->collectors_count;
+  return active ? epoch : NULL;
+}
+
+int validation_clear_epoch(rpki_cfg_t *cfg, validation_epoch_t *epoch)
+{
+  /* Without an arena every table is cleared record by record (the tables of
+     the delta mode are never allocated from an arena) */
+  config_validation_t *val = &cfg->cfg_val;
+  memset(epoch->hash, 0, sizeof(epoch->hash));
+  epoch->divergence_count = 0;
+  if (!cfg->cfg_input.arena || cfg->cfg_input.delta) {
+    for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+      if (backend_table_clear(&epoch->pfxt[i]) != 0) {
+        return -1;
+      }
+    }
+    roa_index_close(&epoch->image);
+    return 0;
+  }
+
+  /* Release the whole epoch at once and rebuild empty tables in the arena,
+     the differential counters are kept */
+  size_t lookups[MAX_RPKI_COUNT], mismatches[MAX_RPKI_COUNT];
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    lookups[i] = epoch->pfxt[i].lookups;
+    mismatches[i] = epoch->pfxt[i].mismatches;
+    backend_table_free(&epoch->pfxt[i]);
+  }
+  roa_index_close(&epoch->image);
+  arena_reset(&epoch->arena);
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    if (backend_table_init(&epoch->pfxt[i], val->backend, val->diff_backend,
+                           &epoch->arena) != 0) {
+      std_print("%s", "Error: Could not initialize the prefix tables\n");
+      return -1;
+    }
+    epoch->pfxt[i].lookups = lookups[i];
+    epoch->pfxt[i].mismatches = mismatches[i];
+  }
+  return 0;
+}
+
+/** A computation of the divergent records of an epoch */
+typedef struct struct_validation_divergence_job_t {
+
+  /** Epoch of the divergent records */
+  validation_epoch_t *epoch;
+
+  /** Bit mask of all collectors with a ROA dump */
+  uint32_t active;
+
+} validation_divergence_job_t;
+
+/* Add a merged record to the divergent records of an epoch if it is not
+   contained in the ROA dumps of all collectors */
+static int validation_divergence_record(const roa_record_t *record,
+                                        uint32_t sets, void *data)
+{
+  validation_divergence_job_t *job = (validation_divergence_job_t *)data;
+  validation_epoch_t *epoch = job->epoch;
+  if (sets == job->active) {
+    return 0;
+  }
+  if (epoch->divergence_count == epoch->divergence_size) {
+    size_t size = epoch->divergence_size ? 2 * epoch->divergence_size : 64;
+    validation_divergence_t *tmp =
+      realloc(epoch->divergence, size * sizeof(validation_divergence_t));
+    if (tmp == NULL) {
+      return -1;
+    }
+    epoch->divergence = tmp;
+    epoch->divergence_size = size;
+  }
+  validation_divergence_t *div = &epoch->divergence[epoch->divergence_count++];
+  div->record = *record;
+  div->collectors = sets;
+  return 0;
+}
+
+int validation_set_divergence(validation_epoch_t *epoch, const roa_set_t *sets,
+                              const int *pfxt_active, int pfxt_count)
+{
+  /* Collectors without a ROA dump have empty sets and are not compared */
+  validation_divergence_job_t job;
+  job.epoch = epoch;
+  job.active = 0;
+  for (int i = 0; i < pfxt_count; i++) {
+    job.active |= (pfxt_active[i] ? (uint32_t)1 << i : 0);
+  }
+  epoch->divergence_count = 0;
+  if (roa_set_merge(sets, pfxt_count, validation_divergence_record, &job)
+      != 0) {
+    std_print("%s", "Error: Could not compute the divergent records\n");
+    epoch->divergence_count = 0;
+    return -1;
+  }
+  debug_print("Divergent records: %zu\n", epoch->divergence_count);
+  return 0;
+}
+
+int validation_publish_epoch(rpki_cfg_t *cfg, int pfxt_count,
+                             const int *pfxt_active)
+{
+  /* The differential counters move on with the current epoch */
+  config_validation_t *val = &cfg->cfg_val;
+  validation_epoch_t *prev = val->epoch;
+  for (int i = 0; i < MAX_RPKI_COUNT; i++) {
+    val->next->pfxt[i].lookups += prev->pfxt[i].lookups;
+    val->next->pfxt[i].mismatches += prev->pfxt[i].mismatches;
+    prev->pfxt[i].lookups = prev->pfxt[i].mismatches = 0;
+  }
+
+  /* Swap the epochs and release the previous one, in delta mode it is kept as
+     base of the next import */
+  val->epoch = val->next;
+  val->next = prev;
+  val->pfxt = val->epoch->pfxt;
+  val->pfxt_count = val->epoch->pfxt_count = pfxt_count;
+  memcpy(val->pfxt_active, pfxt_active, sizeof(val->pfxt_active));
+  memcpy(val->epoch->pfxt_active, pfxt_active, sizeof(val->pfxt_active));
+
+  /* Keep the previous epoch for out-of-order timestamps, the next import
+     reuses an evicted epoch instead (in delta mode only the difference to
+     its records is applied) */
+  if (cfg->cfg_input.epochs && prev->timestamp &&
+      (val->next = validation_keep_epoch(cfg, prev)) == NULL) {
+    val->next = prev;
+    return -1;
+  }
+
+  return cfg->cfg_input.delta ? 0 : validation_clear_epoch(cfg, val->next);
+}
+
+int validation_set_change_feed(rpki_cfg_t *cfg, validation_change_fp change_fp,
+                               void *data)
+{
+  /* Historical mode: the change feed is used by the next published epoch, its
+     ROA dumps are compared with the ones of the last report */
+  config_validation_t *val = &cfg->cfg_val;
+  pthread_mutex_lock(&validation_feeds_lock);
+  validation_remove_feed(cfg);
+  val->change_fp = change_fp;
+  val->change_data = data;
+  for (int i = 0; change_fp == NULL && i < MAX_RPKI_COUNT; i++) {
+    roa_set_free(&val->change_sets[i]);
+  }
+  if (change_fp == NULL || val->rtr_mgr_cfg == NULL ||
+      val->rtr_socket == NULL) {
+    pthread_mutex_unlock(&validation_feeds_lock);
+    return 0;
+  }
+
+  /* Live mode: the feed is registered before the records of the prefix
+     table are read, the updates meanwhile are buffered */
+  int free_feed = -1;
+  for (int i = 0; i < MAX_LIVE_FEEDS && free_feed < 0; i++) {
+    free_feed = (validation_feeds[i].cfg == NULL ? i : -1);
+  }
+  roa_set_t set;
+  if (free_feed < 0 || roa_set_init(&set) != 0) {
+    val->change_fp = NULL;
+    pthread_mutex_unlock(&validation_feeds_lock);
+    std_print("%s", "Error: Could not set the change feed\n");
+    return -1;
+  }
+  struct pfx_table *table = val->rtr_socket->pfx_table;
+  validation_feed_t *slot = &validation_feeds[free_feed];
+  slot->table = table;
+  slot->cfg = cfg;
+  slot->change_fp = change_fp;
+  slot->change_data = data;
+  snprintf(slot->project, sizeof(slot->project), "%s",
+           cfg->cfg_input.projects[0]);
+  snprintf(slot->collector, sizeof(slot->collector), "%s",
+           cfg->cfg_input.collectors[0]);
+  slot->serial = ++validation_feeds_serial;
+  validation_feed_t feed = *slot;
+  pthread_mutex_unlock(&validation_feeds_lock);
+
+  /* The records of the prefix table are reported at once, the buffered
+     updates afterwards (the lock is released for every call of the feed) */
+  pfx_table_for_each_ipv4_record(table, validation_table_record, &set);
+  pfx_table_for_each_ipv6_record(table, validation_table_record, &set);
+  qsort(set.records, set.count, sizeof(roa_record_t), validation_record_cmp);
+  if (set.count) {
+    change_fp(feed.project, feed.collector, (uint32_t)time(NULL), set.records,
+              set.count, NULL, 0, data);
+  }
+  while (1) {
+    pthread_mutex_lock(&validation_feeds_lock);
+    if (slot->cfg != cfg || slot->serial != feed.serial) {
+      pthread_mutex_unlock(&validation_feeds_lock);
+      break;
+    }
+    validation_update_t *updates = slot->updates;
+    size_t count = slot->updates_count;
+    slot->updates = NULL;
+    slot->updates_count = slot->updates_size = 0;
+    slot->synced = !count;
+    pthread_mutex_unlock(&validation_feeds_lock);
+    for (size_t i = 0; i < count; i++) {
+      if (validation_apply_update(&set, &updates[i])) {
+        validation_report_update(&feed, &updates[i].record, updates[i].added);
+      }
+    }
+    free(updates);
+    if (!count) {
+      break;
+    }
+  }
+  roa_set_free(&set);
+  return 0;
+}
+
+int validation_report_changes(rpki_cfg_t *cfg, uint32_t timestamp,
+                              roa_set_t *sets, const int *pfxt_active,
+                              int pfxt_count)
+{
+  /* Compare the ROA set of every collector with its previous one (the first
+     ROA dump of a collector is reported as added) */
+  config_validation_t *val = &cfg->cfg_val;
+  int ret = 0;
+  for (int i = 0; i < pfxt_count; i++) {
+    if (!pfxt_active[i]) {
+      continue;
+    }
+    roa_set_t added, removed;
+    memset(&added, 0, sizeof(added));
+    memset(&removed, 0, sizeof(removed));
+    if (val->change_fp != NULL && !ret &&
+        roa_set_diff(&val->change_sets[i], &sets[i], &added, &removed) != 0) {
+      std_print("%s", "Error: Could not compute the ROA changes\n");
+      ret = -1;
+    } else if (val->change_fp != NULL && (added.count || removed.count)) {
+      val->change_fp(cfg->cfg_input.projects[i], cfg->cfg_input.collectors[i],
+                     timestamp, added.records, added.count, removed.records,
+                     removed.count, val->change_data);
+    }
+    roa_set_free(&added);
+    roa_set_free(&removed);
+    roa_set_free(&val->change_sets[i]);
+    val->change_sets[i] = sets[i];
+    memset(&sets[i], 0, sizeof(sets[i]));
+  }
+  return ret;
+}
+
+int validation_validate(rpki_cfg_t *cfg, uint32_t asn,
+                        const struct lrtr_ip_addr *prefix,
+                        uint8_t mask_len, backend_table_t *pfxt,
+                        struct reasoned_result *reason)
+{
+  enum pfxv_state result;
+  struct pfx_record *pfx_reason = NULL;
+  unsigned int reason_len = 0;
+
+  /* Validate the BGP record with the current state of the RTR server (Live)
+     or with the given prefix table (Historical) */
+  backend_table_t *tbl = (pfxt == NULL ? &cfg->cfg_val.live_table : pfxt);
+  if (tbl->ops == NULL ||
+      backend_table_lookup_with_reasons(tbl, asn, prefix, mask_len, &pfx_reason,
+                                        &reason_len, &result) != 0) {
+    std_print("%s\n", "Error: COuld not validate the record");
+    return -1;
   }
 
   /* Return the RTRlib reasons for the validation */
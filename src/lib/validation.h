@@ -30,17 +30,215 @@
 #ifndef __VALIDATION_H
 #define __VALIDATION_H
 
+#include <stddef.h>
+
+#include "backend.h"
 #include "constants.h"
 #include "rtrlib/rtrlib.h"
 
+/** A record which is not contained in the ROA dumps of all collectors */
+typedef struct struct_validation_divergence_t {
+
+  /** ROA record
+   *
+   * Record of the ROA dumps of some collectors (canonical)
+   */
+  roa_record_t record;
+
+  /** Collectors
+   *
+   * Bit mask of the collectors whose ROA dump contains the record (bit i =
+   * i-th configured collector)
+   */
+  uint32_t collectors;
+
+} validation_divergence_t;
+
+/** Prefix tables of an epoch (all ROA dumps of a timestamp) */
+typedef struct struct_validation_epoch_t {
+
+  /** Prefix tables
+   *
+   * Prefix tables of all collectors of the epoch
+   */
+  backend_table_t pfxt[MAX_RPKI_COUNT];
+
+  /** Epoch arena
+   *
+   * Arena of all prefix tables of the epoch (if enabled)
+   */
+  arena_t arena;
+
+  /** ROA dump hashes
+   *
+   * Content hash of the ROA dump of every collector (0 = no ROA dump)
+   */
+  uint64_t hash[MAX_RPKI_COUNT];
+
+  /** ROA timestamp
+   *
+   * Timestamp of the first ROA dumps of the epoch (0 = not published yet)
+   */
+  uint32_t timestamp;
+
+  /** Expiry timestamp
+   *
+   * First timestamp the epoch is outdated (next ROA dumps or a gap)
+   */
+  uint32_t expires;
+
+  /** Prefix table count
+   *
+   * Number of prefix tables used for unified or discrete validation
+   */
+  int pfxt_count;
+
+  /** Active prefix table flags (existing ROA files)
+   *
+   * Whether a collector has a matching ROA file and prefix table
+   */
+  int pfxt_active[MAX_RPKI_COUNT];
+
+  /** Divergent records
+   *
+   * Records which are not contained in the ROA dumps of all collectors of
+   * the epoch, sorted (divergence option)
+   */
+  validation_divergence_t *divergence;
+
+  /** Divergent record count
+   *
+   * Number of divergent records
+   */
+  size_t divergence_count;
+
+  /** Divergent record size
+   *
+   * Number of allocated divergent records
+   */
+  size_t divergence_size;
+
+  /** Epoch image
+   *
+   * Mapped epoch image of another process the prefix tables read from (shm
+   * option, not mapped otherwise)
+   */
+  roa_index_t image;
+
+} validation_epoch_t;
+
+/** Function called with the ROA records of a collector which changed with an
+ *  epoch (historical mode) or an update of the RTR server (live mode)
+ *
+ * @param[in] project        Project of the collector
+ * @param[in] collector      Collector of the ROA records
+ * @param[in] timestamp      ROA timestamp of the epoch (live mode: time of the
+ *                           update)
+ * @param[in] added          Added ROA records
+ * @param[in] added_count    Number of added ROA records
+ * @param[in] removed        Removed ROA records
+ * @param[in] removed_count  Number of removed ROA records
+ * @param[in] data           User data passed with the change feed
+ */
+typedef void (*validation_change_fp)(const char *project, const char *collector,
+                                     uint32_t timestamp,
+                                     const roa_record_t *added,
+                                     size_t added_count,
+                                     const roa_record_t *removed,
+                                     size_t removed_count, void *data);
+
 /** A RPKI config for RTRLib object */
 typedef struct struct_config_validation_t {
 
   /** All prefix tables for the current RPKI elem
    *
-   * Prefix-tables used for unified or discrete validation
+   * Prefix-tables used for unified or discrete validation (of the current
+   * epoch)
+   */
+  backend_table_t *pfxt;
+
+  /** Current epoch
+   *
+   * Epoch whose prefix tables are used for the validation
+   */
+  validation_epoch_t *epoch;
+
+  /** Next epoch
+   *
+   * Epoch the ROA dumps are imported into before it is published
+   */
+  validation_epoch_t *next;
+
+  /** Recent epochs
+   *
+   * Previous epochs kept for out-of-order timestamps (most recently used
+   * first)
+   */
+  validation_epoch_t *recent[MAX_RECENT_EPOCHS];
+
+  /** Recent epoch count
+   *
+   * Number of previous epochs kept
+   */
+  int recent_count;
+
+  /** Temporal ROA index
+   *
+   * Index of the ROA dumps of an archive interval (historical mode)
+   */
+  roa_index_t index;
+
+  /** Index epoch
+   *
+   * Prefix tables of the configured collectors backed by the temporal ROA
+   * index (NULL = no index)
+   */
+  validation_epoch_t *index_epoch;
+
+  /** Index collectors
+   *
+   * Collector of the temporal ROA index per configured collector (-1 = not
+   * indexed)
+   */
+  int index_collectors[MAX_RPKI_COUNT];
+
+  /** Change feed
+   *
+   * Function called with the changed ROA records of every collector (NULL =
+   * no change feed)
+   */
+  validation_change_fp change_fp;
+
+  /** Change feed data
+   *
+   * User data passed to the change feed
+   */
+  void *change_data;
+
+  /** Change feed ROA sets
+   *
+   * Canonical ROA set of the last ROA dump of every collector the next ROA
+   * dump is compared with (historical)
+   */
+  roa_set_t change_sets[MAX_RPKI_COUNT];
+
+  /** Prefix table backend
+   *
+   * Backend of all prefix tables (historical)
    */
-  struct pfx_table *pfxt;
+  const backend_ops_t *backend;
+
+  /** Reference backend
+   *
+   * Backend all lookups are compared with (differential mode, otherwise NULL)
+   */
+  const backend_ops_t *diff_backend;
+
+  /** Live prefix table
+   *
+   * Prefix table of the RTR socket (live)
+   */
+  backend_table_t live_table;
 
   /** Prefix table count
    *
@@ -54,6 +252,18 @@ typedef struct struct_config_validation_t {
    */
   int pfxt_active[MAX_RPKI_COUNT];
 
+  /** Parsed ROA records
+   *
+   * Number of ROA records parsed from all imported ROA dumps
+   */
+  size_t roa_records_parsed;
+
+  /** Imported ROA records
+   *
+   * Number of ROA records added to the prefix tables (after minimization)
+   */
+  size_t roa_records_imported;
+
   /** RTR manager configuration of the RTRLib
    *
    * Pointer to the RTR manager configuration of the RTRLib
@@ -147,19 +357,200 @@ struct rtr_mgr_config *validation_start_connection(rpki_cfg_t *cfg, char *host,
  */
 void validation_close_connection(rpki_cfg_t *cfg);
 
+/** Set the backend of all prefix tables and (re)initialize them
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] backend        Name of the backend (NULL for the default backend)
+ * @param[in] diff_backend   Name of the reference backend for the differential
+ *                           mode (NULL to disable the differential mode)
+ * @return                   0 if the backend was set, otherwise -1
+ */
+int validation_set_backend(rpki_cfg_t *cfg, char *backend, char *diff_backend);
+
+/** Remove all records of all prefix tables of an epoch before it is reused
+ *  (the epoch arena is released at once if enabled)
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] epoch          Epoch which will be cleared
+ * @return                   0 if all prefix tables were cleared, otherwise -1
+ */
+int validation_clear_epoch(rpki_cfg_t *cfg, validation_epoch_t *epoch);
+
+/** Allocate an epoch with empty prefix tables of the configured backend
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @return                   Pointer to the epoch, NULL if an error occurred
+ */
+validation_epoch_t *validation_create_epoch(rpki_cfg_t *cfg);
+
+/** Free an epoch and all of its prefix tables
+ *
+ * @param[in] epoch          Epoch which will be freed (or NULL)
+ */
+void validation_free_epoch(validation_epoch_t *epoch);
+
+/** Get the memory usage of all prefix tables of an epoch
+ *
+ * @param[in] epoch          Pointer to the epoch
+ * @return                   Memory usage in bytes
+ */
+size_t validation_epoch_memory_usage(validation_epoch_t *epoch);
+
+/** Keep an epoch as most recently used previous epoch, the least recently
+ *  used epochs are evicted beyond the count or the memory budget
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] epoch          Epoch which will be kept
+ * @return                   An evicted epoch (not cleared) or a new epoch to
+ *                           reuse, NULL if an error occurred
+ */
+validation_epoch_t *validation_keep_epoch(rpki_cfg_t *cfg,
+                                          validation_epoch_t *epoch);
+
+/** Find the previous epoch of a timestamp and mark it as most recently used
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] timestamp      UTC epoch timestamp
+ * @return                   Pointer to the epoch, NULL if none is kept
+ */
+validation_epoch_t *validation_find_epoch(rpki_cfg_t *cfg, uint32_t timestamp);
+
+/** Load a temporal ROA index whose records are used for all timestamps
+ *  instead of the epochs
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] path           Path of the index (local file)
+ * @return                   0 if the index was loaded, otherwise -1
+ */
+int validation_set_index(rpki_cfg_t *cfg, const char *path);
+
+/** Get the path of the epoch image of the ROA dumps of an epoch in the shared
+ *  memory directory (shm option)
+ *
+ * @param[in]  cfg           Pointer to the configuration struct
+ * @param[in]  urls          ROA URLs of the epoch (delimiter: ",")
+ * @param[out] path          Path of the epoch image
+ * @param[in]  len           Size of the path buffer
+ * @return                   0 if the path fits the buffer, otherwise -1
+ */
+int validation_image_path(rpki_cfg_t *cfg, const char *urls, char *path,
+                          size_t len);
+
+/** Publish the ROA sets of an imported epoch as epoch image (a temporal ROA
+ *  index with a single ROA dump per collector) for other processes
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] path           Path of the epoch image
+ * @param[in] timestamp      ROA timestamp of the epoch
+ * @param[in] sets           ROA set of every collector (not minimized)
+ * @param[in] pfxt_active    Whether a collector has a ROA dump
+ * @param[in] pfxt_count     Number of collectors
+ * @return                   0 if the image was published, otherwise -1
+ */
+int validation_write_image(rpki_cfg_t *cfg, const char *path,
+                           uint32_t timestamp, const roa_set_t *sets,
+                           const int *pfxt_active, int pfxt_count);
+
+/** Remove all but the most recently published or mapped epoch images of the
+ *  shared memory directory (shm_count option), processes which still map a
+ *  removed image keep it until the epoch is cleared
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @return                   Number of removed images, -1 on failure
+ */
+int validation_evict_images(rpki_cfg_t *cfg);
+
+/** Let the prefix tables of an epoch use a published epoch image (mapped
+ *  read-only until the epoch is cleared, the image counts as used)
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] epoch          Pointer to the epoch
+ * @param[in] path           Path of the epoch image
+ * @return                   0 if the image was mapped, -1 if there is none
+ */
+int validation_map_image(rpki_cfg_t *cfg, validation_epoch_t *epoch,
+                         const char *path);
+
+/** Get the prefix tables of the temporal ROA index for a timestamp
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] timestamp      UTC epoch timestamp
+ * @return                   Pointer to the index epoch, NULL if no configured
+ *                           collector has a ROA dump for the timestamp
+ */
+validation_epoch_t *validation_index_epoch(rpki_cfg_t *cfg, uint32_t timestamp);
+
+/** Compute the divergent records of an epoch with a single k-way merge of
+ *  the ROA dumps of all collectors with a ROA dump
+ *
+ * @param[in] epoch          Epoch of the ROA dumps
+ * @param[in] sets           Canonical ROA set of every collector
+ * @param[in] pfxt_active    Whether a collector has a ROA dump in the epoch
+ * @param[in] pfxt_count     Number of collectors of the epoch
+ * @return                   0 if the records were computed, otherwise -1
+ */
+int validation_set_divergence(validation_epoch_t *epoch, const roa_set_t *sets,
+                              const int *pfxt_active, int pfxt_count);
+
+/** Publish the imported next epoch as the current epoch at once, the
+ *  previous epoch is cleared and becomes the next epoch (or is kept for
+ *  out-of-order timestamps)
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] pfxt_count     Number of prefix tables of the next epoch
+ * @param[in] pfxt_active    Active prefix table flags of the next epoch
+ * @return                   0 if the epoch was published, otherwise -1
+ */
+int validation_publish_epoch(rpki_cfg_t *cfg, int pfxt_count,
+                             const int *pfxt_active);
+
+/** Set the change feed of a configuration, in live mode the records of the
+ *  prefix table of the RTR socket are reported as added at once, updates of
+ *  the RTR server meanwhile are buffered and reported afterwards
+ *
+ *  The change feed is called without internal locks, but it must not set a
+ *  change feed or close the connection itself (no re-entry)
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] change_fp      Function called with the changed ROA records of
+ *                           every collector (NULL to disable the change feed)
+ * @param[in] data           User data passed to the change feed
+ * @return                   0 if the change feed was set, otherwise -1
+ */
+int validation_set_change_feed(rpki_cfg_t *cfg, validation_change_fp change_fp,
+                               void *data);
+
+/** Report the changed ROA records of all collectors with a ROA dump in an
+ *  epoch to the change feed, the ROA sets replace the previous ones of the
+ *  collectors (collectors without a ROA dump keep their previous ROA set)
+ *
+ * @param[in] cfg            Pointer to the configuration struct
+ * @param[in] timestamp      ROA timestamp of the epoch
+ * @param[in] sets           Canonical ROA set of every collector (the
+ *                           ownership of the ROA sets is taken)
+ * @param[in] pfxt_active    Whether a collector has a ROA dump in the epoch
+ * @param[in] pfxt_count     Number of collectors of the epoch
+ * @return                   0 if the changes were reported, otherwise -1
+ */
+int validation_report_changes(rpki_cfg_t *cfg, uint32_t timestamp,
+                              roa_set_t *sets, const int *pfxt_active,
+                              int pfxt_count);
+
 /** Validate the origin of a BGP-Route and returns the reason for the validation
  *  result (Live- and Historical-Validation)
  *
  * @param[in]  cfg           Pointer to the configuration struct
  * @param[in]  asn           Origin ASN of the prefix
- * @param[in]  prefix        Announced network prefix
+ * @param[in]  prefix        Address of the announced network prefix
  * @param[in]  mask_len      Length of the network mask of the announced prefix
- * @param[in]  pfxt          Pointer to the prefix Tables (Historical)
+ * @param[in]  pfxt          Pointer to the prefix Tables (Historical), NULL for
+ *                           the prefix table of the RTR socket (Live)
  * @param[out] reason        Result of the validation and the reason
  * @return                   0 if the validation process was valid, otherwise -1
  */
-int validation_validate(rpki_cfg_t *cfg, uint32_t asn, char *prefix,
-                        uint8_t mask_len, struct pfx_table *pfxt,
+int validation_validate(rpki_cfg_t *cfg, uint32_t asn,
+                        const struct lrtr_ip_addr *prefix,
+                        uint8_t mask_len, backend_table_t *pfxt,
                         struct reasoned_result *reason);
 
 /** @} */
@@ -31,10 +31,20 @@
 #define __ROAFETCHLIB_H
 
 #include "lib/broker.h"
+#include "lib/broker_index.h"
 #include "lib/constants.h"
 #include "lib/elem.h"
 #include "lib/validation.h"
 #include "lib/khash.h"
+#include "lib/arena.h"
+#include "lib/backend.h"
+#include "lib/cache.h"
+#include "lib/registry.h"
+#include "lib/roa_index.h"
+#include "lib/roa_parser.h"
+#include "lib/roa_scan.h"
+#include "lib/roa_set.h"
+#include "lib/roa_snapshot.h"
 #include "lib/rpki_config.h"
 #include "rpki.h"
 
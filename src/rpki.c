@@ -38,6 +38,7 @@
 #include "utils.h"
 #include "broker.h"
 #include "debug.h"
+#include "roa_parser.h"
 #include "validation.h"
 #include "rpki.h"
 #include "rtrlib/rtrlib.h"
@@ -45,6 +46,15 @@
 rpki_cfg_t *rpki_set_config(char *project_collectors, char *time_intervals,
                             int unified, int mode, char *broker_url,
                             char *ssh_options)
+{
+  return rpki_set_config_opts(project_collectors, time_intervals, unified, mode,
+                              broker_url, ssh_options, NULL);
+}
+
+rpki_cfg_t *rpki_set_config_opts(char *project_collectors,
+                                 char *time_intervals, int unified, int mode,
+                                 char *broker_url, char *ssh_options,
+                                 char *options)
 {
   /* Create the configuration */
   rpki_cfg_t *cfg;
@@ -54,8 +64,31 @@ rpki_cfg_t *rpki_set_config(char *project_collectors, char *time_intervals,
     exit(-1);
   }
 
-  /* Configuration of live mode */
+  /* Check and add the additional options */
+  if (utils_cfg_check_options(cfg, options) != 0) {
+    rpki_destroy_config(cfg);
+    exit(-1);
+  }
+
+  /* Set up the prefix tables with the configured backend */
   config_input_t *input = &cfg->cfg_input;
+  if ((strlen(input->backend) || strlen(input->diff_backend) ||
+       input->arena) &&
+      validation_set_backend(cfg, input->backend, input->diff_backend) != 0) {
+    rpki_destroy_config(cfg);
+    exit(-1);
+  }
+
+  /* Set up the local cache of ROA dumps and broker responses */
+  uint64_t cache_size = input->cache_size ? input->cache_size
+                                          : CACHE_DEFAULT_SIZE;
+  if (strlen(input->cache_dir) &&
+      cache_init(&cfg->cache, input->cache_dir, cache_size << 20) != 0) {
+    rpki_destroy_config(cfg);
+    exit(-1);
+  }
+
+  /* Configuration of live mode */
   if (!mode) {
     debug_print("%s", "Info: For Live RPKI Validation only the first collector "
                       "will be taken\n");
@@ -67,9 +100,20 @@ rpki_cfg_t *rpki_set_config(char *project_collectors, char *time_intervals,
     return cfg;
   }
 
-  /* Configuration of historical mode */
-  if (broker_connect(cfg, input->broker_collectors, input->broker_intervals) 
-      != 0) {
+  /* Configuration of historical mode, a temporal ROA index replaces the
+     ROA dumps of the broker */
+  if (strlen(input->index_path)) {
+    if (validation_set_index(cfg, input->index_path) != 0) {
+      rpki_destroy_config(cfg);
+      exit(-1);
+    }
+    utils_rpki_print_config_debug(cfg);
+    return cfg;
+  }
+  /* The broker index is fetched at once or in windows */
+  if ((input->window ? broker_window_init(cfg)
+                     : broker_connect(cfg, input->broker_collectors,
+                                      input->broker_intervals)) != 0) {
     rpki_destroy_config(cfg);
     exit(-1);
   }
@@ -77,9 +121,93 @@ rpki_cfg_t *rpki_set_config(char *project_collectors, char *time_intervals,
   return cfg;
 }
 
+/* Whether a timestamp is in one of the configured time intervals */
+static int rpki_in_intervals(rpki_cfg_t *cfg, uint32_t timestamp)
+{
+  int check = 0;
+  config_input_t *input = &cfg->cfg_input;
+  for (int i = 0; i < input->intervals_count; i = i + 2) {
+    if ((timestamp >= input->intervals[i] &&
+         timestamp <= input->intervals[i + 1]) ||
+        (timestamp >= input->intervals[i] && input->intervals[i + 1] == 0)) {
+      check = 1;
+    }
+  }
+  if (!check) {
+    debug_err_print("%s%" PRIu32 "%s\n", "Error: The timestamp: ", timestamp,
+                    " is not in the configuration time interval\n");
+  }
+  return check;
+}
+
+/* Import the epoch of the ROA timestamp preceding a timestamp */
+static int rpki_load_epoch(rpki_cfg_t *cfg, uint32_t timestamp)
+{
+  char current_urls[BROKER_ROA_URLS_LEN] = {0};
+  if (cfg_get_timestamps(cfg, timestamp, current_urls)) {
+    debug_err_print("%s", "Error: Could not find current and next timestamp");
+    return -1;
+  }
+  if (cfg_switch_epoch(cfg, cfg->cfg_time.current_roa_timestamp,
+                       current_urls) != 0) {
+    return -1;
+  }
+  debug_print("Current ROA Timestamp: %" PRIu32 "\n",
+              cfg->cfg_time.current_roa_timestamp);
+  debug_print("Next ROA Timestamp:    %" PRIu32 "\n",
+              cfg->cfg_time.next_roa_timestamp);
+  return 0;
+}
+
+int rpki_warmup(rpki_cfg_t *cfg, uint32_t timestamp)
+{
+  /* Nothing to preload in live mode, with a temporal ROA index or if an
+     epoch was already imported */
+  config_time_t *cfg_time = &cfg->cfg_time;
+  if (!cfg->cfg_input.mode || cfg->cfg_val.index_epoch != NULL ||
+      cfg_time->current_roa_timestamp || cfg_time->next_roa_timestamp) {
+    return 0;
+  }
+  if (!rpki_in_intervals(cfg, timestamp) ||
+      (!cfg->cfg_broker.index.count &&
+       !cfg->cfg_broker.window.running)) {
+    return -1;
+  }
+
+  /* Import the first epoch (and prefetch the next one) */
+  return rpki_load_epoch(cfg, timestamp);
+}
+
+/* Validate with a previous epoch or the epoch of the temporal ROA index, the
+   collectors of the epoch are used for the result */
+static int rpki_validate_epoch(rpki_cfg_t *cfg, validation_epoch_t *epoch,
+                               elem_t *elem, const struct lrtr_ip_addr *addr,
+                               uint32_t asn, uint8_t mask_len, char *result,
+                               size_t size)
+{
+  int ret = 0;
+  for (int i = 0; i < epoch->pfxt_count && !ret; i++) {
+    ret = elem_get_rpki_validation_result_epoch(cfg, NULL, elem, addr, asn,
+                                                mask_len, &epoch->pfxt[i], i,
+                                                epoch->pfxt_active);
+  }
+  if (!ret) {
+    elem_get_rpki_validation_result_snprintf_epoch(cfg, result, size, elem,
+                                                   epoch->pfxt_count);
+  }
+  return ret;
+}
+
 int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
                   char *prefix, uint8_t mask_len, char *result, size_t size)
 {
+  /* Convert the prefix once for all prefix tables */
+  struct lrtr_ip_addr addr;
+  if (roa_parser_addr(prefix, strlen(prefix), &addr) != 0) {
+    std_print("%s", "Error: Address not interpretable\n");
+    return -1;
+  }
+
   elem_t *elem;
   if ((elem = elem_create()) == NULL) {
     debug_err_print("%s", "Error: Could not allocate memory for RPKI elem\n");
@@ -89,7 +217,7 @@ int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
   /* Validate with live mode -> if the flag is set */
   config_validation_t *val = &cfg->cfg_val;
   if (!cfg->cfg_input.mode && val->rtr_mgr_cfg != NULL) {
-    if(elem_get_rpki_validation_result(cfg, val->rtr_mgr_cfg, elem, prefix, asn,
+    if(elem_get_rpki_validation_result(cfg, val->rtr_mgr_cfg, elem, &addr, asn,
                                        mask_len, NULL, 0) != 0) {
       return -1;
     }
@@ -100,25 +228,42 @@ int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
   }
 
   /* No validation if the timestamp is not in the time interval */
-  int check = 0;
   config_input_t *input = &cfg->cfg_input;
-  for (int i = 0; i < input->intervals_count; i = i + 2) {
-    if ((timestamp >= input->intervals[i] &&
-         timestamp <= input->intervals[i + 1]) ||
-        (timestamp >= input->intervals[i] && input->intervals[i + 1] == 0)) {
-      check = 1;
-    }
-  }
-  if (!check) {
-    debug_err_print("%s%" PRIu32 "%s\n", "Error: The timestamp: ", timestamp,
-                    " is not in the configuration time interval\n");
+  if (!rpki_in_intervals(cfg, timestamp)) {
     elem_destroy(elem);
     return -1;
   }
 
-  /* No validation if the timestamp is older than the current ROA timestamp */
+  /* Validate with the temporal ROA index -> no epoch is imported */
+  if (input->mode && val->index_epoch != NULL) {
+    validation_epoch_t *epoch = validation_index_epoch(cfg, timestamp);
+    int ret = 0;
+    if (epoch != NULL) {
+      ret = rpki_validate_epoch(cfg, epoch, elem, &addr, asn, mask_len, result,
+                                size);
+    } else {
+      debug_err_print("Info: No ROA dumps in the index for the timestamp %"
+                      PRIu32 "\n", timestamp);
+      snprintf(result, size, "%s", "");
+    }
+    elem_destroy(elem);
+    return ret;
+  }
+
+  /* Validate a timestamp older than the current ROA timestamp with a previous
+     epoch (kept or loaded on demand), otherwise no validation */
   config_time_t *cfg_time = &cfg->cfg_time;
   if (input->mode && timestamp < cfg_time->current_roa_timestamp) {
+    validation_epoch_t *epoch = validation_find_epoch(cfg, timestamp);
+    if (epoch == NULL) {
+      epoch = cfg_load_epoch(cfg, timestamp);
+    }
+    if (epoch != NULL) {
+      int ret = rpki_validate_epoch(cfg, epoch, elem, &addr, asn, mask_len,
+                                    result, size);
+      elem_destroy(elem);
+      return ret;
+    }
     debug_err_print("Info: No ROA dumps for the interval %" PRIu32
                     " - next available timestamp: %" PRIu32 "\n",
                     timestamp, cfg_time->current_roa_timestamp);
@@ -127,8 +272,9 @@ int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
     return 0;
   }
 
-  /* No validation if no ROA entries exist for the time interval */
-  if (!cfg->cfg_broker.broker_khash_count) {
+  /* No validation if no ROA entries exist for the time interval (later
+     windows of the broker index may have some) */
+  if (!cfg->cfg_broker.index.count && !cfg->cfg_broker.window.running) {
     elem_destroy(elem);
     return -1;
   }
@@ -136,26 +282,29 @@ int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
   /* If the current timestamp is empty -> get it, parse URLs and import ROAs */
   char current_urls[BROKER_ROA_URLS_LEN] = {0};
   if (!cfg_time->current_roa_timestamp && !cfg_time->next_roa_timestamp) {
-    if (cfg_get_timestamps(cfg, timestamp, current_urls)) {
-      debug_err_print("%s", "Error: Could not find current and next timestamp");
+    if (rpki_load_epoch(cfg, timestamp) != 0) {
       elem_destroy(elem);
       return -1;
     }
-    if (cfg_parse_urls(cfg, current_urls) != 0) {
-      return -1;
-    }
-    debug_print("Current ROA Timestamp: %" PRIu32 "\n",
-                cfg->cfg_time.current_roa_timestamp);
-    debug_print("Next ROA Timestamp:    %" PRIu32 "\n",
-                cfg->cfg_time.next_roa_timestamp);
+  }
+
+  /* The current ROA dump is used until the ROA dumps skipped by the epoch
+     stride or bucket are outdated */
+  uint32_t covered_ts = cfg_time->current_roa_timestamp;
+  if (cfg_time->skipped_roa_timestamp > covered_ts) {
+    covered_ts = cfg_time->skipped_roa_timestamp;
   }
 
   /* Switch the mode if the timestamp is newer than the last cached ROA dump */
   config_broker_t *broker = &cfg->cfg_broker;
   if (input->mode && !cfg_time->max_end &&
-      timestamp >= cfg_time->current_roa_timestamp + ROA_ARCHIVE_INTERVAL &&
+      timestamp >= covered_ts + ROA_ARCHIVE_INTERVAL &&
       !cfg_time->next_roa_timestamp) {
 
+    /* The broker response and the prefix tables are replaced */
+    cfg_prefetch_cancel(cfg);
+    broker_window_cancel(cfg);
+
     /* Hybrid mode if timestamp is older than current time - ROA interval */
     if (cfg_time->current_roa_timestamp <
         (uint32_t)time(NULL) - ROA_ARCHIVE_INTERVAL) {
@@ -166,10 +315,11 @@ int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
       if (broker_connect(cfg, input->broker_collectors,current_interval) != 0) {
         return -1;
       }
-      broker->broker_khash_used = 0;
+      broker->index_used = 0;
       val->pfxt_count = 0;
       cfg_get_timestamps(cfg, timestamp, current_urls);
-      if (cfg_parse_urls(cfg, current_urls) != 0) {
+      if (cfg_switch_epoch(cfg, cfg_time->current_roa_timestamp,
+                           current_urls) != 0) {
         return -1;
       }
 
@@ -179,8 +329,8 @@ int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
       input->mode = 0;
       validation_set_live_config(input->broker_collectors, cfg,
                                  input->ssh_options);
-      if(elem_get_rpki_validation_result(cfg, val->rtr_mgr_cfg, elem,prefix,asn,
-                                         mask_len, NULL, 0) != 0) {
+      if(elem_get_rpki_validation_result(cfg, val->rtr_mgr_cfg, elem, &addr,
+                                         asn, mask_len, NULL, 0) != 0) {
         return -1;
       }
       elem_get_rpki_validation_result_snprintf(cfg, result, size, elem);
@@ -190,8 +340,7 @@ int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
 
     /* No validation if there is a gap between two ROA dumps */
   } else if (input->mode &&
-             timestamp >=
-               cfg_time->current_roa_timestamp + ROA_ARCHIVE_INTERVAL &&
+             timestamp >= covered_ts + ROA_ARCHIVE_INTERVAL &&
              timestamp < cfg_time->next_roa_timestamp &&
              cfg_time->next_roa_timestamp != 0) {
     if (cfg->cfg_time.current_gap) {
@@ -205,19 +354,24 @@ int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
     return 0;
   }
 
-  /* If the timestamp equals next timestamp, clean pfxt and set next timestamp
+  /* If the timestamp equals next timestamp, switch to the next epoch (a
+     prefetched epoch is published at once) and set next timestamp
      next_roa_timestamp =  0 -> There is no next ROA file
      next_roa_timestamp = -1 -> Live mode active */
   if (timestamp >= cfg_time->next_roa_timestamp &&
       cfg_time->next_roa_timestamp != 0) {
-    broker->broker_khash_used++;
+    broker->index_used++;
     cfg_time->current_roa_timestamp = cfg_time->next_roa_timestamp;
     cfg_time->next_roa_timestamp =
       cfg_next_timestamp(cfg, cfg_time->current_roa_timestamp);
-    strcpy(current_urls, kh_value(broker->broker_kh,
-                                  kh_get(broker_result, broker->broker_kh,
-                                         cfg_time->current_roa_timestamp)));
-    if (cfg_parse_urls(cfg, current_urls) != 0) {
+    int pos = broker_index_find(&broker->index,
+                                cfg_time->current_roa_timestamp);
+    if (pos < 0 || broker_index_urls(&broker->index, pos, current_urls,
+                                     BROKER_ROA_URLS_LEN) != 0) {
+      return -1;
+    }
+    if (cfg_switch_epoch(cfg, cfg_time->current_roa_timestamp,
+                         current_urls) != 0) {
       return -1;
     }
     debug_print("Current ROA Timestamp: %" PRIu32 "\n",
@@ -228,7 +382,7 @@ int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
 
   /* Validation the prefix, mask_len and ASN with Historical RPKI Validation */
   for (int i = 0; i < val->pfxt_count; i++) {
-    if(elem_get_rpki_validation_result(cfg, NULL, elem, prefix, asn, mask_len,
+    if(elem_get_rpki_validation_result(cfg, NULL, elem, &addr, asn, mask_len,
                                     &val->pfxt[i], i) != 0) {
       return -1;
     }
@@ -246,6 +400,27 @@ int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
   return 0;
 }
 
+int rpki_set_change_feed(rpki_cfg_t *cfg, validation_change_fp change_fp,
+                         void *data)
+{
+  /* A running prefetch imports the next epoch without the new change feed */
+  cfg_prefetch_cancel(cfg);
+  return validation_set_change_feed(cfg, change_fp, data);
+}
+
+const validation_divergence_t *rpki_get_divergence(rpki_cfg_t *cfg,
+                                                   size_t *count)
+{
+  /* The divergent records belong to the current epoch */
+  validation_epoch_t *epoch = cfg->cfg_val.epoch;
+  *count = 0;
+  if (!cfg->cfg_input.mode || epoch == NULL || !epoch->divergence_count) {
+    return NULL;
+  }
+  *count = epoch->divergence_count;
+  return epoch->divergence;
+}
+
 int rpki_destroy_config(rpki_cfg_t *cfg)
 {
   /* Destroy the RPKI configuration */
@@ -56,6 +56,50 @@ rpki_cfg_t *rpki_set_config(char *project_collectors, char *time_intervals,
                             int unified, int mode, char *broker_url,
                             char *ssh_options);
 
+/** Create a configuration with additional options for the RPKI validation
+ *
+ * @param[in] project_collectors  All RPKI projects and collectors
+ *                                PJ_1:(*|CC_1,CC_2);PJ_2:(*|CC_1,CC_2)
+ * @param[in] time_intervals      Time intervals as UTC epoch timestamps
+ *                                (start_1-end_1[,start_n-end_n]*)
+ * @param[in] unified             Distinct (0) or unified validation (1)
+ * @param[in] mode                Validation mode - live (0) or historical (1)
+ * @param[in] broker_url          RPKI broker url
+ * @param[in] ssh_options         SSH user, SSH hostkey, SSH privkey
+ * @param[in] options             Additional options (key=value[,key=value]*)
+ *                                minimize=(0|1)
+ *                                backend=(rtrlib|array)
+ *                                diff_backend=(rtrlib|array)
+ *                                arena=(0|1), hugepages=(0|1)
+ *                                threads=(0-64, 0 = all cores)
+ *                                delta=(0|1)
+ *                                cache=DIR, cache_size=(MB > 0)
+ *                                prefetch=(0|1)
+ *                                epoch_stride=(> 0), epoch_bucket=(seconds > 0)
+ *                                epochs=(0-64), epochs_size=(MB > 0)
+ *                                index=FILE
+ *                                divergence=(0|1)
+ *                                shared=(0|1)
+ *                                shm=DIR, shm_count=(images > 0)
+ *                                window=(seconds > 0)
+ * @return                        Pointer to RPKI configuration
+ */
+rpki_cfg_t *rpki_set_config_opts(char *project_collectors,
+                                 char *time_intervals, int unified, int mode,
+                                 char *broker_url, char *ssh_options,
+                                 char *options);
+
+/** Import the ROA dumps for a timestamp before the first validation (the
+ *  epoch of the following ROA timestamp is prefetched in the background if
+ *  the prefetch option is set), does nothing in live mode or if an epoch was
+ *  already imported
+ *
+ * @param[in]  cfg           Pointer to the RPKI configuration
+ * @param[in]  timestamp     UTC epoch timestamp of the first BGP elem
+ * @return                   0 if the ROA dumps were imported, otherwise -1
+ */
+int rpki_warmup(rpki_cfg_t *cfg, uint32_t timestamp);
+
 /** Validate a BGP element with RPKI and stores the result in the given buffer 
  *
  * @param[in]  cfg           Pointer to the RPKI configuration
@@ -70,6 +114,34 @@ rpki_cfg_t *rpki_set_config(char *project_collectors, char *time_intervals,
 int rpki_validate(rpki_cfg_t *cfg, uint32_t timestamp, uint32_t asn,
                   char *prefix, uint8_t mask_len, char *result, size_t size);
 
+/** Set a change feed which is called with the ROA records added and removed
+ *  per collector at every epoch advance (historical mode, the first epoch
+ *  reports all records as added) or with every update of the RTR server
+ *  (live mode, called by the thread of the RTRlib), the change feed must not
+ *  call rpki_set_change_feed or rpki_destroy_config
+ *
+ * @param[in] cfg            Pointer to the RPKI configuration
+ * @param[in] change_fp      Function called with the changed ROA records of a
+ *                           collector (NULL to disable the change feed)
+ * @param[in] data           User data passed to the change feed
+ * @return                   0 if the change feed was set, otherwise -1
+ */
+int rpki_set_change_feed(rpki_cfg_t *cfg, validation_change_fp change_fp,
+                         void *data);
+
+/** Get the records of the current epoch which are contained in the ROA dumps
+ *  of some collectors but not in the ones of all collectors with a ROA dump
+ *  (historical mode, computed by the import if the divergence option is set)
+ *
+ * @param[in]  cfg           Pointer to the RPKI configuration
+ * @param[out] count         Number of divergent records
+ * @return                   Divergent records sorted by ASN and prefix (valid
+ *                           until the next epoch switch), NULL if there are
+ *                           none
+ */
+const validation_divergence_t *rpki_get_divergence(rpki_cfg_t *cfg,
+                                                   size_t *count);
+
 /** Destroy a configuration
  *
  * @param[in] cfg            Pointer to the RPKI configuration
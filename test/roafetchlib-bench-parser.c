@@ -0,0 +1,137 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "roafetchlib.h"
+
+/** Number of records of the generated ROA dump */
+#define BENCH_RECORDS 1000000
+
+/** Number of runs per instruction set (the best run is reported) */
+#define BENCH_RUNS 5
+
+/* Count the parsed records */
+static int bench_record(const roa_record_t *record, void *data)
+{
+  (*(size_t *)data)++;
+  return 0;
+}
+
+static double bench_now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Generate a ROA dump with IPv4 and IPv6 records */
+static char *bench_generate(size_t *len)
+{
+  size_t size = BENCH_RECORDS * 64 + 64;
+  char *dump = malloc(size);
+  if (dump == NULL) {
+    return NULL;
+  }
+  size_t pos = snprintf(dump, size, "ASN,IP Prefix,Max Length,Trust Anchor\n");
+  for (uint32_t i = 0; i < BENCH_RECORDS; i++) {
+    if (i % 4) {
+      pos += snprintf(dump + pos, size - pos, "AS%" PRIu32 ",%u.%u.%u.0/24,24,"
+                      "ripe\n", 64512 + i % 1000, 1 + (i >> 16) % 223,
+                      (i >> 8) & 0xff, i & 0xff);
+    } else {
+      pos += snprintf(dump + pos, size - pos, "AS%" PRIu32 ",2001:db8:%x::/48,"
+                      "48,arin\n", 64512 + i % 1000, i & 0xffff);
+    }
+  }
+  *len = pos;
+  return dump;
+}
+
+int main()
+{
+  size_t len = 0;
+  char *dump = bench_generate(&len);
+  if (dump == NULL) {
+    return -1;
+  }
+  printf("ROA dump: %zu records, %.1f MB, chunk size: %i bytes\n",
+         (size_t)BENCH_RECORDS, len / 1e6, ROA_PARSER_CHUNK_SIZE);
+
+  roa_scan_isa_t isas[] = {ROA_SCAN_SCALAR, ROA_SCAN_SSE2, ROA_SCAN_AVX2};
+  for (int i = 0; i < 3; i++) {
+    if (roa_scan_set_isa(isas[i]) != 0) {
+      continue;
+    }
+
+    /* Structural scanning only */
+    uint64_t bitmap[ROA_SCAN_BLOCK_SIZE / 64];
+    double scan = 0, import = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+      double start = bench_now();
+      for (size_t pos = 0; pos < len; pos += ROA_SCAN_BLOCK_SIZE) {
+        roa_scan_structural(dump + pos, len - pos < ROA_SCAN_BLOCK_SIZE
+                                            ? len - pos : ROA_SCAN_BLOCK_SIZE,
+                            bitmap);
+      }
+      double t = bench_now() - start;
+      scan = (!run || t < scan) ? t : scan;
+    }
+
+    /* Import (scanning, field extraction and record conversion) */
+    size_t records = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+      roa_parser_t parser;
+      records = 0;
+      roa_parser_init(&parser, bench_record, &records);
+      double start = bench_now();
+      for (size_t pos = 0; pos < len; pos += ROA_PARSER_CHUNK_SIZE) {
+        if (roa_parser_feed(&parser, dump + pos,
+                            len - pos < ROA_PARSER_CHUNK_SIZE
+                                ? len - pos : ROA_PARSER_CHUNK_SIZE) != 0) {
+          free(dump);
+          return -1;
+        }
+      }
+      roa_parser_finish(&parser);
+      double t = bench_now() - start;
+      import = (!run || t < import) ? t : import;
+    }
+
+    printf("%-8s scan: %8.1f MB/s   import: %7.1f MB/s (%zu records)\n",
+           roa_scan_isa_name(), len / 1e6 / scan, len / 1e6 / import, records);
+  }
+
+  free(dump);
+  return 0;
+}
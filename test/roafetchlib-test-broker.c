@@ -36,11 +36,22 @@
 #include "roafetchlib-test-broker.h"
 #include "roafetchlib-test.h"
 
+/* Render the ROA URLs of an entry of the broker index */
+static int test_broker_urls(rpki_cfg_t *cfg, size_t pos, char *urls)
+{
+  broker_index_t *index = &cfg->cfg_broker.index;
+  if (pos >= index->count) {
+    return -1;
+  }
+  return broker_index_urls(index, pos, urls, BROKER_ROA_URLS_LEN);
+}
+
 int test_rpki_broker_connect(rpki_cfg_t *cfg, char *collector,
                              char *interval, char *type, char *buf,
                              char *result)
 {
   int ret = -1;
+  char urls[BROKER_ROA_URLS_LEN];
 
   // invalid connection
   if (!strcmp(result, "invalid")) {
@@ -54,7 +65,7 @@ int test_rpki_broker_connect(rpki_cfg_t *cfg, char *collector,
   if (!strcmp(result, "semi-valid")) {
     PRINT_INTENDED_ERR;
     ret = broker_connect(cfg, collector, interval);
-    CHECK_RESULT("Khash Count", type, !cfg->cfg_broker.broker_khash_count);
+    CHECK_RESULT("Index Count", type, !cfg->cfg_broker.index.count);
     return 0;
   }
 
@@ -62,8 +73,8 @@ int test_rpki_broker_connect(rpki_cfg_t *cfg, char *collector,
   ret = broker_connect(cfg, collector, interval);
 
   CHECK_RESULT("valid URL", type, !ret);
-  CHECK_RESULT("Broker-URL", type,
-               !strcmp(cfg->cfg_broker.roa_urls[0], TEST_BROKER_URL_4));
+  CHECK_RESULT("Broker-URL", type, !test_broker_urls(cfg, 0, urls) &&
+                                     !strcmp(urls, TEST_BROKER_URL_4));
   return 0;
 }
 int test_rpki_broker_parse(rpki_cfg_t *cfg, char *type, char *json, char *buf,
@@ -72,6 +83,7 @@ int test_rpki_broker_parse(rpki_cfg_t *cfg, char *type, char *json, char *buf,
 
   int all_in = 0;
   int ret = -1;
+  char urls[BROKER_ROA_URLS_LEN];
 
   // invalid parsing
   if (!strcmp(result, "invalid")) {
@@ -88,23 +100,150 @@ int test_rpki_broker_parse(rpki_cfg_t *cfg, char *type, char *json, char *buf,
                !strcmp(cfg->cfg_input.broker_projects, TEST_BROKER_PARSE_PRJ));
   CHECK_RESULT("of the collectors", type,
                !strcmp(cfg->cfg_input.broker_collectors, TEST_BROKER_PARSE_CC));
-  CHECK_RESULT("of the Khash-Count", type, cfg->cfg_broker.broker_khash_count ==
+  CHECK_RESULT("of the Index-Count", type, cfg->cfg_broker.index.count ==
                                              TEST_BROKER_PARSE_KHASH_CNT);
   CHECK_RESULT("of the start timestamp", type,
                cfg->cfg_time.start == TEST_BROKER_PARSE_START);
   CHECK_RESULT("of the end timestamp", type,
                cfg->cfg_time.max_end == TEST_BROKER_PARSE_END);
 
-  for (int i = 0; i < cfg->cfg_broker.broker_khash_count; i++) {
-    if (!strcmp(cfg->cfg_broker.roa_urls[i], TEST_BROKER_URL_1) ||
-        !strcmp(cfg->cfg_broker.roa_urls[i], TEST_BROKER_URL_2) ||
-        !strcmp(cfg->cfg_broker.roa_urls[i], TEST_BROKER_URL_3)) {
+  for (int i = 0; i < (int)cfg->cfg_broker.index.count; i++) {
+    if (!test_broker_urls(cfg, i, urls) &&
+        (!strcmp(urls, TEST_BROKER_URL_1) || !strcmp(urls, TEST_BROKER_URL_2) ||
+         !strcmp(urls, TEST_BROKER_URL_3))) {
       all_in++;
     }
   }
 
   CHECK_RESULT("of the broker URL", type,
                all_in == TEST_BROKER_PARSE_KHASH_CNT);
+  CHECK_RESULT("of the URL templates", type,
+               cfg->cfg_broker.index.templates_count == 1 &&
+                 !cfg->cfg_broker.index.pool_len);
+  return 0;
+}
+
+int test_rpki_broker_window(char *type)
+{
+  // a single window covers the whole interval
+  rpki_cfg_t *cfg =
+    cfg_create(TEST_PROJECT_COLLECTOR, TEST_TIMEWDW, 0, 1, NULL, NULL);
+  cfg->cfg_input.window = TEST_BROKER_WINDOW;
+  int ret = broker_window_init(cfg);
+  char urls[BROKER_ROA_URLS_LEN];
+
+  CHECK_RESULT("of the first window", type, !ret);
+  CHECK_RESULT("of the Index-Count", type,
+               cfg->cfg_broker.index.count == TEST_KHASH_CNT);
+  CHECK_RESULT("of the broker URL", type, !test_broker_urls(cfg, 0, urls) &&
+                                             !strcmp(urls, TEST_BROKER_URL_4));
+  CHECK_RESULT("of the last window", type, !cfg->cfg_broker.window.running &&
+                                             !broker_window_next(cfg, 0));
+  cfg_destroy(cfg);
+  return 0;
+}
+
+int test_rpki_broker_chunks(rpki_cfg_t *cfg, char *type)
+{
+  // response with more ROA URLs than initially allocated (read in chunks)
+  FILE *file = fopen(TEST_BROKER_CHUNK_FILE, "w");
+  if (file == NULL) {
+    return -1;
+  }
+  fprintf(file, "{\"projects\": \"%s\", \"collectors\": \"%s\", "
+                "\"interval\": \"%s\", \"start\": \"%d\", "
+                "\"max_end\": \"%d\", \"data\": {",
+          TEST_BROKER_PARSE_PRJ, TEST_BROKER_PARSE_CC, TEST_BROKER_PARSE_INV,
+          TEST_BROKER_PARSE_START, TEST_BROKER_PARSE_END);
+  for (int i = 0; i < TEST_BROKER_CHUNK_CNT; i++) {
+    fprintf(file, "%s\"%d\": \"" TEST_BROKER_CHUNK_URL "\"", i ? ", " : "",
+            TEST_BROKER_PARSE_START + i, i);
+  }
+  fprintf(file, "}}");
+  fclose(file);
+
+  int ret = broker_json_buf(cfg, TEST_BROKER_CHUNK_FILE);
+  remove(TEST_BROKER_CHUNK_FILE);
+  CHECK_RESULT("of a valid format", type, !ret);
+  CHECK_RESULT("of the Index-Count", type, cfg->cfg_broker.index.count ==
+                                             TEST_BROKER_CHUNK_CNT);
+
+  char url[BROKER_ROA_URLS_LEN];
+  char urls[BROKER_ROA_URLS_LEN];
+  int all_in = 0;
+  for (int i = 0; i < (int)cfg->cfg_broker.index.count; i++) {
+    int pos = broker_index_find(&cfg->cfg_broker.index,
+                                TEST_BROKER_PARSE_START + i);
+    snprintf(url, sizeof(url), TEST_BROKER_CHUNK_URL, i);
+    if (pos >= 0 && !test_broker_urls(cfg, pos, urls) && !strcmp(urls, url)) {
+      all_in++;
+    }
+  }
+  CHECK_RESULT("of the broker URL", type, all_in == TEST_BROKER_CHUNK_CNT);
+  return 0;
+}
+
+int test_rpki_broker_index(char *type)
+{
+  // ROA URLs rendered from URL templates (a collector without a ROA dump in
+  // every entry) and stored verbatim
+  broker_index_t index;
+  char urls[BROKER_ROA_URLS_LEN];
+  char *test_urls[] = {TEST_BROKER_INDEX_URLS_1, TEST_BROKER_INDEX_URLS_2,
+                       TEST_BROKER_INDEX_VERBATIM};
+  int ret = 0, all_in = 0;
+  broker_index_init(&index);
+  for (int i = TEST_BROKER_INDEX_CNT - 1; i >= 0; i--) {
+    ret |= broker_index_add(&index, TEST_BROKER_INDEX_TS[i], test_urls[i],
+                            strlen(test_urls[i]));
+  }
+  CHECK_RESULT("of the URL templates", type,
+               !ret && index.count == TEST_BROKER_INDEX_CNT &&
+                 index.templates_count == 1);
+  for (int i = 0; i < TEST_BROKER_INDEX_CNT; i++) {
+    if (index.entries[i].timestamp == TEST_BROKER_INDEX_TS[i] &&
+        !broker_index_urls(&index, i, urls, sizeof(urls)) &&
+        !strcmp(urls, test_urls[i])) {
+      all_in++;
+    }
+  }
+  CHECK_RESULT("of the rendered URLs", type, all_in == TEST_BROKER_INDEX_CNT);
+  CHECK_RESULT("of the verbatim URLs", type,
+               !index.entries[0].verbatim && !index.entries[1].verbatim &&
+                 index.entries[2].verbatim);
+
+  // the latest entry at or before a timestamp
+  CHECK_RESULT("of the lookup", type,
+               broker_index_floor(&index, TEST_BROKER_INDEX_TS[1] + 60) == 1 &&
+                 broker_index_find(&index, TEST_BROKER_INDEX_TS[1] + 60) < 0 &&
+                 broker_index_floor(&index, TEST_BROKER_INDEX_TS[0] - 1) < 0);
+
+  // entries preceding a timestamp are removed
+  broker_index_remove(&index, TEST_BROKER_INDEX_TS[1]);
+  CHECK_RESULT("of the removal", type,
+               index.count == TEST_BROKER_INDEX_CNT - 1 &&
+                 !broker_index_urls(&index, 1, urls, sizeof(urls)) &&
+                 !strcmp(urls, TEST_BROKER_INDEX_VERBATIM));
+  broker_index_free(&index);
+  return 0;
+}
+
+int test_rpki_broker_check(char *type)
+{
+  // error messages of the broker and HTML pages of the web server
+  PRINT_INTENDED_ERR;
+  CHECK_RESULT("of an error message", type,
+               utils_broker_check_response(TEST_BROKER_RESP_ERR,
+                                           strlen(TEST_BROKER_RESP_ERR)) != 0);
+  PRINT_INTENDED_ERR;
+  CHECK_RESULT("of an HTML page", type,
+               utils_broker_check_response(TEST_BROKER_RESP_HTML,
+                                           strlen(TEST_BROKER_RESP_HTML)) != 0);
+
+  // valid broker response
+  CHECK_RESULT("of a valid response", type,
+               !utils_broker_check_response(TEST_JSON_FILE,
+                                            strlen(TEST_JSON_FILE)));
   return 0;
 }
 
@@ -127,6 +266,15 @@ int test_rpki_broker(char *buf, char *result)
                                            TEST_JSON_FILE_ERR_FMT, buf,
                                            "invalid"));
 
+  CHECK_SUBSECTION("Broker Parsing - chunked response", 0,
+                   !test_rpki_broker_chunks(cfg, "Broker parsing "));
+  CHECK_SUBSECTION("Broker Parsing - URL templates", 0,
+                   !test_rpki_broker_index("Broker index "));
+
+  // Check broker responses
+  CHECK_SUBSECTION("Broker Response Check", 0,
+                   !test_rpki_broker_check("Broker response check "));
+
   // Check broker connection
   CHECK_SUBSECTION(
     "Broker Connection - valid URL", 0,
@@ -145,6 +293,8 @@ int test_rpki_broker(char *buf, char *result)
                                              TEST_BROKER_CNN_TIMEWDW_ERR,
                                              "Broker connection - ", buf,
                                              "semi-valid"));
+  CHECK_SUBSECTION("Broker Connection - windowed index", 0,
+                   !test_rpki_broker_window("Broker window "));
   cfg_destroy(cfg);
   return 0;
 }
@@ -32,6 +32,7 @@
 #define __ROAFETCHLIB_TEST_BROKER_H
 
 #include "roafetchlib.h"
+#include "utils.h"
 #include "constants.h"
 
 #define TEST_BUF_LEN 2048
@@ -83,4 +84,32 @@
 
 #define TEST_JSON_FILE_ERR_FMT "{\\ä}"
 
+#define TEST_BROKER_WINDOW 60
+
+#define TEST_BROKER_CHUNK_FILE "roafetchlib-test-broker.json"
+#define TEST_BROKER_CHUNK_CNT 3000
+#define TEST_BROKER_CHUNK_URL                                                  \
+  BROKER_HISTORY_VALIDATION_URL_FILE "/CC01/2017.11/vrp.%d.csv.gz"
+
+#define TEST_BROKER_INDEX_CNT 3
+#define TEST_BROKER_INDEX_TS                                                   \
+  (uint32_t[TEST_BROKER_INDEX_CNT])                                            \
+  {                                                                            \
+    1511960400, 1511960580, 1511960760                                         \
+  }
+#define TEST_BROKER_INDEX_URLS_1                                               \
+  TEST_BROKER_URL_1 ",0," BROKER_HISTORY_VALIDATION_URL_FILE                   \
+  "/CC03%25/2017/11/29/rpki-201711291300.csv"
+#define TEST_BROKER_INDEX_URLS_2                                               \
+  TEST_BROKER_URL_2 "," BROKER_HISTORY_VALIDATION_URL_FILE                     \
+  "/CC02/2017-11-29/rpki-201711291303.csv,0"
+#define TEST_BROKER_INDEX_VERBATIM                                             \
+  BROKER_HISTORY_VALIDATION_URL_FILE "/CC01/latest.csv.gz,0,0"
+
+#define TEST_BROKER_RESP_ERR "Error: Malformed request, unknown project"
+
+#define TEST_BROKER_RESP_HTML                                                  \
+  "<html>\r\n<head><title>502 Bad Gateway</title></head>\r\n<body>"           \
+  "<center><h1>502 Bad Gateway</h1></center>\r\n<hr><center>nginx</center>"
+
 #endif /* __ROAFETCHLIB_TEST_BROKER_H */
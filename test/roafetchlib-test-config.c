@@ -57,19 +57,39 @@ void print_record(const struct pfx_record *pfx_record, void *data)
            (*pfx_record).max_len);
 }
 
-void create_dummy_broker_kh(rpki_cfg_t *cfg, uint32_t timestamps[], int size)
+void create_dummy_broker_index(rpki_cfg_t *cfg, uint32_t timestamps[],
+                               int size)
 {
   config_broker_t *broker = &cfg->cfg_broker;
-  broker->broker_kh = kh_init(broker_result);
-  broker->broker_khash_init = 1;
-  int kh_ret = 0;
-  khiter_t k;
+  broker_index_clear(&broker->index);
 
   for (int i = 0; i < size; i++) {
-    k = kh_put(broker_result, broker->broker_kh, timestamps[i], &kh_ret);
-    kh_val(broker->broker_kh, k) = '\0';
-    kh_val(broker->broker_kh, k) = TEST_TS_URL[i];
-    broker->broker_khash_count++;
+    broker_index_add(&broker->index, timestamps[i], TEST_TS_URL[i],
+                     strlen(TEST_TS_URL[i]));
+  }
+}
+
+int create_dummy_roa_dumps(char *paths[], const char *content[], int size)
+{
+  int ret = 0;
+  for (int i = 0; i < size; i++) {
+    FILE *file = fopen(paths[i], "wb");
+    ret |= (file == NULL || fputs(content[i], file) == EOF);
+    ret |= (file != NULL && fclose(file));
+  }
+  return ret;
+}
+
+void create_dummy_broker_index_paths(rpki_cfg_t *cfg, uint32_t timestamps[],
+                                     char *paths[], int paths_count, int size)
+{
+  config_broker_t *broker = &cfg->cfg_broker;
+  broker_index_clear(&broker->index);
+
+  /* The ROA dumps are repeated if there are more timestamps than paths */
+  for (int i = 0; i < size; i++) {
+    char *path = paths[i % paths_count];
+    broker_index_add(&broker->index, timestamps[i], path, strlen(path));
   }
 }
 /** Utility functions - END **/
@@ -165,11 +185,11 @@ int test_rpki_config_import_roa_file(rpki_cfg_t *cfg)
   char ip_v6[TEST_BUF_LEN] = {0};
   char ip_v4_s[TEST_BUF_LEN] = {0};
   char ip_v6_s[TEST_BUF_LEN] = {0};
-  struct pfx_table *pfxt = NULL;
-  pfxt = malloc(sizeof(struct pfx_table));
-  pfx_table_init(pfxt, NULL);
+  backend_table_t tbl;
+  backend_table_init(&tbl, &backend_rtr_ops, NULL, NULL);
 
-  int ret = cfg_import_roa_file(TEST_IMP_URL, pfxt);
+  int ret = cfg_import_roa_file(cfg, TEST_IMP_URL, &tbl, NULL);
+  struct pfx_table *pfxt = backend_rtr_pfx_table(&tbl);
 
   pfx_table_for_each_ipv4_record(pfxt, print_pfxt, &ip_v4);
   utils_elem_sort_result(ip_v4, TEST_BUF_LEN, ip_v4_s, "\n");
@@ -181,6 +201,882 @@ int test_rpki_config_import_roa_file(rpki_cfg_t *cfg)
   CHECK_RESULT("", "Import all IPv6 ROA Records",
                !strcmp(TEST_IMP_IPv6, ip_v6_s) && !ret);
 
+  backend_table_free(&tbl);
+  return 0;
+}
+
+/* Add a parsed ROA record to a ROA set */
+int test_roa_set_record(const roa_record_t *record, void *data)
+{
+  return roa_set_add((roa_set_t *)data, record);
+}
+
+int test_rpki_config_roa_parser()
+{
+  /** roa_parser_feed **/
+  char testcase[TEST_BUF_LEN];
+  const char *csv = TEST_PARSER_CSV;
+  size_t len = strlen(csv);
+  roa_parser_t parser;
+  roa_set_t set;
+
+  /* Every chunk size has to yield the same records and content hash */
+  int valid = 1;
+  uint64_t hash = 0;
+  for (size_t chunk = 1; chunk <= len; chunk++) {
+    roa_set_init(&set);
+    roa_parser_init(&parser, test_roa_set_record, &set);
+    int ret = 0;
+    for (size_t i = 0; i < len && !ret; i += chunk) {
+      ret = roa_parser_feed(&parser, csv + i, i + chunk > len ? len - i : chunk);
+    }
+    ret |= roa_parser_finish(&parser);
+    valid &= (!ret && set.count == TEST_PARSER_COUNT);
+    hash = (chunk == 1 ? roa_parser_hash(&parser) : hash);
+    valid &= (roa_parser_hash(&parser) == hash);
+    for (int i = 0; valid && i < TEST_PARSER_COUNT; i++) {
+      valid &= (set.records[i].asn == TEST_PARSER_ASN[i] &&
+                set.records[i].max_len == TEST_PARSER_MAXL[i]);
+    }
+    roa_set_free(&set);
+  }
+  snprintf(testcase, sizeof(testcase), "Parse %i records in chunks of 1-%zu "
+           "bytes", TEST_PARSER_COUNT, len);
+  CHECK_RESULT("", testcase, valid);
+
+  /* A changed max length of the last record has to change the hash */
+  char changed[TEST_BUF_LEN];
+  snprintf(changed, sizeof(changed), "%s", csv);
+  changed[len - 1] = TEST_PARSER_CHANGED_MAXL;
+  roa_set_init(&set);
+  roa_parser_init(&parser, test_roa_set_record, &set);
+  int ret = roa_parser_feed(&parser, changed, len);
+  ret |= roa_parser_finish(&parser);
+  CHECK_RESULT("", "Content hash of a changed ROA dump",
+               !ret && roa_parser_hash(&parser) != hash);
+  roa_set_free(&set);
+
+  /* A corrupt record has to abort the parsing */
+  PRINT_INTENDED_ERR;
+  roa_set_init(&set);
+  roa_parser_init(&parser, test_roa_set_record, &set);
+  ret = roa_parser_feed(&parser, TEST_PARSER_CORRUPT,
+                            strlen(TEST_PARSER_CORRUPT));
+  CHECK_RESULT("", "Abort on a corrupt record", ret == -1 && !set.count);
+  roa_set_free(&set);
+
+  return 0;
+}
+
+int test_rpki_config_roa_snapshot(rpki_cfg_t *cfg)
+{
+  /** roa_snapshot_write / roa_snapshot_open **/
+  const char *csv = TEST_PARSER_CSV;
+  roa_parser_t parser;
+  roa_set_t set;
+  roa_set_init(&set);
+  roa_parser_init(&parser, test_roa_set_record, &set);
+  int ret = roa_parser_feed(&parser, csv, strlen(csv));
+  ret |= roa_parser_finish(&parser);
+  uint64_t hash = roa_parser_hash(&parser);
+  ret |= roa_snapshot_write(TEST_SNAPSHOT_PATH, &set, hash, 1);
+  roa_set_free(&set);
+  CHECK_RESULT("", "Write a ROA snapshot", !ret);
+
+  roa_snapshot_t snap;
+  ret = roa_snapshot_open(&snap, TEST_SNAPSHOT_PATH);
+  CHECK_RESULT("", "Map a ROA snapshot", !ret && snap.map != NULL &&
+                                           snap.header->hash == hash);
+  CHECK_RESULT("", "Records per address family",
+               !ret && snap.header->count[ROA_IPV4] == TEST_SNAPSHOT_COUNT[0] &&
+                 snap.header->count[ROA_IPV6] == TEST_SNAPSHOT_COUNT[1]);
+
+  size_t first = 0, count = 0, first_93 = 0;
+  ret = roa_snapshot_range(&snap, ROA_IPV4, 80, &first, &count);
+  ret |= roa_snapshot_range(&snap, ROA_IPV4, 93, &first_93, &count);
+  CHECK_RESULT("", "Index of the top address bytes",
+               !ret && first_93 - first == TEST_SNAPSHOT_COUNT_80 &&
+                 first_93 == TEST_SNAPSHOT_FIRST_93 && count == 1);
+  roa_snapshot_close(&snap);
+
+  /* Snapshots are detected by the import and keep the hash of the ROA dump */
+  uint64_t snap_hash = 0;
+  size_t records = 0;
+  roa_set_init(&set);
+  ret = roa_parser_read(TEST_SNAPSHOT_PATH, test_roa_set_record, &set,
+                        &records, &snap_hash);
+  CHECK_RESULT("", "Read a ROA snapshot like a ROA dump",
+               !ret && records == TEST_PARSER_COUNT && snap_hash == hash);
+  CHECK_RESULT("", "Map a local ROA snapshot",
+               roa_parser_mappable(TEST_SNAPSHOT_PATH));
+
+  /* Every record of the snapshot has to be valid in the imported table */
+  backend_table_t tbl;
+  backend_table_init(&tbl, &backend_rtr_ops, NULL, NULL);
+  ret = cfg_import_roa_file(cfg, TEST_SNAPSHOT_PATH, &tbl, NULL);
+  int valid = (!ret && set.count == TEST_PARSER_COUNT);
+  for (size_t i = 0; valid && i < set.count; i++) {
+    const roa_record_t *rec = &set.records[i];
+    struct lrtr_ip_addr prefix;
+    enum pfxv_state state;
+    prefix.ver = (rec->family == ROA_IPV4 ? LRTR_IPV4 : LRTR_IPV6);
+    if (rec->family == ROA_IPV4) {
+      prefix.u.addr4.addr = rec->addr[0];
+    } else {
+      memcpy(prefix.u.addr6.addr, rec->addr, sizeof(rec->addr));
+    }
+    valid &= (!backend_table_lookup(&tbl, rec->asn, &prefix, rec->max_len,
+                                    &state) &&
+              state == BGP_PFXV_STATE_VALID);
+  }
+  CHECK_RESULT("", "Import a ROA snapshot", valid);
+  backend_table_free(&tbl);
+  roa_set_free(&set);
+
+  /* A corrupt snapshot has to be rejected */
+  FILE *file = fopen(TEST_SNAPSHOT_PATH, "r+b");
+  ret = (file == NULL || fseek(file, -1, SEEK_END) || fputc('X', file) == EOF);
+  ret |= (file != NULL && fclose(file));
+  PRINT_INTENDED_ERR;
+  ret |= (roa_snapshot_open(&snap, TEST_SNAPSHOT_PATH) != -1);
+  CHECK_RESULT("", "Reject a corrupt ROA snapshot", !ret);
+  remove(TEST_SNAPSHOT_PATH);
+
+  return 0;
+}
+
+int test_rpki_config_roa_parser_mapped()
+{
+  /** roa_parser_read (mapped) **/
+  const char *csv = TEST_PARSER_CSV;
+  char *paths[] = {TEST_MAPPED_PATH, TEST_MAPPED_GZIP};
+  const char *content[] = {csv, "\x1f\x8b"};
+  int ret = create_dummy_roa_dumps(paths, content, 2);
+  CHECK_RESULT("", "Detect local uncompressed ROA dumps",
+               !ret && roa_parser_mappable(TEST_MAPPED_PATH) &&
+                 !roa_parser_mappable(TEST_MAPPED_GZIP) &&
+                 !roa_parser_mappable(TEST_IMP_URL));
+
+  /* A mapped ROA dump yields the same records and hash as a streamed one */
+  roa_parser_t parser;
+  roa_set_t set;
+  roa_set_init(&set);
+  roa_parser_init(&parser, test_roa_set_record, &set);
+  ret = roa_parser_feed(&parser, csv, strlen(csv));
+  ret |= roa_parser_finish(&parser);
+  roa_set_free(&set);
+  uint64_t hash = 0;
+  size_t records = 0;
+  roa_set_init(&set);
+  ret |= roa_parser_read(TEST_MAPPED_PATH, test_roa_set_record, &set,
+                         &records, &hash);
+  int valid = (!ret && records == TEST_PARSER_COUNT &&
+               set.count == TEST_PARSER_COUNT &&
+               hash == roa_parser_hash(&parser));
+  for (int i = 0; valid && i < TEST_PARSER_COUNT; i++) {
+    valid &= (set.records[i].asn == TEST_PARSER_ASN[i] &&
+              set.records[i].max_len == TEST_PARSER_MAXL[i]);
+  }
+  CHECK_RESULT("", "Parse a mapped ROA dump", valid);
+  roa_set_free(&set);
+
+  remove(TEST_MAPPED_PATH);
+  remove(TEST_MAPPED_GZIP);
+  return 0;
+}
+
+int test_rpki_config_cache(rpki_cfg_t *cfg)
+{
+  /** cache_store_set / cache_lookup / cache_evict **/
+  char path[CACHE_MAX_PATH_LEN], path2[CACHE_MAX_PATH_LEN];
+  int ret = cache_init(&cfg->cache, TEST_CACHE_DIR, UINT64_MAX);
+  CHECK_RESULT("", "Create the cache directory", !ret);
+
+  /* Both URLs of the same ROA dump share one cached snapshot */
+  const char *csv = TEST_PARSER_CSV;
+  roa_parser_t parser;
+  roa_set_t set;
+  roa_set_init(&set);
+  roa_parser_init(&parser, test_roa_set_record, &set);
+  ret = roa_parser_feed(&parser, csv, strlen(csv));
+  ret |= roa_parser_finish(&parser);
+  uint64_t hash = roa_parser_hash(&parser);
+  ret |= (cache_lookup(&cfg->cache, TEST_CACHE_URLS[0], "snap", path,
+                       sizeof(path)) != -1);
+  for (int i = 0; i < 2; i++) {
+    ret |= cache_store_set(&cfg->cache, TEST_CACHE_URLS[i], &set, hash);
+  }
+  roa_set_free(&set);
+  ret |= cache_lookup(&cfg->cache, TEST_CACHE_URLS[0], "snap", path,
+                      sizeof(path));
+  ret |= cache_lookup(&cfg->cache, TEST_CACHE_URLS[1], "snap", path2,
+                      sizeof(path2));
+  CHECK_RESULT("", "Store a ROA dump under two URLs",
+               !ret && !strcmp(path, path2));
+
+  /* A cached ROA dump is imported from its snapshot */
+  backend_table_t tbl;
+  backend_table_t *pfxts[] = {&tbl};
+  char *paths[] = {TEST_CACHE_URLS[0]};
+  uint64_t hashes[] = {0};
+  backend_table_init(&tbl, &backend_rtr_ops, NULL, NULL);
+  ret = cfg_import_roa_files(cfg, paths, pfxts, hashes, 1);
+  struct lrtr_ip_addr prefix;
+  enum pfxv_state state = BGP_PFXV_STATE_NOT_FOUND;
+  lrtr_ip_str_to_addr(TEST_PART_PFX[0], &prefix);
+  ret |= backend_table_lookup(&tbl, TEST_PART_ASN[0], &prefix,
+                              TEST_PART_MSKL[0], &state);
+  CHECK_RESULT("", "Import a cached ROA dump",
+               !ret && hashes[0] == hash && state == TEST_PART_RST[0]);
+  backend_table_free(&tbl);
+
+  /* Broker responses are cached as they are */
+  size_t len = 0;
+  ret = cache_store_buf(&cfg->cache, TEST_CACHE_URLS[0], "json",
+                        TEST_CACHE_JSON, strlen(TEST_CACHE_JSON));
+  ret |= cache_lookup(&cfg->cache, TEST_CACHE_URLS[0], "json", path,
+                      sizeof(path));
+  char *json = (ret ? NULL : cache_read_buf(path, &len));
+  CHECK_RESULT("", "Store a broker response",
+               json != NULL && len == strlen(TEST_CACHE_JSON) &&
+                 !strcmp(json, TEST_CACHE_JSON));
+  free(json);
+
+  /* A size limit of one byte evicts all objects and their links */
+  cfg->cache.limit = 1;
+  ret = (cache_evict(&cfg->cache) != 2);
+  ret |= (cache_lookup(&cfg->cache, TEST_CACHE_URLS[0], "snap", path,
+                       sizeof(path)) != -1);
+  ret |= (cache_lookup(&cfg->cache, TEST_CACHE_URLS[0], "json", path,
+                       sizeof(path)) != -1);
+  ret |= (cache_lookup(&cfg->cache, TEST_CACHE_URLS[1], "snap", path,
+                       sizeof(path)) != -1);
+  CHECK_RESULT("", "Evict the least recently used objects", !ret);
+
+  rmdir(TEST_CACHE_DIR);
+  memset(&cfg->cache, 0, sizeof(cache_t));
+  return 0;
+}
+
+int test_rpki_config_roa_parser_fields()
+{
+  /** roa_parser_addr, roa_parser_prefix, roa_parser_asn **/
+  char testcase[TEST_BUF_LEN];
+  struct lrtr_ip_addr addr, ref;
+
+  PRINT_SSECTION("Address");
+  for (int i = 0; i < TEST_FIELD_ADDR_COUNT; i++) {
+    char *str = TEST_FIELD_ADDR[i];
+    uint8_t buf[16];
+    int ret = roa_parser_addr(str, strlen(str), &addr);
+    int valid = inet_pton(strchr(str, ':') ? AF_INET6 : AF_INET, str, buf);
+    if (valid == 1) {
+      lrtr_ip_str_to_addr(str, &ref);
+    }
+    snprintf(testcase, sizeof(testcase), "#%i - Address: %s", i + 1, str);
+    CHECK_RESULT("", testcase,
+                 valid == 1 ? !ret && addr.ver == ref.ver &&
+                                !memcmp(&addr.u, &ref.u,
+                                        addr.ver == LRTR_IPV4 ? 4 : 16)
+                            : ret == -1);
+  }
+
+  PRINT_SSECTION("Prefix");
+  for (int i = 0; i < TEST_FIELD_PFX_COUNT; i++) {
+    uint8_t min_len = 0;
+    int ret = roa_parser_prefix(TEST_FIELD_PFX[i], strlen(TEST_FIELD_PFX[i]),
+                                &addr, &min_len);
+    snprintf(testcase, sizeof(testcase), "#%i - Prefix: %s", i + 1,
+             TEST_FIELD_PFX[i]);
+    CHECK_RESULT("", testcase, TEST_FIELD_PFX_RST[i] == -1
+                                 ? ret == -1
+                                 : !ret && min_len == TEST_FIELD_PFX_RST[i]);
+  }
+
+  PRINT_SSECTION("ASN");
+  for (int i = 0; i < TEST_FIELD_ASN_COUNT; i++) {
+    uint32_t asn = 0;
+    int ret = roa_parser_asn(TEST_FIELD_ASN[i], strlen(TEST_FIELD_ASN[i]),
+                             &asn);
+    snprintf(testcase, sizeof(testcase), "#%i - ASN: %s", i + 1,
+             TEST_FIELD_ASN[i]);
+    CHECK_RESULT("", testcase, TEST_FIELD_ASN_RST[i] == -1
+                                 ? ret == -1
+                                 : !ret && asn == TEST_FIELD_ASN_RST[i]);
+  }
+
+  return 0;
+}
+
+int test_rpki_config_roa_scan()
+{
+  /** roa_scan_structural **/
+  char testcase[TEST_BUF_LEN];
+  char block[ROA_SCAN_BLOCK_SIZE];
+  uint64_t bitmap[ROA_SCAN_BLOCK_SIZE / 64], ref[ROA_SCAN_BLOCK_SIZE / 64];
+  const char *csv = TEST_PARSER_CSV;
+  for (size_t i = 0; i < sizeof(block); i++) {
+    block[i] = csv[i % strlen(csv)];
+  }
+
+  /* Every instruction set has to find the same positions for every length */
+  roa_scan_isa_t isas[] = {ROA_SCAN_SSE2, ROA_SCAN_AVX2};
+  char *names[] = {"SSE2", "AVX2"};
+  for (int i = 0; i < 2; i++) {
+    if (roa_scan_set_isa(isas[i]) != 0) {
+      continue;
+    }
+    int valid = 1;
+    for (size_t len = 1; len <= sizeof(block); len += 61) {
+      roa_scan_set_isa(ROA_SCAN_SCALAR);
+      roa_scan_structural(block, len, ref);
+      roa_scan_set_isa(isas[i]);
+      roa_scan_structural(block, len, bitmap);
+      valid &= !memcmp(ref, bitmap, ((len + 63) / 64) * sizeof(uint64_t));
+    }
+    snprintf(testcase, sizeof(testcase), "%s scanner matches scalar scanner",
+             names[i]);
+    CHECK_RESULT("", testcase, valid);
+  }
+  roa_scan_set_isa(ROA_SCAN_AUTO);
+
+  return 0;
+}
+
+int test_rpki_config_prefetch()
+{
+  /** cfg_switch_epoch / cfg_prefetch_next **/
+  const char *content[] = {TEST_PARSER_CSV, TEST_PREFETCH_CSV};
+  int ret = create_dummy_roa_dumps(TEST_PREFETCH_PATHS, content, 2);
+  rpki_cfg_t *cfg = cfg_create(TEST_PREFETCH_PJ_CC, TEST_PREFETCH_TIMEWDW, 0,
+                               1, NULL, NULL);
+  cfg->cfg_input.prefetch = 1;
+
+  /* Broker response of two consecutive ROA dumps */
+  config_broker_t *broker = &cfg->cfg_broker;
+  create_dummy_broker_index_paths(cfg, TEST_PREFETCH_TS, TEST_PREFETCH_PATHS,
+                                  2, 2);
+
+  /* The next epoch is imported in the background after the first switch */
+  config_time_t *cfg_time = &cfg->cfg_time;
+  config_prefetch_t *prefetch = &cfg->cfg_prefetch;
+  char urls[BROKER_ROA_URLS_LEN] = {0};
+  ret |= cfg_get_timestamps(cfg, TEST_PREFETCH_TS[0], urls);
+  ret |= cfg_switch_epoch(cfg, cfg_time->current_roa_timestamp, urls);
+  CHECK_RESULT("", "Prefetch the next epoch",
+               !ret && prefetch->running &&
+                 prefetch->timestamp == TEST_PREFETCH_TS[1]);
+
+  struct lrtr_ip_addr prefix;
+  enum pfxv_state state[2];
+  lrtr_ip_str_to_addr(TEST_PREFETCH_PFX[0], &prefix);
+  ret = backend_table_lookup(&cfg->cfg_val.pfxt[0], TEST_PARSER_ASN[0],
+                             &prefix, 24, &state[0]);
+  CHECK_RESULT("", "Validate with the current epoch",
+               !ret && state[0] == BGP_PFXV_STATE_VALID);
+
+  /* The switch to the next ROA timestamp publishes the prefetched epoch */
+  validation_epoch_t *next = cfg->cfg_val.next;
+  broker->index_used++;
+  cfg_time->current_roa_timestamp = cfg_time->next_roa_timestamp;
+  cfg_time->next_roa_timestamp = cfg_next_timestamp(cfg, TEST_PREFETCH_TS[1]);
+  ret = cfg_switch_epoch(cfg, TEST_PREFETCH_TS[1], TEST_PREFETCH_PATHS[1]);
+  ret |= backend_table_lookup(&cfg->cfg_val.pfxt[0], TEST_PARSER_ASN[0],
+                              &prefix, 24, &state[0]);
+  lrtr_ip_str_to_addr(TEST_PREFETCH_PFX[1], &prefix);
+  ret |= backend_table_lookup(&cfg->cfg_val.pfxt[0], TEST_PARSER_ASN[2],
+                              &prefix, 16, &state[1]);
+  CHECK_RESULT("", "Publish the prefetched epoch",
+               !ret && cfg->cfg_val.epoch == next && !prefetch->running &&
+                 state[0] == BGP_PFXV_STATE_NOT_FOUND &&
+                 state[1] == BGP_PFXV_STATE_VALID);
+
+  cfg_destroy(cfg);
+  for (int i = 0; i < 2; i++) {
+    remove(TEST_PREFETCH_PATHS[i]);
+  }
+  return 0;
+}
+
+int test_rpki_config_epochs()
+{
+  /** validation_find_epoch / cfg_load_epoch **/
+  const char *content[] = {TEST_PARSER_CSV, TEST_PREFETCH_CSV};
+  int ret = create_dummy_roa_dumps(TEST_PREFETCH_PATHS, content, 2);
+  rpki_cfg_t *cfg = cfg_create(TEST_PREFETCH_PJ_CC, TEST_EPOCHS_TIMEWDW, 0,
+                               1, NULL, NULL);
+  cfg->cfg_input.epochs = TEST_EPOCHS;
+
+  /* Broker response of three consecutive ROA dumps */
+  config_broker_t *broker = &cfg->cfg_broker;
+  create_dummy_broker_index_paths(cfg, TEST_EPOCHS_TS, TEST_PREFETCH_PATHS, 2,
+                                  TEST_EPOCHS_COUNT);
+
+  /* Every replaced epoch is kept for out-of-order timestamps */
+  config_time_t *cfg_time = &cfg->cfg_time;
+  config_validation_t *val = &cfg->cfg_val;
+  char urls[BROKER_ROA_URLS_LEN] = {0};
+  ret |= cfg_get_timestamps(cfg, TEST_EPOCHS_TS[0], urls);
+  ret |= cfg_switch_epoch(cfg, cfg_time->current_roa_timestamp, urls);
+  for (int i = 1; i < TEST_EPOCHS_COUNT - 1; i++) {
+    broker->index_used++;
+    cfg_time->current_roa_timestamp = cfg_time->next_roa_timestamp;
+    cfg_time->next_roa_timestamp = cfg_next_timestamp(cfg, TEST_EPOCHS_TS[i]);
+    ret |= cfg_switch_epoch(cfg, TEST_EPOCHS_TS[i], TEST_PREFETCH_PATHS[i % 2]);
+  }
+  validation_epoch_t *epoch;
+  epoch = validation_find_epoch(cfg, TEST_EPOCHS_TS[0] + 60);
+  struct lrtr_ip_addr prefix;
+  enum pfxv_state state = BGP_PFXV_STATE_NOT_FOUND;
+  lrtr_ip_str_to_addr(TEST_PREFETCH_PFX[0], &prefix);
+  ret |= (epoch == NULL);
+  ret |= (epoch != NULL && backend_table_lookup(&epoch->pfxt[0],
+                                                TEST_PARSER_ASN[0], &prefix,
+                                                24, &state));
+  CHECK_RESULT("", "Find the previous epoch",
+               !ret && val->recent_count == 1 &&
+                 epoch->timestamp == TEST_EPOCHS_TS[0] &&
+                 epoch->expires == TEST_EPOCHS_TS[1] &&
+                 state == BGP_PFXV_STATE_VALID);
+
+  /* The least recently used epoch is evicted beyond the count */
+  broker->index_used++;
+  cfg_time->current_roa_timestamp = cfg_time->next_roa_timestamp;
+  cfg_time->next_roa_timestamp = cfg_next_timestamp(cfg, TEST_EPOCHS_TS[2]);
+  ret = cfg_switch_epoch(cfg, TEST_EPOCHS_TS[2], TEST_PREFETCH_PATHS[0]);
+  CHECK_RESULT("", "Evict the least recently used epoch",
+               !ret && val->recent_count == TEST_EPOCHS &&
+                 validation_find_epoch(cfg, TEST_EPOCHS_TS[0]) == NULL &&
+                 validation_find_epoch(cfg, TEST_EPOCHS_TS[1]) != NULL);
+
+  /* An evicted epoch is imported again on demand */
+  epoch = cfg_load_epoch(cfg, TEST_EPOCHS_TS[0] + 60);
+  state = BGP_PFXV_STATE_NOT_FOUND;
+  ret = (epoch == NULL);
+  ret |= (epoch != NULL && backend_table_lookup(&epoch->pfxt[0],
+                                                TEST_PARSER_ASN[0], &prefix,
+                                                24, &state));
+  CHECK_RESULT("", "Load an evicted epoch on demand",
+               !ret && val->recent_count == TEST_EPOCHS &&
+                 val->recent[0] == epoch &&
+                 epoch->timestamp == TEST_EPOCHS_TS[0] &&
+                 state == BGP_PFXV_STATE_VALID);
+
+  cfg_destroy(cfg);
+  for (int i = 0; i < 2; i++) {
+    remove(TEST_PREFETCH_PATHS[i]);
+  }
+  return 0;
+}
+
+/* Changes reported to the change feed of the test */
+typedef struct struct_test_feed_t {
+  int calls;
+  uint32_t timestamp[TEST_EPOCHS_COUNT];
+  size_t added[TEST_EPOCHS_COUNT];
+  size_t removed[TEST_EPOCHS_COUNT];
+} test_feed_t;
+
+void test_change_feed(const char *project, const char *collector,
+                      uint32_t timestamp, const roa_record_t *added,
+                      size_t added_count, const roa_record_t *removed,
+                      size_t removed_count, void *data)
+{
+  test_feed_t *feed = (test_feed_t *)data;
+  if (feed->calls < TEST_EPOCHS_COUNT &&
+      !strcmp(collector, strchr(TEST_PREFETCH_PJ_CC, ':') + 1)) {
+    feed->timestamp[feed->calls] = timestamp;
+    feed->added[feed->calls] = added_count;
+    feed->removed[feed->calls] = removed_count;
+  }
+  feed->calls++;
+}
+
+int test_rpki_config_change_feed()
+{
+  /** validation_set_change_feed / validation_report_changes **/
+  const char *content[] = {TEST_PARSER_CSV, TEST_PREFETCH_CSV};
+  int ret = create_dummy_roa_dumps(TEST_PREFETCH_PATHS, content, 2);
+  rpki_cfg_t *cfg = cfg_create(TEST_PREFETCH_PJ_CC, TEST_EPOCHS_TIMEWDW, 0,
+                               1, NULL, NULL);
+  cfg->cfg_input.prefetch = 1;
+  test_feed_t feed;
+  memset(&feed, 0, sizeof(feed));
+  ret |= rpki_set_change_feed(cfg, test_change_feed, &feed);
+
+  /* Broker response of three consecutive ROA dumps */
+  config_broker_t *broker = &cfg->cfg_broker;
+  create_dummy_broker_index_paths(cfg, TEST_EPOCHS_TS, TEST_PREFETCH_PATHS, 2,
+                                  TEST_EPOCHS_COUNT);
+
+  /* Every epoch advance reports the difference to the previous ROA dump (the
+     epochs after the first one are prefetched) */
+  config_time_t *cfg_time = &cfg->cfg_time;
+  char urls[BROKER_ROA_URLS_LEN] = {0};
+  ret |= cfg_get_timestamps(cfg, TEST_EPOCHS_TS[0], urls);
+  ret |= cfg_switch_epoch(cfg, cfg_time->current_roa_timestamp, urls);
+  for (int i = 1; i < TEST_EPOCHS_COUNT; i++) {
+    broker->index_used++;
+    cfg_time->current_roa_timestamp = cfg_time->next_roa_timestamp;
+    cfg_time->next_roa_timestamp = cfg_next_timestamp(cfg, TEST_EPOCHS_TS[i]);
+    ret |= cfg_switch_epoch(cfg, TEST_EPOCHS_TS[i], TEST_PREFETCH_PATHS[i % 2]);
+  }
+  int valid = (!ret && feed.calls == TEST_EPOCHS_COUNT);
+  for (int i = 0; valid && i < TEST_EPOCHS_COUNT; i++) {
+    valid &= (feed.timestamp[i] == TEST_EPOCHS_TS[i] &&
+              feed.added[i] == TEST_FEED_ADDED[i] &&
+              feed.removed[i] == TEST_FEED_REMOVED[i]);
+  }
+  CHECK_RESULT("", "Report the changes of every epoch", valid);
+
+  /* An unchanged ROA dump and a disabled change feed report nothing */
+  ret = cfg_switch_epoch(cfg, TEST_EPOCHS_TS[2], TEST_PREFETCH_PATHS[0]);
+  ret |= rpki_set_change_feed(cfg, NULL, NULL);
+  ret |= cfg_switch_epoch(cfg, TEST_EPOCHS_TS[1], TEST_PREFETCH_PATHS[1]);
+  CHECK_RESULT("", "No report without changes or feed",
+               !ret && feed.calls == TEST_EPOCHS_COUNT);
+
+  cfg_destroy(cfg);
+  for (int i = 0; i < 2; i++) {
+    remove(TEST_PREFETCH_PATHS[i]);
+  }
+  return 0;
+}
+
+int test_rpki_config_divergence()
+{
+  /** roa_set_merge / validation_set_divergence **/
+  const char *content[] = {TEST_PARSER_CSV, TEST_PREFETCH_CSV};
+  roa_set_t sets[TEST_DIVERGENCE_COLLECTORS];
+  int ret = 0;
+  for (int i = 0; i < TEST_DIVERGENCE_COLLECTORS; i++) {
+    roa_parser_t parser;
+    ret |= roa_set_init(&sets[i]);
+    roa_parser_init(&parser, test_roa_set_record, &sets[i]);
+    if (i < 2) {
+      ret |= roa_parser_feed(&parser, content[i], strlen(content[i]));
+      ret |= roa_parser_finish(&parser);
+    }
+    roa_set_unique(&sets[i]);
+  }
+
+  /* Only records missing at a collector with a ROA dump are divergent */
+  validation_epoch_t epoch;
+  memset(&epoch, 0, sizeof(epoch));
+  ret |= validation_set_divergence(&epoch, sets, TEST_DIVERGENCE_ACTIVE,
+                                   TEST_DIVERGENCE_COLLECTORS);
+  int valid = (!ret && epoch.divergence_count == TEST_DIVERGENCE_COUNT);
+  for (size_t i = 0; valid && i < epoch.divergence_count; i++) {
+    valid &= (epoch.divergence[i].collectors == TEST_DIVERGENCE_MASK);
+    valid &= (!i || epoch.divergence[i - 1].record.asn <=
+                      epoch.divergence[i].record.asn);
+  }
+  CHECK_RESULT("", "Divergent records of the ROA dumps", valid);
+
+  /* An empty ROA dump of an active collector makes every record divergent */
+  int active[TEST_DIVERGENCE_COLLECTORS] = {1, 1, 1};
+  ret = validation_set_divergence(&epoch, sets, active,
+                                  TEST_DIVERGENCE_COLLECTORS);
+  CHECK_RESULT("", "Divergent records with an empty dump",
+               !ret && epoch.divergence_count == TEST_DIVERGENCE_COUNT_ALL);
+
+  free(epoch.divergence);
+  for (int i = 0; i < TEST_DIVERGENCE_COLLECTORS; i++) {
+    roa_set_free(&sets[i]);
+  }
+  return 0;
+}
+
+int test_rpki_config_shared_tables()
+{
+  /** registry_acquire / backend_shared_wrap **/
+  const char *content[] = {TEST_PARSER_CSV, TEST_PREFETCH_CSV};
+  int ret = create_dummy_roa_dumps(TEST_PREFETCH_PATHS, content, 2);
+
+  /* Every configuration importing the same ROA dump uses one shared table */
+  rpki_cfg_t *cfgs[TEST_SHARED_CONFIGS];
+  for (int i = 0; i < TEST_SHARED_CONFIGS; i++) {
+    cfgs[i] = cfg_create(TEST_PREFETCH_PJ_CC, TEST_PREFETCH_TIMEWDW, 0, 1,
+                         NULL, NULL);
+    cfgs[i]->cfg_input.shared = 1;
+    ret |= cfg_parse_urls(cfgs[i], TEST_PREFETCH_PATHS[0]);
+  }
+  struct lrtr_ip_addr prefix;
+  enum pfxv_state state = BGP_PFXV_STATE_NOT_FOUND;
+  lrtr_ip_str_to_addr(TEST_PREFETCH_PFX[0], &prefix);
+  int valid = (!ret && registry_count() == 1);
+  for (int i = 0; valid && i < TEST_SHARED_CONFIGS; i++) {
+    backend_table_t *tbl = &cfgs[i]->cfg_val.pfxt[0];
+    valid &= (tbl->ops == &backend_shared_ops &&
+              !backend_table_lookup(tbl, TEST_PARSER_ASN[0], &prefix, 24,
+                                    &state) &&
+              state == BGP_PFXV_STATE_VALID);
+  }
+  CHECK_RESULT("", "Share the prefix table of a ROA dump", valid);
+
+  /* A shared table is released with the last configuration using it */
+  ret = cfg_parse_urls(cfgs[0], TEST_PREFETCH_PATHS[1]);
+  valid = (!ret && registry_count() == 2);
+  for (int i = 1; i < TEST_SHARED_CONFIGS; i++) {
+    ret |= cfg_parse_urls(cfgs[i], TEST_PREFETCH_PATHS[1]);
+  }
+  CHECK_RESULT("", "Release the shared prefix tables",
+               valid && !ret && registry_count() == 1);
+
+  for (int i = 0; i < TEST_SHARED_CONFIGS; i++) {
+    cfg_destroy(cfgs[i]);
+  }
+  CHECK_RESULT("", "Release the shared tables on destroy",
+               registry_count() == 0);
+  for (int i = 0; i < 2; i++) {
+    remove(TEST_PREFETCH_PATHS[i]);
+  }
+  return 0;
+}
+
+int test_rpki_config_epoch_image()
+{
+  /** validation_write_image / validation_map_image /
+      validation_evict_images **/
+  const char *content[] = {TEST_PARSER_CSV, TEST_PREFETCH_CSV};
+  int ret = create_dummy_roa_dumps(TEST_PREFETCH_PATHS, content, 2);
+
+  /* The first process imports the ROA dump and publishes the epoch image */
+  rpki_cfg_t *cfgs[2];
+  char image[CACHE_MAX_PATH_LEN];
+  for (int i = 0; i < 2; i++) {
+    cfgs[i] = cfg_create(TEST_PREFETCH_PJ_CC, TEST_PREFETCH_TIMEWDW, i, 1,
+                         NULL, NULL);
+    ret |= utils_cfg_add_option(cfgs[i], OPTION_SHM, TEST_IMAGE_SHM_DIR);
+    cfgs[i]->cfg_time.current_roa_timestamp = TEST_PREFETCH_TS[0];
+  }
+  ret |= validation_image_path(cfgs[0], TEST_PREFETCH_PATHS[0], image,
+                               sizeof(image));
+  ret |= cfg_parse_urls(cfgs[0], TEST_PREFETCH_PATHS[0]);
+  CHECK_RESULT("", "Publish the epoch image",
+               !ret && !access(image, R_OK) &&
+                 cfgs[0]->cfg_val.pfxt[0].ops == cfgs[0]->cfg_val.backend);
+
+  /* Another process maps the epoch image without reading the ROA dump */
+  remove(TEST_PREFETCH_PATHS[0]);
+  ret = cfg_parse_urls(cfgs[1], TEST_PREFETCH_PATHS[0]);
+  struct lrtr_ip_addr prefix;
+  enum pfxv_state state = BGP_PFXV_STATE_NOT_FOUND;
+  lrtr_ip_str_to_addr(TEST_PREFETCH_PFX[0], &prefix);
+  backend_table_t *tbl = &cfgs[1]->cfg_val.pfxt[0];
+  ret |= backend_table_lookup(tbl, TEST_PARSER_ASN[0], &prefix, 24, &state);
+  CHECK_RESULT("", "Map the epoch image of another process",
+               !ret && tbl->ops == &backend_index_ops &&
+                 state == BGP_PFXV_STATE_VALID);
+
+  /* Only the most recent image is kept, the mapping of the evicted image
+     stays valid */
+  char next[CACHE_MAX_PATH_LEN];
+  ret = utils_cfg_add_option(cfgs[0], OPTION_SHM_COUNT, TEST_IMAGE_SHM_COUNT);
+  ret |= validation_image_path(cfgs[0], TEST_PREFETCH_PATHS[1], next,
+                               sizeof(next));
+  cfgs[0]->cfg_time.current_roa_timestamp = TEST_PREFETCH_TS[1];
+  ret |= cfg_parse_urls(cfgs[0], TEST_PREFETCH_PATHS[1]);
+  ret |= backend_table_lookup(tbl, TEST_PARSER_ASN[0], &prefix, 24, &state);
+  CHECK_RESULT("", "Evict the older epoch image",
+               !ret && !access(next, R_OK) && access(image, F_OK) != 0 &&
+                 state == BGP_PFXV_STATE_VALID);
+
+  for (int i = 0; i < 2; i++) {
+    cfg_destroy(cfgs[i]);
+  }
+  remove(image);
+  remove(next);
+  remove(TEST_PREFETCH_PATHS[1]);
+  return 0;
+}
+
+int test_rpki_config_roa_index()
+{
+  /** roa_index_builder_write / roa_index_open / roa_index_lookup **/
+  const char *content[] = {TEST_PARSER_CSV, TEST_PREFETCH_CSV, NULL,
+                           TEST_PARSER_CSV};
+  roa_index_builder_t builder;
+  roa_index_builder_init(&builder);
+  int collector = roa_index_builder_collector(&builder, TEST_PREFETCH_PJ_CC);
+  int ret = (collector != 0);
+  for (int i = 0; i < TEST_INDEX_COUNT && !ret; i++) {
+    if (content[i] == NULL) {
+      continue;
+    }
+    roa_parser_t parser;
+    roa_set_t set;
+    roa_set_init(&set);
+    roa_parser_init(&parser, test_roa_set_record, &set);
+    ret |= roa_parser_feed(&parser, content[i], strlen(content[i]));
+    ret |= roa_parser_finish(&parser);
+    ret |= roa_index_builder_add(&builder, collector, TEST_INDEX_TS[i], &set);
+  }
+  ret |= roa_index_builder_write(&builder, TEST_INDEX_PATH);
+  roa_index_builder_free(&builder);
+  CHECK_RESULT("", "Write a temporal ROA index", !ret);
+
+  roa_index_t index;
+  ret = roa_index_open(&index, TEST_INDEX_PATH);
+  CHECK_RESULT("", "Map a temporal ROA index",
+               !ret && index.header->start == TEST_INDEX_TS[0] &&
+                 index.header->end == TEST_INDEX_TS[TEST_INDEX_COUNT - 1] +
+                                        ROA_ARCHIVE_INTERVAL &&
+                 index.collectors[0].count == TEST_INDEX_INTERVALS &&
+                 roa_index_collector(&index, TEST_PREFETCH_PJ_CC) == 0);
+
+  /* Every timestamp of a ROA dump has to yield the records of this dump, the
+     missing ROA dump interrupts the collector */
+  struct lrtr_ip_addr prefix;
+  lrtr_ip_str_to_addr(TEST_PREFETCH_PFX[0], &prefix);
+  int valid = !ret;
+  for (int i = 0; valid && i < TEST_INDEX_COUNT; i++) {
+    struct pfx_record *reason = NULL;
+    unsigned int reason_len = 0;
+    enum pfxv_state state;
+    valid &= (!roa_index_lookup(&index, 1, TEST_INDEX_TS[i] + 60,
+                                TEST_PARSER_ASN[0], &prefix, 24, &reason,
+                                &reason_len, &state) &&
+              state == TEST_INDEX_STATE[i] &&
+              reason_len == (state == BGP_PFXV_STATE_VALID) &&
+              roa_index_active(&index, 0, TEST_INDEX_TS[i] + 60) ==
+                TEST_INDEX_ACTIVE[i]);
+    free(reason);
+  }
+  CHECK_RESULT("", "Lookup at the timestamps of the dumps", valid);
+  CHECK_RESULT("", "No ROA dump outside of the interval",
+               !ret && !roa_index_active(&index, 0, TEST_INDEX_TS[0] - 1) &&
+                 !roa_index_active(&index, 0, index.header->end));
+  roa_index_close(&index);
+
+  /* A corrupt index has to be rejected */
+  FILE *file = fopen(TEST_INDEX_PATH, "r+b");
+  ret = (file == NULL || fseek(file, -1, SEEK_END) || fputc('X', file) == EOF);
+  ret |= (file != NULL && fclose(file));
+  PRINT_INTENDED_ERR;
+  ret |= (roa_index_open(&index, TEST_INDEX_PATH) != -1);
+  CHECK_RESULT("", "Reject a corrupt temporal ROA index", !ret);
+  remove(TEST_INDEX_PATH);
+
+  return 0;
+}
+
+int test_rpki_config_import_roa_files(rpki_cfg_t *cfg)
+{
+  /** cfg_import_roa_files **/
+  char testcase[TEST_BUF_LEN];
+  char *paths[] = {TEST_IMP_URL, TEST_IMP_URL};
+  backend_table_t tbl[2];
+  backend_table_t *pfxts[2];
+  int threads = cfg->cfg_input.threads;
+  int unified = cfg->cfg_input.unified;
+  cfg->cfg_input.threads = TEST_PART_THREADS;
+
+  /* IPv6 records of all RIRs (within 2000::/3) use several partitions */
+  roa_parser_t parser;
+  roa_set_t set;
+  roa_set_init(&set);
+  roa_parser_init(&parser, test_roa_set_record, &set);
+  int built = (!roa_parser_feed(&parser, TEST_PART_V6_CSV,
+                                strlen(TEST_PART_V6_CSV)) &&
+               !roa_parser_finish(&parser));
+  void *part = (built ? backend_part_create(backend_get(NULL), &set, 1, NULL,
+                                            TEST_PART_THREADS)
+                      : NULL);
+  CHECK_RESULT("", "Spread IPv6 records over partitions",
+               part != NULL && backend_part_used(part, ROA_IPV6) > 1);
+  backend_part_ops.destroy(part);
+  roa_set_free(&set);
+
+  /* Import the same ROA dump twice into a partitioned prefix table (unified)
+     and into two prefix tables (discrete) */
+  for (int u = 1; u >= 0; u--) {
+    for (int t = 0; t < 2; t++) {
+      backend_table_init(&tbl[t], &backend_rtr_ops, NULL, NULL);
+      pfxts[t] = &tbl[u ? 0 : t];
+    }
+    cfg->cfg_input.unified = u;
+    int ret = cfg_import_roa_files(cfg, paths, pfxts, NULL, 2);
+    if (u) {
+      CHECK_RESULT("", "Build a partitioned prefix table",
+                   !ret && tbl[0].ops == &backend_part_ops);
+    } else {
+      CHECK_RESULT("", "Import two prefix tables in a pipeline", !ret);
+    }
+
+    struct lrtr_ip_addr prefix;
+    enum pfxv_state state;
+    for (int i = 0; i < TEST_PART_COUNT; i++) {
+      lrtr_ip_str_to_addr(TEST_PART_PFX[i], &prefix);
+      for (int t = 0; t < 2 - u; t++) {
+        ret = backend_table_lookup(&tbl[t], TEST_PART_ASN[i], &prefix,
+                                   TEST_PART_MSKL[i], &state);
+        snprintf(testcase, sizeof(testcase),
+                 "#%i - Table %i: AS%" PRIu32 " %s/%" PRIu8, i + 1, t + 1,
+                 TEST_PART_ASN[i], TEST_PART_PFX[i], TEST_PART_MSKL[i]);
+        CHECK_RESULT("", testcase, !ret && state == TEST_PART_RST[i]);
+      }
+    }
+    for (int t = 0; t < 2; t++) {
+      backend_table_free(&tbl[t]);
+    }
+  }
+
+  /* Unchanged ROA dumps (same content hash) are not inserted again, their
+     prefix tables are left empty (serial import and pipeline) */
+  uint64_t hashes[2];
+  struct lrtr_ip_addr prefix;
+  enum pfxv_state state[2];
+  lrtr_ip_str_to_addr(TEST_PART_PFX[0], &prefix);
+  for (int serial = 1; serial >= 0; serial--) {
+    cfg->cfg_input.threads = (serial ? 1 : TEST_PART_THREADS);
+    memset(hashes, 0, sizeof(hashes));
+    for (int run = 0; run < 3; run++) {
+      for (int t = 0; t < 2; t++) {
+        backend_table_init(&tbl[t], &backend_rtr_ops, NULL, NULL);
+        pfxts[t] = &tbl[t];
+      }
+      hashes[1] = (run == 2 ? 0 : hashes[1]);
+      int ret = cfg_import_roa_files(cfg, paths, pfxts, hashes, 2);
+      for (int t = 0; t < 2; t++) {
+        backend_table_lookup(&tbl[t], TEST_PART_ASN[0], &prefix,
+                             TEST_PART_MSKL[0], &state[t]);
+        backend_table_free(&tbl[t]);
+      }
+      enum pfxv_state rst = (run == 0 ? TEST_PART_RST[0]
+                                      : BGP_PFXV_STATE_NOT_FOUND);
+      snprintf(testcase, sizeof(testcase), "%s ROA dumps (%s)",
+               run == 0 ? "Import new" : (run == 1 ? "Skip unchanged"
+                                                   : "Import changed"),
+               serial ? "serial" : "pipeline");
+      CHECK_RESULT("", testcase, !ret && hashes[0] && hashes[0] == hashes[1] &&
+                                   state[0] == rst &&
+                                   state[1] == (run == 2 ? TEST_PART_RST[0]
+                                                         : rst));
+    }
+  }
+
+  /* The prefix table of an unchanged ROA dump shares the records of the
+     previous one, the records are kept until both tables are released */
+  for (int t = 0; t < 2; t++) {
+    backend_table_init(&tbl[t], &backend_rtr_ops, NULL, NULL);
+    pfxts[t] = &tbl[t];
+  }
+  int ret = cfg_import_roa_files(cfg, paths, pfxts, NULL, 1);
+  ret |= backend_shared_reuse(&tbl[1], &tbl[0]);
+  ret |= (tbl[0].ops != &backend_shared_ops || registry_count() != 0);
+  backend_table_lookup(&tbl[0], TEST_PART_ASN[0], &prefix, TEST_PART_MSKL[0],
+                       &state[0]);
+  backend_table_free(&tbl[0]);
+  backend_table_lookup(&tbl[1], TEST_PART_ASN[0], &prefix, TEST_PART_MSKL[0],
+                       &state[1]);
+  backend_table_free(&tbl[1]);
+  CHECK_RESULT("", "Share the table of an unchanged dump",
+               !ret && state[0] == TEST_PART_RST[0] &&
+               state[1] == TEST_PART_RST[0]);
+
+  cfg->cfg_input.threads = threads;
+  cfg->cfg_input.unified = unified;
   return 0;
 }
 
@@ -225,15 +1121,195 @@ int test_rpki_config_add_record_to_pfx_table()
   return 0;
 }
 
+int test_rpki_config_minimize_roa_set()
+{
+  /** roa_set_minimize **/
+  char testcase[TEST_BUF_LEN];
+  char address[TEST_BUF_LEN];
+  uint8_t min_len = 0;
+  struct pfx_table pfxt, pfxt_min;
+  pfx_table_init(&pfxt, NULL);
+  pfx_table_init(&pfxt_min, NULL);
+  roa_set_t set;
+  roa_set_init(&set);
+
+  /* Import all records into the full prefix table and the ROA set */
+  for (int i = 0; i < TEST_MIN_COUNT; i++) {
+    utils_cfg_validity_check_prefix(TEST_MIN_PFX[i], address, &min_len);
+    cfg_add_record_to_pfx_table(TEST_MIN_ASN[i], address, min_len,
+                                TEST_MIN_MAXL[i], &pfxt);
+    cfg_add_record_to_roa_set(TEST_MIN_ASN[i], address, min_len,
+                              TEST_MIN_MAXL[i], &set);
+  }
+
+  /* Minimize the ROA set and import it into the second prefix table */
+  size_t removed = roa_set_minimize(&set);
+  struct pfx_record pfx;
+  for (size_t i = 0; i < set.count; i++) {
+    roa_record_to_pfx_record(&set.records[i], &pfx);
+    pfx_table_add(&pfxt_min, &pfx);
+  }
+  snprintf(testcase, sizeof(testcase), "Minimize %i records to %i records",
+           TEST_MIN_COUNT, TEST_MIN_RST_COUNT);
+  CHECK_RESULT("", testcase, set.count == TEST_MIN_RST_COUNT &&
+                               removed == TEST_MIN_COUNT - TEST_MIN_RST_COUNT);
+
+  /* The validation state has to be identical for both prefix tables */
+  struct lrtr_ip_addr prefix;
+  enum pfxv_state state, state_min;
+  for (int i = 0; i < TEST_MIN_VAL_COUNT; i++) {
+    lrtr_ip_str_to_addr(TEST_MIN_VAL_PFX[i], &prefix);
+    pfx_table_validate(&pfxt, TEST_MIN_VAL_ASN[i], &prefix,
+                       TEST_MIN_VAL_MSKL[i], &state);
+    pfx_table_validate(&pfxt_min, TEST_MIN_VAL_ASN[i], &prefix,
+                       TEST_MIN_VAL_MSKL[i], &state_min);
+    snprintf(testcase, sizeof(testcase), "#%i - AS%" PRIu32 " %s/%" PRIu8,
+             i + 1, TEST_MIN_VAL_ASN[i], TEST_MIN_VAL_PFX[i],
+             TEST_MIN_VAL_MSKL[i]);
+    CHECK_RESULT("", testcase,
+                 state == state_min && state == TEST_MIN_VAL_RST[i]);
+  }
+
+  roa_set_free(&set);
+  pfx_table_free(&pfxt);
+  pfx_table_free(&pfxt_min);
+  return 0;
+}
+
+int test_rpki_config_backend_differential(arena_t *arena)
+{
+  /** backend_table_lookup_with_reasons **/
+  char testcase[TEST_BUF_LEN];
+  char address[TEST_BUF_LEN];
+  uint8_t min_len = 0;
+  backend_table_t tbl;
+  backend_table_init(&tbl, &backend_array_ops, &backend_rtr_ops, arena);
+
+  /* Import all records into the array backend and the RTRlib reference */
+  for (int i = 0; i < TEST_MIN_COUNT; i++) {
+    utils_cfg_validity_check_prefix(TEST_MIN_PFX[i], address, &min_len);
+    cfg_add_record_to_table(TEST_MIN_ASN[i], address, min_len,
+                            TEST_MIN_MAXL[i], &tbl);
+  }
+
+  /* Every lookup (state and reasons) has to match the reference backend */
+  struct lrtr_ip_addr prefix;
+  struct pfx_record *reason = NULL;
+  unsigned int reason_len = 0;
+  enum pfxv_state state;
+  for (int i = 0; i < TEST_MIN_VAL_COUNT; i++) {
+    lrtr_ip_str_to_addr(TEST_MIN_VAL_PFX[i], &prefix);
+    int ret = backend_table_lookup_with_reasons(&tbl, TEST_MIN_VAL_ASN[i],
+                                                &prefix, TEST_MIN_VAL_MSKL[i],
+                                                &reason, &reason_len, &state);
+    snprintf(testcase, sizeof(testcase), "#%i - AS%" PRIu32 " %s/%" PRIu8,
+             i + 1, TEST_MIN_VAL_ASN[i], TEST_MIN_VAL_PFX[i],
+             TEST_MIN_VAL_MSKL[i]);
+    CHECK_RESULT("", testcase, !ret && state == TEST_MIN_VAL_RST[i]);
+    free(reason);
+    reason = NULL;
+  }
+  CHECK_RESULT("", "No mismatches of the rtrlib backend",
+               tbl.lookups == TEST_MIN_VAL_COUNT && !tbl.mismatches);
+
+  backend_table_free(&tbl);
+  if (arena != NULL) {
+    size_t mapped = arena_memory_usage(arena);
+    arena_reset(arena);
+    CHECK_RESULT("", "Release the arena at once",
+                 mapped > 0 && !arena_memory_usage(arena));
+
+    /* A chunk larger than the default is mapped in whole huge pages */
+    arena_t huge;
+    arena_init(&huge, 0, 1);
+    void *ptr = arena_alloc(&huge, ARENA_CHUNK_SIZE + 1);
+    mapped = arena_memory_usage(&huge);
+    arena_reset(&huge);
+    CHECK_RESULT("", "Round huge chunks to the huge page size",
+                 ptr != NULL && mapped > ARENA_CHUNK_SIZE &&
+                 !(mapped % ARENA_HUGE_PAGE_SIZE));
+  }
+  return 0;
+}
+
+int test_rpki_config_backend_delta()
+{
+  /** backend_table_update **/
+  char testcase[TEST_BUF_LEN];
+  char address[TEST_BUF_LEN];
+  uint8_t min_len = 0;
+  backend_table_t tbl, ref;
+  backend_table_init(&tbl, &backend_array_ops, &backend_rtr_ops, NULL);
+  backend_table_init(&ref, &backend_rtr_ops, NULL, NULL);
+  roa_set_t prev, next, empty;
+  roa_set_init(&prev);
+  roa_set_init(&next);
+  roa_set_init(&empty);
+
+  /* The previous and the next ROA set overlap in some records */
+  for (int i = 0; i < TEST_MIN_COUNT; i++) {
+    utils_cfg_validity_check_prefix(TEST_MIN_PFX[i], address, &min_len);
+    if (i < TEST_DELTA_PREV_COUNT) {
+      cfg_add_record_to_roa_set(TEST_MIN_ASN[i], address, min_len,
+                                TEST_MIN_MAXL[i], &prev);
+    }
+    if (i >= TEST_DELTA_NEXT_FIRST) {
+      cfg_add_record_to_roa_set(TEST_MIN_ASN[i], address, min_len,
+                                TEST_MIN_MAXL[i], &next);
+      cfg_add_record_to_table(TEST_MIN_ASN[i], address, min_len,
+                              TEST_MIN_MAXL[i], &ref);
+    }
+  }
+  roa_set_unique(&prev);
+  roa_set_unique(&next);
+
+  size_t added = 0, removed = 0;
+  int ret = backend_table_update(&tbl, &prev, &added, &removed);
+  CHECK_RESULT("", "Update an empty prefix table",
+               !ret && added == TEST_DELTA_PREV_COUNT && !removed);
+  ret = backend_table_update(&tbl, &next, &added, &removed);
+  snprintf(testcase, sizeof(testcase), "Apply %i added and %i removed records",
+           TEST_DELTA_ADDED, TEST_DELTA_REMOVED);
+  CHECK_RESULT("", testcase, !ret && added == TEST_DELTA_ADDED &&
+                               removed == TEST_DELTA_REMOVED);
+
+  /* The updated table has to match a table built from the next records */
+  struct lrtr_ip_addr prefix;
+  enum pfxv_state state, state_ref;
+  for (int i = 0; i < TEST_MIN_VAL_COUNT; i++) {
+    lrtr_ip_str_to_addr(TEST_MIN_VAL_PFX[i], &prefix);
+    ret = backend_table_lookup(&tbl, TEST_MIN_VAL_ASN[i], &prefix,
+                               TEST_MIN_VAL_MSKL[i], &state);
+    backend_table_lookup(&ref, TEST_MIN_VAL_ASN[i], &prefix,
+                         TEST_MIN_VAL_MSKL[i], &state_ref);
+    snprintf(testcase, sizeof(testcase), "#%i - AS%" PRIu32 " %s/%" PRIu8,
+             i + 1, TEST_MIN_VAL_ASN[i], TEST_MIN_VAL_PFX[i],
+             TEST_MIN_VAL_MSKL[i]);
+    CHECK_RESULT("", testcase, !ret && state == state_ref);
+  }
+  CHECK_RESULT("", "No mismatches of the rtrlib backend",
+               tbl.lookups == TEST_MIN_VAL_COUNT && !tbl.mismatches);
+
+  /* An empty ROA set removes all records */
+  ret = backend_table_update(&tbl, &empty, &added, &removed);
+  CHECK_RESULT("", "Remove all records",
+               !ret && !added && !tbl.records.count &&
+                 removed == TEST_MIN_COUNT - TEST_DELTA_NEXT_FIRST);
+
+  backend_table_free(&tbl);
+  backend_table_free(&ref);
+  return 0;
+}
+
 int test_rpki_config_next_timestamp(rpki_cfg_t *cfg)
 {
   /* cfg_next_timestamp */
   config_time_t *cfg_time = &cfg->cfg_time;
   char testcase[TEST_BUF_LEN];
   int skipped_cnt = TEST_TS_COUNT - 2;
-  create_dummy_broker_kh(cfg, TEST_TS_NTS, skipped_cnt);
+  create_dummy_broker_index(cfg, TEST_TS_NTS, skipped_cnt);
   for (int i = 0; i < skipped_cnt; i++) {
-    cfg->cfg_broker.broker_khash_used++;
+    cfg->cfg_broker.index_used++;
     cfg_time->next_roa_timestamp = cfg_next_timestamp(cfg, TEST_TS_NTS[i]);
     snprintf(testcase, sizeof(testcase), "#%i - %10" PRIu32 " - Next timestamp",
              i + 1, TEST_TS_NTS[i]);
@@ -247,6 +1323,39 @@ int test_rpki_config_next_timestamp(rpki_cfg_t *cfg)
   return 0;
 }
 
+int test_rpki_config_epoch_stride()
+{
+  /* cfg_next_timestamp (epoch stride and bucket) */
+  char testcase[TEST_BUF_LEN];
+  rpki_cfg_t *cfg = cfg_create(TEST_TS_PROJECT_COLLECTOR,
+                               TEST_TS_HISTORY_TIMEWDW, 0, 1, NULL, NULL);
+  config_input_t *input = &cfg->cfg_input;
+  config_time_t *cfg_time = &cfg->cfg_time;
+  create_dummy_broker_index(cfg, TEST_TS, TEST_TS_COUNT);
+  for (int run = 0; run < 2; run++) {
+    input->epoch_stride = run ? 0 : TEST_STRIDE;
+    input->epoch_bucket = run ? TEST_STRIDE_BUCKET : 0;
+    uint32_t *nts = run ? TEST_BUCKET_NTS : TEST_STRIDE_NTS;
+
+    /* Every switch to the next timestamp marks its ROA file as used */
+    uint32_t current_ts = TEST_TS[0];
+    cfg->cfg_broker.index_used = 0;
+    for (int i = 0; i < TEST_STRIDE_COUNT; i++) {
+      cfg_time->next_roa_timestamp = cfg_next_timestamp(cfg, current_ts);
+      snprintf(testcase, sizeof(testcase),
+               "#%i - %10" PRIu32 " - Next timestamp (%s)", i + 1,
+               current_ts, run ? "bucket" : "stride");
+      CHECK_RESULT("", testcase, cfg_time->next_roa_timestamp == nts[i]);
+      cfg->cfg_broker.index_used++;
+      current_ts = cfg_time->next_roa_timestamp;
+    }
+    CHECK_RESULT("", "Last skipped ROA file",
+                 cfg_time->skipped_roa_timestamp == TEST_TS_6);
+  }
+  cfg_destroy(cfg);
+  return 0;
+}
+
 int test_rpki_config_get_timestamps(rpki_cfg_t *cfg)
 {
   /* cfg_get_timestamps */
@@ -255,9 +1364,9 @@ int test_rpki_config_get_timestamps(rpki_cfg_t *cfg)
   char testcase[TEST_BUF_LEN];
   char rst_url[TEST_BUF_LEN];
 
-  create_dummy_broker_kh(cfg, TEST_TS, TEST_TS_COUNT);
+  create_dummy_broker_index(cfg, TEST_TS, TEST_TS_COUNT);
   for (int i = 0; i < TEST_TS_COUNT; i++) {
-    cfg->cfg_broker.broker_khash_used++;
+    cfg->cfg_broker.index_used++;
     cfg_get_timestamps(cfg, TEST_TS[i], url);
     snprintf(testcase, sizeof(testcase), "#%i - %10" PRIu32 " - URL", i + 1,
              TEST_TS[i]);
@@ -287,6 +1396,47 @@ int test_rpki_config()
   CHECK_SUBSECTION("Import ROA dump file", 0,
                    !test_rpki_config_import_roa_file(cfg));
 
+  CHECK_SUBSECTION("Parsing of the fields of a ROA record", 0,
+                   !test_rpki_config_roa_parser_fields());
+
+  CHECK_SUBSECTION("Structural scanning of a ROA dump", 0,
+                   !test_rpki_config_roa_scan());
+
+  CHECK_SUBSECTION("Incremental parsing of a ROA dump", 0,
+                   !test_rpki_config_roa_parser());
+
+  CHECK_SUBSECTION("Parsing of a mapped ROA dump", 0,
+                   !test_rpki_config_roa_parser_mapped());
+
+  CHECK_SUBSECTION("Binary ROA snapshots", 0,
+                   !test_rpki_config_roa_snapshot(cfg));
+
+  CHECK_SUBSECTION("Local cache of ROA dumps", 0,
+                   !test_rpki_config_cache(cfg));
+
+  CHECK_SUBSECTION("Prefetch of the next epoch", 0,
+                   !test_rpki_config_prefetch());
+
+  CHECK_SUBSECTION("Previous epochs for out-of-order timestamps", 0,
+                   !test_rpki_config_epochs());
+
+  CHECK_SUBSECTION("Change feed of the ROA records", 0,
+                   !test_rpki_config_change_feed());
+
+  CHECK_SUBSECTION("Divergent records of the collectors", 0,
+                   !test_rpki_config_divergence());
+
+  CHECK_SUBSECTION("Shared prefix tables", 0,
+                   !test_rpki_config_shared_tables());
+
+  CHECK_SUBSECTION("Temporal ROA index", 0, !test_rpki_config_roa_index());
+
+  CHECK_SUBSECTION("Epoch images in shared memory", 0,
+                   !test_rpki_config_epoch_image());
+
+  CHECK_SUBSECTION("Partitioned import of ROA dump files", 0,
+                   !test_rpki_config_import_roa_files(cfg));
+
   CHECK_SUBSECTION("Validity check for prefix of a ROA record", 0,
                    !test_rpki_config_validity_check_prefix(cfg));
 
@@ -296,9 +1446,26 @@ int test_rpki_config()
   CHECK_SUBSECTION("Addition of a ROA record to the prefix table", 0,
                    !test_rpki_config_add_record_to_pfx_table());
 
+  CHECK_SUBSECTION("Minimization of a ROA set", 0,
+                   !test_rpki_config_minimize_roa_set());
+
+  CHECK_SUBSECTION("Differential lookup of the array backend", 0,
+                   !test_rpki_config_backend_differential(NULL));
+
+  arena_t arena;
+  arena_init(&arena, 0, 0);
+  CHECK_SUBSECTION("Differential lookup of the array backend (arena)", 0,
+                   !test_rpki_config_backend_differential(&arena));
+
+  CHECK_SUBSECTION("Delta update of a prefix table", 0,
+                   !test_rpki_config_backend_delta());
+
   CHECK_SUBSECTION("Next Timestamp Determination (skipped)", 0,
                    !test_rpki_config_next_timestamp(cfg));
 
+  CHECK_SUBSECTION("Next Timestamp Determination (epoch stride)", 0,
+                   !test_rpki_config_epoch_stride());
+
   CHECK_SUBSECTION("Current & Next Timestamp Determination", 0,
                    !test_rpki_config_get_timestamps(cfg));
 
@@ -92,6 +92,23 @@
     TEST_TS_1, TEST_TS_2, TEST_TS_5, TEST_TS_6                                 \
   }
 
+/** Testcases for the epoch stride and bucket (of TEST_TS) **/
+#define TEST_STRIDE 2
+#define TEST_STRIDE_BUCKET 540
+#define TEST_STRIDE_COUNT 3
+
+#define TEST_STRIDE_NTS                                                        \
+  (uint32_t[TEST_STRIDE_COUNT])                                                \
+  {                                                                            \
+    TEST_TS_3, TEST_TS_5, 0                                                    \
+  }
+
+#define TEST_BUCKET_NTS                                                        \
+  (uint32_t[TEST_STRIDE_COUNT])                                                \
+  {                                                                            \
+    TEST_TS_2, TEST_TS_5, 0                                                    \
+  }
+
 /** Testcases for the addition checks **/
 #define TEST_ADD_COUNT 5
 
@@ -299,6 +316,310 @@
   "12654,2001:7fb:fd02::/48,48\n"                                              \
   "196615,2001:7fb:fd03::/48,48\n"
 
+/** Testcases for the incremental ROA dump parser **/
+#define TEST_PARSER_COUNT 4
+
+#define TEST_PARSER_CSV                                                        \
+  "ASN,IP Prefix,Max Length,Trust Anchor\n"                                    \
+  "AS12654,93.175.146.0/24,24,ripe\r\n"                                        \
+  "196615,2001:7fb:fd03::/48,48,ripe\n"                                        \
+  "\n"                                                                         \
+  "AS3320,80.128.0.0/11,16,ripe\n"                                             \
+  "AS2792,80.128.0.0/11,11"
+
+#define TEST_PARSER_ASN                                                        \
+  (uint32_t[TEST_PARSER_COUNT])                                                \
+  {                                                                            \
+    12654, 196615, 3320, 2792                                                  \
+  }
+
+#define TEST_PARSER_MAXL                                                       \
+  (uint8_t[TEST_PARSER_COUNT])                                                 \
+  {                                                                            \
+    24, 48, 16, 11                                                             \
+  }
+
+/* Last character of the CSV (max length 11 -> 12) */
+#define TEST_PARSER_CHANGED_MAXL '2'
+
+#define TEST_PARSER_CORRUPT                                                    \
+  "ASN,IP Prefix,Max Length\nAS12654,93.175.146.0/24\n"
+
+/** Testcases for the ROA snapshots (of TEST_PARSER_CSV) **/
+#define TEST_SNAPSHOT_PATH "roafetchlib-test-config.snap"
+
+#define TEST_SNAPSHOT_COUNT                                                    \
+  (size_t[2])                                                                  \
+  {                                                                            \
+    3, 1                                                                       \
+  }
+
+#define TEST_SNAPSHOT_COUNT_80 2
+
+#define TEST_SNAPSHOT_FIRST_93 2
+
+/** Testcases for the mapped ROA dumps (TEST_PARSER_CSV as local file) **/
+#define TEST_MAPPED_PATH "roafetchlib-test-config.csv"
+
+#define TEST_MAPPED_GZIP "roafetchlib-test-config.csv.gz"
+
+/** Testcases for the local cache **/
+#define TEST_CACHE_DIR "roafetchlib-test-config.cache"
+
+#define TEST_CACHE_URLS                                                        \
+  (char *[2])                                                                  \
+  {                                                                            \
+    "http://localhost/CC01/vrp.1.csv", "http://localhost/CC01/vrp.2.csv"       \
+  }
+
+#define TEST_CACHE_JSON "{\"data\": {}}"
+
+/** Testcases for the prefetch (TEST_PARSER_CSV followed by a changed dump) **/
+#define TEST_PREFETCH_PJ_CC "FU-Berlin:CC01"
+
+#define TEST_PREFETCH_TIMEWDW "1493647200-1493647560"
+
+#define TEST_PREFETCH_TS                                                       \
+  (uint32_t[2])                                                                \
+  {                                                                            \
+    1493647200, 1493647380                                                     \
+  }
+
+#define TEST_PREFETCH_PATHS                                                    \
+  (char *[2])                                                                  \
+  {                                                                            \
+    "roafetchlib-test-config-CC01.1.csv", "roafetchlib-test-config-CC01.2.csv" \
+  }
+
+#define TEST_PREFETCH_CSV                                                      \
+  "ASN,IP Prefix,Max Length,Trust Anchor\n"                                    \
+  "AS3320,80.128.0.0/11,16,ripe\n"
+
+#define TEST_PREFETCH_PFX                                                      \
+  (char *[2])                                                                  \
+  {                                                                            \
+    "93.175.146.0", "80.128.0.0"                                               \
+  }
+
+/** Testcases for the previous epochs (alternating TEST_PREFETCH_PATHS) **/
+#define TEST_EPOCHS 1
+
+#define TEST_EPOCHS_COUNT 3
+
+#define TEST_EPOCHS_TIMEWDW "1493647200-1493647740"
+
+#define TEST_EPOCHS_TS                                                         \
+  (uint32_t[TEST_EPOCHS_COUNT])                                                \
+  {                                                                            \
+    1493647200, 1493647380, 1493647560                                         \
+  }
+
+/** Testcases for the change feed (alternating TEST_PREFETCH_PATHS) **/
+#define TEST_FEED_ADDED                                                        \
+  (size_t[TEST_EPOCHS_COUNT])                                                  \
+  {                                                                            \
+    4, 0, 3                                                                    \
+  }
+
+#define TEST_FEED_REMOVED                                                      \
+  (size_t[TEST_EPOCHS_COUNT])                                                  \
+  {                                                                            \
+    0, 3, 0                                                                    \
+  }
+
+/** Testcases for the divergent records (TEST_PARSER_CSV, TEST_PREFETCH_CSV
+    and a collector without a ROA dump) **/
+#define TEST_DIVERGENCE_COLLECTORS 3
+
+#define TEST_DIVERGENCE_ACTIVE                                                 \
+  (int[TEST_DIVERGENCE_COLLECTORS])                                            \
+  {                                                                            \
+    1, 1, 0                                                                    \
+  }
+
+#define TEST_DIVERGENCE_COUNT 3
+
+#define TEST_DIVERGENCE_MASK 0x1
+
+#define TEST_DIVERGENCE_COUNT_ALL 4
+
+/** Testcases for the shared prefix tables (TEST_PREFETCH_PATHS) **/
+#define TEST_SHARED_CONFIGS 3
+
+/** Testcases for the epoch images (TEST_PREFETCH_PATHS) **/
+#define TEST_IMAGE_SHM_DIR "."
+
+#define TEST_IMAGE_SHM_COUNT "1"
+
+/** Testcases for the temporal ROA index (TEST_PARSER_CSV, TEST_PREFETCH_CSV,
+    a missing ROA dump and TEST_PARSER_CSV again) **/
+#define TEST_INDEX_PATH "roafetchlib-test-config.rix"
+
+#define TEST_INDEX_COUNT 4
+
+#define TEST_INDEX_TS                                                          \
+  (uint32_t[TEST_INDEX_COUNT])                                                 \
+  {                                                                            \
+    1493647200, 1493647380, 1493647560, 1493647740                             \
+  }
+
+#define TEST_INDEX_STATE                                                       \
+  (enum pfxv_state[TEST_INDEX_COUNT])                                          \
+  {                                                                            \
+    BGP_PFXV_STATE_VALID, BGP_PFXV_STATE_NOT_FOUND,                            \
+      BGP_PFXV_STATE_NOT_FOUND, BGP_PFXV_STATE_VALID                           \
+  }
+
+#define TEST_INDEX_ACTIVE                                                      \
+  (int[TEST_INDEX_COUNT])                                                      \
+  {                                                                            \
+    1, 1, 0, 1                                                                 \
+  }
+
+#define TEST_INDEX_INTERVALS 2
+
+/** Testcases for the field parsers (addresses are compared with inet_pton) **/
+#define TEST_FIELD_ADDR_COUNT 24
+
+#define TEST_FIELD_ADDR                                                        \
+  (char * [TEST_FIELD_ADDR_COUNT])                                             \
+  {                                                                            \
+    "0.0.0.0", "255.255.255.255", "93.175.146.0", "256.1.1.1", "1.2.3",        \
+      "1.2.3.4.5", "01.2.3.4", "1..2.3", "1.2.3.", "::", "::1", "1::",         \
+      "2001:7fb:fd03::", "2001:db8::1:0:0:1", "1:2:3:4:5:6:7:8",               \
+      "::ffff:80.128.0.1", "1:2:3:4:5:6:7:8:9", "1:2:3:4:5:6:7::8", ":1::",    \
+      "1:::2", "12345::", "1::2::3", "g::", "1:"                               \
+  }
+
+#define TEST_FIELD_ASN_COUNT 6
+
+#define TEST_FIELD_ASN                                                         \
+  (char * [TEST_FIELD_ASN_COUNT])                                              \
+  {                                                                            \
+    "AS718", "718", "4294967295", "4294967296", "AS", "AS-1"                   \
+  }
+
+#define TEST_FIELD_ASN_RST                                                     \
+  (int64_t[TEST_FIELD_ASN_COUNT])                                              \
+  {                                                                            \
+    718, 718, 4294967295, -1, -1, -1                                           \
+  }
+
+#define TEST_FIELD_PFX_COUNT 5
+
+#define TEST_FIELD_PFX                                                         \
+  (char * [TEST_FIELD_PFX_COUNT])                                              \
+  {                                                                            \
+    "80.128.0.0/11", "2001:7fb:fd02::/128", "80.128.0.0/33",                   \
+      "2001:7fb:fd02::/129", "80.128.0.0/"                                     \
+  }
+
+#define TEST_FIELD_PFX_RST                                                     \
+  (int[TEST_FIELD_PFX_COUNT])                                                  \
+  {                                                                            \
+    11, 128, -1, -1, -1                                                        \
+  }
+
+/** Testcases for the partitioned import **/
+#define TEST_PART_THREADS 2
+#define TEST_PART_COUNT 6
+
+#define TEST_PART_ASN                                                          \
+  (uint32_t[TEST_PART_COUNT])                                                  \
+  {                                                                            \
+    3320, 3320, 12654, 1, 12654, 1                                             \
+  }
+
+#define TEST_PART_PFX                                                          \
+  (char * [TEST_PART_COUNT])                                                   \
+  {                                                                            \
+    "80.128.0.0", "80.130.0.0", "93.175.146.0", "93.175.146.0",                \
+      "2001:7fb:fd02::", "10.0.0.0"                                            \
+  }
+
+#define TEST_PART_MSKL                                                         \
+  (uint8_t[TEST_PART_COUNT])                                                   \
+  {                                                                            \
+    11, 16, 24, 24, 48, 8                                                      \
+  }
+
+#define TEST_PART_RST                                                          \
+  (enum pfxv_state[TEST_PART_COUNT])                                           \
+  {                                                                            \
+    BGP_PFXV_STATE_VALID, BGP_PFXV_STATE_INVALID, BGP_PFXV_STATE_VALID,        \
+      BGP_PFXV_STATE_INVALID, BGP_PFXV_STATE_VALID, BGP_PFXV_STATE_NOT_FOUND   \
+  }
+
+#define TEST_PART_V6_CSV                                                       \
+  "ASN,IP Prefix,Max Length,Trust Anchor\n"                                    \
+  "AS3333,2001:67c:2e8::/48,48,ripe\n"                                         \
+  "AS15169,2a00:1450::/32,48,ripe\n"                                           \
+  "AS3320,2003::/19,48,ripe\n"                                                 \
+  "AS13335,2400:cb00::/32,48,apnic\n"                                          \
+  "AS7018,2600:1700::/28,48,arin\n"                                            \
+  "AS28000,2801:10::/32,48,lacnic\n"                                           \
+  "AS37100,2c0f:fe08::/32,48,afrinic\n"
+
+/** Testcases for the ROA set minimization **/
+#define TEST_MIN_COUNT 8
+#define TEST_MIN_RST_COUNT 4
+
+#define TEST_MIN_ASN                                                           \
+  (uint32_t[TEST_MIN_COUNT])                                                   \
+  {                                                                            \
+    100, 100, 100, 200, 300, 300, 300, 300                                     \
+  }
+
+#define TEST_MIN_PFX                                                           \
+  (char * [TEST_MIN_COUNT])                                                    \
+  {                                                                            \
+    "10.0.0.0/8", "10.1.0.0/16", "10.0.0.0/8", "10.1.0.0/16",                  \
+      "192.168.0.0/16", "192.168.0.0/17", "192.168.128.0/17",                  \
+      "2001:db8::/32"                                                          \
+  }
+
+#define TEST_MIN_MAXL                                                          \
+  (uint8_t[TEST_MIN_COUNT])                                                    \
+  {                                                                            \
+    16, 16, 8, 24, 16, 24, 24, 48                                              \
+  }
+
+#define TEST_MIN_VAL_COUNT 10
+
+#define TEST_MIN_VAL_ASN                                                       \
+  (uint32_t[TEST_MIN_VAL_COUNT])                                               \
+  {                                                                            \
+    100, 100, 200, 100, 300, 300, 300, 300, 300, 100                           \
+  }
+
+#define TEST_MIN_VAL_PFX                                                       \
+  (char * [TEST_MIN_VAL_COUNT])                                                \
+  {                                                                            \
+    "10.1.0.0", "10.1.0.0", "10.1.0.0", "10.0.0.0", "192.168.0.0",             \
+      "192.168.0.0", "192.168.0.0", "192.168.0.0", "2001:db8::", "11.0.0.0"    \
+  }
+
+#define TEST_MIN_VAL_MSKL                                                      \
+  (uint8_t[TEST_MIN_VAL_COUNT])                                                \
+  {                                                                            \
+    16, 20, 20, 8, 16, 24, 25, 15, 48, 8                                       \
+  }
+
+#define TEST_MIN_VAL_RST                                                       \
+  (enum pfxv_state[TEST_MIN_VAL_COUNT])                                        \
+  {                                                                            \
+    BGP_PFXV_STATE_VALID, BGP_PFXV_STATE_INVALID, BGP_PFXV_STATE_VALID,        \
+      BGP_PFXV_STATE_VALID, BGP_PFXV_STATE_VALID, BGP_PFXV_STATE_VALID,        \
+      BGP_PFXV_STATE_INVALID, BGP_PFXV_STATE_NOT_FOUND, BGP_PFXV_STATE_VALID,  \
+      BGP_PFXV_STATE_NOT_FOUND                                                 \
+  }
+
+/** Testcases for the delta update (previous and next records of TEST_MIN) **/
+#define TEST_DELTA_PREV_COUNT 4
+#define TEST_DELTA_NEXT_FIRST 2
+#define TEST_DELTA_ADDED 4
+#define TEST_DELTA_REMOVED 2
+
 /** Testcases for the input to config addition **/
 #define TEST_ADD_INP_COUNT 5
 
@@ -73,8 +73,10 @@ int test_rpki_validation_status(rpki_cfg_t *cfg, char *result)
     config_input_t *input = &cfg->cfg_input;
 
     snprintf(testcase, sizeof(testcase), "BGP Beacon #%i - ", j + 1);
+    struct lrtr_ip_addr addr;
+    roa_parser_addr(TEST_PFX[j], strlen(TEST_PFX[j]), &addr);
     for (int i = 0; i < cfg->cfg_val.pfxt_count; i++) {
-      elem_get_rpki_validation_result(cfg, NULL, elem, TEST_PFX[j],
+      elem_get_rpki_validation_result(cfg, NULL, elem, &addr,
                                       TEST_O_ASN[j], TEST_MSKL[j],
                                       &cfg->cfg_val.pfxt[i], i);
     }
@@ -117,8 +119,10 @@ int test_rpki_validation_output(rpki_cfg_t *cfg, char *result)
     config_input_t *input = &cfg->cfg_input;
     snprintf(testcase, sizeof(testcase), "BGP Beacon #%i", j + 1);
 
+    struct lrtr_ip_addr addr;
+    roa_parser_addr(TEST_PFX[j], strlen(TEST_PFX[j]), &addr);
     for (int i = 0; i < cfg->cfg_val.pfxt_count; i++) {
-      elem_get_rpki_validation_result(cfg, NULL, elem, TEST_PFX[j],
+      elem_get_rpki_validation_result(cfg, NULL, elem, &addr,
                                       TEST_O_ASN[j], TEST_MSKL[j],
                                       &cfg->cfg_val.pfxt[i], i);
     }
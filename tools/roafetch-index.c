@@ -0,0 +1,305 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "roafetchlib.h"
+
+/** Maximum number of ROA dumps of a local directory */
+#define INDEX_MAX_DUMPS 1048576
+
+/** A ROA dump of a collector at a timestamp */
+typedef struct struct_index_dump_t {
+
+  /** Timestamp of the ROA dump */
+  uint32_t timestamp;
+
+  /** Path to the ROA dump (local file or URL) */
+  char *path;
+
+} index_dump_t;
+
+/* Collect the records of a ROA dump */
+static int index_record(const roa_record_t *record, void *data)
+{
+  return roa_set_add((roa_set_t *)data, record);
+}
+
+static int index_dump_cmp(const void *a, const void *b)
+{
+  const index_dump_t *x = a, *y = b;
+  return x->timestamp == y->timestamp ? 0
+                                      : (x->timestamp < y->timestamp ? -1 : 1);
+}
+
+static void index_usage(const char *name)
+{
+  fprintf(stderr,
+          "Usage: %s -o <index> -d <PJ:CC>=<directory> [-d ...]\n"
+          "       %s -o <index> -c <PJ:CC;...> -w <start-end> [-u <url>]\n"
+          "       %s -v <index>\n"
+          "  -d  Local directory of ROA dumps of a collector\n"
+          "  -c  Projects and collectors of the broker\n"
+          "  -w  Time window of the ROA dumps of the broker\n"
+          "  -u  Broker URL (default broker if not set)\n"
+          "  -v  Verify an index and print its header\n",
+          name, name, name);
+}
+
+/* Get the timestamp of a ROA dump from its name (vrp.YYYYMMDD.HHMM...) */
+static int index_timestamp(const char *name, uint32_t *timestamp)
+{
+  const char *digits = "0123456789";
+  for (const char *p = name; *p; p++) {
+    if (strspn(p, digits) != 8 || p[8] != '.' || strspn(p + 9, digits) < 4) {
+      continue;
+    }
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(p, "%4d%2d%2d.%2d%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min) != 5) {
+      return -1;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    *timestamp = (uint32_t)timegm(&tm);
+    return 0;
+  }
+  return -1;
+}
+
+/* Parse a ROA dump and add it to the index */
+static int index_add_dump(roa_index_builder_t *builder, int collector,
+                          uint32_t timestamp, char *path)
+{
+  roa_set_t set;
+  if (roa_set_init(&set) != 0) {
+    return -1;
+  }
+  size_t records = 0;
+  if (roa_parser_read(path, index_record, &set, &records, NULL) != 0) {
+    roa_set_free(&set);
+    return -1;
+  }
+  printf("%s: %" PRIu32 ", %zu records\n", path, timestamp, records);
+  return roa_index_builder_add(builder, collector, timestamp, &set);
+}
+
+/* Add all ROA dumps of a local directory of a collector (PJ:CC=<directory>) */
+static int index_add_directory(roa_index_builder_t *builder, char *arg)
+{
+  char *dir_path = strchr(arg, '=');
+  if (dir_path == NULL) {
+    fprintf(stderr, "Error: Invalid collector directory %s\n", arg);
+    return -1;
+  }
+  *dir_path++ = '\0';
+  int collector = roa_index_builder_collector(builder, arg);
+  DIR *dir = opendir(dir_path);
+  if (collector < 0 || dir == NULL) {
+    fprintf(stderr, "Error: Could not read the directory %s\n", dir_path);
+    if (dir != NULL) {
+      closedir(dir);
+    }
+    return -1;
+  }
+
+  /* ROA dumps are added in chronological order */
+  index_dump_t *dumps = NULL;
+  size_t count = 0, size = 0;
+  struct dirent *entry;
+  int ret = 0;
+  while ((entry = readdir(dir)) != NULL && !ret) {
+    uint32_t timestamp;
+    if (entry->d_name[0] == '.' ||
+        index_timestamp(entry->d_name, &timestamp) != 0) {
+      continue;
+    }
+    if (count == size) {
+      index_dump_t *tmp = NULL;
+      size = size ? 2 * size : 64;
+      if (size > INDEX_MAX_DUMPS ||
+          (tmp = realloc(dumps, size * sizeof(index_dump_t))) == NULL) {
+        fprintf(stderr, "Error: Too many ROA dumps in %s\n", dir_path);
+        ret = -1;
+        break;
+      }
+      dumps = tmp;
+    }
+    size_t len = strlen(dir_path) + strlen(entry->d_name) + 2;
+    if ((dumps[count].path = malloc(len)) == NULL) {
+      ret = -1;
+      break;
+    }
+    snprintf(dumps[count].path, len, "%s/%s", dir_path, entry->d_name);
+    dumps[count++].timestamp = timestamp;
+  }
+  closedir(dir);
+  if (dumps != NULL) {
+    qsort(dumps, count, sizeof(index_dump_t), index_dump_cmp);
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (!ret) {
+      ret = index_add_dump(builder, collector, dumps[i].timestamp,
+                           dumps[i].path);
+    }
+    free(dumps[i].path);
+  }
+  free(dumps);
+  return ret;
+}
+
+/* Add all ROA dumps of the broker for collectors and a time window */
+static int index_add_broker(roa_index_builder_t *builder, char *collectors,
+                            char *window, char *broker_url)
+{
+  rpki_cfg_t *cfg = cfg_create(collectors, window, 0, 1, broker_url, NULL);
+  if (cfg == NULL) {
+    return -1;
+  }
+  config_input_t *input = &cfg->cfg_input;
+  config_broker_t *broker = &cfg->cfg_broker;
+  if (broker_connect(cfg, input->broker_collectors, input->broker_intervals) !=
+      0 || !broker->index.count) {
+    fprintf(stderr, "%s", "Error: No ROA dumps of the broker\n");
+    cfg_destroy(cfg);
+    return -1;
+  }
+
+  /* The ROA dumps of all timestamps are added in chronological order (the
+     order of the broker index), the URLs of a timestamp are ordered like the
+     collectors (empty if the collector has no ROA dump) */
+  broker_index_t *index = &broker->index;
+  char urls[BROKER_ROA_URLS_LEN];
+  int ret = 0;
+  for (size_t i = 0; i < index->count && !ret; i++) {
+    char *end_url, *url = NULL;
+    char name[ROA_INDEX_NAME_LEN];
+    ret = broker_index_urls(index, i, urls, sizeof(urls));
+    if (!ret) {
+      url = strtok_r(urls, ",", &end_url);
+    }
+    for (int c = 0; url != NULL && c < input->collectors_count && !ret; c++) {
+      if (strlen(url) > 1) {
+        snprintf(name, sizeof(name), "%s:%s", input->projects[c],
+                 input->collectors[c]);
+        int collector = roa_index_builder_collector(builder, name);
+        ret = (collector < 0 ||
+               index_add_dump(builder, collector, index->entries[i].timestamp,
+                              url));
+      }
+      url = strtok_r(NULL, ",", &end_url);
+    }
+  }
+  cfg_destroy(cfg);
+  return ret;
+}
+
+/* Verify an index (header, section bounds, references and checksum) */
+static int index_verify(const char *index_path)
+{
+  roa_index_t index;
+  if (roa_index_open(&index, index_path) != 0) {
+    return -1;
+  }
+  const roa_index_header_t *header = index.header;
+  printf("%s: version %" PRIu32 ", %" PRIu64 " bytes\n", index_path,
+         header->version, header->size);
+  printf("  Interval:     %" PRIu32 "-%" PRIu32 "\n", header->start,
+         header->end);
+  printf("  IPv4 records: %" PRIu64 "\n", header->count[ROA_IPV4]);
+  printf("  IPv6 records: %" PRIu64 "\n", header->count[ROA_IPV6]);
+  printf("  Intervals:    %" PRIu64 "\n", header->interval_count);
+  for (uint32_t c = 0; c < header->collectors; c++) {
+    printf("  Collector:    %s (%" PRIu32 " intervals)\n",
+           index.collectors[c].name, index.collectors[c].count);
+  }
+  printf("  Checksum:     %016" PRIx64 "\n", header->checksum);
+  roa_index_close(&index);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  roa_index_builder_t builder;
+  roa_index_builder_init(&builder);
+  char *out = NULL, *collectors = NULL, *window = NULL, *broker_url = NULL;
+  char *verify = NULL;
+  int ret = 0, dirs = 0, opt;
+  while ((opt = getopt(argc, argv, "o:d:c:w:u:v:h")) != -1 && !ret) {
+    switch (opt) {
+    case 'o':
+      out = optarg;
+      break;
+    case 'd':
+      ret = index_add_directory(&builder, optarg);
+      dirs++;
+      break;
+    case 'c':
+      collectors = optarg;
+      break;
+    case 'w':
+      window = optarg;
+      break;
+    case 'u':
+      broker_url = optarg;
+      break;
+    case 'v':
+      verify = optarg;
+      break;
+    default:
+      index_usage(argv[0]);
+      roa_index_builder_free(&builder);
+      return opt == 'h' ? 0 : -1;
+    }
+  }
+
+  if (!ret && verify != NULL && out == NULL && !dirs && collectors == NULL) {
+    ret = index_verify(verify);
+  } else if (!ret && out != NULL && verify == NULL &&
+             (dirs || (collectors != NULL && window != NULL))) {
+    if (collectors != NULL) {
+      ret = index_add_broker(&builder, collectors, window, broker_url);
+    }
+    if (!ret && (ret = roa_index_builder_write(&builder, out)) == 0) {
+      printf("Index written to %s\n", out);
+    }
+  } else if (!ret) {
+    index_usage(argv[0]);
+    ret = -1;
+  }
+  roa_index_builder_free(&builder);
+  return ret == 0 ? 0 : -1;
+}
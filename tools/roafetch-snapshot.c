@@ -0,0 +1,118 @@
+/*
+ * This file is part of ROAFetchlib
+ *
+ * Author: Samir Al-Sheikh (Freie Universitaet, Berlin)
+ *         s.al-sheikh@fu-berlin.de
+ *
+ * MIT License
+ *
+ * Copyright (c) 2017 The ROAFetchlib authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "roafetchlib.h"
+
+/* Collect the records of a ROA dump */
+static int snapshot_record(const roa_record_t *record, void *data)
+{
+  return roa_set_add((roa_set_t *)data, record);
+}
+
+static void snapshot_usage(const char *name)
+{
+  fprintf(stderr,
+          "Usage: %s [-n] <ROA dump> <snapshot>\n"
+          "       %s -v <snapshot>\n"
+          "  -n  Do not write the index section\n"
+          "  -v  Verify a snapshot and print its header\n",
+          name, name);
+}
+
+/* Convert a ROA dump (CSV, local file or URL) into a snapshot */
+static int snapshot_convert(char *dump_path, const char *snap_path, int index)
+{
+  roa_set_t set;
+  if (roa_set_init(&set) != 0) {
+    return -1;
+  }
+  size_t records = 0;
+  uint64_t hash = 0;
+  if (roa_parser_read(dump_path, snapshot_record, &set, &records, &hash) != 0 ||
+      roa_snapshot_write(snap_path, &set, hash, index) != 0) {
+    roa_set_free(&set);
+    return -1;
+  }
+  printf("%s: %zu records, %zu unique records written to %s\n", dump_path,
+         records, set.count, snap_path);
+  roa_set_free(&set);
+  return 0;
+}
+
+/* Verify a snapshot (header, section bounds and checksum) */
+static int snapshot_verify(const char *snap_path)
+{
+  roa_snapshot_t snap;
+  if (roa_snapshot_open(&snap, snap_path) != 0) {
+    return -1;
+  }
+  printf("%s: version %" PRIu32 ", %" PRIu64 " bytes, %s\n", snap_path,
+         snap.header->version, snap.header->size,
+         snap.map != NULL ? "mapped" : "read into memory");
+  printf("  IPv4 records: %" PRIu64 "\n", snap.header->count[ROA_IPV4]);
+  printf("  IPv6 records: %" PRIu64 "\n", snap.header->count[ROA_IPV6]);
+  printf("  Index:        %s\n", snap.index != NULL ? "yes" : "no");
+  printf("  Dump hash:    %016" PRIx64 "\n", snap.header->hash);
+  printf("  Checksum:     %016" PRIx64 "\n", snap.header->checksum);
+  roa_snapshot_close(&snap);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  int index = 1, verify = 0, opt;
+  while ((opt = getopt(argc, argv, "nvh")) != -1) {
+    switch (opt) {
+    case 'n':
+      index = 0;
+      break;
+    case 'v':
+      verify = 1;
+      break;
+    default:
+      snapshot_usage(argv[0]);
+      return opt == 'h' ? 0 : -1;
+    }
+  }
+
+  if (verify && argc - optind == 1) {
+    return snapshot_verify(argv[optind]) == 0 ? 0 : -1;
+  }
+  if (!verify && argc - optind == 2) {
+    return snapshot_convert(argv[optind], argv[optind + 1], index) == 0 ? 0
+                                                                        : -1;
+  }
+  snapshot_usage(argv[0]);
+  return -1;
+}